@@ -20,6 +20,9 @@ public:
     std::string getParameterDisplayString() const;
     void display() const;
 
+    // hash of the model, image size, intrinsics and extrinsics, equal cameras have equal fingerprints
+    uint64_t fingerprint() const;
+
     // getter for accessing image size
     std::vector<int> getImageSize() const;
     void setImageSize(std::vector<int> image_size);
@@ -30,11 +33,11 @@ public:
     virtual const std::string getModelName() const = 0;
     virtual std::shared_ptr<Pinhole> getPinhole() const = 0;
 
-    // Multiple Array projects
-    std::vector<Point2> project(const std::vector<Point3>& points_3d) const;
-    std::vector<std::vector<Point2>> project(const std::vector<std::vector<Point3>>& points_3d1) const;
-    std::vector<std::vector<std::array<double, 3>>> backproject(const std::vector<std::vector<double>>& image) const;
-    std::vector<Point3> backproject(const std::vector<Point2>& points_2d) const;
+    // Multiple Array projects, run in parallel on the executor
+    std::vector<Point2> project(const std::vector<Point3>& points_3d, const Executor& executor = Executor::current()) const;
+    std::vector<std::vector<Point2>> project(const std::vector<std::vector<Point3>>& points_3d1, const Executor& executor = Executor::current()) const;
+    std::vector<std::vector<std::array<double, 3>>> backproject(const std::vector<std::vector<double>>& image, const Executor& executor = Executor::current()) const;
+    std::vector<Point3> backproject(const std::vector<Point2>& points_2d, const Executor& executor = Executor::current()) const;
 
     // Getters for extrinsic parameters
     const Point3 getTranslation() const { return translation; }
@@ -24,9 +24,19 @@
 
 #include "utilities/common_math.h"
 #include "utilities/utils.h"
+#include "utilities/image.h"
+#include "utilities/cpu_features.h"
+#include "utilities/executor.h"
 #include "external/nlohmann/json.hpp"
 
 #include "remapper/remapper.h"
+#include "remapper/pixel_transform.h"
+#include "remapper/remap_kernels.h"
+#include "remapper/map_cache.h"
+#include "remapper/remap_stream.h"
+#include "remapper/remap_pyramid.h"
+#include "remapper/stereo_remapper.h"
+#include "remapper/panorama_stitcher.h"
 
 #include "camera/camera.h"
 #include "camera/pinhole.h"
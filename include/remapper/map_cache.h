@@ -0,0 +1,27 @@
+#ifndef MAP_CACHE_H
+#define MAP_CACHE_H
+
+#include <string>
+#include <cstdint>
+#include "remapper/remap_map.h"
+
+/**
+ * @brief Versioned binary file format for RemapMap, loaded with memory mapping.
+ *
+ * A cache file holds a fixed header followed by the two coordinate planes of the map, each
+ * aligned to 64 bytes. Loading maps the file read-only and points the map directly at the
+ * mapped pages, so processes loading the same file share one page cache copy. Files store
+ * values in host byte order and are rejected on a host with a different byte order, on a
+ * version mismatch or when the key differs from the expected one.
+ */
+class MapCache {
+public:
+    // incremented whenever the file layout or the meaning of a map changes
+    static const uint32_t VERSION = 3;
+
+    static void save(const RemapMap& map, const std::string& filename, uint64_t key);
+    static RemapMap load(const std::string& filename, uint64_t key);
+    static bool tryLoad(const std::string& filename, uint64_t key, RemapMap& map);
+};
+
+#endif // MAP_CACHE_H
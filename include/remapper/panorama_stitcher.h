@@ -0,0 +1,88 @@
+#ifndef PANORAMA_STITCHER_H
+#define PANORAMA_STITCHER_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "camera/camera.h"
+#include "utilities/executor.h"
+#include "utilities/image.h"
+
+// Mapping of the panorama pixels to directions in the rig frame, x right, y down and z forward
+enum class PanoramaProjection {
+    Equirectangular,    // columns linear in longitude, rows linear in latitude
+    Cylindrical         // columns linear in longitude, rows linear in height on the unit cylinder
+};
+
+// Construction options of a PanoramaStitcher
+struct PanoramaOptions {
+    PanoramaProjection projection = PanoramaProjection::Equirectangular;
+    int width = 2048;                                   // size of the panorama
+    int height = 1024;
+    double horizontal_fov = 2 * 3.14159265358979323846; // longitudes covered by the columns in radians, centered on the z axis
+    double vertical_fov = 3.14159265358979323846;       // latitudes covered by the rows in radians, centered on the horizon, below pi for Cylindrical
+    std::shared_ptr<Executor> executor;                 // builds the blend table and stitches, nullptr for Executor::current() of the calling thread
+};
+
+// Contribution of one camera to a panorama pixel
+struct BlendSample {
+    float x, y;         // source coordinate in the image of the camera
+    float weight;       // blend weight, the weights of a pixel sum to 1
+    int32_t camera;     // index of the camera
+};
+
+/**
+ * @brief Stitches the frames of a camera rig into a panorama in a single pass over the output.
+ *
+ * The constructor computes a blend table holding, for every panorama pixel, the cameras that see
+ * its direction, the source coordinates in their images and the blend weights. A stitch call then
+ * samples the frames of all cameras bilinearly at those coordinates and writes the weighted sums
+ * directly, without remapping every camera into an image of its own first.
+ *
+ * The directions of the panorama pixels are rotated into each camera with the rotation of its
+ * extrinsics, the translations are ignored, so the panorama is exact for distant scenes. A camera
+ * contributes to a pixel when the direction projects into its image and backprojects to the same
+ * direction, which rejects directions beyond the field of view of the model. The weights fall off
+ * linearly with the distance of the source coordinate to the border of the image, so overlapping
+ * cameras fade into each other instead of leaving seams. Pixels seen by no camera are zero.
+ */
+class PanoramaStitcher {
+public:
+    PanoramaStitcher(const std::vector<std::shared_ptr<Camera>>& cameras, const PanoramaOptions& options = PanoramaOptions());
+
+    // stitch one frame per camera, in the order of the cameras, into a newly allocated panorama with the layout of the first frame
+    Image<double> stitch(const std::vector<ImageView<const double>>& frames) const;
+    Image<uint8_t> stitch(const std::vector<ImageView<const uint8_t>>& frames) const;
+    Image<uint16_t> stitch(const std::vector<ImageView<const uint16_t>>& frames) const;
+    // stitch into a caller-owned panorama of the panorama size with the channel count of the frames
+    void stitchInto(const std::vector<ImageView<const double>>& frames, const ImageView<double>& output) const;
+    void stitchInto(const std::vector<ImageView<const uint8_t>>& frames, const ImageView<uint8_t>& output) const;
+    void stitchInto(const std::vector<ImageView<const uint16_t>>& frames, const ImageView<uint16_t>& output) const;
+
+    int width() const { return options.width; }
+    int height() const { return options.height; }
+    size_t cameraCount() const { return cameras.size(); }
+    // direction of a panorama pixel in the rig frame
+    Point3 direction(double x, double y) const;
+    // contributions to a panorama pixel
+    std::vector<BlendSample> samples(int x, int y) const;
+    size_t memoryUsage() const;
+
+private:
+    template <typename T>
+    void run(const std::vector<ImageView<const T>>& frames, const ImageView<T>& output) const;
+    template <typename T>
+    Image<T> allocate(const std::vector<ImageView<const T>>& frames) const;
+    const Executor& getExecutor() const { return options.executor ? *options.executor : Executor::current(); }
+
+    std::vector<std::shared_ptr<Camera>> cameras;
+    std::vector<std::array<int, 2>> image_sizes;
+    PanoramaOptions options;
+
+    // samples of pixel i are blend[start[i]] up to blend[start[i + 1]], pixels in row-major order
+    std::vector<uint32_t> start;
+    std::vector<BlendSample> blend;
+};
+
+#endif // PANORAMA_STITCHER_H
@@ -0,0 +1,51 @@
+#ifndef PIXEL_TRANSFORM_H
+#define PIXEL_TRANSFORM_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "utilities/common_math.h"
+
+/**
+ * @brief Projective transform of pixel coordinates from an input image onto an output image.
+ *
+ * The homography maps the input pixel (x, y, 1) to the output pixel H * (x, y, 1) up to scale,
+ * with pixel centers on integer coordinates. Crops, resizes, flips and quarter turns are exact
+ * special cases. A transform composed with a Remapper is folded into its maps, so the image is
+ * resampled once for the whole chain (see the composing constructors of Remapper).
+ */
+class PixelTransform {
+public:
+    PixelTransform(const Matrix3x3& homography, int width, int height);
+
+    // 2x3 matrix applied to (x, y, 1)
+    static PixelTransform affine(const std::array<std::array<double, 3>, 2>& matrix, int width, int height);
+    // window of width x height input pixels starting at (x, y)
+    static PixelTransform crop(int x, int y, int width, int height);
+    // scales the input image to width x height, aligning the outer pixel edges
+    static PixelTransform resize(int input_width, int input_height, int width, int height);
+    static PixelTransform flip(bool horizontal, bool vertical, int input_width, int input_height);
+    // clockwise quarter turns as displayed with y pointing down, odd turns swap width and height
+    static PixelTransform rotate90(int quarter_turns, int input_width, int input_height);
+
+    // this transform followed by next
+    PixelTransform then(const PixelTransform& next) const;
+
+    const Matrix3x3& matrix() const { return H; }
+    const Matrix3x3& inverse() const { return H_inv; }
+    int width() const { return output_width; }
+    int height() const { return output_height; }
+    uint64_t fingerprint() const;
+
+    // input pixels to output pixels and back, points mapped to infinity or behind the projection are NaN
+    std::vector<std::array<double, 2>> forward(const std::vector<std::array<double, 2>>& input_pixels) const;
+    std::vector<std::array<double, 2>> backward(const std::vector<std::array<double, 2>>& output_pixels) const;
+
+private:
+    Matrix3x3 H;
+    Matrix3x3 H_inv;
+    int output_width;
+    int output_height;
+};
+
+#endif // PIXEL_TRANSFORM_H
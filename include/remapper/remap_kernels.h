@@ -0,0 +1,169 @@
+#ifndef REMAP_KERNELS_H
+#define REMAP_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include "utilities/common_math.h"
+#include "utilities/image.h"
+
+// The vectorized backends are compiled on x86 with per-function target attributes, so the rest of
+// the library keeps the baseline instruction set and the backend is chosen at runtime.
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && !defined(PIXELTRAQ_DISABLE_SIMD)
+#define PIXELTRAQ_HAVE_SSE41
+#define PIXELTRAQ_HAVE_AVX2
+#define PIXELTRAQ_HAVE_AVX512
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PIXELTRAQ_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PIXELTRAQ_TARGET(isa)
+#endif
+
+// Instruction set used by the remap kernels
+enum class RemapBackend {
+    Auto,       // best backend supported by the running processor
+    Scalar,     // portable reference implementation
+    SSE41,
+    AVX2,
+    AVX512
+};
+
+/**
+ * @brief Table of row kernels implementing the remap inner loops for one instruction set.
+ *
+ * Every kernel processes count consecutive output pixels of all channels of the image. The map
+ * is read and the taps and weights are computed once per pixel, then applied to every channel,
+ * so color images cost little more than a single channel. The image may use any layout or
+ * stride; the output pixels are out_stride elements apart and their channels out_channel_stride
+ * elements. All backends produce results identical to the Scalar backend, which in turn matches
+ * CommonMath::bilinearInterpolate. The interior variants may only be fed pixels classified as
+ * PixelClass::Interior by the map.
+ *
+ * Kernels with a float output interpolate in single precision and convert every tap as it is
+ * read, so 8-bit and 16-bit images are remapped into float without a conversion pass.
+ *
+ * The homography entry computes the source coordinates of a span of a Homography map instead of
+ * sampling an image, see RemapMap::homographySpan.
+ *
+ * Only some entries have vectorized versions, the other entries of every table are the Scalar kernels:
+ *
+ *   entries                                      SSE41   AVX2   AVX512   (output pixels per iteration)
+ *   bilinearDouble, bilinearDoubleInterior       2       8      8
+ *   fixedPointU8/U16, fixedPointInteriorU8/U16   4       8      16
+ *   bilinearFloat, bilinearU8Float,              4       8      8 (the AVX2 kernels)
+ *   bilinearU16Float and their interior variants
+ *   homographySpan                               2       4      8
+ *
+ * Nearest, Bicubic and Area sampling therefore run at the same speed on every backend.
+ */
+struct RemapKernels {
+    // Float64 map, double image
+    using BilinearDouble = void (*)(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    // FixedPoint map, integer images
+    using FixedPointU8 = void (*)(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint8_t>& image, uint8_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using FixedPointU16 = void (*)(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint16_t>& image, uint16_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+
+    // Float64 or Float32 coordinates, float output from float, 8-bit or 16-bit images
+    using BilinearFloat = void (*)(const double* X, const double* Y, int count, const ImageView<const float>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using BilinearU8Float = void (*)(const double* X, const double* Y, int count, const ImageView<const uint8_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using BilinearU16Float = void (*)(const double* X, const double* Y, int count, const ImageView<const uint16_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+
+    // Nearest sampling from linear source pixel indices, -1 outside the source
+    using NearestDouble = void (*)(const int32_t* index, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using NearestU8 = void (*)(const int32_t* index, int count, const ImageView<const uint8_t>& image, uint8_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using NearestU16 = void (*)(const int32_t* index, int count, const ImageView<const uint16_t>& image, uint16_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using NearestFloat = void (*)(const int32_t* index, int count, const ImageView<const float>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using NearestU8Float = void (*)(const int32_t* index, int count, const ImageView<const uint8_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using NearestU16Float = void (*)(const int32_t* index, int count, const ImageView<const uint16_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+
+    // weighted sums over the (linear source index, weight) pairs taps[start[i]] up to taps[start[i + 1]] of output pixel i,
+    // index_shift is subtracted from every index, pixels without taps are zero
+    using AreaDouble = void (*)(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using AreaU8 = void (*)(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const uint8_t>& image, uint8_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using AreaU16 = void (*)(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const uint16_t>& image, uint16_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using AreaFloat = void (*)(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const float>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using AreaU8Float = void (*)(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const uint8_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+    using AreaU16Float = void (*)(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const uint16_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride);
+
+    // source coordinates of output pixels (x + i, y) through the homography H, -1 behind the source camera
+    using HomographySpan = void (*)(const Matrix3x3& H, int x, int y, int count, double* X, double* Y);
+
+    RemapBackend backend;
+    BilinearDouble bilinearDouble;
+    FixedPointU8 fixedPointU8;
+    FixedPointU16 fixedPointU16;
+    NearestDouble nearestDouble;
+    NearestU8 nearestU8;
+    NearestU16 nearestU16;
+    // Catmull-Rom sampling, with the signatures of the bilinear kernels
+    BilinearDouble bicubicDouble;
+    FixedPointU8 bicubicU8;
+    FixedPointU16 bicubicU16;
+    // variants for interior pixels, whose taps all lie inside the image, without range checks or clamping
+    BilinearDouble bilinearDoubleInterior;
+    FixedPointU8 fixedPointInteriorU8;
+    FixedPointU16 fixedPointInteriorU16;
+    BilinearDouble bicubicDoubleInterior;
+    FixedPointU8 bicubicInteriorU8;
+    FixedPointU16 bicubicInteriorU16;
+    AreaDouble areaDouble;
+    AreaU8 areaU8;
+    AreaU16 areaU16;
+    // float images, with the interior variants
+    BilinearFloat bilinearFloat;
+    BilinearFloat bilinearFloatInterior;
+    BilinearFloat bicubicFloat;
+    BilinearFloat bicubicFloatInterior;
+    NearestFloat nearestFloat;
+    AreaFloat areaFloat;
+    // 8-bit and 16-bit images into float outputs, with the interior variants
+    BilinearU8Float bilinearU8Float;
+    BilinearU8Float bilinearU8FloatInterior;
+    BilinearU8Float bicubicU8Float;
+    BilinearU8Float bicubicU8FloatInterior;
+    NearestU8Float nearestU8Float;
+    AreaU8Float areaU8Float;
+    BilinearU16Float bilinearU16Float;
+    BilinearU16Float bilinearU16FloatInterior;
+    BilinearU16Float bicubicU16Float;
+    BilinearU16Float bicubicU16FloatInterior;
+    NearestU16Float nearestU16Float;
+    AreaU16Float areaU16Float;
+    HomographySpan homographySpan;
+
+    static const RemapKernels& get(RemapBackend backend = RemapBackend::Auto);
+    // kernels of a backend for a source image, the Scalar kernels if the image is out of reach of the gathers
+    template <typename T>
+    static const RemapKernels& get(RemapBackend backend, const ImageView<T>& image);
+    // the vectorized kernels gather with 32-bit element offsets from the first element of the image
+    template <typename T>
+    static bool fitsGatherOffsets(const ImageView<T>& image);
+    static bool isSupported(RemapBackend backend);
+    static RemapBackend best();
+    static const char* name(RemapBackend backend);
+};
+
+// backend tables, only defined when the compiler supports the instruction set
+const RemapKernels& remapKernelsScalar();
+const RemapKernels& remapKernelsSSE41();
+const RemapKernels& remapKernelsAVX2();
+const RemapKernels& remapKernelsAVX512();
+
+template <typename T>
+const RemapKernels& RemapKernels::get(RemapBackend backend, const ImageView<T>& image) {
+    const RemapKernels& kernels = get(backend);
+    return fitsGatherOffsets(image) ? kernels : remapKernelsScalar();
+}
+
+template <typename T>
+bool RemapKernels::fitsGatherOffsets(const ImageView<T>& image) {
+    // one pixel and row past the last element covers the neighbouring taps and the word loads of the kernels
+    const std::ptrdiff_t extent = image.height() * std::abs(image.rowStride()) + image.width() * std::abs(image.pixelStride()) +
+        image.channels() * std::abs(image.channelStride());
+    return extent <= std::numeric_limits<int32_t>::max();
+}
+
+#endif // REMAP_KERNELS_H
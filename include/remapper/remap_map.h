@@ -0,0 +1,376 @@
+#ifndef REMAP_MAP_H
+#define REMAP_MAP_H
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "utilities/common_math.h"
+#include "utilities/image.h"
+#include "utilities/executor.h"
+#include "remapper/remap_kernels.h"
+
+// Storage format of the per-pixel source coordinates of a RemapMap
+enum class MapFormat {
+    Float64,        // two doubles per pixel, exact (16 bytes per pixel)
+    FixedPoint,     // int16 integer pixel plus a quantized sub-pixel index (6 bytes per pixel, 2.7x smaller than Float64)
+    ControlGrid,    // doubles on a coarse grid, expanded row by row while remapping
+    Index,          // int32 linear index of the nearest source pixel, Nearest interpolation only (4 bytes per pixel)
+    Area,           // weighted source pixels of the footprint of every output pixel, Area interpolation only (see RemapMap::fromArea)
+    Float32,        // two floats per pixel, within 5e-4 pixels for sources up to 8192 pixels (8 bytes per pixel)
+    Float16,        // two half floats per pixel, the offset from the identity position (4 bytes per pixel, see RemapMap)
+    Offset16,       // two int16 per pixel, the offset from the identity position in fixed point (4 bytes per pixel, see RemapMap)
+    Homography      // a 3x3 projective transform evaluated row by row while remapping, pinhole to pinhole mappings only (no per-pixel storage)
+};
+
+// Sampling of the source image by the remap kernels
+enum class RemapInterpolation {
+    Nearest,        // closest source pixel, a plain gather
+    Bilinear,
+    Bicubic,        // Catmull-Rom over 4x4 source pixels, borders replicated
+    Area            // weighted average of the source footprint of the output pixel, Area maps only
+};
+
+// Interpolation of the control points of a ControlGrid map
+enum class GridInterpolation {
+    Bilinear,
+    Bicubic         // Catmull-Rom, more accurate for strong distortion at the same spacing
+};
+
+// Rectangle of output pixels remapped together, with the bounding box of the source pixels it reads
+struct RemapTile {
+    int x, y, width, height;
+    int source_x0, source_y0, source_x1, source_y1;         // exclusive upper bounds, all 0 when no pixel is inside the source
+};
+
+// Classification of an output pixel by the source pixels its interpolation reads
+enum class PixelClass : uint8_t {
+    Outside,        // outside the valid region, the output is zero
+    Border,         // some taps are clamped to the border of the source
+    Interior        // all taps lie inside the source, sampled without range checks or clamping
+};
+
+// Horizontal run of output pixels of one class
+struct PixelRun {
+    int x, count;
+    PixelClass pixel_class;
+};
+
+// Axis aligned rectangle of output pixels
+struct RemapRect {
+    int x, y, width, height;
+};
+
+// Output pixels of a map split into runs of one class, row by row
+struct RemapRegion {
+    std::vector<PixelRun> runs;
+    std::vector<size_t> row_start;                          // runs of row y are runs[row_start[y]] up to runs[row_start[y + 1]]
+    RemapRect bounds = { 0, 0, 0, 0 };                      // bounding box of the valid pixels, empty when there are none
+    size_t counts[3] = { 0, 0, 0 };                         // pixels per class of the runs, indexed by PixelClass
+};
+
+// Construction parameters of a ControlGrid map
+struct ControlGridOptions {
+    int spacing = 16;                                       // initial distance between control points in pixels
+    double max_error = 0.1;                                 // tolerated deviation from the exact map in pixels, halves the spacing until met
+    GridInterpolation interpolation = GridInterpolation::Bicubic;
+};
+
+// Construction parameters of an Area map
+struct AreaOptions {
+    int max_samples = 16;                                   // largest number of samples along each axis of an output pixel
+};
+
+/**
+ * @brief Per-pixel mapping from output pixels to source image coordinates.
+ *
+ * A RemapMap holds one direction of a Remapper. In FixedPoint format every output pixel
+ * stores the top left source pixel as two int16 values and a single index into a table of
+ * precomputed bilinear weights, so the per-frame kernel only gathers and blends. That is 6
+ * bytes per pixel, 2.7 times smaller than Float64 at 16 bytes. Offset16 and Float16 below take
+ * 4 bytes but are decoded span by span instead of feeding the integer kernels directly. Border
+ * clamping is folded into the map when it is built, and pixels outside the source are
+ * marked with a negative x coordinate. In Index format every output pixel stores the linear
+ * index y * source width + x of its nearest source pixel, or -1 outside the source. In Area
+ * format every output pixel stores the list of source pixels covered by its footprint with
+ * their weights, so maps that shrink the image average instead of skipping source pixels.
+ *
+ * Pixels are sampled with the interpolation of the map. All interpolations share the valid
+ * region of CommonMath::bilinearInterpolate, [0, source width] x [0, source height], and read
+ * taps beyond the last row or column from the border.
+ *
+ * The output pixels are classified once per map into runs of Outside, Border and Interior
+ * pixels (see region()). Remapping a source image of the size the map was built for zero-fills
+ * Outside runs without reading the image and samples Interior runs with kernels that skip the
+ * range checks and border clamping.
+ *
+ * Float32, Float16 and Offset16 maps trade accuracy for size and are decoded span by span into
+ * the scratch buffers of the kernels, like ControlGrid maps. Float16 and Offset16 store the
+ * offset of every coordinate from the identity position (x + 0.5) * source width / width - 0.5,
+ * and likewise for y, so their error grows with the distortion rather than with the image size:
+ *
+ *   format      bytes/pixel   error in source pixels
+ *   Float64     16            exact
+ *   Float32     8             2^-24 of the coordinate, below 5e-4 for sources up to 8192 pixels
+ *   FixedPoint  6             1/64 (positions quantized to 1/32), integer images only at full speed
+ *   Offset16    4             2^-(offset bits + 1), about the largest offset / 65534 (1/1024 for offsets up to 32 pixels)
+ *   Float16     4             2^-11 of the offset (1/64 for offsets below 64 pixels, 1/4 below 1024)
+ *
+ * Like FixedPoint maps, Float16 and Offset16 maps mark pixels outside the source and keep the
+ * decoded coordinates of the others inside it, so they only remap sources of the size they were
+ * built for.
+ *
+ * Homography maps hold no coordinates at all. The mapping between two pinhole images, optionally
+ * followed by crops, resizes and other projective transforms, is a single homography, and the
+ * source coordinates of every span are computed from it while remapping. Output pixels whose
+ * homogeneous coordinate is not positive lie behind the source camera and are outside.
+ *
+ * The coordinate planes are immutable once built and held through shared storage, which is
+ * either heap memory or a memory mapped cache file (see MapCache). Copying a map is cheap.
+ */
+class RemapMap {
+public:
+    // sub-pixel resolution of the FixedPoint format, 1/32 pixel
+    static const int FRAC_BITS = 5;
+    static const int FRAC_SIZE = 1 << FRAC_BITS;
+    // bilinear weights of the FixedPoint format sum to 1 << WEIGHT_BITS
+    static const int WEIGHT_BITS = 14;
+    // granularity and maximum height of the tiles from planTiles in pixels
+    static const int TILE_BLOCK = 8;
+    static const int MAX_TILE = 128;
+    // shortest Interior or Outside run of region(), shorter ones are merged into the border
+    static const int MIN_RUN = 16;
+    // weights of the taps of an Area pixel sum to 1 << AREA_WEIGHT_BITS
+    static const int AREA_WEIGHT_BITS = 16;
+    // points mapped together while building a map, bounds the temporaries of the camera models per thread
+    static const int MAP_CHUNK_PIXELS = 16384;
+
+    // maps a list of output pixels to source coordinates
+    using PointMapping = std::function<std::vector<std::array<double, 2>>(const std::vector<std::array<double, 2>>&)>;
+    // receives the first row of a band and the coordinates of its pixels in row-major order
+    using RowChunk = std::function<void(int first_row, const std::vector<std::array<double, 2>>& pixels)>;
+    // calls chunk for bands of rows of a pixel grid of about MAP_CHUNK_PIXELS pixels, in parallel on the current executor
+    static void forEachRowChunk(int width, int height, const RowChunk& chunk);
+
+    RemapMap() = default;
+    RemapMap(Image<double> Xd, Image<double> Yd, int source_width, int source_height, MapFormat format = MapFormat::Float64);
+    RemapMap(Image<double> Xg, Image<double> Yg, int spacing, int width, int height, int source_width, int source_height, GridInterpolation interpolation);
+    static RemapMap fromControlGrid(int width, int height, int source_width, int source_height, const PointMapping& mapping, const ControlGridOptions& options = ControlGridOptions());
+    static RemapMap fromArea(int width, int height, int source_width, int source_height, const PointMapping& mapping, const AreaOptions& options = AreaOptions());
+    static RemapMap fromHomography(int width, int height, int source_width, int source_height, const Matrix3x3& homography);
+
+    int width() const { return map_width; }
+    int height() const { return map_height; }
+    int sourceWidth() const { return source_width; }
+    int sourceHeight() const { return source_height; }
+    MapFormat format() const { return map_format; }
+    bool empty() const { return map_width == 0 || map_height == 0; }
+    size_t memoryUsage() const;
+
+    // Float64 storage
+    ImageView<const double> getX() const { return Xd; }
+    ImageView<const double> getY() const { return Yd; }
+
+    // ControlGrid storage
+    ImageView<const double> getGridX() const { return Xg; }
+    ImageView<const double> getGridY() const { return Yg; }
+    int gridSpacing() const { return grid_spacing; }
+    double gridError() const { return grid_error; }
+    void expandRow(int y, double* X, double* Y, int x = 0, int count = -1) const;
+
+    // Homography storage, maps output pixels (x, y, 1) to source pixels up to scale
+    const Matrix3x3& getHomography() const { return homography; }
+
+    // source coordinate of an output pixel in any format, (-1, -1) for FixedPoint, Index and Area pixels outside the source
+    std::array<double, 2> coordinate(int x, int y) const;
+    // source coordinate at a fractional output position, bilinear between pixels, (-1, -1) next to pixels outside the source
+    std::array<double, 2> coordinateAt(double x, double y) const;
+
+    // Float32 storage
+    ImageView<const float> getFloatX() const { return Xf; }
+    ImageView<const float> getFloatY() const { return Yf; }
+
+    // Float16 and Offset16 storage, interleaved x and y offsets from the identity position,
+    // half floats or multiples of 2^-offsetBits() pixels with INT16_MIN outside the source
+    ImageView<const uint16_t> getHalfOffsets() const { return XYh; }
+    ImageView<const int16_t> getFixedOffsets() const { return XYo; }
+    int offsetBits() const { return offset_bits; }
+
+    // FixedPoint storage
+    ImageView<const int16_t> getIntegerCoordinates() const { return XYi; }
+    ImageView<const uint16_t> getFractionIndices() const { return frac; }
+    static const int16_t* bilinearWeights();
+    // 4x4 Catmull-Rom weights of the FixedPoint format, row by row, summing to 1 << WEIGHT_BITS
+    static const int16_t* bicubicWeights();
+
+    // Index storage
+    ImageView<const int32_t> getIndices() const { return indices; }
+
+    // Area storage, the taps of pixel (x, y) are getAreaTaps() columns getAreaStarts()(x, y) up to getAreaStarts()(x + 1, y)
+    ImageView<const uint32_t> getAreaStarts() const { return area_start; }
+    ImageView<const int32_t> getAreaTaps() const { return area_taps; }
+
+    // sampling of the remap kernels, Index maps only support Nearest and Area maps only Area
+    RemapInterpolation interpolation() const { return map_interpolation; }
+    void setInterpolation(RemapInterpolation interpolation);
+    // first and last source pixel read along an axis of the given size for a coordinate inside it
+    void tapRange(double v, int size, int& first, int& last) const;
+
+    // classification of the output pixels for the interpolation of the map, computed on first use
+    const RemapRegion& region() const;
+    // 255 for output pixels inside the valid region, 0 elsewhere
+    Image<uint8_t> validMask() const;
+    // bounding box of the valid output pixels
+    RemapRect validRect() const { return region().bounds; }
+
+    // remap kernels, the output must have the size of the map and the channel count of the image, rows run on the executor
+    void remap(const ImageView<const double>& image, const ImageView<double>& output, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const float>& image, const ImageView<float>& output, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    // integer images into float outputs, the taps are converted inside the kernels
+    void remap(const ImageView<const uint8_t>& image, const ImageView<float>& output, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint16_t>& image, const ImageView<float>& output, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+
+    // cache-blocked execution, tiles are processed in parallel and must not overlap
+    std::vector<RemapTile> planTiles(size_t pixel_bytes, size_t cache_bytes = 0) const;
+    void remap(const ImageView<const double>& image, const ImageView<double>& output, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const float>& image, const ImageView<float>& output, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint8_t>& image, const ImageView<float>& output, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint16_t>& image, const ImageView<float>& output, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+
+    // batched execution, each span of the map is read once and applied to every frame of the batch
+    void remapBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remapBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+
+private:
+    int map_width = 0;
+    int map_height = 0;
+    int source_width = 0;
+    int source_height = 0;
+    MapFormat map_format = MapFormat::Float64;
+    RemapInterpolation map_interpolation = RemapInterpolation::Bilinear;
+
+    // read-only views into the shared storage, copies of a map share the same memory
+    std::shared_ptr<const void> storage;
+    ImageView<const double> Xd, Yd;
+    ImageView<const float> Xf, Yf;
+    ImageView<const uint16_t> XYh;
+    ImageView<const int16_t> XYo;
+    int offset_bits = 0;
+    ImageView<const int16_t> XYi;
+    ImageView<const uint16_t> frac;
+    ImageView<const int32_t> indices;
+    ImageView<const uint32_t> area_start;
+    ImageView<const int32_t> area_taps;
+
+    ImageView<const double> Xg, Yg;
+    int grid_spacing = 0;
+    double grid_error = 0.0;
+    GridInterpolation grid_interpolation = GridInterpolation::Bilinear;
+
+    Matrix3x3 homography = { { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } } };
+
+    // lazily computed region, shared by copies of the map and replaced when the interpolation changes
+    struct RegionCache {
+        std::once_flag once;
+        RemapRegion region;
+    };
+    std::shared_ptr<RegionCache> region_cache = std::make_shared<RegionCache>();
+
+    friend class MapCache;
+    template <typename T>
+    friend class RemapStream;
+    friend class RemapPyramid;
+    friend class StereoRemapper;
+
+    template <typename A, typename B>
+    void adopt(Image<A> first, Image<B> second, ImageView<const A>& first_view, ImageView<const B>& second_view);
+    void buildFixedPoint(const Image<double>& X, const Image<double>& Y);
+    void buildIndex(const Image<double>& X, const Image<double>& Y);
+    void buildCompact(const Image<double>& X, const Image<double>& Y);
+    // per-thread scratch buffers holding the coordinates of one span of output pixels
+    struct SpanBuffers {
+        std::vector<double> X, Y;
+        std::vector<int16_t> XY;
+        std::vector<uint16_t> frac;
+        std::vector<int32_t> index;
+        std::vector<double> lineX, lineY;   // combined control points of a ControlGrid row
+
+        void reserve(int count, int grid_width) {
+            if (static_cast<int>(X.size()) < count) {
+                X.resize(count);
+                Y.resize(count);
+                XY.resize(2 * static_cast<size_t>(count));
+                frac.resize(count);
+                index.resize(count);
+            }
+            if (static_cast<int>(lineX.size()) < grid_width + 2) {
+                lineX.resize(grid_width + 2);
+                lineY.resize(grid_width + 2);
+            }
+        }
+    };
+
+    SpanBuffers& threadBuffers(int count) const;
+    void expandSpan(int y, double* X, double* Y, int x, int count, double* lineX, double* lineY) const;
+    // coordinates of a Float32, Float16 or Offset16 span, -1 outside the source
+    void decodeSpan(int x, int y, int count, double* X, double* Y) const;
+    // coordinates of a Homography span, -1 behind the source camera
+    void homographySpan(int x, int y, int count, double* X, double* Y) const;
+    // coordinates of a span of a map with per-pixel coordinates, Float64 rows in place and the others decoded or computed into the buffers
+    void coordinateRow(int x, int y, int count, SpanBuffers& buffers, const double*& X, const double*& Y) const;
+    template <typename In, typename Out>
+    void run(const ImageView<const In>& image, const ImageView<Out>& output, RemapBackend backend, const std::vector<RemapTile>* tiles, const Executor& executor) const;
+    // source coordinates of one span, X and Y for Float64 kernels, XY and frac for FixedPoint ones, index for Nearest ones, start and taps for Area ones
+    struct SpanCoordinates {
+        const double* X;
+        const double* Y;
+        const int16_t* XY;
+        const uint16_t* frac;
+        const int32_t* index;
+        const uint32_t* start;
+        const int32_t* taps;
+        int32_t index_shift;
+    };
+
+    void classifyRow(int y, PixelClass* classes, SpanBuffers& buffers) const;
+    RemapRegion buildRegion() const;
+    template <typename SpanFunction>
+    void classifiedSpans(const RemapRegion* region, int x, int y, int count, SpanBuffers& buffers, const SpanFunction& span) const;
+    template <typename SpanFunction>
+    void traverse(const std::vector<RemapTile>* tiles, const RemapRegion* region, const Executor& executor, const SpanFunction& span) const;
+    template <typename In, typename Out>
+    void remapTile(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, const RemapRegion* region, const RemapTile& tile, SpanBuffers& buffers) const;
+    template <typename In, typename Out>
+    void runBatch(const std::vector<ImageView<const In>>& images, const std::vector<ImageView<Out>>& outputs, RemapBackend backend, const std::vector<RemapTile>* tiles, const Executor& executor) const;
+    SpanCoordinates areaSpan(int x, int y, int first_row) const;
+    const int32_t* indexSpan(int image_width, int image_height, int x, int y, int count, SpanBuffers& buffers, int first_row) const;
+    // the floating point path for floating point outputs, the integer path otherwise
+    template <typename In, typename Out>
+    SpanCoordinates prepareSpan(const ImageView<const In>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const;
+    template <typename T>
+    SpanCoordinates prepareFloatingSpan(const ImageView<const T>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const;
+    template <typename In, typename Out>
+    void applyFloatingSpan(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const;
+    template <typename In, typename Out>
+    void applySpan(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior = false) const;
+    template <typename In, typename Out>
+    void remapSpan(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, int x, int y, int count, SpanBuffers& buffers, int first_row) const;
+    void coordinateSpan(int x, int y, int count, double* X, double* Y) const;
+    // inclusive bounds x0, y0, x1, y1 of the source pixels read by every output pixel of a row, x1 < x0 for pixels reading none
+    void rowFootprint(int y, std::array<int, 4>* bounds, double* X, double* Y) const;
+    void checkShapes(int image_width, int image_height, int image_channels, int output_width, int output_height, int output_channels) const;
+};
+
+#endif // REMAP_MAP_H
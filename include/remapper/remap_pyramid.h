@@ -0,0 +1,59 @@
+#ifndef REMAP_PYRAMID_H
+#define REMAP_PYRAMID_H
+
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "utilities/image.h"
+#include "remapper/remap_map.h"
+
+class Remapper;
+
+/**
+ * @brief Remaps a source image into several output scales in one call, from maps derived from one full resolution map.
+ *
+ * Level 0 is the given map. Level l halves the size of level l - 1, rounding up, with the outer
+ * pixel edges aligned. Its coordinates are interpolated from the level 0 map (see
+ * RemapMap::coordinateAt), so the camera models are evaluated once for the whole pyramid. Every
+ * level samples the source image directly, by default with Area interpolation, which averages
+ * the footprint of a pixel and keeps the small scales free of aliasing.
+ *
+ * The tiles of all levels are distributed over the threads in a single parallel loop, so the
+ * small levels fill in behind the large one instead of running one after another.
+ */
+class RemapPyramid {
+public:
+    RemapPyramid(const RemapMap& base, int levels, RemapInterpolation interpolation = RemapInterpolation::Area);
+    // pyramid over the undistort map of a remapper
+    RemapPyramid(const Remapper& remapper, int levels, RemapInterpolation interpolation = RemapInterpolation::Area);
+
+    int levels() const { return static_cast<int>(maps.size()); }
+    const RemapMap& level(int index) const { return maps.at(index); }
+    size_t memoryUsage() const;
+
+    // remap every level, outputs[l] must have the size of level l and the channel count of the image
+    void remap(const ImageView<const double>& image, const std::vector<ImageView<double>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint8_t>& image, const std::vector<ImageView<uint8_t>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    void remap(const ImageView<const uint16_t>& image, const std::vector<ImageView<uint16_t>>& outputs, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    // allocating variants, the levels have the layout of the image
+    std::vector<Image<double>> remap(const ImageView<const double>& image, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    std::vector<Image<uint8_t>> remap(const ImageView<const uint8_t>& image, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+    std::vector<Image<uint16_t>> remap(const ImageView<const uint16_t>& image, RemapBackend backend = RemapBackend::Auto, const Executor& executor = Executor::current()) const;
+
+private:
+    static RemapMap deriveLevel(const RemapMap& base, int width, int height, RemapInterpolation interpolation);
+    const std::vector<std::pair<int, RemapTile>>& getTilePlan(size_t pixel_bytes) const;
+    template <typename T>
+    void run(const ImageView<const T>& image, const std::vector<ImageView<T>>& outputs, RemapBackend backend, const Executor& executor) const;
+    template <typename T>
+    std::vector<Image<T>> allocate(const ImageView<const T>& image, RemapBackend backend, const Executor& executor) const;
+
+    std::vector<RemapMap> maps;
+
+    // tiles of all levels per source pixel size, as (level, tile)
+    mutable std::mutex plan_mutex;
+    mutable std::map<size_t, std::vector<std::pair<int, RemapTile>>> tile_plans;
+};
+
+#endif // REMAP_PYRAMID_H
@@ -0,0 +1,65 @@
+#ifndef REMAP_STREAM_H
+#define REMAP_STREAM_H
+
+#include <vector>
+#include <functional>
+#include <memory>
+#include "utilities/executor.h"
+#include "utilities/image.h"
+#include "remapper/remap_map.h"
+
+/**
+ * @brief Remaps a source image that arrives as bands of rows, in bounded memory.
+ *
+ * The source rows every output row depends on are precomputed from the map. Bands are pushed
+ * top to bottom; every output row is remapped and handed to the callback as soon as the last
+ * source row it reads has arrived, and source rows are released once no pending output row
+ * reads them. Output rows are therefore emitted in the order their inputs complete, which is
+ * not necessarily top to bottom, and each is emitted exactly once.
+ *
+ * Only the window of source rows between the lowest row still needed and the last row pushed
+ * is kept, so the memory depends on how far the map reaches vertically rather than on the
+ * image height. ControlGrid maps keep the map itself small as well.
+ *
+ * @tparam T Element type of the source and output (double, float, uint8_t or uint16_t).
+ */
+template <typename T>
+class RemapStream {
+public:
+    // receives output row y as a view of width() x 1 interleaved pixels, valid during the call
+    using RowCallback = std::function<void(int y, const ImageView<const T>& row)>;
+
+    RemapStream(const RemapMap& map, int channels, RowCallback callback, RemapBackend backend = RemapBackend::Auto, std::shared_ptr<Executor> executor = nullptr);
+
+    void push(const ImageView<const T>& band);
+
+    int width() const { return map.width(); }
+    int height() const { return map.height(); }
+    int receivedRows() const { return received; }
+    int emittedRows() const { return emitted; }
+    int bufferedRows() const { return received - first_row; }
+    int peakBufferedRows() const { return peak_rows; }
+    bool finished() const { return emitted == map.height(); }
+
+private:
+    const Executor& getExecutor() const { return executor ? *executor : Executor::current(); }
+
+    RemapMap map;
+    int channels;
+    RowCallback callback;
+    RemapBackend backend;
+    std::shared_ptr<Executor> executor;
+
+    std::vector<int> order;         // output rows sorted by the last source row they read
+    std::vector<int> last_row;      // last source row read by an output row, -1 if it reads none
+    std::vector<int> first_needed;  // lowest source row read by order[i] and all rows emitted after it
+
+    std::vector<T> window;          // interleaved source rows first_row to received - 1
+    std::vector<T> staging;         // output rows remapped by the current push
+    int first_row = 0;
+    int received = 0;
+    int emitted = 0;
+    int peak_rows = 0;
+};
+
+#endif // REMAP_STREAM_H
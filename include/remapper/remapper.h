@@ -3,30 +3,192 @@
 
 #include <vector>
 #include <memory>
+#include <map>
+#include <mutex>
+#include <string>
 #include "camera/camera.h"
+#include "utilities/image.h"
+#include "remapper/remap_map.h"
+#include "remapper/pixel_transform.h"
+
+// Remap directions of a Remapper
+enum class RemapDirection {
+    None,
+    Undistort,  // target pixels sampled from the source image
+    Distort,    // source pixels sampled from the target image
+    Both
+};
+
+// Traversal of the output by the remap calls of a Remapper
+enum class RemapExecution {
+    Rows,       // whole output rows, streams the map once
+    Tiles       // cache-blocked tiles whose source footprint fits into the L2 cache
+};
+
+// Construction options of a Remapper
+struct RemapperOptions {
+    // storage of the undistort and distort maps, see RemapMap for the size and accuracy of each. Never chosen
+    // automatically: pinhole to pinhole remappers keep Float64 maps unless Homography is requested here
+    MapFormat map_format = MapFormat::Float64;
+    RemapInterpolation interpolation = RemapInterpolation::Bilinear; // sampling of the source, Nearest always stores Index maps and Area Area maps
+    RemapBackend backend = RemapBackend::Auto;  // instruction set of the remap kernels
+    RemapDirection prebuild = RemapDirection::None; // maps built by the constructor, the others are built on first use
+    ControlGridOptions control_grid;                // spacing and tolerance of ControlGrid maps
+    std::string cache_directory;                    // persistent map cache, maps are loaded from and stored in it when set
+    RemapExecution execution = RemapExecution::Rows; // traversal of the output
+    size_t tile_cache_bytes = 0;                    // source footprint budget per tile, 0 selects half of the L2 cache
+    double output_scale = 1.0;                      // size of the undistorted image relative to the target camera, use Area interpolation well below 1
+    AreaOptions area;                               // sample limit of Area maps
+    std::shared_ptr<Executor> executor;             // runs map building and remapping, nullptr for Executor::current() of the calling thread
+};
 
 class Remapper {
 public:
-    Remapper(const std::shared_ptr<Camera>& cam_source);
-    Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target);
-    Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const Matrix3x3& rotation_matrix);
+    Remapper(const std::shared_ptr<Camera>& cam_source, const RemapperOptions& options = RemapperOptions());
+    Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const RemapperOptions& options = RemapperOptions());
+    Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const Matrix3x3& rotation_matrix, const RemapperOptions& options = RemapperOptions());
+    // composition, the maps hold the whole chain so the image is resampled once, options default to those of the first remapper
+    // without its output_scale, which is already part of its chain
+    Remapper(const Remapper& first, const Remapper& second);
+    Remapper(const Remapper& first, const Remapper& second, const RemapperOptions& options);
+    Remapper(const Remapper& remapper, const PixelTransform& transform);
+    Remapper(const Remapper& remapper, const PixelTransform& transform, const RemapperOptions& options);
+    // copies take the maps built so far and a lock of their own
+    Remapper(const Remapper& other);
+    Remapper(Remapper&& other);
+    Remapper& operator=(const Remapper& other);
+    Remapper& operator=(Remapper&& other);
 
     std::vector<std::vector<std::vector<double>>>  undistort(const std::vector<std::vector<std::vector<double>>>& image);
     std::vector<std::vector<std::vector<double>>>  distort(const std::vector<std::vector<std::vector<double>>>& image);
 
+    Image<double> undistort(const ImageView<const double>& image);
+    Image<double> distort(const ImageView<const double>& image);
+    Image<uint8_t> undistort(const ImageView<const uint8_t>& image);
+    Image<uint8_t> distort(const ImageView<const uint8_t>& image);
+    Image<uint16_t> undistort(const ImageView<const uint16_t>& image);
+    Image<uint16_t> distort(const ImageView<const uint16_t>& image);
+    Image<float> undistort(const ImageView<const float>& image);
+    Image<float> distort(const ImageView<const float>& image);
+
+    // remap into caller-owned outputs of the map size with the channel count of the image, without allocating
+    void undistortInto(const ImageView<const double>& image, const ImageView<double>& output);
+    void distortInto(const ImageView<const double>& image, const ImageView<double>& output);
+    void undistortInto(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output);
+    void distortInto(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output);
+    void undistortInto(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output);
+    void distortInto(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output);
+    void undistortInto(const ImageView<const float>& image, const ImageView<float>& output);
+    void distortInto(const ImageView<const float>& image, const ImageView<float>& output);
+    // integer frames into float outputs, converted inside the remap kernels without a separate pass
+    void undistortInto(const ImageView<const uint8_t>& image, const ImageView<float>& output);
+    void distortInto(const ImageView<const uint8_t>& image, const ImageView<float>& output);
+    void undistortInto(const ImageView<const uint16_t>& image, const ImageView<float>& output);
+    void distortInto(const ImageView<const uint16_t>& image, const ImageView<float>& output);
+
+    // remap bursts of frames of the same size into caller-owned outputs, reading the map once per batch
+    void undistortBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs);
+    void distortBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs);
+    void undistortBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs);
+    void distortBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs);
+    void undistortBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs);
+    void distortBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs);
+    void undistortBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs);
+    void distortBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs);
+
+    const RemapMap& getUndistortMap() const;
+    const RemapMap& getDistortMap() const;
+    size_t memoryUsage() const;
+
+    // replace the rotation or the pinhole target and rebuild only the undistort map, reprojecting the target rays
+    // cached by the first update instead of backprojecting the target pixels again, see updateRotation.
+    // Not thread safe with remap calls on the same remapper.
+    void updateRotation(const Matrix3x3& rotation_matrix);
+    void updateTargetIntrinsics(const std::vector<double>& focal_length, const std::vector<double>& principal_point, double skew = 0.0);
+    // rolling shutter, one rotation per band of source rows from the first to the last exposed row, see updateRowRotations
+    void updateRowRotations(const std::vector<Matrix3x3>& row_rotations);
+
+    const Matrix3x3& getRotationMatrix() const { return rotation_matrix; }
+    const std::shared_ptr<Camera>& getTargetCamera() const { return cam_target; }
+
+    // true for pinhole to pinhole mappings with projective stages, which accept MapFormat::Homography to remap without map storage
+    bool isHomography() const;
+
+    // size of the undistorted image, the output of the last composed stage
+    int targetWidth() const { return target_width; }
+    int targetHeight() const { return target_height; }
+
 private:
+    // warp composed after the camera mapping, from the pixels of the previous output to its own output
+    struct RemapStage {
+        RemapMap::PointMapping backward;    // output pixels to input pixels
+        RemapMap::PointMapping forward;     // input pixels to output pixels
+        int width, height;                  // output size
+        uint64_t fingerprint;
+        bool projective = false;            // backward is the homography below
+        Matrix3x3 homography;               // output pixels to input pixels in homogeneous coordinates
+    };
+
     void configure(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const Matrix3x3& rotation_matrix = { { {1.0,0,0},{0,1.0,0},{0,0,1.0} } });
-    
+    void compose(const Remapper& first, const std::vector<RemapStage>& next);
+    void stageInputSize(size_t stage, int& width, int& height) const;
+    static RemapStage transformStage(const PixelTransform& transform);
+    template <typename Other>
+    void assign(Other&& other);
+
+    std::vector<std::array<double, 3>> targetRays(const std::vector<std::array<double, 2>>& target_pixels) const;
+    int rowBand(double source_y) const;
+    std::vector<Matrix3x3> inverseRotations() const;
+    std::array<double, 2> projectRay(const std::array<double, 3>& ray, const std::vector<Matrix3x3>& inverses) const;
+    std::vector<std::array<double, 2>> undistortPoints(const std::vector<std::array<double, 2>>& target_pixels) const;
+    std::vector<std::array<double, 2>> distortPoints(const std::vector<std::array<double, 2>>& source_pixels) const;
+    uint64_t cacheKey(RemapDirection direction) const;
+    RemapMap loadOrBuild(RemapDirection direction) const;
+    RemapMap buildUndistortMap() const;
+    RemapMap buildDistortMap() const;
+    RemapMap projectTargetRays() const;
+    void rebuildUndistortMap();
+    MapFormat mapFormat() const;
+    MapFormat denseFormat() const;
+    bool undistortHomography(Matrix3x3& homography) const;
+    bool mapHomography(RemapDirection direction, Matrix3x3& homography) const;
+    const Executor& getExecutor() const { return options.executor ? *options.executor : Executor::current(); }
+
+    template <typename T>
+    Image<T> apply(RemapDirection direction, const ImageView<const T>& image) const;
+    template <typename In, typename Out>
+    void applyInto(RemapDirection direction, const ImageView<const In>& image, const ImageView<Out>& output) const;
+    template <typename In, typename Out>
+    void execute(RemapDirection direction, const RemapMap& map, const ImageView<const In>& image, const ImageView<Out>& output) const;
+    template <typename T>
+    void applyBatch(RemapDirection direction, const std::vector<ImageView<const T>>& images, const std::vector<ImageView<T>>& outputs) const;
+    const std::vector<RemapTile>& getTilePlan(RemapDirection direction, size_t pixel_bytes) const;
+
     std::shared_ptr<Camera> cam_source;
     std::shared_ptr<Camera> cam_target;
+    RemapperOptions options;
 
     int source_width;
     int source_height;
     int target_width;
     int target_height;
 
-    std::vector<std::vector<double>> X, Y;
-    std::vector<std::vector<double>> Xd, Yd, Xd_invert, Yd_invert;
+    Matrix3x3 rotation_matrix;
+    // rotations of equal bands of source rows for rolling shutter cameras, empty for the global rotation_matrix
+    std::vector<Matrix3x3> row_rotations;
+    std::vector<RemapStage> stages;
+
+    // maps are built lazily by the const getters
+    mutable std::mutex map_mutex;
+    mutable bool undistort_built = false;
+    mutable bool distort_built = false;
+    mutable RemapMap undistort_map, distort_map;
+    // rays of the undistort map pixels in the target camera frame, kept once updateRotation or updateTargetIntrinsics ran
+    std::vector<std::array<double, 3>> target_rays;
+    // set by the per-frame updates, maps built after one bypass the persistent cache
+    bool updated = false;
+    // tile plans per direction and source pixel size
+    mutable std::map<std::pair<int, size_t>, std::vector<RemapTile>> tile_plans;
 };
 
 #endif // REMAPPER_H
@@ -0,0 +1,77 @@
+#ifndef STEREO_REMAPPER_H
+#define STEREO_REMAPPER_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "camera/camera.h"
+#include "camera/pinhole.h"
+#include "utilities/image.h"
+#include "remapper/remapper.h"
+
+/**
+ * @brief Rectifies the frames of a calibrated stereo pair into a common pinhole camera.
+ *
+ * The rectification rotations and the shared pinhole come from CommonMath::stereoRectify, applied
+ * to the pinholes of both cameras together. Both maps are built by the constructor. A rectify call
+ * distributes the tiles of the left and the right map over the executor of the options in a single
+ * parallel loop, so both frames finish together and the pair is returned only when both are complete.
+ *
+ * In the rectified frames the rows of both cameras are aligned and the right camera lies at
+ * baseline() along the x axis of the rectified left camera, so a point with disparity
+ * d = x_left - x_right has depth focal length * baseline / d.
+ */
+class StereoRemapper {
+public:
+    StereoRemapper(const std::shared_ptr<Camera>& cam_left, const std::shared_ptr<Camera>& cam_right, const RemapperOptions& options = RemapperOptions());
+
+    // rectify both frames of a pair into newly allocated images with the layout of the inputs
+    std::pair<Image<double>, Image<double>> rectify(const ImageView<const double>& left, const ImageView<const double>& right) const;
+    std::pair<Image<uint8_t>, Image<uint8_t>> rectify(const ImageView<const uint8_t>& left, const ImageView<const uint8_t>& right) const;
+    std::pair<Image<uint16_t>, Image<uint16_t>> rectify(const ImageView<const uint16_t>& left, const ImageView<const uint16_t>& right) const;
+    // rectify into caller-owned outputs of the rectified size with the channel counts of the inputs
+    void rectifyInto(const ImageView<const double>& left, const ImageView<const double>& right, const ImageView<double>& left_output, const ImageView<double>& right_output) const;
+    void rectifyInto(const ImageView<const uint8_t>& left, const ImageView<const uint8_t>& right, const ImageView<uint8_t>& left_output, const ImageView<uint8_t>& right_output) const;
+    void rectifyInto(const ImageView<const uint16_t>& left, const ImageView<const uint16_t>& right, const ImageView<uint16_t>& left_output, const ImageView<uint16_t>& right_output) const;
+
+    const Remapper& left() const { return *left_remapper; }
+    const Remapper& right() const { return *right_remapper; }
+    // rotations from the camera frames to the rectified frames
+    const Matrix3x3& leftRotation() const { return left_rotation; }
+    const Matrix3x3& rightRotation() const { return right_rotation; }
+
+    // common pinhole of both rectified images, including the output scale of the options
+    const std::shared_ptr<Pinhole>& rectifiedCamera() const { return rectified_camera; }
+    int width() const { return left_remapper->targetWidth(); }
+    int height() const { return left_remapper->targetHeight(); }
+    // distance between the camera centers in the units of the camera translations
+    double baseline() const { return baseline_length; }
+    // depth along the rectified optical axis, NaN for disparities that are not positive
+    double depth(double disparity) const;
+    // point in the rectified left camera frame seen at a left pixel with a disparity
+    Point3 triangulate(double x, double y, double disparity) const;
+    size_t memoryUsage() const;
+
+private:
+    const std::vector<std::pair<int, RemapTile>>& getTilePlan(size_t left_pixel_bytes, size_t right_pixel_bytes) const;
+    template <typename T>
+    void run(const ImageView<const T>& left, const ImageView<const T>& right, const ImageView<T>& left_output, const ImageView<T>& right_output) const;
+    template <typename T>
+    std::pair<Image<T>, Image<T>> allocate(const ImageView<const T>& left, const ImageView<const T>& right) const;
+
+    RemapperOptions options;
+    Matrix3x3 left_rotation;
+    Matrix3x3 right_rotation;
+    std::shared_ptr<Pinhole> rectified_camera;
+    double baseline_length;
+    std::unique_ptr<Remapper> left_remapper;
+    std::unique_ptr<Remapper> right_remapper;
+
+    // tiles of both maps per pair of source pixel sizes, as (0 for left or 1 for right, tile)
+    mutable std::mutex plan_mutex;
+    mutable std::map<std::pair<size_t, size_t>, std::vector<std::pair<int, RemapTile>>> tile_plans;
+};
+
+#endif // STEREO_REMAPPER_H
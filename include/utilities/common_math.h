@@ -5,10 +5,13 @@
 #include <vector>
 #include <iostream>
 #include <array>
+#include <cstdint>
 #include <cmath>
 #include <limits>
 #include <memory>
 #include <algorithm>
+#include "utilities/image.h"
+#include "utilities/executor.h"
 
 class Camera; // Forward declaration
 class Pinhole; // Forward declaration
@@ -28,15 +31,16 @@ public:
     static double evaluateFourier(const std::vector<double>& fourier_coeff,double phi);
 
     // extrinsics math
-    static std::vector<Point3> transformPoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix, const Point3& translation);
+    static std::vector<Point3> transformPoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix, const Point3& translation, const Executor& executor = Executor::current());
     static Point3 transformPoint(const Point3& point, const Matrix3x3& rotation_matrix, const Point3& translation);
     static Point3 rotatePoint(const Point3& point, const Matrix3x3& rotation_matrix);
-    static std::vector<Point3> rotatePoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix);
+    static std::vector<Point3> rotatePoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix, const Executor& executor = Executor::current());
     static Matrix3x3 rotationInverse(const Matrix3x3& rotation_matrix);
+    static Matrix3x3 matrixInverse(const Matrix3x3& matrix);
     static std::vector<std::vector<double>> transposeMatrix(const std::vector<std::vector<double>>& matrix);
 
     // specialized operations
-    static std::vector<std::array<double, 3>> intersectRays(std::shared_ptr<Camera> cameraL, std::shared_ptr<Camera> cameraR, const std::vector<Point3>& raysL, const std::vector<Point3>& raysR);
+    static std::vector<std::array<double, 3>> intersectRays(std::shared_ptr<Camera> cameraL, std::shared_ptr<Camera> cameraR, const std::vector<Point3>& raysL, const std::vector<Point3>& raysR, const Executor& executor = Executor::current());
     static int lineLineIntersect(Point3 p1, Point3 p2, Point3 p3, Point3 p4, Point3& pa, Point3& pb, double& mua, double& mub);
     static void stereoRectify(std::shared_ptr<Pinhole> cameraL, std::shared_ptr<Pinhole> cameraR, Matrix3x3& Rl, Matrix3x3& Rr);
 
@@ -53,9 +57,18 @@ public:
     static Matrix3x3 eulerToRot(const Point3& rotation);
 
     // interpolation
-    static std::vector<std::vector<double>> interp2(const std::vector<std::vector<double>>& img, const std::vector<std::vector<double>>& Xd, const std::vector<std::vector<double>>& Yd);
-    static std::vector<std::vector<std::vector<double>>> interp2(const std::vector<std::vector<std::vector<double>>>& img, const std::vector<std::vector<double>>& Xd, const std::vector<std::vector<double>>& Y);
+    static std::vector<std::vector<double>> interp2(const std::vector<std::vector<double>>& img, const std::vector<std::vector<double>>& Xd, const std::vector<std::vector<double>>& Yd, const Executor& executor = Executor::current());
+    static std::vector<std::vector<std::vector<double>>> interp2(const std::vector<std::vector<std::vector<double>>>& img, const std::vector<std::vector<double>>& Xd, const std::vector<std::vector<double>>& Y, const Executor& executor = Executor::current());
     static double bilinearInterpolate(const std::vector<std::vector<double>>& img, double x, double y);
+    static void interp2(const ImageView<const double>& img, const ImageView<const double>& Xd, const ImageView<const double>& Yd, const ImageView<double>& output, const Executor& executor = Executor::current());
+    static Image<double> interp2(const ImageView<const double>& img, const ImageView<const double>& Xd, const ImageView<const double>& Yd, const Executor& executor = Executor::current());
+    static double bilinearInterpolate(const ImageView<const double>& img, double x, double y);
+    static double bicubicInterpolate(const ImageView<const double>& img, double x, double y);
+    static void catmullRomWeights(double t, double weights[4]);
+
+    // IEEE 754 half precision bit patterns
+    static uint16_t floatToHalf(float value);
+    static float halfToFloat(uint16_t half);
 
     // operator overload
     friend Point3 operator+(const Point3& lhs, const Point3& rhs);
@@ -0,0 +1,18 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#include <cstddef>
+#include <string>
+
+// Instruction set extensions relevant for the vectorized kernels, detected once at runtime
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512f = false;
+    size_t l2_cache_bytes = 1 << 20;   // per core, 1 MiB when the platform does not report it
+
+    static const CpuFeatures& get();
+    std::string toString() const;
+};
+
+#endif // CPU_FEATURES_H
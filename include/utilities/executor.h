@@ -0,0 +1,117 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Non-owning reference to a loop body called as body(begin, end), unlike std::function it never allocates.
+// It refers to the callable it was made from, which must outlive it, so it is only passed down, never stored.
+class LoopBody {
+public:
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, LoopBody>::value>::type>
+    LoopBody(const F& body)
+        : object(&body), call([](const void* f, long begin, long end) { (*static_cast<const F*>(f))(begin, end); }) {}
+
+    void operator()(long begin, long end) const { call(object, begin, end); }
+
+private:
+    const void* object;
+    void (*call)(const void*, long, long);
+};
+
+/**
+ * @brief Runs the data parallel loops of the library.
+ *
+ * Every batch API (camera projection, point transforms, map building and the remap kernels)
+ * takes an executor, defaulting to current(). Inside a loop body current() is the executor
+ * running the loop, so nested batch calls stay on it instead of starting more threads. Outside
+ * of a loop it is the process default, a ThreadPool with one thread per core unless replaced
+ * with setDefault, so one bounded pool can serve every camera and remapper of a process.
+ */
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    // runs body(begin, end) over consecutive chunks covering [0, count) and returns once all ran,
+    // chunks hold at least grain items, max_threads caps the threads of this loop, 0 for no cap.
+    // The first exception thrown by the body is rethrown after the loop, skipping the chunks not yet started.
+    void parallelFor(long count, LoopBody body, long grain = 1, int max_threads = 0) const;
+    // threads a loop can use, including the calling thread
+    virtual int concurrency() const = 0;
+
+    static const Executor& current();
+    // replaces the process default, nullptr restores the built-in pool
+    static void setDefault(std::shared_ptr<Executor> executor);
+    static std::shared_ptr<Executor> getDefault();
+
+    // makes an executor current on the calling thread for the lifetime of the scope
+    class Scope {
+    public:
+        explicit Scope(const Executor& executor);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const Executor* previous;
+    };
+
+protected:
+    // count is positive, grain at least 1
+    virtual void run(long count, LoopBody body, long grain, int max_threads) const = 0;
+};
+
+// Runs every loop on the calling thread
+class InlineExecutor : public Executor {
+public:
+    int concurrency() const override { return 1; }
+
+protected:
+    void run(long count, LoopBody body, long grain, int max_threads) const override;
+};
+
+// Construction options of a ThreadPool
+struct ThreadPoolOptions {
+    int threads = 0;            // threads per loop including the calling thread, 0 selects the hardware concurrency
+    bool pin_threads = false;   // bind worker thread i to logical processor i + 1, Linux only
+};
+
+/**
+ * @brief Executor with a fixed set of worker threads shared by all loops submitted to it.
+ *
+ * A loop is split into chunks on demand: every thread takes the next chunk of a share of the
+ * remaining items, so the chunks shrink towards the end of the loop and threads that hit cheap
+ * items simply take more of them. The calling thread works on its own loop, and idle workers
+ * take chunks from any running loop, the most recent first, so loops submitted concurrently by
+ * several threads or nested inside each other share the same workers and never oversubscribe.
+ */
+class ThreadPool : public Executor {
+public:
+    explicit ThreadPool(const ThreadPoolOptions& options = ThreadPoolOptions());
+    ~ThreadPool() override;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int concurrency() const override { return static_cast<int>(workers.size()) + 1; }
+
+protected:
+    void run(long count, LoopBody body, long grain, int max_threads) const override;
+
+private:
+    struct Loop;
+
+    void work();
+    void execute(Loop& loop) const;
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    mutable std::condition_variable wake;
+    mutable std::vector<Loop*> loops;   // loops of running parallelFor calls, newest last
+    bool stopping = false;
+};
+
+#endif // EXECUTOR_H
@@ -0,0 +1,219 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+// Memory order of the channels of an image
+enum class ImageLayout {
+    Interleaved,    // pixel-major: c0 c1 c2 c0 c1 c2 ... (stb, most capture stacks)
+    Planar          // channel-major: every channel is a separate 2D plane
+};
+
+/**
+ * @brief Non-owning view of a strided 2D image with one or more channels.
+ *
+ * Element (x, y, c) lives at data[y * rowStride() + x * pixelStride() + c * channelStride()].
+ * All strides are expressed in elements, not bytes. A view never allocates; it can be
+ * created over an Image, over a buffer owned by the caller, or as a region of interest
+ * of another view. ImageView<T> converts implicitly to ImageView<const T>.
+ *
+ * @tparam T Element type of the image (e.g. uint8_t, uint16_t, float, double).
+ */
+template <typename T>
+class ImageView {
+public:
+    using value_type = T;
+
+    ImageView() = default;
+
+    /**
+     * @brief Creates a view over a dense buffer with the given layout.
+     *
+     * @param data Pointer to the first element.
+     * @param width Width of the image in pixels.
+     * @param height Height of the image in pixels.
+     * @param channels Number of channels.
+     * @param layout Interleaved or planar channel storage.
+     * @param row_stride Elements between consecutive rows, 0 selects the dense stride.
+     */
+    ImageView(T* data, int width, int height, int channels = 1, ImageLayout layout = ImageLayout::Interleaved, std::ptrdiff_t row_stride = 0)
+        : data_(data), width_(width), height_(height), channels_(channels), layout_(layout) {
+        if (width < 0 || height < 0 || channels < 1) {
+            throw std::invalid_argument("Image dimensions must be non-negative with at least one channel.");
+        }
+        if (layout == ImageLayout::Interleaved) {
+            pixel_stride_ = channels;
+            channel_stride_ = 1;
+            row_stride_ = row_stride > 0 ? row_stride : static_cast<std::ptrdiff_t>(width) * channels;
+        }
+        else {
+            pixel_stride_ = 1;
+            row_stride_ = row_stride > 0 ? row_stride : width;
+            channel_stride_ = row_stride_ * height;
+        }
+    }
+
+    /**
+     * @brief Creates a view with fully explicit strides (in elements).
+     */
+    ImageView(T* data, int width, int height, int channels, std::ptrdiff_t pixel_stride, std::ptrdiff_t row_stride, std::ptrdiff_t channel_stride)
+        : data_(data), width_(width), height_(height), channels_(channels),
+          pixel_stride_(pixel_stride), row_stride_(row_stride), channel_stride_(channel_stride) {
+        layout_ = (channels > 1 && channel_stride != 1) ? ImageLayout::Planar : ImageLayout::Interleaved;
+    }
+
+    // allows ImageView<T> -> ImageView<const T>
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+    ImageView(const ImageView<U>& other)
+        : data_(other.data()), width_(other.width()), height_(other.height()), channels_(other.channels()), layout_(other.layout()),
+          pixel_stride_(other.pixelStride()), row_stride_(other.rowStride()), channel_stride_(other.channelStride()) {
+    }
+
+    T* data() const { return data_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int channels() const { return channels_; }
+    ImageLayout layout() const { return layout_; }
+    std::ptrdiff_t pixelStride() const { return pixel_stride_; }
+    std::ptrdiff_t rowStride() const { return row_stride_; }
+    std::ptrdiff_t channelStride() const { return channel_stride_; }
+    bool empty() const { return data_ == nullptr || width_ == 0 || height_ == 0; }
+
+    // pointer to the first element of row y in channel c
+    T* row(int y, int c = 0) const { return data_ + y * row_stride_ + c * channel_stride_; }
+
+    T& operator()(int x, int y, int c = 0) const { return data_[y * row_stride_ + x * pixel_stride_ + c * channel_stride_]; }
+
+    // true when rows follow each other without padding
+    bool isContiguous() const {
+        return row_stride_ == static_cast<std::ptrdiff_t>(width_) * pixel_stride_;
+    }
+
+    bool sameShape(int width, int height, int channels) const {
+        return width_ == width && height_ == height && channels_ == channels;
+    }
+
+    template <typename U>
+    bool sameShape(const ImageView<U>& other) const {
+        return sameShape(other.width(), other.height(), other.channels());
+    }
+
+    /**
+     * @brief Returns a view of a rectangular region of interest without copying.
+     */
+    ImageView roi(int x, int y, int width, int height) const {
+        if (x < 0 || y < 0 || width < 0 || height < 0 || x + width > width_ || y + height > height_) {
+            throw std::out_of_range("Region of interest exceeds the image bounds.");
+        }
+        return ImageView(data_ + y * row_stride_ + x * pixel_stride_, width, height, channels_, pixel_stride_, row_stride_, channel_stride_);
+    }
+
+    /**
+     * @brief Returns a single channel view of channel c without copying.
+     */
+    ImageView channel(int c) const {
+        if (c < 0 || c >= channels_) {
+            throw std::out_of_range("Channel index out of range.");
+        }
+        return ImageView(data_ + c * channel_stride_, width_, height_, 1, pixel_stride_, row_stride_, 1);
+    }
+
+private:
+    T* data_ = nullptr;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 1;
+    ImageLayout layout_ = ImageLayout::Interleaved;
+    std::ptrdiff_t pixel_stride_ = 1;
+    std::ptrdiff_t row_stride_ = 0;
+    std::ptrdiff_t channel_stride_ = 1;
+};
+
+/**
+ * @brief Contiguous image that owns a single allocation for all rows and channels.
+ *
+ * Image<T> is the owning counterpart of ImageView<T> and converts implicitly to a
+ * mutable or const view, so it can be handed to every API that accepts a view.
+ *
+ * @tparam T Element type of the image.
+ */
+template <typename T>
+class Image {
+public:
+    using value_type = T;
+
+    Image() = default;
+
+    Image(int width, int height, int channels = 1, ImageLayout layout = ImageLayout::Interleaved, T value = T())
+        : buffer(static_cast<size_t>(width) * height * channels, value), view_(buffer.data(), width, height, channels, layout) {
+    }
+
+    Image(const Image& other) : buffer(other.buffer) {
+        view_ = ImageView<T>(buffer.data(), other.width(), other.height(), other.channels(), other.layout());
+    }
+
+    Image(Image&& other) noexcept : buffer(std::move(other.buffer)), view_(other.view_) {
+        other.view_ = ImageView<T>();
+    }
+
+    Image& operator=(const Image& other) {
+        if (this != &other) {
+            buffer = other.buffer;
+            view_ = ImageView<T>(buffer.data(), other.width(), other.height(), other.channels(), other.layout());
+        }
+        return *this;
+    }
+
+    Image& operator=(Image&& other) noexcept {
+        buffer = std::move(other.buffer);
+        view_ = other.view_;
+        other.view_ = ImageView<T>();
+        return *this;
+    }
+
+    /**
+     * @brief Reallocates the image only if the requested shape differs from the current one.
+     */
+    void resize(int width, int height, int channels = 1, ImageLayout layout = ImageLayout::Interleaved) {
+        if (view_.sameShape(width, height, channels) && view_.layout() == layout && !buffer.empty()) {
+            return;
+        }
+        buffer.assign(static_cast<size_t>(width) * height * channels, T());
+        view_ = ImageView<T>(buffer.data(), width, height, channels, layout);
+    }
+
+    void fill(T value) { std::fill(buffer.begin(), buffer.end(), value); }
+
+    ImageView<T> view() { return view_; }
+    ImageView<const T> view() const { return view_; }
+    operator ImageView<T>() { return view_; }
+    operator ImageView<const T>() const { return view_; }
+
+    T* data() { return buffer.data(); }
+    const T* data() const { return buffer.data(); }
+    int width() const { return view_.width(); }
+    int height() const { return view_.height(); }
+    int channels() const { return view_.channels(); }
+    ImageLayout layout() const { return view_.layout(); }
+    std::ptrdiff_t pixelStride() const { return view_.pixelStride(); }
+    std::ptrdiff_t rowStride() const { return view_.rowStride(); }
+    std::ptrdiff_t channelStride() const { return view_.channelStride(); }
+    size_t size() const { return buffer.size(); }
+    bool empty() const { return buffer.empty(); }
+
+    T* row(int y, int c = 0) { return view_.row(y, c); }
+    const T* row(int y, int c = 0) const { return view_.row(y, c); }
+    T& operator()(int x, int y, int c = 0) { return view_(x, y, c); }
+    const T& operator()(int x, int y, int c = 0) const { return view_(x, y, c); }
+
+private:
+    std::vector<T> buffer;
+    ImageView<T> view_;
+};
+
+#endif // IMAGE_H
@@ -4,13 +4,31 @@
 #include <vector>
 #include <stdexcept>
 #include <string>
+#include <cstdint>
+#include "utilities/image.h"
 
 class Utils {
 public:
     static std::vector<std::vector<std::vector<double>>> loadImage(const std::string& filename, int desiredChannels = 1);
     static void saveImage(const std::vector<std::vector<std::vector<double>>>& data, const std::string& filename, const std::string& format);
     static void saveImage(const std::vector<std::vector<std::vector<double>>>& data, const std::string& filename);
+
+    // contiguous image I/O, reuses the storage of image when the shape matches
+    static void loadImage(const std::string& filename, Image<uint8_t>& image, int desiredChannels = 1);
+    static void loadImage(const std::string& filename, Image<double>& image, int desiredChannels = 1);
+    static void saveImage(const ImageView<const uint8_t>& image, const std::string& filename, const std::string& format);
+    static void saveImage(const ImageView<const uint8_t>& image, const std::string& filename);
+    static void saveImage(const ImageView<const double>& image, const std::string& filename, const std::string& format);
+    static void saveImage(const ImageView<const double>& image, const std::string& filename);
+
+    // conversion between the nested vector representation [channel][row][column] and Image
+    static Image<double> toImage(const std::vector<std::vector<std::vector<double>>>& data, ImageLayout layout = ImageLayout::Planar);
+    static std::vector<std::vector<std::vector<double>>> toVector(const ImageView<const double>& image);
+
     static bool exists(const std::string& name);
+
+    // 64-bit FNV-1a hash, chain calls by passing the previous hash as seed
+    static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
 };
 
 #endif // UTILS_H
\ No newline at end of file
@@ -17,31 +17,23 @@ int main()
 		modelR->display();
 
 		// load in the images
-		auto imageL = Utils::loadImage(std::string(DATA_DIR) + "/H2387815.png");
-		auto imageR = Utils::loadImage(std::string(DATA_DIR) + "/H2395912.png");
+		Image<uint8_t> imageL, imageR;
+		Utils::loadImage(std::string(DATA_DIR) + "/H2387815.png", imageL);
+		Utils::loadImage(std::string(DATA_DIR) + "/H2395912.png", imageR);
 
-		// compute rectification rotation
-		Matrix3x3 RrectL{ {{1,0,0}, { 0,1,0 }, { 0,0,1 }} };
-		Matrix3x3 RrectR{ {{1,0,0}, { 0,1,0 }, { 0,0,1 }} };
+		// compute the rectification of both cameras and build their maps together
+		StereoRemapper stereo(modelL, modelR);
 
-		// get the nominal pinhole models to send into the rectify method
-		auto pinholeL = modelL->getPinhole();
-		auto pinholeR = modelR->getPinhole();
+		// rectify both images in one call (wrap this section in a loop for streaming applications)
+		auto rectified = stereo.rectify(imageL.view(), imageR.view());
 
-		// this method computes the normalized pinhole models and the rotations for rectification
-		CommonMath::stereoRectify(pinholeL, pinholeR, RrectL, RrectR);
-
-		// create remappers with 3 argument constructor for rectification matrix
-		auto remapperL = std::make_shared<Remapper>(modelL, pinholeL, RrectL);
-		auto remapperR = std::make_shared<Remapper>(modelR, pinholeR, RrectR);
-
-		// undistort images (wrap this section in a loop for streaming applications)
-		auto imageL_rect = remapperL->undistort(imageL);
-		auto imageR_rect = remapperR->undistort(imageR);
+		// the common rectified pinhole converts disparities to depth
+		std::cout << std::endl << "Rectified focal length: " << stereo.rectifiedCamera()->getFocalLength()[0]
+			<< ", baseline: " << stereo.baseline() << std::endl;
 
 		// save out rectified images
-		Utils::saveImage(imageL_rect, "imageLRect.png");
-		Utils::saveImage(imageR_rect, "imageRRect.png");
+		Utils::saveImage(rectified.first.view(), "imageLRect.png");
+		Utils::saveImage(rectified.second.view(), "imageRRect.png");
 	}
 	catch (const std::exception& e) {
 		std::cerr << "An error occurred: " << e.what() << std::endl;
@@ -0,0 +1,193 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "pixeltraq.h"
+
+namespace {
+
+// Times the undistort call of a Remapper and returns the throughput in megapixels per second
+template <typename T>
+double measure(Remapper& remapper, const Image<T>& image, int iterations) {
+    Image<T> output = remapper.undistort(image.view());
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        output = remapper.undistort(image.view());
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(output.width()) * output.height() * iterations / elapsed.count() / 1e6;
+}
+
+// Times batches of frames through undistortBatch and returns the throughput in megapixels per second
+template <typename T>
+double measureBatch(Remapper& remapper, const Image<T>& image, int frames, int iterations) {
+    std::vector<Image<T>> outputs;
+    std::vector<ImageView<const T>> views(frames, image.view());
+    std::vector<ImageView<T>> outputViews;
+    for (int f = 0; f < frames; ++f) {
+        outputs.emplace_back(image.width(), image.height(), image.channels());
+    }
+    for (Image<T>& output : outputs) {
+        outputViews.push_back(output.view());
+    }
+    const RemapMap& map = remapper.getUndistortMap();
+    remapper.undistortBatch(views, outputViews);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        remapper.undistortBatch(views, outputViews);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(map.width()) * map.height() * frames * iterations / elapsed.count() / 1e6;
+}
+
+template <typename T>
+Image<T> createImage(int width, int height, int channels) {
+    Image<T> image(width, height, channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                image(x, y, c) = static_cast<T>((x * 7 + y * 13 + c * 31) % 251);
+            }
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+
+    if (argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " [input_model] [iterations]" << std::endl;
+        return 1;
+    }
+
+    try {
+        // Without a model, a 1920x1080 fisheye with strong compression at the rim is used
+        std::shared_ptr<Camera> camera;
+        if (argc >= 2) {
+            camera = Camera::load(argv[1]);
+        }
+        else {
+            camera = std::make_shared<Kannala>(std::vector<double>{ 700.0, 700.0 }, std::vector<double>{ 960.0, 540.0 }, std::vector<int>{ 1920, 1080 },
+                std::vector<double>{ -0.05, 0.01 });
+        }
+        const int iterations = argc == 3 ? std::atoi(argv[2]) : 10;
+        const std::vector<int> size = camera->getImageSize();
+
+        std::cout << "CPU: " << CpuFeatures::get().toString() << std::endl;
+        std::cout << "Image: " << size[0] << "x" << size[1] << ", " << iterations << " iterations" << std::endl << std::endl;
+
+        const Image<uint8_t> image8 = createImage<uint8_t>(size[0], size[1], 3);
+        const Image<double> image64 = createImage<double>(size[0], size[1], 3);
+
+        const MapFormat formats[] = { MapFormat::Float64, MapFormat::Float32, MapFormat::Float16, MapFormat::Offset16, MapFormat::FixedPoint, MapFormat::ControlGrid };
+        const char* formatNames[] = { "Float64", "Float32", "Float16", "Offset16", "FixedPoint", "ControlGrid" };
+        for (int f = 0; f < 6; ++f) {
+            RemapperOptions options;
+            options.map_format = formats[f];
+            options.prebuild = RemapDirection::Undistort;
+            Remapper rows(camera, options);
+            options.execution = RemapExecution::Tiles;
+            Remapper tiles(camera, options);
+
+            const double rows8 = measure(rows, image8, iterations);
+            const double tiles8 = measure(tiles, image8, iterations);
+            const double rows64 = measure(rows, image64, iterations);
+            const double tiles64 = measure(tiles, image64, iterations);
+
+            std::cout << formatNames[f] << " (" << rows.getUndistortMap().memoryUsage() / (1 << 20) << " MiB)" << std::endl;
+            std::cout << "  uint8 x3   rows " << rows8 << " MPix/s, tiles " << tiles8 << " MPix/s (" << tiles8 / rows8 << "x)" << std::endl;
+            std::cout << "  double x3  rows " << rows64 << " MPix/s, tiles " << tiles64 << " MPix/s (" << tiles64 / rows64 << "x)" << std::endl;
+
+            const int frames = 8;
+            const double batchRows8 = measureBatch(rows, image8, frames, iterations);
+            const double batchTiles8 = measureBatch(tiles, image8, frames, iterations);
+            std::cout << "  uint8 x3   batch of " << frames << ": rows " << batchRows8 << " MPix/s, tiles " << batchTiles8 << " MPix/s" << std::endl;
+        }
+
+        const RemapInterpolation interpolations[] = { RemapInterpolation::Nearest, RemapInterpolation::Bicubic };
+        const char* interpolationNames[] = { "Nearest (Index)", "Bicubic (FixedPoint)" };
+        for (int i = 0; i < 2; ++i) {
+            RemapperOptions options;
+            options.map_format = MapFormat::FixedPoint;
+            options.interpolation = interpolations[i];
+            options.prebuild = RemapDirection::Undistort;
+            Remapper remapper(camera, options);
+
+            std::cout << interpolationNames[i] << std::endl;
+            std::cout << "  uint8 x3   rows " << measure(remapper, image8, iterations) << " MPix/s" << std::endl;
+            std::cout << "  double x3  rows " << measure(remapper, image64, iterations) << " MPix/s" << std::endl;
+        }
+
+        // quarter size preview, bilinear sampling skips source pixels while Area averages the footprint
+        RemapperOptions options;
+        options.output_scale = 0.25;
+        options.prebuild = RemapDirection::Undistort;
+        Remapper bilinear(camera, options);
+        options.interpolation = RemapInterpolation::Area;
+        Remapper area(camera, options);
+        std::cout << "Output scale 1/4 (" << area.targetWidth() << "x" << area.targetHeight() << ", output pixels)" << std::endl;
+        std::cout << "  uint8 x3   bilinear " << measure(bilinear, image8, iterations) << " MPix/s, area " << measure(area, image8, iterations) << " MPix/s" << std::endl;
+
+        // stabilization: a new rotation every frame, rebuilding the remapper or reprojecting the cached target rays
+        {
+            std::shared_ptr<Camera> pinhole = camera->getPinhole();
+            RemapperOptions updateOptions;
+            updateOptions.map_format = MapFormat::FixedPoint;
+            updateOptions.prebuild = RemapDirection::Undistort;
+            Remapper updated(camera, pinhole, updateOptions);
+            updated.updateRotation(CommonMath::eulerToRot({ 0.0, 0.0, 0.0 }));
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                Remapper rebuilt(camera, pinhole, CommonMath::eulerToRot({ 0.001 * i, 0.0, 0.0 }), updateOptions);
+            }
+            std::chrono::duration<double> rebuildTime = std::chrono::steady_clock::now() - start;
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                updated.updateRotation(CommonMath::eulerToRot({ 0.001 * i, 0.0, 0.0 }));
+            }
+            std::chrono::duration<double> updateTime = std::chrono::steady_clock::now() - start;
+            std::cout << "Rotation update (FixedPoint)" << std::endl;
+            std::cout << "  new remapper " << rebuildTime.count() * 1000 / iterations << " ms, updateRotation " << updateTime.count() * 1000 / iterations
+                      << " ms (" << rebuildTime.count() / updateTime.count() << "x)" << std::endl;
+        }
+
+        // virtual pan of the pinhole view, the source coordinates computed per row from the homography instead of read from a map
+        {
+            std::shared_ptr<Camera> pinhole = camera->getPinhole();
+            const Matrix3x3 pan = CommonMath::eulerToRot({ 0.0, 0.1, 0.0 });
+            RemapperOptions panOptions;
+            panOptions.map_format = MapFormat::Float32;
+            panOptions.prebuild = RemapDirection::Undistort;
+            Remapper stored(pinhole, pinhole, pan, panOptions);
+            panOptions.map_format = MapFormat::Homography;
+            Remapper computed(pinhole, pinhole, pan, panOptions);
+            std::cout << "Pinhole pan (Float32 " << stored.getUndistortMap().memoryUsage() / (1 << 20) << " MiB, Homography "
+                      << computed.getUndistortMap().memoryUsage() << " bytes)" << std::endl;
+            std::cout << "  uint8 x3   Float32 " << measure(stored, image8, iterations) << " MPix/s, Homography " << measure(computed, image8, iterations) << " MPix/s" << std::endl;
+        }
+
+        // scaling of the tiled kernels over the threads of the default pool
+        RemapperOptions threadOptions;
+        threadOptions.map_format = MapFormat::FixedPoint;
+        threadOptions.execution = RemapExecution::Tiles;
+        threadOptions.prebuild = RemapDirection::Undistort;
+        threadOptions.executor = std::make_shared<InlineExecutor>();
+        Remapper single(camera, threadOptions);
+        threadOptions.executor = nullptr;
+        Remapper pooled(camera, threadOptions);
+        const double single8 = measure(single, image8, iterations);
+        const double pooled8 = measure(pooled, image8, iterations);
+        std::cout << "Threads (FixedPoint tiles, " << Executor::getDefault()->concurrency() << " threads)" << std::endl;
+        std::cout << "  uint8 x3   1 thread " << single8 << " MPix/s, pool " << pooled8 << " MPix/s (" << pooled8 / single8 << "x)" << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "An error occurred: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 #include "pixeltraq.h"
@@ -46,17 +47,24 @@ int main(int argc, char* argv[]) {
             std::cout << std::endl;
         }
 
-        auto input_image = Utils::loadImage(input_image_path);
+        Image<double> input_image;
+        Utils::loadImage(input_image_path, input_image);
+
+        // Maps are cached across runs when PIXELTRAQ_MAP_CACHE names a directory
+        RemapperOptions options;
+        if (const char* cache_directory = std::getenv("PIXELTRAQ_MAP_CACHE")) {
+            options.cache_directory = cache_directory;
+        }
 
         // Core functionality
         std::shared_ptr<Remapper> remapper;
         if (!output_model_path.empty()) {
             // In this case, we are creating a two argument remapper mapping from the input to output model
-            remapper = std::make_shared<Remapper>(input_model,output_model);
+            remapper = std::make_shared<Remapper>(input_model,output_model,options);
         }
         else {
             // In this case, we are creating a one argument remapper mapping from the input model to a Pinhole of the same focal length
-            remapper = std::make_shared<Remapper>(input_model);
+            remapper = std::make_shared<Remapper>(input_model,options);
         };
 
         auto output_image = remapper->undistort(input_image);
@@ -92,6 +92,31 @@ std::string Camera::getParameterDisplayString() const
     return oss.str();
 }
 
+/**
+ * @brief Computes a hash identifying the camera geometry.
+ *
+ * The fingerprint covers the model name, the image size, every intrinsic parameter and the
+ * extrinsics, so any change that alters projection changes the fingerprint. It is used to key
+ * persistent remap map caches.
+ *
+ * @return The 64-bit fingerprint.
+ */
+uint64_t Camera::fingerprint() const
+{
+    const std::string name = getModelName();
+    uint64_t hash = Utils::hashBytes(name.data(), name.size());
+    hash = Utils::hashBytes(image_size.data(), image_size.size() * sizeof(int), hash);
+    hash = Utils::hashBytes(rotation.data(), rotation.size() * sizeof(double), hash);
+    hash = Utils::hashBytes(translation.data(), translation.size() * sizeof(double), hash);
+
+    for (const std::vector<double>& values : getParameters()) {
+        uint64_t count = values.size();
+        hash = Utils::hashBytes(&count, sizeof(count), hash);
+        hash = Utils::hashBytes(values.data(), values.size() * sizeof(double), hash);
+    }
+    return hash;
+}
+
 /**
  * @brief Displays the camera parameters to the console.
  */
@@ -160,69 +185,81 @@ void Camera::save(const std::string& fileName) const {
 /**
  * @brief Projects 3D points to 2D points using the camera model.
  * @param points_3d A vector of 3D points.
+ * @param executor Runs the points in parallel.
  * @return A vector of projected 2D points.
  */
-std::vector<Point2> Camera::project(const std::vector<Point3>& points_3d) const {
+std::vector<Point2> Camera::project(const std::vector<Point3>& points_3d, const Executor& executor) const {
     std::vector<std::array<double, 2>> projectedPoints;
     size_t N = points_3d.size();
     projectedPoints.reserve(N);
     projectedPoints.resize(N);
-    #pragma omp parallel for
-    for (size_t i = 0; i < N; ++i) {
-        projectedPoints[i] = project(points_3d[i]);
-    }
+    executor.parallelFor(static_cast<long>(N), [&](long begin, long end) {
+        for (size_t i = begin; i < static_cast<size_t>(end); ++i) {
+            projectedPoints[i] = project(points_3d[i]);
+        }
+    }, 256);
     return projectedPoints;
 }
 
 /**
  * @brief Projects 2D vectors of 3D points to 2D points using the camera model.
  * @param points_3d A 2D vector of 3D points.
+ * @param executor Runs the rows in parallel.
  * @return A 2D vector of projected 2D points.
  */
-std::vector<std::vector<Point2>> Camera::project(const std::vector<std::vector<Point3>>& points_3d) const {
+std::vector<std::vector<Point2>> Camera::project(const std::vector<std::vector<Point3>>& points_3d, const Executor& executor) const {
     size_t height = points_3d.size();
     size_t width = points_3d[0].size();
     std::vector<std::vector<Point2>> projectedImage(height, std::vector<Point2>(width));
 
-#pragma omp parallel for
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            projectedImage[y][x] = project(points_3d[y][x]);
+    executor.parallelFor(static_cast<long>(height), [&](long begin, long end) {
+        for (size_t y = begin; y < static_cast<size_t>(end); ++y) {
+            for (size_t x = 0; x < width; ++x) {
+                projectedImage[y][x] = project(points_3d[y][x]);
+            }
         }
-    }
+    });
     return projectedImage;
 }
 
 /**
  * @brief Backprojects 2D points to 3D rays using the camera model.
+ *
+ * The iterative models converge at different speeds across the image, the executor balances
+ * the points over its threads in chunks.
+ *
  * @param points_2d A vector of 2D points.
+ * @param executor Runs the points in parallel.
  * @return A vector of backprojected 3D rays.
  */
-std::vector<Point3> Camera::backproject(const std::vector<Point2>& points_2d) const {
-    std::vector<Point3> backprojectedPoints;
-    backprojectedPoints.reserve(points_2d.size());
-    for (const auto& point : points_2d) {
-        backprojectedPoints.push_back(backproject(point));
-    }
+std::vector<Point3> Camera::backproject(const std::vector<Point2>& points_2d, const Executor& executor) const {
+    std::vector<Point3> backprojectedPoints(points_2d.size());
+    executor.parallelFor(static_cast<long>(points_2d.size()), [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            backprojectedPoints[i] = backproject(points_2d[i]);
+        }
+    }, 256);
     return backprojectedPoints;
 }
 
 /**
  * @brief Backprojects a 2D vector of 2D points to 3D rays using the camera model.
  * @param image A 2D vector of 2D points.
+ * @param executor Runs the rows in parallel.
  * @return A 2D vector of backprojected 3D rays.
  */
-std::vector<std::vector<std::array<double, 3>>> Camera::backproject(const std::vector<std::vector<double>>& image) const {
+std::vector<std::vector<std::array<double, 3>>> Camera::backproject(const std::vector<std::vector<double>>& image, const Executor& executor) const {
     size_t height = image.size();
     size_t width = image[0].size();
     std::vector<std::vector<std::array<double, 3>>> backprojectedImage(height, std::vector<std::array<double, 3>>(width));
 
-#pragma omp parallel for
-    for (size_t y = 1; y <= height; ++y) {
-        for (size_t x = 1; x <= width; ++x) {
-            backprojectedImage[y-1][x-1] = backproject(std::array<double, 2> { static_cast<double>(y), static_cast<double>(x) });
+    executor.parallelFor(static_cast<long>(height), [&](long begin, long end) {
+        for (size_t y = begin + 1; y <= static_cast<size_t>(end); ++y) {
+            for (size_t x = 1; x <= width; ++x) {
+                backprojectedImage[y-1][x-1] = backproject(std::array<double, 2> { static_cast<double>(y), static_cast<double>(x) });
+            }
         }
-    }
+    });
     return backprojectedImage;
 }
 
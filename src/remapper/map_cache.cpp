@@ -0,0 +1,461 @@
+#include "remapper/map_cache.h"
+#include "utilities/utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char MAGIC[8] = { 'P', 'T', 'Q', 'R', 'E', 'M', 'A', 'P' };
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint64_t PLANE_ALIGNMENT = 64;
+
+struct MapFilePlane {
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    int32_t element_size;
+    uint64_t offset;
+};
+
+struct MapFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t key;
+    int32_t format;
+    int32_t map_width;
+    int32_t map_height;
+    int32_t source_width;
+    int32_t source_height;
+    int32_t grid_spacing;
+    int32_t grid_interpolation;
+    int32_t interpolation;
+    int32_t offset_bits;
+    int32_t reserved;
+    double grid_error;
+    MapFilePlane planes[2];
+};
+
+/**
+ * @brief Describes a plane of a map for the file header.
+ */
+template <typename T>
+MapFilePlane describePlane(const ImageView<const T>& view) {
+    return { view.width(), view.height(), view.channels(), static_cast<int32_t>(sizeof(T)), 0 };
+}
+
+uint64_t planeBytes(const MapFilePlane& plane) {
+    return static_cast<uint64_t>(plane.width) * plane.height * plane.channels * plane.element_size;
+}
+
+uint64_t alignOffset(uint64_t offset) {
+    return (offset + PLANE_ALIGNMENT - 1) / PLANE_ALIGNMENT * PLANE_ALIGNMENT;
+}
+
+/**
+ * @brief Maps a whole file read-only into memory.
+ *
+ * @param filename The file to map.
+ * @param size Receives the size of the file in bytes.
+ * @return Shared pointer to the mapped bytes, unmapped when the last reference is released.
+ * @throws std::runtime_error if the file cannot be opened or mapped.
+ */
+std::shared_ptr<const void> mapFile(const std::string& filename, size_t& size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open map cache file: " + filename);
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not read the size of map cache file: " + filename);
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error("Could not map cache file: " + filename);
+    }
+    void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (address == nullptr) {
+        throw std::runtime_error("Could not map cache file: " + filename);
+    }
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return std::shared_ptr<const void>(address, [](const void* p) { UnmapViewOfFile(p); });
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open map cache file: " + filename);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Could not read the size of map cache file: " + filename);
+    }
+    size = static_cast<size_t>(status.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Could not map cache file: " + filename);
+    }
+    return std::shared_ptr<const void>(address, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+#endif
+}
+
+} // namespace
+
+/**
+ * @brief Writes a map to a cache file.
+ *
+ * The file is written under a temporary name and renamed into place, so concurrent readers
+ * never observe a partially written file.
+ *
+ * @param map The map to write.
+ * @param filename The cache file.
+ * @param key The key identifying the cameras and options the map was built from.
+ * @throws std::runtime_error if the file cannot be written.
+ * @throws std::invalid_argument for Homography maps, which hold no coordinates.
+ */
+void MapCache::save(const RemapMap& map, const std::string& filename, uint64_t key) {
+    MapFileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.key = key;
+    header.format = static_cast<int32_t>(map.format());
+    header.map_width = map.width();
+    header.map_height = map.height();
+    header.source_width = map.sourceWidth();
+    header.source_height = map.sourceHeight();
+    header.grid_spacing = map.gridSpacing();
+    header.grid_interpolation = static_cast<int32_t>(map.grid_interpolation);
+    header.interpolation = static_cast<int32_t>(map.interpolation());
+    header.offset_bits = map.offsetBits();
+    header.grid_error = map.gridError();
+
+    const void* data[2] = { nullptr, nullptr };
+    switch (map.format()) {
+    case MapFormat::Float64:
+        header.planes[0] = describePlane(map.Xd);
+        header.planes[1] = describePlane(map.Yd);
+        data[0] = map.Xd.data();
+        data[1] = map.Yd.data();
+        break;
+    case MapFormat::FixedPoint:
+        header.planes[0] = describePlane(map.XYi);
+        header.planes[1] = describePlane(map.frac);
+        data[0] = map.XYi.data();
+        data[1] = map.frac.data();
+        break;
+    case MapFormat::ControlGrid:
+        header.planes[0] = describePlane(map.Xg);
+        header.planes[1] = describePlane(map.Yg);
+        data[0] = map.Xg.data();
+        data[1] = map.Yg.data();
+        break;
+    case MapFormat::Index:
+        // the second plane stays empty
+        header.planes[0] = describePlane(map.indices);
+        header.planes[1].channels = 1;
+        header.planes[1].element_size = sizeof(int32_t);
+        data[0] = map.indices.data();
+        break;
+    case MapFormat::Area:
+        header.planes[0] = describePlane(map.area_start);
+        header.planes[1] = describePlane(map.area_taps);
+        data[0] = map.area_start.data();
+        data[1] = map.area_taps.data();
+        break;
+    case MapFormat::Float32:
+        header.planes[0] = describePlane(map.Xf);
+        header.planes[1] = describePlane(map.Yf);
+        data[0] = map.Xf.data();
+        data[1] = map.Yf.data();
+        break;
+    case MapFormat::Float16:
+        header.planes[0] = describePlane(map.XYh);
+        header.planes[1].channels = 1;
+        header.planes[1].element_size = sizeof(uint16_t);
+        data[0] = map.XYh.data();
+        break;
+    case MapFormat::Offset16:
+        header.planes[0] = describePlane(map.XYo);
+        header.planes[1].channels = 1;
+        header.planes[1].element_size = sizeof(int16_t);
+        data[0] = map.XYo.data();
+        break;
+    case MapFormat::Homography:
+        throw std::invalid_argument("Homography maps hold no coordinates to cache.");
+    }
+    header.planes[0].offset = alignOffset(sizeof(MapFileHeader));
+    header.planes[1].offset = alignOffset(header.planes[0].offset + planeBytes(header.planes[0]));
+
+    const std::string temporary = filename + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Could not create map cache file: " + temporary);
+        }
+
+        const char padding[PLANE_ALIGNMENT] = {};
+        uint64_t position = sizeof(MapFileHeader);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int i = 0; i < 2; ++i) {
+            file.write(padding, static_cast<std::streamsize>(header.planes[i].offset - position));
+            if (data[i] != nullptr) {
+                file.write(static_cast<const char*>(data[i]), static_cast<std::streamsize>(planeBytes(header.planes[i])));
+            }
+            position = header.planes[i].offset + planeBytes(header.planes[i]);
+        }
+        if (!file) {
+            file.close();
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Could not write map cache file: " + temporary);
+        }
+    }
+
+    // both replace an existing file atomically, the target never goes missing for concurrent readers
+#ifdef _WIN32
+    if (!MoveFileExA(temporary.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+#else
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+#endif
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not move map cache file into place: " + filename);
+    }
+}
+
+/**
+ * @brief Loads a map from a cache file by memory mapping it.
+ *
+ * @param filename The cache file.
+ * @param key The expected key, the file is rejected if it was written with another key.
+ * @return The map, referencing the mapped file for as long as any copy of it exists.
+ * @throws std::runtime_error if the file cannot be mapped, is corrupt, or does not match the version or key.
+ */
+RemapMap MapCache::load(const std::string& filename, uint64_t key) {
+    size_t size = 0;
+    std::shared_ptr<const void> file = mapFile(filename, size);
+    const char* bytes = static_cast<const char*>(file.get());
+
+    if (size < sizeof(MapFileHeader)) {
+        throw std::runtime_error("Map cache file is truncated: " + filename);
+    }
+    MapFileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.byte_order != BYTE_ORDER_MARK) {
+        throw std::runtime_error("Not a map cache file for this platform: " + filename);
+    }
+    if (header.version != VERSION) {
+        throw std::runtime_error("Map cache file has an unsupported version: " + filename);
+    }
+    if (header.key != key) {
+        throw std::runtime_error("Map cache file was built for different cameras: " + filename);
+    }
+    // the image views reject negative sizes with std::invalid_argument, a corrupt file must only raise std::runtime_error
+    if (header.map_width <= 0 || header.map_height <= 0 || header.source_width <= 0 || header.source_height <= 0) {
+        throw std::runtime_error("Map cache file has invalid dimensions: " + filename);
+    }
+
+    const MapFormat format = static_cast<MapFormat>(header.format);
+    int channels[2] = { 1, 1 };
+    int elementSizes[2] = { sizeof(double), sizeof(double) };
+    int planeWidth = header.map_width;
+    int planeHeight = header.map_height;
+    int planeWidths[2], planeHeights[2];
+    switch (format) {
+    case MapFormat::Float64:
+        break;
+    case MapFormat::FixedPoint:
+        channels[0] = 2;
+        elementSizes[0] = sizeof(int16_t);
+        elementSizes[1] = sizeof(uint16_t);
+        break;
+    case MapFormat::ControlGrid:
+        planeWidth = header.planes[0].width;
+        planeHeight = header.planes[0].height;
+        if (header.grid_spacing < 1 || (planeWidth - 1) * header.grid_spacing < header.map_width - 1 ||
+            (planeHeight - 1) * header.grid_spacing < header.map_height - 1) {
+            throw std::runtime_error("Map cache file has an invalid control grid: " + filename);
+        }
+        break;
+    case MapFormat::Index:
+        elementSizes[0] = elementSizes[1] = sizeof(int32_t);
+        break;
+    case MapFormat::Area:
+        channels[1] = 2;
+        elementSizes[0] = sizeof(uint32_t);
+        elementSizes[1] = sizeof(int32_t);
+        break;
+    case MapFormat::Float32:
+        elementSizes[0] = elementSizes[1] = sizeof(float);
+        break;
+    case MapFormat::Float16:
+    case MapFormat::Offset16:
+        channels[0] = 2;
+        elementSizes[0] = elementSizes[1] = sizeof(int16_t);
+        if (header.offset_bits < 0 || header.offset_bits > 14) {
+            throw std::runtime_error("Map cache file has invalid offsets: " + filename);
+        }
+        break;
+    default:
+        throw std::runtime_error("Map cache file has an unknown map format: " + filename);
+    }
+    const RemapInterpolation interpolation = static_cast<RemapInterpolation>(header.interpolation);
+    if (header.interpolation < static_cast<int32_t>(RemapInterpolation::Nearest) || header.interpolation > static_cast<int32_t>(RemapInterpolation::Area) ||
+        (format == MapFormat::Index && interpolation != RemapInterpolation::Nearest) || ((format == MapFormat::Area) != (interpolation == RemapInterpolation::Area))) {
+        throw std::runtime_error("Map cache file has an invalid interpolation: " + filename);
+    }
+    // Index, Float16 and Offset16 maps hold a single plane, the second one stays empty
+    const bool single = format == MapFormat::Index || format == MapFormat::Float16 || format == MapFormat::Offset16;
+    for (int i = 0; i < 2; ++i) {
+        planeWidths[i] = single && i == 1 ? 0 : planeWidth;
+        planeHeights[i] = single && i == 1 ? 0 : planeHeight;
+    }
+    if (format == MapFormat::Area) {
+        // pixel starts with one more column than the map, taps as a single row of pairs
+        planeWidths[0] = header.map_width + 1;
+        planeWidths[1] = header.planes[1].width;
+        planeHeights[1] = 1;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        const MapFilePlane& plane = header.planes[i];
+        if (plane.width < 0 || plane.height < 0 || plane.width != planeWidths[i] || plane.height != planeHeights[i] || plane.channels != channels[i] || plane.element_size != elementSizes[i] ||
+            plane.offset % PLANE_ALIGNMENT != 0 || plane.offset > size || planeBytes(plane) > size - plane.offset) {
+            throw std::runtime_error("Map cache file is corrupt: " + filename);
+        }
+    }
+
+    RemapMap map;
+    map.map_width = header.map_width;
+    map.map_height = header.map_height;
+    map.source_width = header.source_width;
+    map.source_height = header.source_height;
+    map.map_format = format;
+    map.map_interpolation = interpolation;
+    map.grid_spacing = header.grid_spacing;
+    map.grid_interpolation = static_cast<GridInterpolation>(header.grid_interpolation);
+    map.grid_error = header.grid_error;
+    map.offset_bits = header.offset_bits;
+
+    const int64_t sourcePixels = static_cast<int64_t>(std::max(header.source_width, 0)) * std::max(header.source_height, 0);
+    const char* first = bytes + header.planes[0].offset;
+    const char* second = bytes + header.planes[1].offset;
+    switch (format) {
+    case MapFormat::Float64:
+        map.Xd = ImageView<const double>(reinterpret_cast<const double*>(first), planeWidth, planeHeight);
+        map.Yd = ImageView<const double>(reinterpret_cast<const double*>(second), planeWidth, planeHeight);
+        break;
+    case MapFormat::FixedPoint:
+        map.XYi = ImageView<const int16_t>(reinterpret_cast<const int16_t*>(first), planeWidth, planeHeight, 2);
+        map.frac = ImageView<const uint16_t>(reinterpret_cast<const uint16_t*>(second), planeWidth, planeHeight);
+        // the integer kernels read the source pixel and the weight tables unchecked, every pixel must be the
+        // (-1, -1) sentinel or address a source pixel, and every fraction must index the weight tables
+        for (int y = 0; y < planeHeight; ++y) {
+            const int16_t* xy = map.XYi.row(y);
+            const uint16_t* frac = map.frac.row(y);
+            for (int x = 0; x < planeWidth; ++x) {
+                const int ix = xy[2 * x];
+                const int iy = xy[2 * x + 1];
+                const bool sentinel = ix == -1 && iy == -1;
+                if ((!sentinel && (ix < 0 || ix >= header.source_width || iy < 0 || iy >= header.source_height)) ||
+                    frac[x] >= RemapMap::FRAC_SIZE * RemapMap::FRAC_SIZE) {
+                    throw std::runtime_error("Map cache file has invalid fixed point coordinates: " + filename);
+                }
+            }
+        }
+        break;
+    case MapFormat::ControlGrid:
+        map.Xg = ImageView<const double>(reinterpret_cast<const double*>(first), planeWidth, planeHeight);
+        map.Yg = ImageView<const double>(reinterpret_cast<const double*>(second), planeWidth, planeHeight);
+        break;
+    case MapFormat::Index:
+        map.indices = ImageView<const int32_t>(reinterpret_cast<const int32_t*>(first), planeWidth, planeHeight);
+        // the nearest kernels read the stored indices unchecked, they must be -1 or address a source pixel
+        for (int y = 0; y < planeHeight; ++y) {
+            const int32_t* row = map.indices.row(y);
+            for (int x = 0; x < planeWidth; ++x) {
+                if (row[x] < -1 || row[x] >= sourcePixels) {
+                    throw std::runtime_error("Map cache file has invalid source indices: " + filename);
+                }
+            }
+        }
+        break;
+    case MapFormat::Float32:
+        map.Xf = ImageView<const float>(reinterpret_cast<const float*>(first), planeWidth, planeHeight);
+        map.Yf = ImageView<const float>(reinterpret_cast<const float*>(second), planeWidth, planeHeight);
+        break;
+    case MapFormat::Float16:
+        map.XYh = ImageView<const uint16_t>(reinterpret_cast<const uint16_t*>(first), planeWidth, planeHeight, 2);
+        break;
+    case MapFormat::Offset16:
+        map.XYo = ImageView<const int16_t>(reinterpret_cast<const int16_t*>(first), planeWidth, planeHeight, 2);
+        break;
+    case MapFormat::Homography:
+        break;
+    case MapFormat::Area: {
+        map.area_start = ImageView<const uint32_t>(reinterpret_cast<const uint32_t*>(first), planeWidths[0], planeHeight);
+        map.area_taps = ImageView<const int32_t>(reinterpret_cast<const int32_t*>(second), planeWidths[1], 1, 2);
+        // the kernels trust the starts and taps, the starts must ascend within the taps and every tap must
+        // address a source pixel with a weight of at most one
+        const int32_t* taps = map.area_taps.row(0);
+        uint32_t previous = 0;
+        for (int y = 0; y < planeHeight; ++y) {
+            const uint32_t* row = map.area_start.row(y);
+            for (int x = 0; x < planeWidths[0]; ++x) {
+                if (row[x] < previous || row[x] > static_cast<uint32_t>(planeWidths[1]) || (x == 0 && y > 0 && row[x] != previous)) {
+                    throw std::runtime_error("Map cache file has invalid area taps: " + filename);
+                }
+                for (uint32_t t = previous; t < row[x]; ++t) {
+                    if (taps[2 * t] < 0 || taps[2 * t] >= sourcePixels || taps[2 * t + 1] < 0 || taps[2 * t + 1] > (1 << RemapMap::AREA_WEIGHT_BITS)) {
+                        throw std::runtime_error("Map cache file has invalid area taps: " + filename);
+                    }
+                }
+                previous = row[x];
+            }
+        }
+        break;
+    }
+    }
+    map.storage = std::move(file);
+    return map;
+}
+
+/**
+ * @brief Loads a map from a cache file if it exists and is valid.
+ *
+ * @param filename The cache file.
+ * @param key The expected key.
+ * @param map Receives the map on success, unchanged otherwise.
+ * @return True if the map was loaded.
+ */
+bool MapCache::tryLoad(const std::string& filename, uint64_t key, RemapMap& map) {
+    if (!Utils::exists(filename)) {
+        return false;
+    }
+    try {
+        map = load(filename, key);
+        return true;
+    }
+    catch (const std::runtime_error&) {
+        return false;
+    }
+}
@@ -0,0 +1,287 @@
+#include "remapper/panorama_stitcher.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace {
+
+// smallest cosine between a direction and the backprojection of its projection for a camera to see it
+const double ROUNDTRIP_COS = 0.9999;
+
+/**
+ * @brief Converts a weighted sum to the pixel type, rounding and saturating integer types.
+ */
+template <typename T>
+inline T pixelValue(double sum) {
+    if (std::is_floating_point<T>::value) {
+        return static_cast<T>(sum);
+    }
+    return static_cast<T>(CommonMath::clamp(std::lround(sum), 0L, static_cast<long>(std::numeric_limits<T>::max())));
+}
+
+} // namespace
+
+/**
+ * @brief Computes the blend table of a camera rig for a panorama.
+ *
+ * @param cameras The cameras of the rig, their rotations map the rig frame to the camera frames.
+ * @param options Projection, size and field of view of the panorama and the executor building the table.
+ * @throws std::invalid_argument if there are no cameras, the panorama is empty or a field of view is out of range.
+ */
+PanoramaStitcher::PanoramaStitcher(const std::vector<std::shared_ptr<Camera>>& cameras, const PanoramaOptions& options)
+    : cameras(cameras), options(options) {
+    if (cameras.empty()) {
+        throw std::invalid_argument("A panorama needs at least one camera.");
+    }
+    if (options.width <= 0 || options.height <= 0) {
+        throw std::invalid_argument("The panorama size must be positive.");
+    }
+    const double max_vertical = options.projection == PanoramaProjection::Cylindrical ? M_PI - 1e-6 : M_PI;
+    if (!(options.horizontal_fov > 0 && options.horizontal_fov <= 2 * M_PI) || !(options.vertical_fov > 0 && options.vertical_fov <= max_vertical)) {
+        throw std::invalid_argument("The panorama field of view is out of range.");
+    }
+
+    std::vector<Matrix3x3> rotations;
+    for (const std::shared_ptr<Camera>& camera : cameras) {
+        const std::vector<int> size = camera->getImageSize();
+        rotations.push_back(camera->getRotationMatrix());
+        image_sizes.push_back({ size[0], size[1] });
+    }
+
+    // samples of every row, collected in parallel and concatenated afterwards
+    const int width = options.width;
+    const int height = options.height;
+    std::vector<std::vector<BlendSample>> rows(height);
+    std::vector<uint32_t> counts(static_cast<size_t>(width) * height, 0);
+    getExecutor().parallelFor(height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            std::vector<BlendSample>& row = rows[y];
+            for (int x = 0; x < width; ++x) {
+                const Point3 dir = direction(x, y);
+                const size_t first = row.size();
+                double total = 0;
+                for (size_t c = 0; c < cameras.size(); ++c) {
+                    const Point3 ray = CommonMath::rotatePoint(dir, rotations[c]);
+                    const Point2 p = cameras[c]->project(ray);
+                    const double border = std::min(std::min(p[0] + 0.5, image_sizes[c][0] - 0.5 - p[0]), std::min(p[1] + 0.5, image_sizes[c][1] - 0.5 - p[1]));
+                    if (!(border > 0)) {
+                        continue;
+                    }
+                    const Point3 back = cameras[c]->backproject(p);
+                    if (!(CommonMath::dot(back, ray) >= ROUNDTRIP_COS * CommonMath::norm(back) * CommonMath::norm(ray))) {
+                        continue;
+                    }
+                    row.push_back({ static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(border), static_cast<int32_t>(c) });
+                    total += row.back().weight;
+                }
+                for (size_t i = first; i < row.size(); ++i) {
+                    row[i].weight = static_cast<float>(row[i].weight / total);
+                }
+                counts[static_cast<size_t>(y) * width + x] = static_cast<uint32_t>(row.size() - first);
+            }
+        }
+    });
+
+    start.resize(counts.size() + 1);
+    start[0] = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        start[i + 1] = start[i] + counts[i];
+    }
+    blend.reserve(start.back());
+    for (std::vector<BlendSample>& row : rows) {
+        blend.insert(blend.end(), row.begin(), row.end());
+        std::vector<BlendSample>().swap(row);
+    }
+}
+
+/**
+ * @brief Returns the direction a panorama pixel looks into.
+ *
+ * @param x Column of the panorama, pixel centers at integers.
+ * @param y Row of the panorama, pixel centers at integers.
+ * @return The unit direction in the rig frame.
+ */
+Point3 PanoramaStitcher::direction(double x, double y) const {
+    const double longitude = ((x + 0.5) / options.width - 0.5) * options.horizontal_fov;
+    if (options.projection == PanoramaProjection::Cylindrical) {
+        const double h = std::tan(options.vertical_fov / 2) * (2 * (y + 0.5) / options.height - 1);
+        const double n = std::sqrt(1 + h * h);
+        return { std::sin(longitude) / n, h / n, std::cos(longitude) / n };
+    }
+    const double latitude = (0.5 - (y + 0.5) / options.height) * options.vertical_fov;
+    return { std::cos(latitude) * std::sin(longitude), -std::sin(latitude), std::cos(latitude) * std::cos(longitude) };
+}
+
+/**
+ * @brief Returns the contributions of the cameras to a panorama pixel.
+ *
+ * @param x Column of the panorama.
+ * @param y Row of the panorama.
+ * @return The blend samples of the pixel, empty if no camera sees it.
+ * @throws std::out_of_range if the pixel lies outside the panorama.
+ */
+std::vector<BlendSample> PanoramaStitcher::samples(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width() || y >= height()) {
+        throw std::out_of_range("The pixel lies outside the panorama.");
+    }
+    const size_t i = static_cast<size_t>(y) * width() + x;
+    return std::vector<BlendSample>(blend.begin() + start[i], blend.begin() + start[i + 1]);
+}
+
+/**
+ * @brief Returns the number of bytes held by the blend table.
+ *
+ * @return The memory usage in bytes.
+ */
+size_t PanoramaStitcher::memoryUsage() const {
+    return start.capacity() * sizeof(uint32_t) + blend.capacity() * sizeof(BlendSample);
+}
+
+/**
+ * @brief Validates the shapes and writes the blended samples of every panorama pixel, row by row in parallel.
+ *
+ * Every sample is interpolated bilinearly, replicating the border pixels of its frame, and the
+ * weighted sums of up to four channels are accumulated in one pass over the samples of a pixel.
+ *
+ * @param frames One frame per camera.
+ * @param output The panorama.
+ * @throws std::invalid_argument if the frame count, a frame size, the channel counts or the output do not match.
+ */
+template <typename T>
+void PanoramaStitcher::run(const std::vector<ImageView<const T>>& frames, const ImageView<T>& output) const {
+    if (frames.size() != cameras.size()) {
+        throw std::invalid_argument("A panorama needs one frame per camera.");
+    }
+    const int channels = frames[0].channels();
+    for (size_t c = 0; c < frames.size(); ++c) {
+        if (frames[c].empty() || !frames[c].sameShape(image_sizes[c][0], image_sizes[c][1], channels)) {
+            throw std::invalid_argument("Every frame must have the image size of its camera and the channel count of the first frame.");
+        }
+    }
+    if (!output.sameShape(width(), height(), channels)) {
+        throw std::invalid_argument("The panorama output must have the panorama size and the channel count of the frames.");
+    }
+
+    getExecutor().parallelFor(height(), [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < width(); ++x) {
+                const size_t i = static_cast<size_t>(y) * width() + x;
+                const BlendSample* first = blend.data() + start[i];
+                const BlendSample* last = blend.data() + start[i + 1];
+                for (int c0 = 0; c0 < channels; c0 += 4) {
+                    const int group = std::min(channels - c0, 4);
+                    double sum[4] = {};
+                    for (const BlendSample* s = first; s != last; ++s) {
+                        const ImageView<const T>& frame = frames[s->camera];
+                        const double fx = std::floor(s->x);
+                        const double fy = std::floor(s->y);
+                        const double ax = s->x - fx;
+                        const double ay = s->y - fy;
+                        const int x0 = std::max(static_cast<int>(fx), 0);
+                        const int y0 = std::max(static_cast<int>(fy), 0);
+                        const int x1 = std::min(static_cast<int>(fx) + 1, frame.width() - 1);
+                        const int y1 = std::min(static_cast<int>(fy) + 1, frame.height() - 1);
+                        const double w00 = s->weight * (1 - ax) * (1 - ay);
+                        const double w10 = s->weight * ax * (1 - ay);
+                        const double w01 = s->weight * (1 - ax) * ay;
+                        const double w11 = s->weight * ax * ay;
+                        for (int c = 0; c < group; ++c) {
+                            sum[c] += w00 * frame(x0, y0, c0 + c) + w10 * frame(x1, y0, c0 + c) + w01 * frame(x0, y1, c0 + c) + w11 * frame(x1, y1, c0 + c);
+                        }
+                    }
+                    for (int c = 0; c < group; ++c) {
+                        output(x, y, c0 + c) = pixelValue<T>(sum[c]);
+                    }
+                }
+            }
+        }
+    }, 4);
+}
+
+/**
+ * @brief Allocates a panorama with the layout of the first frame and stitches into it.
+ *
+ * @param frames One frame per camera.
+ * @return The panorama.
+ */
+template <typename T>
+Image<T> PanoramaStitcher::allocate(const std::vector<ImageView<const T>>& frames) const {
+    if (frames.empty()) {
+        throw std::invalid_argument("A panorama needs one frame per camera.");
+    }
+    Image<T> output(width(), height(), frames[0].channels(), frames[0].layout());
+    run(frames, output.view());
+    return output;
+}
+
+/**
+ * @brief Stitches double precision frames into a panorama.
+ *
+ * @param frames One frame per camera, in the order of the cameras, any layout or stride.
+ * @return The panorama with the layout of the first frame.
+ * @throws std::invalid_argument if the frame count, a frame size or the channel counts do not match.
+ */
+Image<double> PanoramaStitcher::stitch(const std::vector<ImageView<const double>>& frames) const {
+    return allocate(frames);
+}
+
+/**
+ * @brief Stitches 8-bit frames into a panorama.
+ *
+ * @param frames One frame per camera, in the order of the cameras, any layout or stride.
+ * @return The panorama with the layout of the first frame.
+ * @throws std::invalid_argument if the frame count, a frame size or the channel counts do not match.
+ */
+Image<uint8_t> PanoramaStitcher::stitch(const std::vector<ImageView<const uint8_t>>& frames) const {
+    return allocate(frames);
+}
+
+/**
+ * @brief Stitches 16-bit frames into a panorama.
+ *
+ * @param frames One frame per camera, in the order of the cameras, any layout or stride.
+ * @return The panorama with the layout of the first frame.
+ * @throws std::invalid_argument if the frame count, a frame size or the channel counts do not match.
+ */
+Image<uint16_t> PanoramaStitcher::stitch(const std::vector<ImageView<const uint16_t>>& frames) const {
+    return allocate(frames);
+}
+
+/**
+ * @brief Stitches double precision frames into a caller-owned panorama, allocating nothing per frame.
+ *
+ * @param frames One frame per camera, in the order of the cameras, any layout or stride.
+ * @param output The panorama, of the panorama size with the channel count of the frames.
+ * @throws std::invalid_argument if the frames or the output do not match.
+ */
+void PanoramaStitcher::stitchInto(const std::vector<ImageView<const double>>& frames, const ImageView<double>& output) const {
+    run(frames, output);
+}
+
+/**
+ * @brief Stitches 8-bit frames into a caller-owned panorama, allocating nothing per frame.
+ *
+ * @param frames One frame per camera, in the order of the cameras, any layout or stride.
+ * @param output The panorama, of the panorama size with the channel count of the frames.
+ * @throws std::invalid_argument if the frames or the output do not match.
+ */
+void PanoramaStitcher::stitchInto(const std::vector<ImageView<const uint8_t>>& frames, const ImageView<uint8_t>& output) const {
+    run(frames, output);
+}
+
+/**
+ * @brief Stitches 16-bit frames into a caller-owned panorama, allocating nothing per frame.
+ *
+ * @param frames One frame per camera, in the order of the cameras, any layout or stride.
+ * @param output The panorama, of the panorama size with the channel count of the frames.
+ * @throws std::invalid_argument if the frames or the output do not match.
+ */
+void PanoramaStitcher::stitchInto(const std::vector<ImageView<const uint16_t>>& frames, const ImageView<uint16_t>& output) const {
+    run(frames, output);
+}
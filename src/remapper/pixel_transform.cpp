@@ -0,0 +1,189 @@
+#include "remapper/pixel_transform.h"
+#include "utilities/utils.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Scales a homography so that its last element is positive, the sign convention of applyHomography.
+ *
+ * @param H The homography.
+ * @return The scaled homography.
+ */
+Matrix3x3 normalizeSign(Matrix3x3 H) {
+    if (H[2][2] < 0) {
+        for (auto& row : H) {
+            for (double& value : row) {
+                value = -value;
+            }
+        }
+    }
+    return H;
+}
+
+/**
+ * @brief Applies a homography to a list of pixels.
+ *
+ * @param H The homography.
+ * @param pixels The pixels.
+ * @return The mapped pixels, NaN where the homogeneous coordinate is not positive.
+ */
+std::vector<std::array<double, 2>> applyHomography(const Matrix3x3& H, const std::vector<std::array<double, 2>>& pixels) {
+    std::vector<std::array<double, 2>> result(pixels.size());
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        const double x = pixels[i][0];
+        const double y = pixels[i][1];
+        const double w = H[2][0] * x + H[2][1] * y + H[2][2];
+        if (!(w > 0)) {
+            result[i] = { DNAN, DNAN };
+            continue;
+        }
+        result[i] = { (H[0][0] * x + H[0][1] * y + H[0][2]) / w, (H[1][0] * x + H[1][1] * y + H[1][2]) / w };
+    }
+    return result;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a transform from a homography and the size of the output image.
+ *
+ * @param homography Maps input pixels to output pixels in homogeneous coordinates.
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @throws std::invalid_argument if the homography is singular or the output size is negative.
+ */
+PixelTransform::PixelTransform(const Matrix3x3& homography, int width, int height)
+    : H(normalizeSign(homography)), H_inv(normalizeSign(CommonMath::matrixInverse(homography))), output_width(width), output_height(height) {
+
+    if (width < 0 || height < 0) {
+        throw std::invalid_argument("Output size of a pixel transform must not be negative.");
+    }
+}
+
+/**
+ * @brief Constructs an affine transform.
+ *
+ * @param matrix The first two rows of the homography, the last row is (0, 0, 1).
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @return The transform.
+ * @throws std::invalid_argument if the matrix is singular.
+ */
+PixelTransform PixelTransform::affine(const std::array<std::array<double, 3>, 2>& matrix, int width, int height) {
+    return PixelTransform({ { matrix[0], matrix[1], { 0.0, 0.0, 1.0 } } }, width, height);
+}
+
+/**
+ * @brief Constructs a crop of the input image.
+ *
+ * @param x The first input column of the window, may lie outside the input.
+ * @param y The first input row of the window.
+ * @param width Width of the window.
+ * @param height Height of the window.
+ * @return The transform.
+ */
+PixelTransform PixelTransform::crop(int x, int y, int width, int height) {
+    return PixelTransform({ { { 1.0, 0.0, static_cast<double>(-x) }, { 0.0, 1.0, static_cast<double>(-y) }, { 0.0, 0.0, 1.0 } } }, width, height);
+}
+
+/**
+ * @brief Constructs a resize of the whole input image.
+ *
+ * The outer edges of the corner pixels line up, so pixel x of the input lands at
+ * (x + 0.5) * width / input_width - 0.5 as in the usual area conventions.
+ *
+ * @param input_width Width of the input image.
+ * @param input_height Height of the input image.
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @return The transform.
+ * @throws std::invalid_argument if a size is not positive.
+ */
+PixelTransform PixelTransform::resize(int input_width, int input_height, int width, int height) {
+    if (input_width <= 0 || input_height <= 0 || width <= 0 || height <= 0) {
+        throw std::invalid_argument("Resize needs positive image sizes.");
+    }
+    const double sx = static_cast<double>(width) / input_width;
+    const double sy = static_cast<double>(height) / input_height;
+    return PixelTransform({ { { sx, 0.0, 0.5 * sx - 0.5 }, { 0.0, sy, 0.5 * sy - 0.5 }, { 0.0, 0.0, 1.0 } } }, width, height);
+}
+
+/**
+ * @brief Constructs a mirror image of the input.
+ *
+ * @param horizontal True to mirror the columns.
+ * @param vertical True to mirror the rows.
+ * @param input_width Width of the input image.
+ * @param input_height Height of the input image.
+ * @return The transform, with the size of the input.
+ */
+PixelTransform PixelTransform::flip(bool horizontal, bool vertical, int input_width, int input_height) {
+    return PixelTransform({ { { horizontal ? -1.0 : 1.0, 0.0, horizontal ? input_width - 1.0 : 0.0 },
+                              { 0.0, vertical ? -1.0 : 1.0, vertical ? input_height - 1.0 : 0.0 },
+                              { 0.0, 0.0, 1.0 } } }, input_width, input_height);
+}
+
+/**
+ * @brief Constructs a rotation of the input by a multiple of 90 degrees.
+ *
+ * @param quarter_turns Number of clockwise quarter turns, negative values turn counterclockwise.
+ * @param input_width Width of the input image.
+ * @param input_height Height of the input image.
+ * @return The transform, odd turns swap the width and height of the input.
+ */
+PixelTransform PixelTransform::rotate90(int quarter_turns, int input_width, int input_height) {
+    const double w = input_width - 1.0;
+    const double h = input_height - 1.0;
+    switch (((quarter_turns % 4) + 4) % 4) {
+    case 1:
+        return PixelTransform({ { { 0.0, -1.0, h }, { 1.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0 } } }, input_height, input_width);
+    case 2:
+        return PixelTransform({ { { -1.0, 0.0, w }, { 0.0, -1.0, h }, { 0.0, 0.0, 1.0 } } }, input_width, input_height);
+    case 3:
+        return PixelTransform({ { { 0.0, 1.0, 0.0 }, { -1.0, 0.0, w }, { 0.0, 0.0, 1.0 } } }, input_height, input_width);
+    default:
+        return PixelTransform({ { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } } }, input_width, input_height);
+    }
+}
+
+/**
+ * @brief Chains two transforms into one.
+ *
+ * @param next The transform applied to the output of this one.
+ * @return The combined transform, with the output size of next.
+ */
+PixelTransform PixelTransform::then(const PixelTransform& next) const {
+    return PixelTransform(CommonMath::matrixMultiply(next.H, H), next.output_width, next.output_height);
+}
+
+/**
+ * @brief Hashes the homography and the output size, used in the keys of the map cache.
+ *
+ * @return The fingerprint.
+ */
+uint64_t PixelTransform::fingerprint() const {
+    const int32_t size[2] = { output_width, output_height };
+    return Utils::hashBytes(size, sizeof(size), Utils::hashBytes(H.data(), sizeof(H)));
+}
+
+/**
+ * @brief Maps input pixels to output pixels.
+ *
+ * @param input_pixels Pixel coordinates in the input image.
+ * @return The output pixel coordinates.
+ */
+std::vector<std::array<double, 2>> PixelTransform::forward(const std::vector<std::array<double, 2>>& input_pixels) const {
+    return applyHomography(H, input_pixels);
+}
+
+/**
+ * @brief Maps output pixels back to the input pixels they show.
+ *
+ * @param output_pixels Pixel coordinates in the output image.
+ * @return The input pixel coordinates.
+ */
+std::vector<std::array<double, 2>> PixelTransform::backward(const std::vector<std::array<double, 2>>& output_pixels) const {
+    return applyHomography(H_inv, output_pixels);
+}
@@ -0,0 +1,476 @@
+#include "remapper/remap_kernels.h"
+#include "remapper/remap_map.h"
+#include "utilities/common_math.h"
+#include "utilities/cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+namespace {
+
+/**
+ * @brief Scalar bilinear row kernel for Float64 maps and floating point outputs, the reference for all other backends.
+ *
+ * The taps and weights are computed once per pixel and applied to every channel, with the
+ * arithmetic of CommonMath::bilinearInterpolate in the precision of the output. Float outputs
+ * round the fractions to float and convert every tap as it is read, whatever the input type.
+ * The Interior variant skips the range check and the clamping of the taps.
+ */
+template <typename In, typename Out, bool Interior>
+void bilinearFloatingScalar(const double* X, const double* Y, int count, const ImageView<const In>& image, Out* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+
+    for (int i = 0; i < count; ++i) {
+        Out* o = out + i * out_stride;
+        const double x = X[i];
+        const double y = Y[i];
+        if (!Interior && (width == 0 || height == 0 || x < 0 || y < 0 || x > width || y > height)) {
+            for (int c = 0; c < channels; ++c) {
+                o[c * out_channel_stride] = 0;
+            }
+            continue;
+        }
+
+        int x1 = static_cast<int>(std::floor(x));
+        int y1 = static_cast<int>(std::floor(y));
+        const Out xFrac = static_cast<Out>(x - x1);
+        const Out yFrac = static_cast<Out>(y - y1);
+        int x2 = x1 + 1;
+        int y2 = y1 + 1;
+        if (!Interior) {
+            x2 = CommonMath::clamp(x2, 0, width - 1);
+            y2 = CommonMath::clamp(y2, 0, height - 1);
+            x1 = CommonMath::clamp(x1, 0, width - 1);
+            y1 = CommonMath::clamp(y1, 0, height - 1);
+        }
+
+        const In* p11 = &image(x1, y1);
+        const In* p12 = &image(x1, y2);
+        const In* p21 = &image(x2, y1);
+        const In* p22 = &image(x2, y2);
+        for (int c = 0; c < channels; ++c) {
+            const std::ptrdiff_t k = c * channelStride;
+            Out R1 = (1 - xFrac) * static_cast<Out>(p11[k]) + xFrac * static_cast<Out>(p21[k]);
+            Out R2 = (1 - xFrac) * static_cast<Out>(p12[k]) + xFrac * static_cast<Out>(p22[k]);
+            o[c * out_channel_stride] = (1 - yFrac) * R1 + yFrac * R2;
+        }
+    }
+}
+
+/**
+ * @brief Scalar integer row kernel for FixedPoint maps, blending every channel with the same taps.
+ *
+ * Interior pixels always read both neighbours, the one of a zero fraction is weighted with zero.
+ */
+template <typename T, bool Interior>
+void fixedPointScalar(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const T>& image, T* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int16_t* weights = RemapMap::bilinearWeights();
+    const int channels = image.channels();
+    const std::ptrdiff_t pixelStride = image.pixelStride();
+    const std::ptrdiff_t rowStride = image.rowStride();
+    const std::ptrdiff_t channelStride = image.channelStride();
+
+    for (int i = 0; i < count; ++i) {
+        T* o = out + i * out_stride;
+        int ix = XY[2 * i];
+        int iy = XY[2 * i + 1];
+        if (!Interior && ix < 0) {
+            for (int c = 0; c < channels; ++c) {
+                o[c * out_channel_stride] = 0;
+            }
+            continue;
+        }
+
+        int index = frac[i];
+        const int16_t* w = weights + 4 * index;
+        // a zero fraction means the second neighbour is never weighted and may lie outside the image
+        const std::ptrdiff_t dx = Interior || (index & (RemapMap::FRAC_SIZE - 1)) ? pixelStride : 0;
+        const std::ptrdiff_t dy = Interior || (index >> RemapMap::FRAC_BITS) ? rowStride : 0;
+        const T* p = &image(ix, iy);
+        for (int c = 0; c < channels; ++c, p += channelStride) {
+            int sum = w[0] * p[0] + w[1] * p[dx] + w[2] * p[dy] + w[3] * p[dx + dy];
+            o[c * out_channel_stride] = static_cast<T>((sum + (1 << (RemapMap::WEIGHT_BITS - 1))) >> RemapMap::WEIGHT_BITS);
+        }
+    }
+}
+
+/**
+ * @brief Scalar nearest neighbour row kernel, a plain gather of every channel converted to the output type.
+ *
+ * Without row padding the linear index addresses the pixel directly, otherwise it is split into
+ * row and column.
+ */
+template <typename In, typename Out>
+void nearestScalar(const int32_t* index, int count, const ImageView<const In>& image, Out* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int channels = image.channels();
+    const std::ptrdiff_t pixelStride = image.pixelStride();
+    const std::ptrdiff_t rowStride = image.rowStride();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    const bool dense = rowStride == width * pixelStride;
+    const In* base = image.data();
+
+    for (int i = 0; i < count; ++i) {
+        Out* o = out + i * out_stride;
+        const std::ptrdiff_t k = index[i];
+        if (k < 0) {
+            for (int c = 0; c < channels; ++c) {
+                o[c * out_channel_stride] = 0;
+            }
+            continue;
+        }
+
+        const In* p = base + (dense ? k * pixelStride : (k / width) * rowStride + (k % width) * pixelStride);
+        for (int c = 0; c < channels; ++c) {
+            o[c * out_channel_stride] = static_cast<Out>(p[c * channelStride]);
+        }
+    }
+}
+
+/**
+ * @brief Scalar Catmull-Rom row kernel for Float64 maps and floating point outputs, with the arithmetic of CommonMath::bicubicInterpolate in the precision of the output.
+ */
+template <typename In, typename Out, bool Interior>
+void bicubicFloatingScalar(const double* X, const double* Y, int count, const ImageView<const In>& image, Out* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t pixelStride = image.pixelStride();
+    const std::ptrdiff_t channelStride = image.channelStride();
+
+    for (int i = 0; i < count; ++i) {
+        Out* o = out + i * out_stride;
+        const double x = X[i];
+        const double y = Y[i];
+        if (!Interior && (width == 0 || height == 0 || x < 0 || y < 0 || x > width || y > height)) {
+            for (int c = 0; c < channels; ++c) {
+                o[c * out_channel_stride] = 0;
+            }
+            continue;
+        }
+
+        const int x1 = static_cast<int>(std::floor(x));
+        const int y1 = static_cast<int>(std::floor(y));
+        double weightsX[4], weightsY[4];
+        CommonMath::catmullRomWeights(x - x1, weightsX);
+        CommonMath::catmullRomWeights(y - y1, weightsY);
+        Out wx[4], wy[4];
+        const In* rows[4];
+        std::ptrdiff_t columns[4];
+        for (int k = 0; k < 4; ++k) {
+            wx[k] = static_cast<Out>(weightsX[k]);
+            wy[k] = static_cast<Out>(weightsY[k]);
+            rows[k] = image.row(Interior ? y1 - 1 + k : CommonMath::clamp(y1 - 1 + k, 0, height - 1));
+            columns[k] = (Interior ? x1 - 1 + k : CommonMath::clamp(x1 - 1 + k, 0, width - 1)) * pixelStride;
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            const std::ptrdiff_t ch = c * channelStride;
+            Out q = 0;
+            for (int j = 0; j < 4; ++j) {
+                Out r = 0;
+                for (int k = 0; k < 4; ++k) {
+                    r += wx[k] * static_cast<Out>(rows[j][columns[k] + ch]);
+                }
+                q += wy[j] * r;
+            }
+            o[c * out_channel_stride] = q;
+        }
+    }
+}
+
+/**
+ * @brief Scalar integer Catmull-Rom row kernel for FixedPoint coordinates.
+ *
+ * The 16 taps are weighted from RemapMap::bicubicWeights and the result is rounded and saturated
+ * to the range of the pixel type, since the negative lobes overshoot at edges.
+ */
+template <typename T, bool Interior>
+void bicubicScalar(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const T>& image, T* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int16_t* weights = RemapMap::bicubicWeights();
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t pixelStride = image.pixelStride();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    const int maxValue = std::numeric_limits<T>::max();
+
+    for (int i = 0; i < count; ++i) {
+        T* o = out + i * out_stride;
+        const int ix = XY[2 * i];
+        const int iy = XY[2 * i + 1];
+        if (!Interior && ix < 0) {
+            for (int c = 0; c < channels; ++c) {
+                o[c * out_channel_stride] = 0;
+            }
+            continue;
+        }
+
+        const int16_t* w = weights + 16 * frac[i];
+        const T* rows[4];
+        std::ptrdiff_t columns[4];
+        for (int k = 0; k < 4; ++k) {
+            rows[k] = image.row(Interior ? iy - 1 + k : CommonMath::clamp(iy - 1 + k, 0, height - 1));
+            columns[k] = (Interior ? ix - 1 + k : CommonMath::clamp(ix - 1 + k, 0, width - 1)) * pixelStride;
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            const std::ptrdiff_t ch = c * channelStride;
+            int sum = 0;
+            for (int j = 0; j < 4; ++j) {
+                for (int k = 0; k < 4; ++k) {
+                    sum += w[4 * j + k] * rows[j][columns[k] + ch];
+                }
+            }
+            const int value = (sum + (1 << (RemapMap::WEIGHT_BITS - 1))) >> RemapMap::WEIGHT_BITS;
+            o[c * out_channel_stride] = static_cast<T>(CommonMath::clamp(value, 0, maxValue));
+        }
+    }
+}
+
+/**
+ * @brief Scales the weighted sum of an Area pixel, which carries 1 << AREA_WEIGHT_BITS times the value, and rounds integer outputs.
+ */
+inline double areaValue(double sum, double) {
+    return sum / (1 << RemapMap::AREA_WEIGHT_BITS);
+}
+
+inline float areaValue(float sum, float) {
+    return sum / (1 << RemapMap::AREA_WEIGHT_BITS);
+}
+
+inline float areaValue(uint32_t sum, float) {
+    return static_cast<float>(sum) / (1 << RemapMap::AREA_WEIGHT_BITS);
+}
+
+template <typename T>
+inline T areaValue(uint32_t sum, T) {
+    return static_cast<T>((static_cast<uint64_t>(sum) + (1u << (RemapMap::AREA_WEIGHT_BITS - 1))) >> RemapMap::AREA_WEIGHT_BITS);
+}
+
+/**
+ * @brief Scalar Area row kernel, the weighted sum of the taps of every pixel.
+ *
+ * The weights of a pixel sum exactly to 1 << AREA_WEIGHT_BITS, so the integer sums never exceed
+ * the range of the pixel type and need no saturation. Integer images are summed exactly even
+ * for float outputs, which only scale the sum.
+ */
+template <typename In, typename Out>
+void areaScalar(const uint32_t* start, const int32_t* taps, int count, int32_t index_shift, const ImageView<const In>& image, Out* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    using Sum = typename std::conditional<std::is_floating_point<In>::value, Out, uint32_t>::type;
+    const int width = image.width();
+    const int channels = image.channels();
+    const std::ptrdiff_t pixelStride = image.pixelStride();
+    const std::ptrdiff_t rowStride = image.rowStride();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    const bool dense = rowStride == width * pixelStride;
+    const In* base = image.data();
+
+    for (int i = 0; i < count; ++i) {
+        Out* o = out + i * out_stride;
+        const int32_t* first = taps + 2 * static_cast<std::ptrdiff_t>(start[i]);
+        const int32_t* last = taps + 2 * static_cast<std::ptrdiff_t>(start[i + 1]);
+        // up to four channels are summed in one pass over the taps
+        for (int c0 = 0; c0 < channels; c0 += 4) {
+            const int group = std::min(channels - c0, 4);
+            const In* p = base + c0 * channelStride;
+            Sum sum[4] = {};
+            for (const int32_t* t = first; t != last; t += 2) {
+                const std::ptrdiff_t k = t[0] - index_shift;
+                const In* q = p + (dense ? k * pixelStride : (k / width) * rowStride + (k % width) * pixelStride);
+                const Sum w = static_cast<Sum>(t[1]);
+                for (int c = 0; c < group; ++c) {
+                    sum[c] += w * q[c * channelStride];
+                }
+            }
+            for (int c = 0; c < group; ++c) {
+                o[(c0 + c) * out_channel_stride] = areaValue(sum[c], Out());
+            }
+        }
+    }
+}
+
+/**
+ * @brief Scalar source coordinates of a span of a Homography map.
+ *
+ * The numerators and the homogeneous coordinate are affine along the row, so every pixel costs
+ * three multiply-adds and a division. The vectorized kernels repeat these operations in the
+ * same order and without fused multiply-adds, so all backends return identical coordinates.
+ */
+void homographyScalar(const Matrix3x3& H, int x, int y, int count, double* X, double* Y) {
+    const double rowX = H[0][1] * y + H[0][2];
+    const double rowY = H[1][1] * y + H[1][2];
+    const double rowW = H[2][1] * y + H[2][2];
+    for (int i = 0; i < count; ++i) {
+        const double px = x + i;
+        const double w = H[2][0] * px + rowW;
+        const bool front = w > 0;
+        const double scale = 1.0 / (front ? w : 1.0);
+        X[i] = front ? (H[0][0] * px + rowX) * scale : -1.0;
+        Y[i] = front ? (H[1][0] * px + rowY) * scale : -1.0;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Returns the portable scalar kernels.
+ *
+ * @return The scalar kernel table.
+ */
+const RemapKernels& remapKernelsScalar() {
+    static const RemapKernels kernels = {
+        RemapBackend::Scalar,
+        bilinearFloatingScalar<double, double, false>,
+        fixedPointScalar<uint8_t, false>,
+        fixedPointScalar<uint16_t, false>,
+        nearestScalar<double, double>,
+        nearestScalar<uint8_t, uint8_t>,
+        nearestScalar<uint16_t, uint16_t>,
+        bicubicFloatingScalar<double, double, false>,
+        bicubicScalar<uint8_t, false>,
+        bicubicScalar<uint16_t, false>,
+        bilinearFloatingScalar<double, double, true>,
+        fixedPointScalar<uint8_t, true>,
+        fixedPointScalar<uint16_t, true>,
+        bicubicFloatingScalar<double, double, true>,
+        bicubicScalar<uint8_t, true>,
+        bicubicScalar<uint16_t, true>,
+        areaScalar<double, double>,
+        areaScalar<uint8_t, uint8_t>,
+        areaScalar<uint16_t, uint16_t>,
+        bilinearFloatingScalar<float, float, false>,
+        bilinearFloatingScalar<float, float, true>,
+        bicubicFloatingScalar<float, float, false>,
+        bicubicFloatingScalar<float, float, true>,
+        nearestScalar<float, float>,
+        areaScalar<float, float>,
+        bilinearFloatingScalar<uint8_t, float, false>,
+        bilinearFloatingScalar<uint8_t, float, true>,
+        bicubicFloatingScalar<uint8_t, float, false>,
+        bicubicFloatingScalar<uint8_t, float, true>,
+        nearestScalar<uint8_t, float>,
+        areaScalar<uint8_t, float>,
+        bilinearFloatingScalar<uint16_t, float, false>,
+        bilinearFloatingScalar<uint16_t, float, true>,
+        bicubicFloatingScalar<uint16_t, float, false>,
+        bicubicFloatingScalar<uint16_t, float, true>,
+        nearestScalar<uint16_t, float>,
+        areaScalar<uint16_t, float>,
+        homographyScalar
+    };
+    return kernels;
+}
+
+/**
+ * @brief Checks whether a backend was compiled in and is supported by the running processor.
+ *
+ * @param backend The backend to check.
+ * @return True if the kernels of the backend can be used.
+ */
+bool RemapKernels::isSupported(RemapBackend backend) {
+    const CpuFeatures& features = CpuFeatures::get();
+    switch (backend) {
+    case RemapBackend::Auto:
+    case RemapBackend::Scalar:
+        return true;
+    case RemapBackend::SSE41:
+#ifdef PIXELTRAQ_HAVE_SSE41
+        return features.sse41;
+#else
+        return false;
+#endif
+    case RemapBackend::AVX2:
+#ifdef PIXELTRAQ_HAVE_AVX2
+        return features.avx2;
+#else
+        return false;
+#endif
+    case RemapBackend::AVX512:
+#ifdef PIXELTRAQ_HAVE_AVX512
+        return features.avx512f;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the fastest backend supported by the running processor.
+ *
+ * @return The best supported backend.
+ */
+RemapBackend RemapKernels::best() {
+    static const RemapBackend backend = [] {
+        for (RemapBackend candidate : { RemapBackend::AVX512, RemapBackend::AVX2, RemapBackend::SSE41 }) {
+            if (isSupported(candidate)) {
+                return candidate;
+            }
+        }
+        return RemapBackend::Scalar;
+    }();
+    return backend;
+}
+
+/**
+ * @brief Returns the kernel table of a backend.
+ *
+ * @param backend The requested backend, Auto selects the best supported one.
+ * @return The kernel table.
+ * @throws std::invalid_argument if the backend is not supported on this processor or build.
+ */
+const RemapKernels& RemapKernels::get(RemapBackend backend) {
+    if (backend == RemapBackend::Auto) {
+        backend = best();
+    }
+    if (!isSupported(backend)) {
+        throw std::invalid_argument(std::string("Remap backend ") + name(backend) + " is not supported on this processor.");
+    }
+
+    switch (backend) {
+#ifdef PIXELTRAQ_HAVE_SSE41
+    case RemapBackend::SSE41:
+        return remapKernelsSSE41();
+#endif
+#ifdef PIXELTRAQ_HAVE_AVX2
+    case RemapBackend::AVX2:
+        return remapKernelsAVX2();
+#endif
+#ifdef PIXELTRAQ_HAVE_AVX512
+    case RemapBackend::AVX512:
+        return remapKernelsAVX512();
+#endif
+    default:
+        return remapKernelsScalar();
+    }
+}
+
+/**
+ * @brief Returns the display name of a backend.
+ *
+ * @param backend The backend.
+ * @return The name of the backend.
+ */
+const char* RemapKernels::name(RemapBackend backend) {
+    switch (backend) {
+    case RemapBackend::Auto:
+        return "Auto";
+    case RemapBackend::Scalar:
+        return "Scalar";
+    case RemapBackend::SSE41:
+        return "SSE4.1";
+    case RemapBackend::AVX2:
+        return "AVX2";
+    case RemapBackend::AVX512:
+        return "AVX-512";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,609 @@
+#include "remapper/remap_kernels.h"
+#include "remapper/remap_map.h"
+
+#ifdef PIXELTRAQ_HAVE_AVX2
+
+#include <immintrin.h>
+
+// GCC reports the deliberately undefined pass-through operands of the inlined AVX2 intrinsics as maybe uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace {
+
+/**
+ * @brief Finishes a row with the scalar kernels, used for tails and groups near the end of the image.
+ */
+template <bool Interior>
+inline void scalarFallback(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint8_t>& image, uint8_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (Interior ? scalar.fixedPointInteriorU8 : scalar.fixedPointU8)(XY, frac, count, image, out, out_stride, out_channel_stride);
+}
+
+template <bool Interior>
+inline void scalarFallback(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint16_t>& image, uint16_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (Interior ? scalar.fixedPointInteriorU16 : scalar.fixedPointU16)(XY, frac, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearDoubleInterior : scalar.bilinearDouble)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const float>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearFloatInterior : scalar.bilinearFloat)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const uint8_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearU8FloatInterior : scalar.bilinearU8Float)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const uint16_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearU16FloatInterior : scalar.bilinearU16Float)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+/**
+ * @brief Gathers 4 bytes for each of 8 pixels at element offsets.
+ *
+ * For interleaved images with up to 4 bytes per pixel a single gather holds every channel.
+ */
+template <typename T>
+PIXELTRAQ_TARGET("avx2")
+inline __m256i gatherWords(const T* base, __m256i offsets) {
+    return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), offsets, sizeof(T));
+}
+
+/**
+ * @brief Extracts channel c from gathered words, masking to the pixel width.
+ */
+template <typename T>
+PIXELTRAQ_TARGET("avx2")
+inline __m256i extractChannel(__m256i words, int c) {
+    const __m256i mask = _mm256_set1_epi32(sizeof(T) == 1 ? 0xFF : 0xFFFF);
+    return _mm256_and_si256(_mm256_srl_epi32(words, _mm_cvtsi32_si128(8 * static_cast<int>(sizeof(T)) * c)), mask);
+}
+
+// taps and weights of 4 output pixels of a Float64 map
+struct BilinearBatch {
+    __m128i offset11, offset12, offset21, offset22;
+    __m256d xFrac, yFrac, xInv, yInv;
+    __m256d inside;
+};
+
+// image bounds and strides shared by the batches of a row
+struct BilinearBounds {
+    __m256d maxX, maxY;
+    __m128i lastX, lastY;
+    __m128i pixelStride, rowStride;
+};
+
+/**
+ * @brief Computes the tap offsets and weights of 4 output pixels.
+ *
+ * The Interior variant drops the range mask and the clamping of the taps.
+ */
+template <bool Interior>
+PIXELTRAQ_TARGET("avx2")
+inline BilinearBatch prepareBatch(const double* X, const double* Y, const BilinearBounds& bounds) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m128i zeroi = _mm_setzero_si128();
+    const __m128i onei = _mm_set1_epi32(1);
+
+    BilinearBatch batch;
+    __m256d x = _mm256_loadu_pd(X);
+    __m256d y = _mm256_loadu_pd(Y);
+    __m256d x0 = _mm256_floor_pd(x);
+    __m256d y0 = _mm256_floor_pd(y);
+    batch.xFrac = _mm256_sub_pd(x, x0);
+    batch.yFrac = _mm256_sub_pd(y, y0);
+    batch.xInv = _mm256_sub_pd(one, batch.xFrac);
+    batch.yInv = _mm256_sub_pd(one, batch.yFrac);
+
+    batch.inside = _mm256_castsi256_pd(_mm256_set1_epi32(-1));
+    __m128i x1, y1, x2, y2;
+    if (Interior) {
+        x1 = _mm256_cvttpd_epi32(x0);
+        y1 = _mm256_cvttpd_epi32(y0);
+        x2 = _mm_add_epi32(x1, onei);
+        y2 = _mm_add_epi32(y1, onei);
+    }
+    else {
+        batch.inside = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GE_OQ), _mm256_cmp_pd(y, zero, _CMP_GE_OQ)),
+            _mm256_and_pd(_mm256_cmp_pd(x, bounds.maxX, _CMP_LE_OQ), _mm256_cmp_pd(y, bounds.maxY, _CMP_LE_OQ)));
+        // lanes outside of the image may hold any value, zero them before the integer conversion
+        x1 = _mm256_cvttpd_epi32(_mm256_and_pd(x0, batch.inside));
+        y1 = _mm256_cvttpd_epi32(_mm256_and_pd(y0, batch.inside));
+        x2 = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(x1, onei), zeroi), bounds.lastX);
+        y2 = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(y1, onei), zeroi), bounds.lastY);
+        x1 = _mm_min_epi32(_mm_max_epi32(x1, zeroi), bounds.lastX);
+        y1 = _mm_min_epi32(_mm_max_epi32(y1, zeroi), bounds.lastY);
+    }
+
+    __m128i row1 = _mm_mullo_epi32(y1, bounds.rowStride);
+    __m128i row2 = _mm_mullo_epi32(y2, bounds.rowStride);
+    __m128i col1 = _mm_mullo_epi32(x1, bounds.pixelStride);
+    __m128i col2 = _mm_mullo_epi32(x2, bounds.pixelStride);
+    batch.offset11 = _mm_add_epi32(row1, col1);
+    batch.offset12 = _mm_add_epi32(row2, col1);
+    batch.offset21 = _mm_add_epi32(row1, col2);
+    batch.offset22 = _mm_add_epi32(row2, col2);
+    return batch;
+}
+
+/**
+ * @brief Blends the taps of 4 output pixels in one channel.
+ */
+template <bool Interior>
+PIXELTRAQ_TARGET("avx2")
+inline __m256d blendBatch(const double* b, const BilinearBatch& batch) {
+    __m256d Q11 = _mm256_i32gather_pd(b, batch.offset11, 8);
+    __m256d Q12 = _mm256_i32gather_pd(b, batch.offset12, 8);
+    __m256d Q21 = _mm256_i32gather_pd(b, batch.offset21, 8);
+    __m256d Q22 = _mm256_i32gather_pd(b, batch.offset22, 8);
+
+    // same operation order as CommonMath::bilinearInterpolate for identical results
+    __m256d R1 = _mm256_add_pd(_mm256_mul_pd(batch.xInv, Q11), _mm256_mul_pd(batch.xFrac, Q21));
+    __m256d R2 = _mm256_add_pd(_mm256_mul_pd(batch.xInv, Q12), _mm256_mul_pd(batch.xFrac, Q22));
+    __m256d q = _mm256_add_pd(_mm256_mul_pd(batch.yInv, R1), _mm256_mul_pd(batch.yFrac, R2));
+    return Interior ? q : _mm256_and_pd(q, batch.inside);
+}
+
+/**
+ * @brief Writes 4 blended pixels of one channel to strided output.
+ */
+PIXELTRAQ_TARGET("avx2")
+inline void storeBatch(double* o, __m256d q, std::ptrdiff_t out_stride) {
+    if (out_stride == 1) {
+        _mm256_storeu_pd(o, q);
+        return;
+    }
+    alignas(32) double result[4];
+    _mm256_store_pd(result, q);
+    for (int k = 0; k < 4; ++k) {
+        o[k * out_stride] = result[k];
+    }
+}
+
+/**
+ * @brief AVX2 bilinear row kernel for Float64 maps, 8 output pixels per iteration.
+ *
+ * Every iteration prepares two batches of 4 pixels before gathering, so the eight independent
+ * gathers of a channel overlap. A remaining batch of 4 runs on its own before the scalar tail.
+ * The Interior variant drops the range mask and the clamping of the taps.
+ */
+template <bool Interior>
+PIXELTRAQ_TARGET("avx2")
+void bilinearDoubleAVX2(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    int i = 0;
+
+    if (width > 0 && height > 0) {
+        const double* base = image.data();
+        BilinearBounds bounds;
+        bounds.maxX = _mm256_set1_pd(width);
+        bounds.maxY = _mm256_set1_pd(height);
+        bounds.lastX = _mm_set1_epi32(width - 1);
+        bounds.lastY = _mm_set1_epi32(height - 1);
+        bounds.pixelStride = _mm_set1_epi32(static_cast<int>(image.pixelStride()));
+        bounds.rowStride = _mm_set1_epi32(static_cast<int>(image.rowStride()));
+
+        for (; i + 8 <= count; i += 8) {
+            const BilinearBatch first = prepareBatch<Interior>(X + i, Y + i, bounds);
+            const BilinearBatch second = prepareBatch<Interior>(X + i + 4, Y + i + 4, bounds);
+            for (int c = 0; c < channels; ++c) {
+                const double* b = base + c * channelStride;
+                const __m256d q1 = blendBatch<Interior>(b, first);
+                const __m256d q2 = blendBatch<Interior>(b, second);
+                double* o = out + i * out_stride + c * out_channel_stride;
+                storeBatch(o, q1, out_stride);
+                storeBatch(o + 4 * out_stride, q2, out_stride);
+            }
+        }
+        if (i + 4 <= count) {
+            const BilinearBatch batch = prepareBatch<Interior>(X + i, Y + i, bounds);
+            for (int c = 0; c < channels; ++c) {
+                storeBatch(out + i * out_stride + c * out_channel_stride, blendBatch<Interior>(base + c * channelStride, batch), out_stride);
+            }
+            i += 4;
+        }
+    }
+
+    scalarFallback(X + i, Y + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride, Interior);
+}
+
+// taps and single precision weights of 8 output pixels of a Float64 map
+struct FloatBatch {
+    __m256i offset11, offset12, offset21, offset22;
+    __m256 xFrac, yFrac, xInv, yInv;
+    __m256 inside;
+};
+
+// image bounds and strides shared by the float batches of a row
+struct FloatBounds {
+    __m256d maxX, maxY;
+    __m256i lastX, lastY;
+    __m256i pixelStride, rowStride;
+};
+
+/**
+ * @brief Joins two halves of 4 lanes into 8 lanes.
+ */
+PIXELTRAQ_TARGET("avx2")
+inline __m256i joinHalves(__m128i low, __m128i high) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+PIXELTRAQ_TARGET("avx2")
+inline __m256 joinHalves(__m128 low, __m128 high) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+}
+
+/**
+ * @brief Narrows the 64-bit lanes of a double comparison mask to 4 32-bit lanes.
+ */
+PIXELTRAQ_TARGET("avx2")
+inline __m128i narrowMask(__m256d mask) {
+    return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(mask), _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+/**
+ * @brief Computes the tap offsets and single precision weights of 8 output pixels.
+ *
+ * The floor, the fractions and the range check run in double on two halves of 4 pixels, as in
+ * the scalar kernel, only the fractions are rounded to float. The Interior variant drops the
+ * range mask and the clamping of the taps.
+ */
+template <bool Interior>
+PIXELTRAQ_TARGET("avx2")
+inline FloatBatch prepareFloatBatch(const double* X, const double* Y, const FloatBounds& bounds) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256i zeroi = _mm256_setzero_si256();
+    const __m256i onei = _mm256_set1_epi32(1);
+
+    __m128 xFrac[2], yFrac[2];
+    __m128i x1[2], y1[2], inside[2];
+    for (int h = 0; h < 2; ++h) {
+        const __m256d x = _mm256_loadu_pd(X + 4 * h);
+        const __m256d y = _mm256_loadu_pd(Y + 4 * h);
+        __m256d x0 = _mm256_floor_pd(x);
+        __m256d y0 = _mm256_floor_pd(y);
+        xFrac[h] = _mm256_cvtpd_ps(_mm256_sub_pd(x, x0));
+        yFrac[h] = _mm256_cvtpd_ps(_mm256_sub_pd(y, y0));
+        if (!Interior) {
+            const __m256d mask = _mm256_and_pd(
+                _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GE_OQ), _mm256_cmp_pd(y, zero, _CMP_GE_OQ)),
+                _mm256_and_pd(_mm256_cmp_pd(x, bounds.maxX, _CMP_LE_OQ), _mm256_cmp_pd(y, bounds.maxY, _CMP_LE_OQ)));
+            // lanes outside of the image may hold any value, zero them before the integer conversion
+            x0 = _mm256_and_pd(x0, mask);
+            y0 = _mm256_and_pd(y0, mask);
+            inside[h] = narrowMask(mask);
+        }
+        x1[h] = _mm256_cvttpd_epi32(x0);
+        y1[h] = _mm256_cvttpd_epi32(y0);
+    }
+
+    FloatBatch batch;
+    const __m256 one = _mm256_set1_ps(1.0f);
+    batch.xFrac = joinHalves(xFrac[0], xFrac[1]);
+    batch.yFrac = joinHalves(yFrac[0], yFrac[1]);
+    batch.xInv = _mm256_sub_ps(one, batch.xFrac);
+    batch.yInv = _mm256_sub_ps(one, batch.yFrac);
+    batch.inside = _mm256_castsi256_ps(Interior ? _mm256_set1_epi32(-1) : joinHalves(inside[0], inside[1]));
+
+    __m256i left = joinHalves(x1[0], x1[1]);
+    __m256i top = joinHalves(y1[0], y1[1]);
+    __m256i right = _mm256_add_epi32(left, onei);
+    __m256i bottom = _mm256_add_epi32(top, onei);
+    if (!Interior) {
+        right = _mm256_min_epi32(_mm256_max_epi32(right, zeroi), bounds.lastX);
+        bottom = _mm256_min_epi32(_mm256_max_epi32(bottom, zeroi), bounds.lastY);
+        left = _mm256_min_epi32(_mm256_max_epi32(left, zeroi), bounds.lastX);
+        top = _mm256_min_epi32(_mm256_max_epi32(top, zeroi), bounds.lastY);
+    }
+
+    const __m256i row1 = _mm256_mullo_epi32(top, bounds.rowStride);
+    const __m256i row2 = _mm256_mullo_epi32(bottom, bounds.rowStride);
+    const __m256i col1 = _mm256_mullo_epi32(left, bounds.pixelStride);
+    const __m256i col2 = _mm256_mullo_epi32(right, bounds.pixelStride);
+    batch.offset11 = _mm256_add_epi32(row1, col1);
+    batch.offset12 = _mm256_add_epi32(row2, col1);
+    batch.offset21 = _mm256_add_epi32(row1, col2);
+    batch.offset22 = _mm256_add_epi32(row2, col2);
+    return batch;
+}
+
+/**
+ * @brief Gathers one element for each of 8 pixels at element offsets and converts it to float.
+ *
+ * Integer pixels are gathered as 32-bit words and masked to the pixel width.
+ */
+PIXELTRAQ_TARGET("avx2")
+inline __m256 gatherFloats(const float* base, __m256i offsets) {
+    return _mm256_i32gather_ps(base, offsets, sizeof(float));
+}
+
+template <typename T>
+PIXELTRAQ_TARGET("avx2")
+inline __m256 gatherFloats(const T* base, __m256i offsets) {
+    const __m256i mask = _mm256_set1_epi32(sizeof(T) == 1 ? 0xFF : 0xFFFF);
+    return _mm256_cvtepi32_ps(_mm256_and_si256(gatherWords(base, offsets), mask));
+}
+
+/**
+ * @brief AVX2 bilinear row kernel for Float64 maps and float outputs, 8 output pixels per iteration.
+ *
+ * The taps of float, 8-bit and 16-bit images are converted to float as they are gathered and
+ * blended in single precision with the operation order of the scalar kernel, so the results are
+ * identical. Integer taps are gathered as 32-bit words, groups reaching the last bytes of the
+ * image fall back to the scalar kernel. The Interior variant drops the range mask and the
+ * clamping of the taps.
+ */
+template <typename In, bool Interior>
+PIXELTRAQ_TARGET("avx2")
+void bilinearFloatAVX2(const double* X, const double* Y, int count, const ImageView<const In>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    int i = 0;
+
+    if (width > 0 && height > 0) {
+        const In* base = image.data();
+        FloatBounds bounds;
+        bounds.maxX = _mm256_set1_pd(width);
+        bounds.maxY = _mm256_set1_pd(height);
+        bounds.lastX = _mm256_set1_epi32(width - 1);
+        bounds.lastY = _mm256_set1_epi32(height - 1);
+        bounds.pixelStride = _mm256_set1_epi32(static_cast<int>(image.pixelStride()));
+        bounds.rowStride = _mm256_set1_epi32(static_cast<int>(image.rowStride()));
+        // a 32-bit gather of an integer image reads 4 bytes, lanes starting beyond this offset would read past the image
+        const __m256i lastOffset = _mm256_set1_epi32(static_cast<int>((height - 1) * image.rowStride() + (width - 1) * image.pixelStride()) - static_cast<int>(4 / sizeof(In) - 1));
+        alignas(32) float result[8];
+
+        for (; i + 8 <= count; i += 8) {
+            const FloatBatch batch = prepareFloatBatch<Interior>(X + i, Y + i, bounds);
+            if (sizeof(In) < 4 && _mm256_movemask_epi8(_mm256_cmpgt_epi32(batch.offset22, lastOffset))) {
+                scalarFallback(X + i, Y + i, 8, image, out + i * out_stride, out_stride, out_channel_stride, Interior);
+                continue;
+            }
+            for (int c = 0; c < channels; ++c) {
+                const In* b = base + c * channelStride;
+                const __m256 Q11 = gatherFloats(b, batch.offset11);
+                const __m256 Q12 = gatherFloats(b, batch.offset12);
+                const __m256 Q21 = gatherFloats(b, batch.offset21);
+                const __m256 Q22 = gatherFloats(b, batch.offset22);
+
+                const __m256 R1 = _mm256_add_ps(_mm256_mul_ps(batch.xInv, Q11), _mm256_mul_ps(batch.xFrac, Q21));
+                const __m256 R2 = _mm256_add_ps(_mm256_mul_ps(batch.xInv, Q12), _mm256_mul_ps(batch.xFrac, Q22));
+                __m256 q = _mm256_add_ps(_mm256_mul_ps(batch.yInv, R1), _mm256_mul_ps(batch.yFrac, R2));
+                if (!Interior) {
+                    q = _mm256_and_ps(q, batch.inside);
+                }
+
+                float* o = out + i * out_stride + c * out_channel_stride;
+                if (out_stride == 1) {
+                    _mm256_storeu_ps(o, q);
+                    continue;
+                }
+                _mm256_store_ps(result, q);
+                for (int k = 0; k < 8; ++k) {
+                    o[k * out_stride] = result[k];
+                }
+            }
+        }
+    }
+
+    scalarFallback(X + i, Y + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride, Interior);
+}
+
+/**
+ * @brief AVX2 integer row kernel for FixedPoint maps, 8 output pixels per iteration.
+ *
+ * Interleaved images with up to 4 bytes per pixel gather each tap once for all channels.
+ * The Interior variant drops the validity mask and always reads both neighbours.
+ */
+template <typename T, bool Interior>
+PIXELTRAQ_TARGET("avx2")
+void fixedPointAVX2(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const T>& image, T* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int16_t* weights = RemapMap::bilinearWeights();
+    const T* base = image.data();
+    const int channels = image.channels();
+    const int pixelStride = static_cast<int>(image.pixelStride());
+    const int rowStride = static_cast<int>(image.rowStride());
+    const int channelStride = static_cast<int>(image.channelStride());
+    const bool packed = channelStride == 1 && channels * sizeof(T) <= 4;
+    // a 32-bit gather reads 4 bytes, lanes of channel 0 starting beyond this offset would read past the image
+    const int lastOffset = (image.height() - 1) * rowStride + (image.width() - 1) * pixelStride - static_cast<int>(4 / sizeof(T) - 1);
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    const __m256i fracMask = _mm256_set1_epi32(RemapMap::FRAC_SIZE - 1);
+    const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+    const __m256i pixelMask = _mm256_set1_epi32(sizeof(T) == 1 ? 0xFF : 0xFFFF);
+    const __m256i rounding = _mm256_set1_epi32(1 << (RemapMap::WEIGHT_BITS - 1));
+    const __m256i vPixelStride = _mm256_set1_epi32(pixelStride);
+    const __m256i vRowStride = _mm256_set1_epi32(rowStride);
+    const __m256i vLastOffset = _mm256_set1_epi32(lastOffset);
+    alignas(32) int32_t result[8];
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i xy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(XY + 2 * i));
+        __m256i x = _mm256_srai_epi32(_mm256_slli_epi32(xy, 16), 16);
+        __m256i y = _mm256_srai_epi32(xy, 16);
+        __m256i index = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(frac + i)));
+
+        __m256i valid = minusOne;
+        __m256i dx = vPixelStride;
+        __m256i dy = vRowStride;
+        if (!Interior) {
+            valid = _mm256_cmpgt_epi32(x, minusOne);
+            x = _mm256_max_epi32(x, zero);
+            y = _mm256_max_epi32(y, zero);
+
+            // a zero fraction means the second neighbour is never weighted and may lie outside the image
+            dx = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(index, fracMask), zero), vPixelStride);
+            dy = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_srli_epi32(index, RemapMap::FRAC_BITS), zero), vRowStride);
+        }
+
+        __m256i offset = _mm256_add_epi32(_mm256_mullo_epi32(y, vRowStride), _mm256_mullo_epi32(x, vPixelStride));
+        __m256i offsetDx = _mm256_add_epi32(offset, dx);
+        __m256i offsetDy = _mm256_add_epi32(offset, dy);
+        __m256i offsetFar = _mm256_add_epi32(offsetDy, dx);
+
+        if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(offsetFar, vLastOffset))) {
+            scalarFallback<Interior>(XY + 2 * i, frac + i, 8, image, out + i * out_stride, out_stride, out_channel_stride);
+            continue;
+        }
+
+        // each table entry holds 4 int16 weights, fetch them as two int32 pairs
+        __m256i pairIndex = _mm256_slli_epi32(index, 1);
+        __m256i w01 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(weights), pairIndex, 4);
+        __m256i w23 = _mm256_i32gather_epi32(reinterpret_cast<const int*>(weights), _mm256_add_epi32(pairIndex, _mm256_set1_epi32(1)), 4);
+        __m256i w11 = _mm256_and_si256(w01, lowMask);
+        __m256i w21 = _mm256_srli_epi32(w01, 16);
+        __m256i w12 = _mm256_and_si256(w23, lowMask);
+        __m256i w22 = _mm256_srli_epi32(w23, 16);
+
+        __m256i g11, g21, g12, g22;
+        if (packed) {
+            g11 = gatherWords(base, offset);
+            g21 = gatherWords(base, offsetDx);
+            g12 = gatherWords(base, offsetDy);
+            g22 = gatherWords(base, offsetFar);
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            __m256i p11, p21, p12, p22;
+            if (packed) {
+                p11 = extractChannel<T>(g11, c);
+                p21 = extractChannel<T>(g21, c);
+                p12 = extractChannel<T>(g12, c);
+                p22 = extractChannel<T>(g22, c);
+            }
+            else {
+                const T* b = base + c * channelStride;
+                p11 = _mm256_and_si256(gatherWords(b, offset), pixelMask);
+                p21 = _mm256_and_si256(gatherWords(b, offsetDx), pixelMask);
+                p12 = _mm256_and_si256(gatherWords(b, offsetDy), pixelMask);
+                p22 = _mm256_and_si256(gatherWords(b, offsetFar), pixelMask);
+            }
+
+            __m256i sum = _mm256_mullo_epi32(w11, p11);
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(w21, p21));
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(w12, p12));
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(w22, p22));
+            __m256i value = _mm256_srli_epi32(_mm256_add_epi32(sum, rounding), RemapMap::WEIGHT_BITS);
+            if (!Interior) {
+                value = _mm256_and_si256(value, valid);
+            }
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(result), value);
+            T* o = out + i * out_stride + c * out_channel_stride;
+            for (int k = 0; k < 8; ++k) {
+                o[k * out_stride] = static_cast<T>(result[k]);
+            }
+        }
+    }
+
+    scalarFallback<Interior>(XY + 2 * i, frac + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride);
+}
+
+/**
+ * @brief AVX2 source coordinates of a span of a Homography map, 4 output pixels per iteration.
+ *
+ * Repeats the operations of the scalar kernel lane by lane, so the coordinates are identical.
+ */
+PIXELTRAQ_TARGET("avx2")
+void homographyAVX2(const Matrix3x3& H, int x, int y, int count, double* X, double* Y) {
+    const __m256d h00 = _mm256_set1_pd(H[0][0]);
+    const __m256d h10 = _mm256_set1_pd(H[1][0]);
+    const __m256d h20 = _mm256_set1_pd(H[2][0]);
+    const __m256d rowX = _mm256_set1_pd(H[0][1] * y + H[0][2]);
+    const __m256d rowY = _mm256_set1_pd(H[1][1] * y + H[1][2]);
+    const __m256d rowW = _mm256_set1_pd(H[2][1] * y + H[2][2]);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d behind = _mm256_set1_pd(-1.0);
+    const __m256d step = _mm256_set1_pd(4.0);
+    __m256d px = _mm256_add_pd(_mm256_set1_pd(x), _mm256_setr_pd(0.0, 1.0, 2.0, 3.0));
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d w = _mm256_add_pd(_mm256_mul_pd(h20, px), rowW);
+        const __m256d front = _mm256_cmp_pd(w, _mm256_setzero_pd(), _CMP_GT_OQ);
+        const __m256d scale = _mm256_div_pd(one, _mm256_blendv_pd(one, w, front));
+        _mm256_storeu_pd(X + i, _mm256_blendv_pd(behind, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(h00, px), rowX), scale), front));
+        _mm256_storeu_pd(Y + i, _mm256_blendv_pd(behind, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(h10, px), rowY), scale), front));
+        px = _mm256_add_pd(px, step);
+    }
+    remapKernelsScalar().homographySpan(H, x + i, y, count - i, X + i, Y + i);
+}
+
+} // namespace
+
+/**
+ * @brief Returns the AVX2 kernels.
+ *
+ * @return The AVX2 kernel table.
+ */
+const RemapKernels& remapKernelsAVX2() {
+    static const RemapKernels kernels = {
+        RemapBackend::AVX2,
+        bilinearDoubleAVX2<false>,
+        fixedPointAVX2<uint8_t, false>,
+        fixedPointAVX2<uint16_t, false>,
+        // shared with the scalar backend
+        remapKernelsScalar().nearestDouble,
+        remapKernelsScalar().nearestU8,
+        remapKernelsScalar().nearestU16,
+        remapKernelsScalar().bicubicDouble,
+        remapKernelsScalar().bicubicU8,
+        remapKernelsScalar().bicubicU16,
+        bilinearDoubleAVX2<true>,
+        fixedPointAVX2<uint8_t, true>,
+        fixedPointAVX2<uint16_t, true>,
+        remapKernelsScalar().bicubicDoubleInterior,
+        remapKernelsScalar().bicubicInteriorU8,
+        remapKernelsScalar().bicubicInteriorU16,
+        remapKernelsScalar().areaDouble,
+        remapKernelsScalar().areaU8,
+        remapKernelsScalar().areaU16,
+        bilinearFloatAVX2<float, false>,
+        bilinearFloatAVX2<float, true>,
+        remapKernelsScalar().bicubicFloat,
+        remapKernelsScalar().bicubicFloatInterior,
+        remapKernelsScalar().nearestFloat,
+        remapKernelsScalar().areaFloat,
+        bilinearFloatAVX2<uint8_t, false>,
+        bilinearFloatAVX2<uint8_t, true>,
+        remapKernelsScalar().bicubicU8Float,
+        remapKernelsScalar().bicubicU8FloatInterior,
+        remapKernelsScalar().nearestU8Float,
+        remapKernelsScalar().areaU8Float,
+        bilinearFloatAVX2<uint16_t, false>,
+        bilinearFloatAVX2<uint16_t, true>,
+        remapKernelsScalar().bicubicU16Float,
+        remapKernelsScalar().bicubicU16FloatInterior,
+        remapKernelsScalar().nearestU16Float,
+        remapKernelsScalar().areaU16Float,
+        homographyAVX2
+    };
+    return kernels;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // PIXELTRAQ_HAVE_AVX2
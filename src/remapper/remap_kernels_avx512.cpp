@@ -0,0 +1,368 @@
+#include "remapper/remap_kernels.h"
+#include "remapper/remap_map.h"
+
+#ifdef PIXELTRAQ_HAVE_AVX512
+
+#include <immintrin.h>
+
+// GCC reports the deliberately undefined pass-through operands of the inlined AVX-512 intrinsics as maybe uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace {
+
+/**
+ * @brief Finishes a row with the scalar kernels, used for tails and groups near the end of the image.
+ */
+template <bool Interior>
+inline void scalarFallback(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint8_t>& image, uint8_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (Interior ? scalar.fixedPointInteriorU8 : scalar.fixedPointU8)(XY, frac, count, image, out, out_stride, out_channel_stride);
+}
+
+template <bool Interior>
+inline void scalarFallback(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint16_t>& image, uint16_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (Interior ? scalar.fixedPointInteriorU16 : scalar.fixedPointU16)(XY, frac, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearDoubleInterior : scalar.bilinearDouble)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+/**
+ * @brief Gathers 4 bytes for each of 16 pixels at element offsets.
+ *
+ * For interleaved images with up to 4 bytes per pixel a single gather holds every channel.
+ */
+template <typename T>
+PIXELTRAQ_TARGET("avx512f")
+inline __m512i gatherWords(const T* base, __m512i offsets) {
+    return _mm512_i32gather_epi32(offsets, reinterpret_cast<const int*>(base), sizeof(T));
+}
+
+/**
+ * @brief Extracts channel c from gathered words, masking to the pixel width.
+ */
+template <typename T>
+PIXELTRAQ_TARGET("avx512f")
+inline __m512i extractChannel(__m512i words, int c) {
+    const __m512i mask = _mm512_set1_epi32(sizeof(T) == 1 ? 0xFF : 0xFFFF);
+    return _mm512_and_si512(_mm512_srl_epi32(words, _mm_cvtsi32_si128(8 * static_cast<int>(sizeof(T)) * c)), mask);
+}
+
+// AVX-512F has its own FMA encodings, the explicit rounding forms keep the compiler from fusing a multiply and add
+PIXELTRAQ_TARGET("avx512f")
+inline __m512d mulExact(__m512d a, __m512d b) {
+    return _mm512_mul_round_pd(a, b, _MM_FROUND_CUR_DIRECTION);
+}
+
+PIXELTRAQ_TARGET("avx512f")
+inline __m512d addExact(__m512d a, __m512d b) {
+    return _mm512_add_round_pd(a, b, _MM_FROUND_CUR_DIRECTION);
+}
+
+/**
+ * @brief AVX-512 bilinear row kernel for Float64 maps, 8 output pixels per iteration.
+ *
+ * The Interior variant drops the range mask and the clamping of the taps.
+ */
+template <bool Interior>
+PIXELTRAQ_TARGET("avx512f")
+void bilinearDoubleAVX512(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    int i = 0;
+
+    if (width > 0 && height > 0) {
+        const double* base = image.data();
+        const __m512d zero = _mm512_setzero_pd();
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d maxX = _mm512_set1_pd(width);
+        const __m512d maxY = _mm512_set1_pd(height);
+        const __m256i zeroi = _mm256_setzero_si256();
+        const __m256i onei = _mm256_set1_epi32(1);
+        const __m256i lastX = _mm256_set1_epi32(width - 1);
+        const __m256i lastY = _mm256_set1_epi32(height - 1);
+        const __m256i pixelStride = _mm256_set1_epi32(static_cast<int>(image.pixelStride()));
+        const __m256i rowStride = _mm256_set1_epi32(static_cast<int>(image.rowStride()));
+        alignas(64) double result[8];
+
+        for (; i + 8 <= count; i += 8) {
+            __m512d x = _mm512_loadu_pd(X + i);
+            __m512d y = _mm512_loadu_pd(Y + i);
+            __m512d x0 = _mm512_roundscale_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            __m512d y0 = _mm512_roundscale_pd(y, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            __m512d xFrac = _mm512_sub_pd(x, x0);
+            __m512d yFrac = _mm512_sub_pd(y, y0);
+
+            __mmask8 inside = 0xFF;
+            __m256i x1, y1, x2, y2;
+            if (Interior) {
+                x1 = _mm512_cvttpd_epi32(x0);
+                y1 = _mm512_cvttpd_epi32(y0);
+                x2 = _mm256_add_epi32(x1, onei);
+                y2 = _mm256_add_epi32(y1, onei);
+            }
+            else {
+                inside = _mm512_cmp_pd_mask(x, zero, _CMP_GE_OQ) & _mm512_cmp_pd_mask(y, zero, _CMP_GE_OQ) &
+                    _mm512_cmp_pd_mask(x, maxX, _CMP_LE_OQ) & _mm512_cmp_pd_mask(y, maxY, _CMP_LE_OQ);
+                // lanes outside of the image may hold any value, zero them before the integer conversion
+                x1 = _mm512_cvttpd_epi32(_mm512_maskz_mov_pd(inside, x0));
+                y1 = _mm512_cvttpd_epi32(_mm512_maskz_mov_pd(inside, y0));
+                x2 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(x1, onei), zeroi), lastX);
+                y2 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(y1, onei), zeroi), lastY);
+                x1 = _mm256_min_epi32(_mm256_max_epi32(x1, zeroi), lastX);
+                y1 = _mm256_min_epi32(_mm256_max_epi32(y1, zeroi), lastY);
+            }
+
+            __m256i row1 = _mm256_mullo_epi32(y1, rowStride);
+            __m256i row2 = _mm256_mullo_epi32(y2, rowStride);
+            __m256i col1 = _mm256_mullo_epi32(x1, pixelStride);
+            __m256i col2 = _mm256_mullo_epi32(x2, pixelStride);
+
+            __m256i offset11 = _mm256_add_epi32(row1, col1);
+            __m256i offset12 = _mm256_add_epi32(row2, col1);
+            __m256i offset21 = _mm256_add_epi32(row1, col2);
+            __m256i offset22 = _mm256_add_epi32(row2, col2);
+            __m512d xInv = _mm512_sub_pd(one, xFrac);
+            __m512d yInv = _mm512_sub_pd(one, yFrac);
+
+            for (int c = 0; c < channels; ++c) {
+                const double* b = base + c * channelStride;
+                __m512d Q11 = _mm512_i32gather_pd(offset11, b, 8);
+                __m512d Q12 = _mm512_i32gather_pd(offset12, b, 8);
+                __m512d Q21 = _mm512_i32gather_pd(offset21, b, 8);
+                __m512d Q22 = _mm512_i32gather_pd(offset22, b, 8);
+
+                // same operation order as CommonMath::bilinearInterpolate for identical results
+                __m512d R1 = addExact(mulExact(xInv, Q11), mulExact(xFrac, Q21));
+                __m512d R2 = addExact(mulExact(xInv, Q12), mulExact(xFrac, Q22));
+                __m512d q = addExact(mulExact(yInv, R1), mulExact(yFrac, R2));
+                if (!Interior) {
+                    q = _mm512_maskz_mov_pd(inside, q);
+                }
+
+                double* o = out + i * out_stride + c * out_channel_stride;
+                if (out_stride == 1) {
+                    _mm512_storeu_pd(o, q);
+                }
+                else {
+                    _mm512_store_pd(result, q);
+                    for (int k = 0; k < 8; ++k) {
+                        o[k * out_stride] = result[k];
+                    }
+                }
+            }
+        }
+    }
+
+    scalarFallback(X + i, Y + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride, Interior);
+}
+
+/**
+ * @brief AVX-512 integer row kernel for FixedPoint maps, 16 output pixels per iteration.
+ *
+ * Interleaved images with up to 4 bytes per pixel gather each tap once for all channels.
+ * The Interior variant drops the validity mask and always reads both neighbours.
+ */
+template <typename T, bool Interior>
+PIXELTRAQ_TARGET("avx512f")
+void fixedPointAVX512(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const T>& image, T* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int16_t* weights = RemapMap::bilinearWeights();
+    const T* base = image.data();
+    const int channels = image.channels();
+    const int pixelStride = static_cast<int>(image.pixelStride());
+    const int rowStride = static_cast<int>(image.rowStride());
+    const int channelStride = static_cast<int>(image.channelStride());
+    const bool packed = channelStride == 1 && channels * sizeof(T) <= 4;
+    // a 32-bit gather reads 4 bytes, lanes of channel 0 starting beyond this offset would read past the image
+    const int lastOffset = (image.height() - 1) * rowStride + (image.width() - 1) * pixelStride - static_cast<int>(4 / sizeof(T) - 1);
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i minusOne = _mm512_set1_epi32(-1);
+    const __m512i fracMask = _mm512_set1_epi32(RemapMap::FRAC_SIZE - 1);
+    const __m512i lowMask = _mm512_set1_epi32(0xFFFF);
+    const __m512i pixelMask = _mm512_set1_epi32(sizeof(T) == 1 ? 0xFF : 0xFFFF);
+    const __m512i rounding = _mm512_set1_epi32(1 << (RemapMap::WEIGHT_BITS - 1));
+    const __m512i vPixelStride = _mm512_set1_epi32(pixelStride);
+    const __m512i vRowStride = _mm512_set1_epi32(rowStride);
+    const __m512i vLastOffset = _mm512_set1_epi32(lastOffset);
+    alignas(64) int32_t result[16];
+
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i xy = _mm512_loadu_si512(XY + 2 * i);
+        __m512i x = _mm512_srai_epi32(_mm512_slli_epi32(xy, 16), 16);
+        __m512i y = _mm512_srai_epi32(xy, 16);
+        __m512i index = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(frac + i)));
+
+        __mmask16 valid = 0xFFFF;
+        __m512i dx = vPixelStride;
+        __m512i dy = vRowStride;
+        if (!Interior) {
+            valid = _mm512_cmpgt_epi32_mask(x, minusOne);
+            x = _mm512_max_epi32(x, zero);
+            y = _mm512_max_epi32(y, zero);
+
+            // a zero fraction means the second neighbour is never weighted and may lie outside the image
+            dx = _mm512_maskz_mov_epi32(_mm512_test_epi32_mask(index, fracMask), vPixelStride);
+            dy = _mm512_maskz_mov_epi32(_mm512_cmpneq_epi32_mask(_mm512_srli_epi32(index, RemapMap::FRAC_BITS), zero), vRowStride);
+        }
+
+        __m512i offset = _mm512_add_epi32(_mm512_mullo_epi32(y, vRowStride), _mm512_mullo_epi32(x, vPixelStride));
+        __m512i offsetDx = _mm512_add_epi32(offset, dx);
+        __m512i offsetDy = _mm512_add_epi32(offset, dy);
+        __m512i offsetFar = _mm512_add_epi32(offsetDy, dx);
+
+        if (_mm512_cmpgt_epi32_mask(offsetFar, vLastOffset)) {
+            scalarFallback<Interior>(XY + 2 * i, frac + i, 16, image, out + i * out_stride, out_stride, out_channel_stride);
+            continue;
+        }
+
+        // each table entry holds 4 int16 weights, fetch them as two int32 pairs
+        __m512i pairIndex = _mm512_slli_epi32(index, 1);
+        __m512i w01 = _mm512_i32gather_epi32(pairIndex, reinterpret_cast<const int*>(weights), 4);
+        __m512i w23 = _mm512_i32gather_epi32(_mm512_add_epi32(pairIndex, _mm512_set1_epi32(1)), reinterpret_cast<const int*>(weights), 4);
+        __m512i w11 = _mm512_and_si512(w01, lowMask);
+        __m512i w21 = _mm512_srli_epi32(w01, 16);
+        __m512i w12 = _mm512_and_si512(w23, lowMask);
+        __m512i w22 = _mm512_srli_epi32(w23, 16);
+
+        __m512i g11, g21, g12, g22;
+        if (packed) {
+            g11 = gatherWords(base, offset);
+            g21 = gatherWords(base, offsetDx);
+            g12 = gatherWords(base, offsetDy);
+            g22 = gatherWords(base, offsetFar);
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            __m512i p11, p21, p12, p22;
+            if (packed) {
+                p11 = extractChannel<T>(g11, c);
+                p21 = extractChannel<T>(g21, c);
+                p12 = extractChannel<T>(g12, c);
+                p22 = extractChannel<T>(g22, c);
+            }
+            else {
+                const T* b = base + c * channelStride;
+                p11 = _mm512_and_si512(gatherWords(b, offset), pixelMask);
+                p21 = _mm512_and_si512(gatherWords(b, offsetDx), pixelMask);
+                p12 = _mm512_and_si512(gatherWords(b, offsetDy), pixelMask);
+                p22 = _mm512_and_si512(gatherWords(b, offsetFar), pixelMask);
+            }
+
+            __m512i sum = _mm512_mullo_epi32(w11, p11);
+            sum = _mm512_add_epi32(sum, _mm512_mullo_epi32(w21, p21));
+            sum = _mm512_add_epi32(sum, _mm512_mullo_epi32(w12, p12));
+            sum = _mm512_add_epi32(sum, _mm512_mullo_epi32(w22, p22));
+            __m512i value = _mm512_srli_epi32(_mm512_add_epi32(sum, rounding), RemapMap::WEIGHT_BITS);
+            if (!Interior) {
+                value = _mm512_maskz_mov_epi32(valid, value);
+            }
+
+            _mm512_store_si512(result, value);
+            T* o = out + i * out_stride + c * out_channel_stride;
+            for (int k = 0; k < 16; ++k) {
+                o[k * out_stride] = static_cast<T>(result[k]);
+            }
+        }
+    }
+
+    scalarFallback<Interior>(XY + 2 * i, frac + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride);
+}
+
+/**
+ * @brief AVX-512 source coordinates of a span of a Homography map, 8 output pixels per iteration.
+ *
+ * Repeats the operations of the scalar kernel lane by lane without fusing them, so the coordinates are identical.
+ */
+PIXELTRAQ_TARGET("avx512f")
+void homographyAVX512(const Matrix3x3& H, int x, int y, int count, double* X, double* Y) {
+    const __m512d h00 = _mm512_set1_pd(H[0][0]);
+    const __m512d h10 = _mm512_set1_pd(H[1][0]);
+    const __m512d h20 = _mm512_set1_pd(H[2][0]);
+    const __m512d rowX = _mm512_set1_pd(H[0][1] * y + H[0][2]);
+    const __m512d rowY = _mm512_set1_pd(H[1][1] * y + H[1][2]);
+    const __m512d rowW = _mm512_set1_pd(H[2][1] * y + H[2][2]);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d behind = _mm512_set1_pd(-1.0);
+    const __m512d step = _mm512_set1_pd(8.0);
+    __m512d px = _mm512_add_pd(_mm512_set1_pd(x), _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0));
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512d w = addExact(mulExact(h20, px), rowW);
+        const __mmask8 front = _mm512_cmp_pd_mask(w, _mm512_setzero_pd(), _CMP_GT_OQ);
+        const __m512d scale = _mm512_div_pd(one, _mm512_mask_blend_pd(front, one, w));
+        _mm512_storeu_pd(X + i, _mm512_mask_blend_pd(front, behind, mulExact(addExact(mulExact(h00, px), rowX), scale)));
+        _mm512_storeu_pd(Y + i, _mm512_mask_blend_pd(front, behind, mulExact(addExact(mulExact(h10, px), rowY), scale)));
+        px = _mm512_add_pd(px, step);
+    }
+    remapKernelsScalar().homographySpan(H, x + i, y, count - i, X + i, Y + i);
+}
+
+} // namespace
+
+/**
+ * @brief Returns the AVX-512 kernels.
+ *
+ * @return The AVX-512 kernel table.
+ */
+const RemapKernels& remapKernelsAVX512() {
+    static const RemapKernels kernels = {
+        RemapBackend::AVX512,
+        bilinearDoubleAVX512<false>,
+        fixedPointAVX512<uint8_t, false>,
+        fixedPointAVX512<uint16_t, false>,
+        // shared with the scalar backend
+        remapKernelsScalar().nearestDouble,
+        remapKernelsScalar().nearestU8,
+        remapKernelsScalar().nearestU16,
+        remapKernelsScalar().bicubicDouble,
+        remapKernelsScalar().bicubicU8,
+        remapKernelsScalar().bicubicU16,
+        bilinearDoubleAVX512<true>,
+        fixedPointAVX512<uint8_t, true>,
+        fixedPointAVX512<uint16_t, true>,
+        remapKernelsScalar().bicubicDoubleInterior,
+        remapKernelsScalar().bicubicInteriorU8,
+        remapKernelsScalar().bicubicInteriorU16,
+        remapKernelsScalar().areaDouble,
+        remapKernelsScalar().areaU8,
+        remapKernelsScalar().areaU16,
+        // processors with AVX-512 also support AVX2, the float kernels are shared with its backend
+        remapKernelsAVX2().bilinearFloat,
+        remapKernelsAVX2().bilinearFloatInterior,
+        remapKernelsScalar().bicubicFloat,
+        remapKernelsScalar().bicubicFloatInterior,
+        remapKernelsScalar().nearestFloat,
+        remapKernelsScalar().areaFloat,
+        remapKernelsAVX2().bilinearU8Float,
+        remapKernelsAVX2().bilinearU8FloatInterior,
+        remapKernelsScalar().bicubicU8Float,
+        remapKernelsScalar().bicubicU8FloatInterior,
+        remapKernelsScalar().nearestU8Float,
+        remapKernelsScalar().areaU8Float,
+        remapKernelsAVX2().bilinearU16Float,
+        remapKernelsAVX2().bilinearU16FloatInterior,
+        remapKernelsScalar().bicubicU16Float,
+        remapKernelsScalar().bicubicU16FloatInterior,
+        remapKernelsScalar().nearestU16Float,
+        remapKernelsScalar().areaU16Float,
+        homographyAVX512
+    };
+    return kernels;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // PIXELTRAQ_HAVE_AVX512
@@ -0,0 +1,422 @@
+#include "remapper/remap_kernels.h"
+#include "remapper/remap_map.h"
+
+#ifdef PIXELTRAQ_HAVE_SSE41
+
+#include <immintrin.h>
+
+namespace {
+
+/**
+ * @brief Finishes a row with the scalar kernels, used for the tail of a row.
+ */
+template <bool Interior>
+inline void scalarFallback(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint8_t>& image, uint8_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (Interior ? scalar.fixedPointInteriorU8 : scalar.fixedPointU8)(XY, frac, count, image, out, out_stride, out_channel_stride);
+}
+
+template <bool Interior>
+inline void scalarFallback(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const uint16_t>& image, uint16_t* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (Interior ? scalar.fixedPointInteriorU16 : scalar.fixedPointU16)(XY, frac, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearDoubleInterior : scalar.bilinearDouble)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const float>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearFloatInterior : scalar.bilinearFloat)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const uint8_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearU8FloatInterior : scalar.bilinearU8Float)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+inline void scalarFallback(const double* X, const double* Y, int count, const ImageView<const uint16_t>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride, bool interior) {
+    const RemapKernels& scalar = remapKernelsScalar();
+    (interior ? scalar.bilinearU16FloatInterior : scalar.bilinearU16Float)(X, Y, count, image, out, out_stride, out_channel_stride);
+}
+
+/**
+ * @brief SSE4.1 bilinear row kernel for Float64 maps, 2 output pixels per iteration.
+ *
+ * SSE has no gather instruction, the four taps are loaded with scalar loads from vector computed offsets.
+ * The Interior variant drops the range mask and the clamping of the taps.
+ */
+template <bool Interior>
+PIXELTRAQ_TARGET("sse4.1")
+void bilinearDoubleSSE41(const double* X, const double* Y, int count, const ImageView<const double>& image, double* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    int i = 0;
+
+    if (width > 0 && height > 0) {
+        const double* base = image.data();
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d maxX = _mm_set1_pd(width);
+        const __m128d maxY = _mm_set1_pd(height);
+        const __m128i zeroi = _mm_setzero_si128();
+        const __m128i onei = _mm_set1_epi32(1);
+        const __m128i lastX = _mm_set1_epi32(width - 1);
+        const __m128i lastY = _mm_set1_epi32(height - 1);
+        const __m128i pixelStride = _mm_set1_epi32(static_cast<int>(image.pixelStride()));
+        const __m128i rowStride = _mm_set1_epi32(static_cast<int>(image.rowStride()));
+        alignas(16) int32_t offsets[4][4];
+        alignas(16) double result[2];
+
+        for (; i + 2 <= count; i += 2) {
+            __m128d x = _mm_loadu_pd(X + i);
+            __m128d y = _mm_loadu_pd(Y + i);
+            __m128d x0 = _mm_floor_pd(x);
+            __m128d y0 = _mm_floor_pd(y);
+            __m128d xFrac = _mm_sub_pd(x, x0);
+            __m128d yFrac = _mm_sub_pd(y, y0);
+
+            __m128d inside = _mm_castsi128_pd(_mm_set1_epi32(-1));
+            __m128i x1, y1, x2, y2;
+            if (Interior) {
+                x1 = _mm_cvttpd_epi32(x0);
+                y1 = _mm_cvttpd_epi32(y0);
+                x2 = _mm_add_epi32(x1, onei);
+                y2 = _mm_add_epi32(y1, onei);
+            }
+            else {
+                inside = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(x, zero), _mm_cmpge_pd(y, zero)),
+                                    _mm_and_pd(_mm_cmple_pd(x, maxX), _mm_cmple_pd(y, maxY)));
+                // lanes outside of the image may hold any value, zero them before the integer conversion
+                x1 = _mm_cvttpd_epi32(_mm_and_pd(x0, inside));
+                y1 = _mm_cvttpd_epi32(_mm_and_pd(y0, inside));
+                x2 = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(x1, onei), zeroi), lastX);
+                y2 = _mm_min_epi32(_mm_max_epi32(_mm_add_epi32(y1, onei), zeroi), lastY);
+                x1 = _mm_min_epi32(_mm_max_epi32(x1, zeroi), lastX);
+                y1 = _mm_min_epi32(_mm_max_epi32(y1, zeroi), lastY);
+            }
+
+            __m128i row1 = _mm_mullo_epi32(y1, rowStride);
+            __m128i row2 = _mm_mullo_epi32(y2, rowStride);
+            __m128i col1 = _mm_mullo_epi32(x1, pixelStride);
+            __m128i col2 = _mm_mullo_epi32(x2, pixelStride);
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[0]), _mm_add_epi32(row1, col1));
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[1]), _mm_add_epi32(row2, col1));
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[2]), _mm_add_epi32(row1, col2));
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[3]), _mm_add_epi32(row2, col2));
+
+            __m128d xInv = _mm_sub_pd(one, xFrac);
+            __m128d yInv = _mm_sub_pd(one, yFrac);
+            for (int c = 0; c < channels; ++c) {
+                const double* b = base + c * channelStride;
+                __m128d Q11 = _mm_set_pd(b[offsets[0][1]], b[offsets[0][0]]);
+                __m128d Q12 = _mm_set_pd(b[offsets[1][1]], b[offsets[1][0]]);
+                __m128d Q21 = _mm_set_pd(b[offsets[2][1]], b[offsets[2][0]]);
+                __m128d Q22 = _mm_set_pd(b[offsets[3][1]], b[offsets[3][0]]);
+
+                // same operation order as CommonMath::bilinearInterpolate for identical results
+                __m128d R1 = _mm_add_pd(_mm_mul_pd(xInv, Q11), _mm_mul_pd(xFrac, Q21));
+                __m128d R2 = _mm_add_pd(_mm_mul_pd(xInv, Q12), _mm_mul_pd(xFrac, Q22));
+                __m128d q = _mm_add_pd(_mm_mul_pd(yInv, R1), _mm_mul_pd(yFrac, R2));
+                if (!Interior) {
+                    q = _mm_and_pd(q, inside);
+                }
+
+                _mm_store_pd(result, q);
+                double* o = out + i * out_stride + c * out_channel_stride;
+                o[0] = result[0];
+                o[out_stride] = result[1];
+            }
+        }
+    }
+
+    scalarFallback(X + i, Y + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride, Interior);
+}
+
+/**
+ * @brief SSE4.1 bilinear row kernel for Float64 maps and float outputs, 4 output pixels per iteration.
+ *
+ * The floor, the fractions and the range check run in double on two pairs of pixels, the taps
+ * of float, 8-bit and 16-bit images are loaded with scalar loads, converted to float and blended
+ * in single precision with the operation order of the scalar kernel. The Interior variant drops
+ * the range mask and the clamping of the taps.
+ */
+template <typename In, bool Interior>
+PIXELTRAQ_TARGET("sse4.1")
+void bilinearFloatSSE41(const double* X, const double* Y, int count, const ImageView<const In>& image, float* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+    int i = 0;
+
+    if (width > 0 && height > 0) {
+        const In* base = image.data();
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d maxX = _mm_set1_pd(width);
+        const __m128d maxY = _mm_set1_pd(height);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128i zeroi = _mm_setzero_si128();
+        const __m128i onei = _mm_set1_epi32(1);
+        const __m128i lastX = _mm_set1_epi32(width - 1);
+        const __m128i lastY = _mm_set1_epi32(height - 1);
+        const __m128i pixelStride = _mm_set1_epi32(static_cast<int>(image.pixelStride()));
+        const __m128i rowStride = _mm_set1_epi32(static_cast<int>(image.rowStride()));
+        alignas(16) int32_t offsets[4][4];
+        alignas(16) float result[4];
+
+        for (; i + 4 <= count; i += 4) {
+            __m128 xFrac[2], yFrac[2];
+            __m128d inside[2];
+            __m128i x1[2], y1[2];
+            for (int h = 0; h < 2; ++h) {
+                const __m128d x = _mm_loadu_pd(X + i + 2 * h);
+                const __m128d y = _mm_loadu_pd(Y + i + 2 * h);
+                __m128d x0 = _mm_floor_pd(x);
+                __m128d y0 = _mm_floor_pd(y);
+                xFrac[h] = _mm_cvtpd_ps(_mm_sub_pd(x, x0));
+                yFrac[h] = _mm_cvtpd_ps(_mm_sub_pd(y, y0));
+                inside[h] = _mm_castsi128_pd(_mm_set1_epi32(-1));
+                if (!Interior) {
+                    inside[h] = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(x, zero), _mm_cmpge_pd(y, zero)),
+                                           _mm_and_pd(_mm_cmple_pd(x, maxX), _mm_cmple_pd(y, maxY)));
+                    // lanes outside of the image may hold any value, zero them before the integer conversion
+                    x0 = _mm_and_pd(x0, inside[h]);
+                    y0 = _mm_and_pd(y0, inside[h]);
+                }
+                x1[h] = _mm_cvttpd_epi32(x0);
+                y1[h] = _mm_cvttpd_epi32(y0);
+            }
+
+            const __m128 xf = _mm_movelh_ps(xFrac[0], xFrac[1]);
+            const __m128 yf = _mm_movelh_ps(yFrac[0], yFrac[1]);
+            const __m128 xInv = _mm_sub_ps(one, xf);
+            const __m128 yInv = _mm_sub_ps(one, yf);
+            // the 64-bit masks are all ones or all zeros, either 32-bit half of a lane will do
+            const __m128 mask = _mm_shuffle_ps(_mm_castpd_ps(inside[0]), _mm_castpd_ps(inside[1]), _MM_SHUFFLE(2, 0, 2, 0));
+
+            __m128i left = _mm_unpacklo_epi64(x1[0], x1[1]);
+            __m128i top = _mm_unpacklo_epi64(y1[0], y1[1]);
+            __m128i right = _mm_add_epi32(left, onei);
+            __m128i bottom = _mm_add_epi32(top, onei);
+            if (!Interior) {
+                right = _mm_min_epi32(_mm_max_epi32(right, zeroi), lastX);
+                bottom = _mm_min_epi32(_mm_max_epi32(bottom, zeroi), lastY);
+                left = _mm_min_epi32(_mm_max_epi32(left, zeroi), lastX);
+                top = _mm_min_epi32(_mm_max_epi32(top, zeroi), lastY);
+            }
+
+            __m128i row1 = _mm_mullo_epi32(top, rowStride);
+            __m128i row2 = _mm_mullo_epi32(bottom, rowStride);
+            __m128i col1 = _mm_mullo_epi32(left, pixelStride);
+            __m128i col2 = _mm_mullo_epi32(right, pixelStride);
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[0]), _mm_add_epi32(row1, col1));
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[1]), _mm_add_epi32(row2, col1));
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[2]), _mm_add_epi32(row1, col2));
+            _mm_store_si128(reinterpret_cast<__m128i*>(offsets[3]), _mm_add_epi32(row2, col2));
+
+            for (int c = 0; c < channels; ++c) {
+                const In* b = base + c * channelStride;
+                __m128 Q[4];
+                for (int t = 0; t < 4; ++t) {
+                    Q[t] = _mm_setr_ps(static_cast<float>(b[offsets[t][0]]), static_cast<float>(b[offsets[t][1]]),
+                                       static_cast<float>(b[offsets[t][2]]), static_cast<float>(b[offsets[t][3]]));
+                }
+
+                __m128 R1 = _mm_add_ps(_mm_mul_ps(xInv, Q[0]), _mm_mul_ps(xf, Q[2]));
+                __m128 R2 = _mm_add_ps(_mm_mul_ps(xInv, Q[1]), _mm_mul_ps(xf, Q[3]));
+                __m128 q = _mm_add_ps(_mm_mul_ps(yInv, R1), _mm_mul_ps(yf, R2));
+                if (!Interior) {
+                    q = _mm_and_ps(q, mask);
+                }
+
+                _mm_store_ps(result, q);
+                float* o = out + i * out_stride + c * out_channel_stride;
+                for (int k = 0; k < 4; ++k) {
+                    o[k * out_stride] = result[k];
+                }
+            }
+        }
+    }
+
+    scalarFallback(X + i, Y + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride, Interior);
+}
+
+/**
+ * @brief SSE4.1 integer row kernel for FixedPoint maps, 4 output pixels per iteration.
+ *
+ * The Interior variant drops the validity mask and always reads both neighbours.
+ */
+template <typename T, bool Interior>
+PIXELTRAQ_TARGET("sse4.1")
+void fixedPointSSE41(const int16_t* XY, const uint16_t* frac, int count, const ImageView<const T>& image, T* out, std::ptrdiff_t out_stride, std::ptrdiff_t out_channel_stride) {
+    const int16_t* weights = RemapMap::bilinearWeights();
+    const T* base = image.data();
+    const int channels = image.channels();
+    const std::ptrdiff_t channelStride = image.channelStride();
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i fracMask = _mm_set1_epi32(RemapMap::FRAC_SIZE - 1);
+    const __m128i rounding = _mm_set1_epi32(1 << (RemapMap::WEIGHT_BITS - 1));
+    const __m128i vPixelStride = _mm_set1_epi32(static_cast<int>(image.pixelStride()));
+    const __m128i vRowStride = _mm_set1_epi32(static_cast<int>(image.rowStride()));
+    alignas(16) int32_t offsets[4][4];
+    alignas(16) int32_t indices[4];
+    alignas(16) int32_t result[4];
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i xy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(XY + 2 * i));
+        __m128i x = _mm_srai_epi32(_mm_slli_epi32(xy, 16), 16);
+        __m128i y = _mm_srai_epi32(xy, 16);
+        __m128i index = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(frac + i)));
+
+        __m128i valid = minusOne;
+        __m128i dx = vPixelStride;
+        __m128i dy = vRowStride;
+        if (!Interior) {
+            valid = _mm_cmpgt_epi32(x, minusOne);
+            x = _mm_max_epi32(x, zero);
+            y = _mm_max_epi32(y, zero);
+
+            // a zero fraction means the second neighbour is never weighted and may lie outside the image
+            dx = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(index, fracMask), zero), vPixelStride);
+            dy = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_srli_epi32(index, RemapMap::FRAC_BITS), zero), vRowStride);
+        }
+
+        __m128i offset = _mm_add_epi32(_mm_mullo_epi32(y, vRowStride), _mm_mullo_epi32(x, vPixelStride));
+        _mm_store_si128(reinterpret_cast<__m128i*>(offsets[0]), offset);
+        _mm_store_si128(reinterpret_cast<__m128i*>(offsets[1]), _mm_add_epi32(offset, dx));
+        _mm_store_si128(reinterpret_cast<__m128i*>(offsets[2]), _mm_add_epi32(offset, dy));
+        _mm_store_si128(reinterpret_cast<__m128i*>(offsets[3]), _mm_add_epi32(_mm_add_epi32(offset, dx), dy));
+        _mm_store_si128(reinterpret_cast<__m128i*>(indices), index);
+
+        // transpose the four weight quadruples into one register per tap
+        __m128i w0 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + 4 * indices[0])));
+        __m128i w1 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + 4 * indices[1])));
+        __m128i w2 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + 4 * indices[2])));
+        __m128i w3 = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(weights + 4 * indices[3])));
+        __m128i t0 = _mm_unpacklo_epi32(w0, w1);
+        __m128i t1 = _mm_unpacklo_epi32(w2, w3);
+        __m128i t2 = _mm_unpackhi_epi32(w0, w1);
+        __m128i t3 = _mm_unpackhi_epi32(w2, w3);
+        __m128i w11 = _mm_unpacklo_epi64(t0, t1);
+        __m128i w21 = _mm_unpackhi_epi64(t0, t1);
+        __m128i w12 = _mm_unpacklo_epi64(t2, t3);
+        __m128i w22 = _mm_unpackhi_epi64(t2, t3);
+
+        for (int c = 0; c < channels; ++c) {
+            const T* b = base + c * channelStride;
+            __m128i p11 = _mm_setr_epi32(b[offsets[0][0]], b[offsets[0][1]], b[offsets[0][2]], b[offsets[0][3]]);
+            __m128i p21 = _mm_setr_epi32(b[offsets[1][0]], b[offsets[1][1]], b[offsets[1][2]], b[offsets[1][3]]);
+            __m128i p12 = _mm_setr_epi32(b[offsets[2][0]], b[offsets[2][1]], b[offsets[2][2]], b[offsets[2][3]]);
+            __m128i p22 = _mm_setr_epi32(b[offsets[3][0]], b[offsets[3][1]], b[offsets[3][2]], b[offsets[3][3]]);
+
+            __m128i sum = _mm_mullo_epi32(w11, p11);
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(w21, p21));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(w12, p12));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(w22, p22));
+            __m128i value = _mm_srli_epi32(_mm_add_epi32(sum, rounding), RemapMap::WEIGHT_BITS);
+            if (!Interior) {
+                value = _mm_and_si128(value, valid);
+            }
+
+            _mm_store_si128(reinterpret_cast<__m128i*>(result), value);
+            T* o = out + i * out_stride + c * out_channel_stride;
+            for (int k = 0; k < 4; ++k) {
+                o[k * out_stride] = static_cast<T>(result[k]);
+            }
+        }
+    }
+
+    scalarFallback<Interior>(XY + 2 * i, frac + i, count - i, image, out + i * out_stride, out_stride, out_channel_stride);
+}
+
+/**
+ * @brief SSE4.1 source coordinates of a span of a Homography map, 2 output pixels per iteration.
+ *
+ * Repeats the operations of the scalar kernel lane by lane, so the coordinates are identical.
+ */
+PIXELTRAQ_TARGET("sse4.1")
+void homographySSE41(const Matrix3x3& H, int x, int y, int count, double* X, double* Y) {
+    const __m128d h00 = _mm_set1_pd(H[0][0]);
+    const __m128d h10 = _mm_set1_pd(H[1][0]);
+    const __m128d h20 = _mm_set1_pd(H[2][0]);
+    const __m128d rowX = _mm_set1_pd(H[0][1] * y + H[0][2]);
+    const __m128d rowY = _mm_set1_pd(H[1][1] * y + H[1][2]);
+    const __m128d rowW = _mm_set1_pd(H[2][1] * y + H[2][2]);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d behind = _mm_set1_pd(-1.0);
+    const __m128d step = _mm_set1_pd(2.0);
+    __m128d px = _mm_add_pd(_mm_set1_pd(x), _mm_setr_pd(0.0, 1.0));
+
+    int i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128d w = _mm_add_pd(_mm_mul_pd(h20, px), rowW);
+        const __m128d front = _mm_cmpgt_pd(w, _mm_setzero_pd());
+        const __m128d scale = _mm_div_pd(one, _mm_blendv_pd(one, w, front));
+        _mm_storeu_pd(X + i, _mm_blendv_pd(behind, _mm_mul_pd(_mm_add_pd(_mm_mul_pd(h00, px), rowX), scale), front));
+        _mm_storeu_pd(Y + i, _mm_blendv_pd(behind, _mm_mul_pd(_mm_add_pd(_mm_mul_pd(h10, px), rowY), scale), front));
+        px = _mm_add_pd(px, step);
+    }
+    remapKernelsScalar().homographySpan(H, x + i, y, count - i, X + i, Y + i);
+}
+
+} // namespace
+
+/**
+ * @brief Returns the SSE4.1 kernels.
+ *
+ * @return The SSE4.1 kernel table.
+ */
+const RemapKernels& remapKernelsSSE41() {
+    static const RemapKernels kernels = {
+        RemapBackend::SSE41,
+        bilinearDoubleSSE41<false>,
+        fixedPointSSE41<uint8_t, false>,
+        fixedPointSSE41<uint16_t, false>,
+        // shared with the scalar backend
+        remapKernelsScalar().nearestDouble,
+        remapKernelsScalar().nearestU8,
+        remapKernelsScalar().nearestU16,
+        remapKernelsScalar().bicubicDouble,
+        remapKernelsScalar().bicubicU8,
+        remapKernelsScalar().bicubicU16,
+        bilinearDoubleSSE41<true>,
+        fixedPointSSE41<uint8_t, true>,
+        fixedPointSSE41<uint16_t, true>,
+        remapKernelsScalar().bicubicDoubleInterior,
+        remapKernelsScalar().bicubicInteriorU8,
+        remapKernelsScalar().bicubicInteriorU16,
+        remapKernelsScalar().areaDouble,
+        remapKernelsScalar().areaU8,
+        remapKernelsScalar().areaU16,
+        bilinearFloatSSE41<float, false>,
+        bilinearFloatSSE41<float, true>,
+        remapKernelsScalar().bicubicFloat,
+        remapKernelsScalar().bicubicFloatInterior,
+        remapKernelsScalar().nearestFloat,
+        remapKernelsScalar().areaFloat,
+        bilinearFloatSSE41<uint8_t, false>,
+        bilinearFloatSSE41<uint8_t, true>,
+        remapKernelsScalar().bicubicU8Float,
+        remapKernelsScalar().bicubicU8FloatInterior,
+        remapKernelsScalar().nearestU8Float,
+        remapKernelsScalar().areaU8Float,
+        bilinearFloatSSE41<uint16_t, false>,
+        bilinearFloatSSE41<uint16_t, true>,
+        remapKernelsScalar().bicubicU16Float,
+        remapKernelsScalar().bicubicU16FloatInterior,
+        remapKernelsScalar().nearestU16Float,
+        remapKernelsScalar().areaU16Float,
+        homographySSE41
+    };
+    return kernels;
+}
+
+#endif // PIXELTRAQ_HAVE_SSE41
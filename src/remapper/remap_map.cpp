@@ -0,0 +1,2462 @@
+#include "remapper/remap_map.h"
+#include "utilities/common_math.h"
+#include "utilities/cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// definitions of the constants declared in the class, needed when they are bound to references
+const int RemapMap::FRAC_BITS;
+const int RemapMap::FRAC_SIZE;
+const int RemapMap::WEIGHT_BITS;
+const int RemapMap::TILE_BLOCK;
+const int RemapMap::MAX_TILE;
+const int RemapMap::MIN_RUN;
+const int RemapMap::AREA_WEIGHT_BITS;
+const int RemapMap::MAP_CHUNK_PIXELS;
+
+namespace {
+
+/**
+ * @brief Quantizes a source coordinate to the FixedPoint representation with border clamping baked in.
+ *
+ * Follows the conventions of CommonMath::bilinearInterpolate: coordinates outside [0, width] x [0, height]
+ * are invalid and neighbours beyond the last row or column collapse onto it, which is equivalent to a zero
+ * sub-pixel fraction in that axis.
+ *
+ * @param x The x-coordinate in the source image.
+ * @param y The y-coordinate in the source image.
+ * @param width Width of the source image.
+ * @param height Height of the source image.
+ * @param ix The integer x-coordinate of the top left neighbour.
+ * @param iy The integer y-coordinate of the top left neighbour.
+ * @param index The index into the bilinear weight table.
+ * @return False if the coordinate lies outside of the source image.
+ */
+inline bool quantizeCoordinate(double x, double y, int width, int height, int& ix, int& iy, int& index) {
+    if (!(x >= 0 && y >= 0 && x <= width && y <= height)) {
+        return false;
+    }
+
+    int qx = static_cast<int>(std::lround(x * RemapMap::FRAC_SIZE));
+    int qy = static_cast<int>(std::lround(y * RemapMap::FRAC_SIZE));
+    ix = qx >> RemapMap::FRAC_BITS;
+    iy = qy >> RemapMap::FRAC_BITS;
+    int fx = qx & (RemapMap::FRAC_SIZE - 1);
+    int fy = qy & (RemapMap::FRAC_SIZE - 1);
+
+    if (ix >= width - 1) {
+        ix = width - 1;
+        fx = 0;
+    }
+    if (iy >= height - 1) {
+        iy = height - 1;
+        fy = 0;
+    }
+
+    index = fy * RemapMap::FRAC_SIZE + fx;
+    return true;
+}
+
+// blends the four neighbours with fixed point weights summing to 1 << WEIGHT_BITS
+template <typename T>
+inline T blendFixed(T q11, T q21, T q12, T q22, const int16_t* w) {
+    int sum = w[0] * q11 + w[1] * q21 + w[2] * q12 + w[3] * q22;
+    return static_cast<T>((sum + (1 << (RemapMap::WEIGHT_BITS - 1))) >> RemapMap::WEIGHT_BITS);
+}
+
+template <>
+inline double blendFixed<double>(double q11, double q21, double q12, double q22, const int16_t* w) {
+    return (w[0] * q11 + w[1] * q21 + w[2] * q12 + w[3] * q22) * (1.0 / (1 << RemapMap::WEIGHT_BITS));
+}
+
+template <>
+inline float blendFixed<float>(float q11, float q21, float q12, float q22, const int16_t* w) {
+    return (w[0] * q11 + w[1] * q21 + w[2] * q12 + w[3] * q22) * (1.0f / (1 << RemapMap::WEIGHT_BITS));
+}
+
+/**
+ * @brief Rounds a source coordinate to its nearest pixel, with the valid region of quantizeCoordinate.
+ *
+ * @param x The x-coordinate in the source image.
+ * @param y The y-coordinate in the source image.
+ * @param width Width of the source image.
+ * @param height Height of the source image.
+ * @param ix Receives the column of the nearest pixel.
+ * @param iy Receives the row of the nearest pixel.
+ * @return False if the coordinate lies outside the source image.
+ */
+inline bool nearestCoordinate(double x, double y, int width, int height, int& ix, int& iy) {
+    if (!(x >= 0 && y >= 0 && x <= width && y <= height)) {
+        return false;
+    }
+    ix = std::min(static_cast<int>(x + 0.5), width - 1);
+    iy = std::min(static_cast<int>(y + 0.5), height - 1);
+    return true;
+}
+
+// selects the floating point row kernels for an input and output pixel type, the interior ones for spans of Interior pixels
+inline RemapKernels::BilinearDouble floatingKernel(const RemapKernels& kernels, RemapInterpolation interpolation, bool interior, double, double) {
+    if (interpolation == RemapInterpolation::Bicubic) {
+        return interior ? kernels.bicubicDoubleInterior : kernels.bicubicDouble;
+    }
+    return interior ? kernels.bilinearDoubleInterior : kernels.bilinearDouble;
+}
+
+inline RemapKernels::BilinearFloat floatingKernel(const RemapKernels& kernels, RemapInterpolation interpolation, bool interior, float, float) {
+    if (interpolation == RemapInterpolation::Bicubic) {
+        return interior ? kernels.bicubicFloatInterior : kernels.bicubicFloat;
+    }
+    return interior ? kernels.bilinearFloatInterior : kernels.bilinearFloat;
+}
+
+inline RemapKernels::BilinearU8Float floatingKernel(const RemapKernels& kernels, RemapInterpolation interpolation, bool interior, uint8_t, float) {
+    if (interpolation == RemapInterpolation::Bicubic) {
+        return interior ? kernels.bicubicU8FloatInterior : kernels.bicubicU8Float;
+    }
+    return interior ? kernels.bilinearU8FloatInterior : kernels.bilinearU8Float;
+}
+
+inline RemapKernels::BilinearU16Float floatingKernel(const RemapKernels& kernels, RemapInterpolation interpolation, bool interior, uint16_t, float) {
+    if (interpolation == RemapInterpolation::Bicubic) {
+        return interior ? kernels.bicubicU16FloatInterior : kernels.bicubicU16Float;
+    }
+    return interior ? kernels.bilinearU16FloatInterior : kernels.bilinearU16Float;
+}
+
+// selects the integer row kernels for a pixel type, the interior ones for spans of Interior pixels
+inline RemapKernels::FixedPointU8 integerKernel(const RemapKernels& kernels, RemapInterpolation interpolation, bool interior, uint8_t) {
+    if (interpolation == RemapInterpolation::Bicubic) {
+        return interior ? kernels.bicubicInteriorU8 : kernels.bicubicU8;
+    }
+    return interior ? kernels.fixedPointInteriorU8 : kernels.fixedPointU8;
+}
+
+inline RemapKernels::FixedPointU16 integerKernel(const RemapKernels& kernels, RemapInterpolation interpolation, bool interior, uint16_t) {
+    if (interpolation == RemapInterpolation::Bicubic) {
+        return interior ? kernels.bicubicInteriorU16 : kernels.bicubicU16;
+    }
+    return interior ? kernels.fixedPointInteriorU16 : kernels.fixedPointU16;
+}
+
+inline RemapKernels::NearestDouble nearestKernel(const RemapKernels& kernels, double, double) {
+    return kernels.nearestDouble;
+}
+
+inline RemapKernels::NearestFloat nearestKernel(const RemapKernels& kernels, float, float) {
+    return kernels.nearestFloat;
+}
+
+inline RemapKernels::NearestU8 nearestKernel(const RemapKernels& kernels, uint8_t, uint8_t) {
+    return kernels.nearestU8;
+}
+
+inline RemapKernels::NearestU16 nearestKernel(const RemapKernels& kernels, uint16_t, uint16_t) {
+    return kernels.nearestU16;
+}
+
+inline RemapKernels::NearestU8Float nearestKernel(const RemapKernels& kernels, uint8_t, float) {
+    return kernels.nearestU8Float;
+}
+
+inline RemapKernels::NearestU16Float nearestKernel(const RemapKernels& kernels, uint16_t, float) {
+    return kernels.nearestU16Float;
+}
+
+inline RemapKernels::AreaDouble areaKernel(const RemapKernels& kernels, double, double) {
+    return kernels.areaDouble;
+}
+
+inline RemapKernels::AreaFloat areaKernel(const RemapKernels& kernels, float, float) {
+    return kernels.areaFloat;
+}
+
+inline RemapKernels::AreaU8 areaKernel(const RemapKernels& kernels, uint8_t, uint8_t) {
+    return kernels.areaU8;
+}
+
+inline RemapKernels::AreaU16 areaKernel(const RemapKernels& kernels, uint16_t, uint16_t) {
+    return kernels.areaU16;
+}
+
+inline RemapKernels::AreaU8Float areaKernel(const RemapKernels& kernels, uint8_t, float) {
+    return kernels.areaU8Float;
+}
+
+inline RemapKernels::AreaU16Float areaKernel(const RemapKernels& kernels, uint16_t, float) {
+    return kernels.areaU16Float;
+}
+
+/**
+ * @brief Computes the number of samples along one axis of an output pixel from the distance of its neighbours in the source.
+ *
+ * @param a The source coordinate of the previous neighbour, or of the pixel itself at the border.
+ * @param b The source coordinate of the next neighbour, or of the pixel itself at the border.
+ * @param steps Number of output pixels between a and b.
+ * @param max_samples The largest number of samples.
+ * @return One sample per source pixel covered, at least one.
+ */
+inline int areaSamples(const std::array<double, 2>& a, const std::array<double, 2>& b, int steps, int max_samples) {
+    if (steps == 0) {
+        return 1;
+    }
+    const double extent = std::hypot(b[0] - a[0], b[1] - a[1]) / steps;
+    if (!std::isfinite(extent)) {
+        return 1;
+    }
+    return CommonMath::clamp(static_cast<int>(std::ceil(extent - 1e-6)), 1, max_samples);
+}
+
+/**
+ * @brief Zero-fills a span of output pixels outside the valid region of the map.
+ *
+ * @param output The remapped image.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ */
+template <typename T>
+inline void clearSpan(const ImageView<T>& output, int x, int y, int count) {
+    const std::ptrdiff_t pixelStride = output.pixelStride();
+    if (output.channelStride() == 1 && pixelStride == output.channels()) {
+        T* o = output.row(y) + x * pixelStride;
+        std::fill(o, o + count * pixelStride, T());
+        return;
+    }
+    for (int c = 0; c < output.channels(); ++c) {
+        T* o = output.row(y, c) + x * pixelStride;
+        for (int i = 0; i < count; ++i) {
+            o[i * pixelStride] = T();
+        }
+    }
+}
+
+/**
+ * @brief Computes the weights of the four control points around a position within a grid cell.
+ *
+ * The taps belong to the control points at offsets -1, 0, 1 and 2 from the cell origin.
+ *
+ * @param interpolation The interpolation of the control grid.
+ * @param t The position within the cell in [0, 1).
+ * @param w The four tap weights.
+ */
+inline void gridWeights(GridInterpolation interpolation, double t, double w[4]) {
+    if (interpolation == GridInterpolation::Bilinear) {
+        w[0] = 0.0;
+        w[1] = 1.0 - t;
+        w[2] = t;
+        w[3] = 0.0;
+        return;
+    }
+
+    CommonMath::catmullRomWeights(t, w);
+}
+
+/**
+ * @brief Reads a control point, extrapolating linearly by one point beyond every border.
+ *
+ * Clamping instead would flatten the spline at the image borders, where the distortion is strongest.
+ *
+ * @param grid The control points.
+ * @param i The column, clamped to [-1, grid width].
+ * @param j The row, clamped to [-1, grid height].
+ * @return The control point value.
+ */
+inline double gridValue(const ImageView<const double>& grid, int i, int j) {
+    const int width = grid.width();
+    const int height = grid.height();
+    i = CommonMath::clamp(i, -1, width);
+    j = CommonMath::clamp(j, -1, height);
+
+    if (height < 2) {
+        j = 0;
+    }
+    else if (j < 0) {
+        return 2.0 * gridValue(grid, i, 0) - gridValue(grid, i, 1);
+    }
+    else if (j == height) {
+        return 2.0 * gridValue(grid, i, height - 1) - gridValue(grid, i, height - 2);
+    }
+
+    if (width < 2) {
+        i = 0;
+    }
+    else if (i < 0) {
+        return 2.0 * grid(0, j) - grid(1, j);
+    }
+    else if (i == width) {
+        return 2.0 * grid(width - 1, j) - grid(width - 2, j);
+    }
+    return grid(i, j);
+}
+
+/**
+ * @brief Appends the merged and quantized taps of one Area pixel.
+ *
+ * Every sample contributes the four bilinear taps of its position, taps on the same source pixel
+ * are merged and the weights quantized to sum to 1 << AREA_WEIGHT_BITS.
+ *
+ * @param samples Source coordinates of the samples of the pixel.
+ * @param count Number of samples.
+ * @param source_width Width of the source image.
+ * @param source_height Height of the source image.
+ * @param taps Scratch list of (source index, weight) pairs.
+ * @param out Receives the (source index, weight) pairs of the pixel, nothing if no sample lies inside the source.
+ */
+void appendAreaTaps(const std::array<double, 2>* samples, size_t count, int source_width, int source_height,
+                    std::vector<std::pair<int32_t, double>>& taps, std::vector<int32_t>& out) {
+    taps.clear();
+    int valid = 0;
+    for (size_t k = 0; k < count; ++k) {
+        const double sx = samples[k][0];
+        const double sy = samples[k][1];
+        if (!(sx >= 0 && sy >= 0 && sx <= source_width && sy <= source_height)) {
+            continue;
+        }
+        // bilinear taps with the border handling of CommonMath::bilinearInterpolate
+        const int ix = std::min(static_cast<int>(sx), source_width - 1);
+        const int iy = std::min(static_cast<int>(sy), source_height - 1);
+        const double fx = sx - ix;
+        const double fy = sy - iy;
+        const int ix2 = std::min(ix + 1, source_width - 1);
+        const int iy2 = std::min(iy + 1, source_height - 1);
+        taps.push_back({ iy * source_width + ix, (1 - fx) * (1 - fy) });
+        taps.push_back({ iy * source_width + ix2, fx * (1 - fy) });
+        taps.push_back({ iy2 * source_width + ix, (1 - fx) * fy });
+        taps.push_back({ iy2 * source_width + ix2, fx * fy });
+        ++valid;
+    }
+    if (valid == 0) {
+        return;
+    }
+
+    std::sort(taps.begin(), taps.end());
+    const size_t pixelStart = out.size();
+    const double scale = static_cast<double>(1 << RemapMap::AREA_WEIGHT_BITS) / valid;
+    int sum = 0;
+    size_t largest = pixelStart;
+    for (size_t t = 0; t < taps.size();) {
+        double weight = 0.0;
+        size_t end = t;
+        for (; end < taps.size() && taps[end].first == taps[t].first; ++end) {
+            weight += taps[end].second;
+        }
+        const int quantized = static_cast<int>(std::lround(weight * scale));
+        if (quantized > 0) {
+            if (out.size() == pixelStart || quantized > out[largest + 1]) {
+                largest = out.size();
+            }
+            out.push_back(taps[t].first);
+            out.push_back(quantized);
+            sum += quantized;
+        }
+        t = end;
+    }
+    // the rounding error goes to the largest weight, so flat regions stay flat
+    if (out.size() > pixelStart) {
+        out[largest + 1] += (1 << RemapMap::AREA_WEIGHT_BITS) - sum;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a map from per-pixel source coordinates.
+ *
+ * @param Xd The source x-coordinate of every output pixel.
+ * @param Yd The source y-coordinate of every output pixel.
+ * @param source_width Width of the source image the map samples from.
+ * @param source_height Height of the source image the map samples from.
+ * @param format The storage format of the map, Index maps sample with Nearest interpolation.
+ * @throws std::invalid_argument if the coordinate grids differ in size or the source is too large for FixedPoint, Index or Offset16.
+ */
+RemapMap::RemapMap(Image<double> Xd, Image<double> Yd, int source_width, int source_height, MapFormat format)
+    : map_width(Xd.width()), map_height(Xd.height()), source_width(source_width), source_height(source_height), map_format(format) {
+
+    if (Xd.width() != Yd.width() || Xd.height() != Yd.height()) {
+        throw std::invalid_argument("Coordinate grids must have matching dimensions.");
+    }
+
+    if (format == MapFormat::ControlGrid) {
+        throw std::invalid_argument("ControlGrid maps are built from control points, see RemapMap::fromControlGrid.");
+    }
+    if (format == MapFormat::Area) {
+        throw std::invalid_argument("Area maps are built from a mapping, see RemapMap::fromArea.");
+    }
+    if (format == MapFormat::Homography) {
+        throw std::invalid_argument("Homography maps are built from a matrix, see RemapMap::fromHomography.");
+    }
+
+    if (format == MapFormat::FixedPoint) {
+        buildFixedPoint(Xd, Yd);
+    }
+    else if (format == MapFormat::Index) {
+        map_interpolation = RemapInterpolation::Nearest;
+        buildIndex(Xd, Yd);
+    }
+    else if (format != MapFormat::Float64) {
+        buildCompact(Xd, Yd);
+    }
+    else {
+        adopt(std::move(Xd), std::move(Yd), this->Xd, this->Yd);
+    }
+}
+
+/**
+ * @brief Constructs a map from source coordinates sampled on a coarse control grid.
+ *
+ * Control point (i, j) holds the source coordinate of output pixel (i * spacing, j * spacing). The grid
+ * must cover the whole output, i.e. (grid width - 1) * spacing >= width - 1 and likewise for the height.
+ *
+ * @param Xg The source x-coordinate of every control point.
+ * @param Yg The source y-coordinate of every control point.
+ * @param spacing Distance between control points in output pixels.
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @param source_width Width of the source image the map samples from.
+ * @param source_height Height of the source image the map samples from.
+ * @param interpolation The interpolation between control points.
+ * @throws std::invalid_argument if the grid does not cover the output.
+ */
+RemapMap::RemapMap(Image<double> Xg, Image<double> Yg, int spacing, int width, int height, int source_width, int source_height, GridInterpolation interpolation)
+    : map_width(width), map_height(height), source_width(source_width), source_height(source_height), map_format(MapFormat::ControlGrid),
+      grid_spacing(spacing), grid_interpolation(interpolation) {
+
+    if (Xg.width() != Yg.width() || Xg.height() != Yg.height()) {
+        throw std::invalid_argument("Coordinate grids must have matching dimensions.");
+    }
+    if (spacing < 1 || (Xg.width() - 1) * spacing < width - 1 || (Xg.height() - 1) * spacing < height - 1) {
+        throw std::invalid_argument("Control grid does not cover the output image.");
+    }
+
+    adopt(std::move(Xg), std::move(Yg), this->Xg, this->Yg);
+}
+
+/**
+ * @brief Moves two coordinate planes into shared storage and points the views at them.
+ *
+ * @param first The first plane.
+ * @param second The second plane.
+ * @param first_view Receives the view of the first plane.
+ * @param second_view Receives the view of the second plane.
+ */
+template <typename A, typename B>
+void RemapMap::adopt(Image<A> first, Image<B> second, ImageView<const A>& first_view, ImageView<const B>& second_view) {
+    auto planes = std::make_shared<std::pair<Image<A>, Image<B>>>(std::move(first), std::move(second));
+    first_view = planes->first;
+    second_view = planes->second;
+    storage = planes;
+}
+
+/**
+ * @brief Builds a ControlGrid map by evaluating a mapping only at the control points.
+ *
+ * The mapping is evaluated on a grid with the requested spacing and the interpolated coordinates are
+ * compared against the exact mapping at the cell centers. The spacing is halved until the largest
+ * deviation among the samples that fall inside the source image is at most options.max_error, a
+ * max_error of zero or less accepts the initial spacing. A sample inside the source whose
+ * interpolated coordinate is not finite, next to a control point the mapping leaves undefined,
+ * exceeds any tolerance, so the grid never drops pixels the dense map keeps.
+ *
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @param source_width Width of the source image the map samples from.
+ * @param source_height Height of the source image the map samples from.
+ * @param mapping Maps output pixels to source coordinates.
+ * @param options Spacing, tolerance and interpolation of the grid.
+ * @return The control grid map, gridError() holds the measured deviation.
+ * @throws std::invalid_argument if the spacing is smaller than one.
+ */
+RemapMap RemapMap::fromControlGrid(int width, int height, int source_width, int source_height, const PointMapping& mapping, const ControlGridOptions& options) {
+    if (options.spacing < 1) {
+        throw std::invalid_argument("Control grid spacing must be at least one pixel.");
+    }
+
+    for (int spacing = options.spacing; ; spacing = std::max(1, spacing / 2)) {
+        const int gridWidth = (std::max(width, 1) - 1 + spacing - 1) / spacing + 1;
+        const int gridHeight = (std::max(height, 1) - 1 + spacing - 1) / spacing + 1;
+
+        std::vector<std::array<double, 2>> points;
+        points.reserve(static_cast<size_t>(gridWidth) * gridHeight);
+        for (int j = 0; j < gridHeight; ++j) {
+            for (int i = 0; i < gridWidth; ++i) {
+                points.push_back({ static_cast<double>(i * spacing), static_cast<double>(j * spacing) });
+            }
+        }
+        std::vector<std::array<double, 2>> coordinates = mapping(points);
+
+        Image<double> Xg(gridWidth, gridHeight);
+        Image<double> Yg(gridWidth, gridHeight);
+        for (size_t i = 0; i < coordinates.size(); ++i) {
+            Xg.data()[i] = coordinates[i][0];
+            Yg.data()[i] = coordinates[i][1];
+        }
+        RemapMap map(std::move(Xg), std::move(Yg), spacing, width, height, source_width, source_height, options.interpolation);
+
+        if (spacing == 1 || options.max_error <= 0) {
+            return map;
+        }
+
+        // cell centers are furthest from the control points
+        std::vector<std::array<double, 2>> samples;
+        for (int y = spacing / 2; y < height; y += spacing) {
+            for (int x = spacing / 2; x < width; x += spacing) {
+                samples.push_back({ static_cast<double>(x), static_cast<double>(y) });
+            }
+        }
+        std::vector<std::array<double, 2>> exact = mapping(samples);
+
+        double error = 0.0;
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const std::array<double, 2>& e = exact[i];
+            if (!(e[0] >= 0 && e[1] >= 0 && e[0] <= source_width && e[1] <= source_height)) {
+                continue;
+            }
+            std::array<double, 2> a = map.coordinate(static_cast<int>(samples[i][0]), static_cast<int>(samples[i][1]));
+            const double deviation = std::hypot(a[0] - e[0], a[1] - e[1]);
+            error = std::isfinite(deviation) ? std::max(error, deviation) : std::numeric_limits<double>::infinity();
+        }
+        map.grid_error = error;
+
+        if (error <= options.max_error) {
+            return map;
+        }
+    }
+}
+
+/**
+ * @brief Calls chunk(first_row, pixels) for bands of rows of a pixel grid, in parallel on the current executor.
+ *
+ * Every band generates its own pixel coordinates, so no list of all pixels is created and the
+ * temporaries of the chunk function are bounded by the band size times the number of threads.
+ *
+ * @param width Width of the grid.
+ * @param height Height of the grid.
+ * @param chunk Called with the first row of a band and the coordinates of its pixels in row-major order.
+ */
+void RemapMap::forEachRowChunk(int width, int height, const RowChunk& chunk) {
+    const int rows = std::max(1, MAP_CHUNK_PIXELS / std::max(width, 1));
+    const long chunks = (height + rows - 1) / rows;
+    Executor::current().parallelFor(chunks, [&](long begin, long end) {
+        std::vector<std::array<double, 2>> pixels;
+        for (long c = begin; c < end; ++c) {
+            const int first_row = static_cast<int>(c) * rows;
+            const int last_row = std::min(first_row + rows, height);
+            pixels.clear();
+            for (int y = first_row; y < last_row; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    pixels.push_back({ static_cast<double>(x), static_cast<double>(y) });
+                }
+            }
+            chunk(first_row, pixels);
+        }
+    });
+}
+
+/**
+ * @brief Builds an Area map, which averages the source footprint of every output pixel.
+ *
+ * The footprint of output pixel (x, y) is the square [x - 0.5, x + 0.5] x [y - 0.5, y + 0.5]
+ * carried into the source by the mapping. Its extent along each axis is measured from the
+ * source coordinates of the neighbouring pixels, and the square is covered by one sample per
+ * source pixel along that axis, up to options.max_samples. Every sample is mapped exactly and
+ * contributes its bilinear taps, so the precomputed weights of a pixel approximate the source
+ * area it covers. Shrinking maps thereby filter instead of alias, while maps that do not shrink
+ * take a single sample at the pixel center and equal bilinear sampling.
+ *
+ * A pixel is valid if its center maps into [0, source width] x [0, source height], samples
+ * outside it are left out of the average. Duplicate taps are merged and the weights of every
+ * pixel are quantized to sum exactly to 1 << AREA_WEIGHT_BITS.
+ *
+ * The map is built in bands of rows, see forEachRowChunk, and the samples of a band are mapped
+ * in chunks, so building needs little memory beyond the taps of the map.
+ *
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @param source_width Width of the source image the map samples from.
+ * @param source_height Height of the source image the map samples from.
+ * @param mapping Maps output pixels to source coordinates.
+ * @param options The sample limit of the footprints.
+ * @return The Area map.
+ * @throws std::invalid_argument if max_samples is smaller than one or the source or the taps are too large for 32-bit indices.
+ */
+RemapMap RemapMap::fromArea(int width, int height, int source_width, int source_height, const PointMapping& mapping, const AreaOptions& options) {
+    if (options.max_samples < 1) {
+        throw std::invalid_argument("Area maps need at least one sample per axis.");
+    }
+    if (static_cast<int64_t>(source_width) * source_height > std::numeric_limits<int32_t>::max()) {
+        throw std::invalid_argument("Source image is too large for an Area map.");
+    }
+
+    RemapMap map;
+    map.map_width = width;
+    map.map_height = height;
+    map.source_width = source_width;
+    map.source_height = source_height;
+    map.map_format = MapFormat::Area;
+    map.map_interpolation = RemapInterpolation::Area;
+
+    // taps of every row, with the starts of its pixels relative to the row
+    std::vector<std::vector<int32_t>> rowTaps(height);
+    std::vector<std::vector<uint32_t>> rowStarts(height);
+
+    // a band maps the centers of its rows and of the rows next to it, which set the footprints, then
+    // the samples of its pixels about MAP_CHUNK_PIXELS at a time, so no list of all samples exists
+    forEachRowChunk(width, height, [&](int first_row, const std::vector<std::array<double, 2>>& pixels) {
+        if (pixels.empty()) {
+            return;
+        }
+        const int rows = static_cast<int>(pixels.size() / width);
+        const int above = first_row > 0 ? 1 : 0;
+        const int below = first_row + rows < height ? 1 : 0;
+        std::vector<std::array<double, 2>> points;
+        points.reserve(pixels.size() + static_cast<size_t>(above + below) * width);
+        for (int x = 0; x < width * above; ++x) {
+            points.push_back({ static_cast<double>(x), first_row - 1.0 });
+        }
+        points.insert(points.end(), pixels.begin(), pixels.end());
+        for (int x = 0; x < width * below; ++x) {
+            points.push_back({ static_cast<double>(x), static_cast<double>(first_row + rows) });
+        }
+        const std::vector<std::array<double, 2>> centers = mapping(points);
+        auto center = [&](int x, int y) -> const std::array<double, 2>& {
+            return centers[static_cast<size_t>(y - first_row + above) * width + x];
+        };
+
+        // pixels whose samples are in points, and their sample counts per axis
+        struct Pending {
+            int x, y, nx, ny;
+        };
+        std::vector<Pending> pending;
+        std::vector<std::pair<int32_t, double>> taps;
+        points.clear();
+        auto flush = [&]() {
+            const std::vector<std::array<double, 2>> samples = points.empty() ? points : mapping(points);
+            size_t k = 0;
+            for (const Pending& p : pending) {
+                std::vector<int32_t>& out = rowTaps[p.y];
+                rowStarts[p.y][p.x] = static_cast<uint32_t>(out.size() / 2);
+                const size_t count = static_cast<size_t>(p.nx) * p.ny;
+                appendAreaTaps(samples.data() + k, count, source_width, source_height, taps, out);
+                k += count;
+            }
+            pending.clear();
+            points.clear();
+        };
+
+        for (int y = first_row; y < first_row + rows; ++y) {
+            rowStarts[y].resize(width + 1);
+            for (int x = 0; x < width; ++x) {
+                const std::array<double, 2>& c = center(x, y);
+                Pending p = { x, y, 0, 0 };
+                if (c[0] >= 0 && c[1] >= 0 && c[0] <= source_width && c[1] <= source_height) {
+                    const int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, width - 1);
+                    const int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, height - 1);
+                    p.nx = areaSamples(center(x0, y), center(x1, y), x1 - x0, options.max_samples);
+                    p.ny = areaSamples(center(x, y0), center(x, y1), y1 - y0, options.max_samples);
+                    for (int j = 0; j < p.ny; ++j) {
+                        for (int k = 0; k < p.nx; ++k) {
+                            points.push_back({ x - 0.5 + (k + 0.5) / p.nx, y - 0.5 + (j + 0.5) / p.ny });
+                        }
+                    }
+                }
+                pending.push_back(p);
+                if (points.size() >= static_cast<size_t>(MAP_CHUNK_PIXELS)) {
+                    flush();
+                }
+            }
+        }
+        flush();
+        for (int y = first_row; y < first_row + rows; ++y) {
+            rowStarts[y][width] = static_cast<uint32_t>(rowTaps[y].size() / 2);
+        }
+    });
+
+    size_t total = 0;
+    for (int y = 0; y < height; ++y) {
+        total += rowTaps[y].size() / 2;
+    }
+    if (total > std::numeric_limits<uint32_t>::max() || total > static_cast<size_t>(std::numeric_limits<int>::max())) {
+        throw std::invalid_argument("Area map has too many taps for 32-bit offsets.");
+    }
+
+    Image<uint32_t> startImage(width + 1, height);
+    Image<int32_t> tapImage(static_cast<int>(total), 1, 2);
+    size_t offset = 0;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x <= width; ++x) {
+            startImage(x, y) = static_cast<uint32_t>(offset + rowStarts[y][x]);
+        }
+        std::copy(rowTaps[y].begin(), rowTaps[y].end(), tapImage.data() + 2 * offset);
+        offset += rowTaps[y].size() / 2;
+        std::vector<int32_t>().swap(rowTaps[y]);
+    }
+    map.adopt(std::move(startImage), std::move(tapImage), map.area_start, map.area_taps);
+    return map;
+}
+
+/**
+ * @brief Builds a Homography map, which computes the source coordinates of every span while remapping.
+ *
+ * @param width Width of the output image.
+ * @param height Height of the output image.
+ * @param source_width Width of the source image the map samples from.
+ * @param source_height Height of the source image the map samples from.
+ * @param homography Maps the output pixel (x, y, 1) to the source pixel up to scale.
+ * @return The map.
+ * @throws std::invalid_argument if the output size is negative or the homography is not finite.
+ */
+RemapMap RemapMap::fromHomography(int width, int height, int source_width, int source_height, const Matrix3x3& homography) {
+    if (width < 0 || height < 0) {
+        throw std::invalid_argument("The map size must not be negative.");
+    }
+    for (const auto& row : homography) {
+        for (double value : row) {
+            if (!std::isfinite(value)) {
+                throw std::invalid_argument("The homography must be finite.");
+            }
+        }
+    }
+
+    RemapMap map;
+    map.map_width = width;
+    map.map_height = height;
+    map.source_width = source_width;
+    map.source_height = source_height;
+    map.map_format = MapFormat::Homography;
+    map.homography = homography;
+    return map;
+}
+
+/**
+ * @brief Expands one row of a ControlGrid map into per-pixel source coordinates.
+ *
+ * The control rows are first combined vertically into one line of control points, which is then
+ * interpolated horizontally, so the cost per pixel is four taps per coordinate.
+ *
+ * @param y The output row.
+ * @param X Receives count source x-coordinates.
+ * @param Y Receives count source y-coordinates.
+ * @param x The first output column.
+ * @param count Number of output pixels, -1 expands to the end of the row.
+ */
+void RemapMap::expandRow(int y, double* X, double* Y, int x, int count) const {
+    std::vector<double> lineX(Xg.width() + 2);
+    std::vector<double> lineY(Xg.width() + 2);
+    expandSpan(y, X, Y, x, count, lineX.data(), lineY.data());
+}
+
+/**
+ * @brief Expands a span of a ControlGrid row with caller-provided scratch for the combined control points.
+ *
+ * @param y The output row.
+ * @param X Receives count source x-coordinates.
+ * @param Y Receives count source y-coordinates.
+ * @param x The first output column.
+ * @param count Number of output pixels, -1 expands to the end of the row.
+ * @param lineX Scratch for grid width + 2 values.
+ * @param lineY Scratch for grid width + 2 values.
+ */
+void RemapMap::expandSpan(int y, double* X, double* Y, int x, int count, double* lineX, double* lineY) const {
+    const int spacing = grid_spacing;
+    const int gridWidth = Xg.width();
+    const int j = y / spacing;
+    const int end = count < 0 ? map_width : x + count;
+    if (x >= end) {
+        return;
+    }
+
+    double wy[4];
+    gridWeights(grid_interpolation, static_cast<double>(y - j * spacing) / spacing, wy);
+
+    // control points -1 to gridWidth of the rows around y, combined vertically where the span needs them
+    const int first = std::max(-1, x / spacing - 1);
+    const int last = std::min(gridWidth, (end - 1) / spacing + 2);
+    for (int i = first; i <= last; ++i) {
+        lineX[i + 1] = 0.0;
+        lineY[i + 1] = 0.0;
+        for (int k = 0; k < 4; ++k) {
+            if (wy[k] != 0.0) {
+                lineX[i + 1] += wy[k] * gridValue(Xg, i, j - 1 + k);
+                lineY[i + 1] += wy[k] * gridValue(Yg, i, j - 1 + k);
+            }
+        }
+    }
+
+    const double step = 1.0 / spacing;
+    for (int px = x; px < end;) {
+        const int cell = px / spacing;
+        const int offset = px - cell * spacing;
+        const int i = cell + 1;
+        const int i3 = std::min(i + 2, gridWidth + 1);
+        const int n = std::min(spacing - offset, end - px);
+        for (int k = 0; k < n; ++k) {
+            double wx[4];
+            gridWeights(grid_interpolation, (offset + k) * step, wx);
+            X[px - x + k] = wx[0] * lineX[i - 1] + wx[1] * lineX[i] + wx[2] * lineX[i + 1] + wx[3] * lineX[i3];
+            Y[px - x + k] = wx[0] * lineY[i - 1] + wx[1] * lineY[i] + wx[2] * lineY[i + 1] + wx[3] * lineY[i3];
+        }
+        px += n;
+    }
+}
+
+/**
+ * @brief Decodes a span of a Float32, Float16 or Offset16 map into double precision coordinates.
+ *
+ * The offsets of Float16 and Offset16 maps are added to the identity position of every pixel and
+ * clamped into the source, so rounding never moves a pixel across the border of the valid region.
+ *
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param X Receives the source x-coordinates, -1 for Float16 and Offset16 pixels outside the source.
+ * @param Y Receives the source y-coordinates.
+ */
+void RemapMap::decodeSpan(int x, int y, int count, double* X, double* Y) const {
+    if (map_format == MapFormat::Float32) {
+        const float* fx = Xf.row(y) + x;
+        const float* fy = Yf.row(y) + x;
+        for (int i = 0; i < count; ++i) {
+            X[i] = fx[i];
+            Y[i] = fy[i];
+        }
+        return;
+    }
+
+    const double scaleX = static_cast<double>(source_width) / map_width;
+    const double identityY = (y + 0.5) * (static_cast<double>(source_height) / map_height) - 0.5;
+    if (map_format == MapFormat::Float16) {
+        const uint16_t* XY = XYh.row(y) + 2 * x;
+        for (int i = 0; i < count; ++i) {
+            const float ox = CommonMath::halfToFloat(XY[2 * i]);
+            const float oy = CommonMath::halfToFloat(XY[2 * i + 1]);
+            if (ox != ox) {
+                X[i] = Y[i] = -1.0;
+                continue;
+            }
+            X[i] = CommonMath::clamp((x + i + 0.5) * scaleX - 0.5 + ox, 0.0, static_cast<double>(source_width));
+            Y[i] = CommonMath::clamp(identityY + oy, 0.0, static_cast<double>(source_height));
+        }
+        return;
+    }
+
+    const double step = std::ldexp(1.0, -offset_bits);
+    const int16_t* XY = XYo.row(y) + 2 * x;
+    for (int i = 0; i < count; ++i) {
+        if (XY[2 * i] == std::numeric_limits<int16_t>::min()) {
+            X[i] = Y[i] = -1.0;
+            continue;
+        }
+        X[i] = CommonMath::clamp((x + i + 0.5) * scaleX - 0.5 + XY[2 * i] * step, 0.0, static_cast<double>(source_width));
+        Y[i] = CommonMath::clamp(identityY + XY[2 * i + 1] * step, 0.0, static_cast<double>(source_height));
+    }
+}
+
+/**
+ * @brief Computes the source coordinates of a span of a Homography map.
+ *
+ * The row is evaluated by the homography kernel of the best backend of the processor, every
+ * backend returns the same coordinates.
+ *
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param X Receives the source x-coordinates, -1 for pixels behind the source camera.
+ * @param Y Receives the source y-coordinates.
+ */
+void RemapMap::homographySpan(int x, int y, int count, double* X, double* Y) const {
+    RemapKernels::get().homographySpan(homography, x, y, count, X, Y);
+}
+
+/**
+ * @brief Resolves the source coordinates of a span of a Float64, ControlGrid, Homography or compact map.
+ *
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param buffers Scratch buffers of the calling thread.
+ * @param X Receives the x-coordinates, the Float64 row itself or the expanded or decoded buffer.
+ * @param Y Receives the y-coordinates.
+ */
+void RemapMap::coordinateRow(int x, int y, int count, SpanBuffers& buffers, const double*& X, const double*& Y) const {
+    if (map_format == MapFormat::Float64) {
+        X = Xd.row(y) + x;
+        Y = Yd.row(y) + x;
+        return;
+    }
+    if (map_format == MapFormat::ControlGrid) {
+        expandSpan(y, buffers.X.data(), buffers.Y.data(), x, count, buffers.lineX.data(), buffers.lineY.data());
+    }
+    else if (map_format == MapFormat::Homography) {
+        homographySpan(x, y, count, buffers.X.data(), buffers.Y.data());
+    }
+    else {
+        decodeSpan(x, y, count, buffers.X.data(), buffers.Y.data());
+    }
+    X = buffers.X.data();
+    Y = buffers.Y.data();
+}
+
+/**
+ * @brief Returns the source coordinate an output pixel samples from.
+ *
+ * @param x The output x-coordinate.
+ * @param y The output y-coordinate.
+ * @return The source coordinate, FixedPoint and the compact formats return the stored position.
+ */
+std::array<double, 2> RemapMap::coordinate(int x, int y) const {
+    switch (map_format) {
+    case MapFormat::Float64:
+        return { Xd(x, y), Yd(x, y) };
+    case MapFormat::FixedPoint: {
+        int ix = XYi(x, y, 0);
+        if (ix < 0) {
+            return { -1.0, -1.0 };
+        }
+        int index = frac(x, y);
+        return { ix + static_cast<double>(index & (FRAC_SIZE - 1)) / FRAC_SIZE,
+                 XYi(x, y, 1) + static_cast<double>(index >> FRAC_BITS) / FRAC_SIZE };
+    }
+    case MapFormat::Index: {
+        const int32_t index = indices(x, y);
+        if (index < 0) {
+            return { -1.0, -1.0 };
+        }
+        return { static_cast<double>(index % source_width), static_cast<double>(index / source_width) };
+    }
+    case MapFormat::Area: {
+        // weighted centroid of the taps
+        const uint32_t first = area_start(x, y);
+        const uint32_t last = area_start(x + 1, y);
+        if (first == last) {
+            return { -1.0, -1.0 };
+        }
+        double sx = 0.0, sy = 0.0;
+        for (uint32_t t = first; t < last; ++t) {
+            const int32_t index = area_taps(t, 0, 0);
+            sx += area_taps(t, 0, 1) * static_cast<double>(index % source_width);
+            sy += area_taps(t, 0, 1) * static_cast<double>(index / source_width);
+        }
+        return { sx / (1 << AREA_WEIGHT_BITS), sy / (1 << AREA_WEIGHT_BITS) };
+    }
+    case MapFormat::Float32:
+    case MapFormat::Float16:
+    case MapFormat::Offset16: {
+        std::array<double, 2> result;
+        decodeSpan(x, y, 1, &result[0], &result[1]);
+        return result;
+    }
+    case MapFormat::Homography: {
+        std::array<double, 2> result;
+        homographySpan(x, y, 1, &result[0], &result[1]);
+        return result;
+    }
+    case MapFormat::ControlGrid:
+        break;
+    }
+
+    const int i = x / grid_spacing;
+    const int j = y / grid_spacing;
+    double wx[4], wy[4];
+    gridWeights(grid_interpolation, static_cast<double>(x - i * grid_spacing) / grid_spacing, wx);
+    gridWeights(grid_interpolation, static_cast<double>(y - j * grid_spacing) / grid_spacing, wy);
+
+    std::array<double, 2> result = { 0.0, 0.0 };
+    for (int b = 0; b < 4; ++b) {
+        for (int a = 0; a < 4; ++a) {
+            if (wx[a] != 0.0 && wy[b] != 0.0) {
+                result[0] += wy[b] * wx[a] * gridValue(Xg, i - 1 + a, j - 1 + b);
+                result[1] += wy[b] * wx[a] * gridValue(Yg, i - 1 + a, j - 1 + b);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the source coordinate at a fractional output position, interpolated bilinearly between the neighbouring pixels.
+ *
+ * Used to derive maps of other output sizes from this one without evaluating the camera models.
+ * Positions are clamped to the map.
+ *
+ * @param x The output x-coordinate.
+ * @param y The output y-coordinate.
+ * @return The source coordinate, (-1, -1) if a neighbour with a nonzero weight lies outside the valid region.
+ */
+std::array<double, 2> RemapMap::coordinateAt(double x, double y) const {
+    x = CommonMath::clamp(x, 0.0, static_cast<double>(map_width - 1));
+    y = CommonMath::clamp(y, 0.0, static_cast<double>(map_height - 1));
+    const int x0 = std::min(static_cast<int>(x), map_width - 1);
+    const int y0 = std::min(static_cast<int>(y), map_height - 1);
+    const double fx = x - x0;
+    const double fy = y - y0;
+
+    std::array<double, 2> result = { 0.0, 0.0 };
+    const double weights[4] = { (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+    for (int k = 0; k < 4; ++k) {
+        if (weights[k] == 0.0) {
+            continue;
+        }
+        const std::array<double, 2> c = coordinate(std::min(x0 + (k & 1), map_width - 1), std::min(y0 + (k >> 1), map_height - 1));
+        if (!(c[0] >= 0 && c[1] >= 0 && c[0] <= source_width && c[1] <= source_height)) {
+            return { -1.0, -1.0 };
+        }
+        result[0] += weights[k] * c[0];
+        result[1] += weights[k] * c[1];
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the number of bytes held by the map storage.
+ *
+ * @return The memory usage in bytes.
+ */
+size_t RemapMap::memoryUsage() const {
+    auto elements = [](int width, int height, int channels) { return static_cast<size_t>(width) * height * channels; };
+    size_t doubles = elements(Xd.width(), Xd.height(), 1) + elements(Yd.width(), Yd.height(), 1) +
+                     elements(Xg.width(), Xg.height(), 1) + elements(Yg.width(), Yg.height(), 1);
+    return doubles * sizeof(double) + (elements(Xf.width(), Xf.height(), 1) + elements(Yf.width(), Yf.height(), 1)) * sizeof(float) +
+           elements(XYh.width(), XYh.height(), XYh.channels()) * sizeof(uint16_t) + elements(XYo.width(), XYo.height(), XYo.channels()) * sizeof(int16_t) +
+           elements(XYi.width(), XYi.height(), XYi.channels()) * sizeof(int16_t) +
+           elements(frac.width(), frac.height(), 1) * sizeof(uint16_t) + elements(indices.width(), indices.height(), 1) * sizeof(int32_t) +
+           elements(area_start.width(), area_start.height(), 1) * sizeof(uint32_t) + elements(area_taps.width(), area_taps.height(), 2) * sizeof(int32_t);
+}
+
+/**
+ * @brief Returns the table of bilinear weights used by the FixedPoint format.
+ *
+ * Entry i holds the four weights (top left, top right, bottom left, bottom right) of the
+ * sub-pixel position (i % FRAC_SIZE, i / FRAC_SIZE) / FRAC_SIZE. All weights are exact.
+ *
+ * @return Pointer to FRAC_SIZE * FRAC_SIZE * 4 weights.
+ */
+const int16_t* RemapMap::bilinearWeights() {
+    static const std::vector<int16_t> table = [] {
+        std::vector<int16_t> weights(FRAC_SIZE * FRAC_SIZE * 4);
+        const int scale = (1 << WEIGHT_BITS) / (FRAC_SIZE * FRAC_SIZE);
+        for (int fy = 0; fy < FRAC_SIZE; ++fy) {
+            for (int fx = 0; fx < FRAC_SIZE; ++fx) {
+                int16_t* w = &weights[4 * (fy * FRAC_SIZE + fx)];
+                w[0] = static_cast<int16_t>((FRAC_SIZE - fx) * (FRAC_SIZE - fy) * scale);
+                w[1] = static_cast<int16_t>(fx * (FRAC_SIZE - fy) * scale);
+                w[2] = static_cast<int16_t>((FRAC_SIZE - fx) * fy * scale);
+                w[3] = static_cast<int16_t>(fx * fy * scale);
+            }
+        }
+        return weights;
+    }();
+
+    return table.data();
+}
+
+/**
+ * @brief Returns the table of bicubic weights used by FixedPoint maps with Bicubic interpolation.
+ *
+ * Entry i holds the 16 Catmull-Rom weights of the 4x4 taps around the sub-pixel position
+ * (i % FRAC_SIZE, i / FRAC_SIZE) / FRAC_SIZE, row by row starting one pixel above and left of the
+ * integer coordinate. The rounding error of every entry is added to its largest weight, so the
+ * weights sum exactly to 1 << WEIGHT_BITS and flat regions stay flat.
+ *
+ * @return Pointer to FRAC_SIZE * FRAC_SIZE * 16 weights.
+ */
+const int16_t* RemapMap::bicubicWeights() {
+    static const std::vector<int16_t> table = [] {
+        std::vector<int16_t> weights(FRAC_SIZE * FRAC_SIZE * 16);
+        for (int fy = 0; fy < FRAC_SIZE; ++fy) {
+            for (int fx = 0; fx < FRAC_SIZE; ++fx) {
+                double wx[4], wy[4];
+                CommonMath::catmullRomWeights(static_cast<double>(fx) / FRAC_SIZE, wx);
+                CommonMath::catmullRomWeights(static_cast<double>(fy) / FRAC_SIZE, wy);
+
+                int16_t* w = &weights[16 * (fy * FRAC_SIZE + fx)];
+                int sum = 0;
+                int largest = 0;
+                for (int k = 0; k < 16; ++k) {
+                    w[k] = static_cast<int16_t>(std::lround(wy[k / 4] * wx[k % 4] * (1 << WEIGHT_BITS)));
+                    sum += w[k];
+                    largest = w[k] > w[largest] ? k : largest;
+                }
+                w[largest] = static_cast<int16_t>(w[largest] + (1 << WEIGHT_BITS) - sum);
+            }
+        }
+        return weights;
+    }();
+
+    return table.data();
+}
+
+/**
+ * @brief Selects the interpolation of the remap kernels.
+ *
+ * The coordinates of Float64, FixedPoint and ControlGrid maps serve every interpolation but Area,
+ * while Index maps only hold the nearest pixel and Area maps only their weighted footprints.
+ *
+ * @param interpolation The interpolation.
+ * @throws std::invalid_argument if an Index map is asked for another interpolation than Nearest, or Area is asked of another map than an Area map or vice versa.
+ */
+void RemapMap::setInterpolation(RemapInterpolation interpolation) {
+    if (map_format == MapFormat::Index && interpolation != RemapInterpolation::Nearest) {
+        throw std::invalid_argument("Index maps only support Nearest interpolation.");
+    }
+    if ((map_format == MapFormat::Area) != (interpolation == RemapInterpolation::Area)) {
+        throw std::invalid_argument("Area interpolation needs an Area map, which supports no other interpolation.");
+    }
+    if (interpolation != map_interpolation) {
+        map_interpolation = interpolation;
+        region_cache = std::make_shared<RegionCache>();
+    }
+}
+
+/**
+ * @brief Computes the source pixels read along one axis when sampling a coordinate.
+ *
+ * Used to bound the source footprint of tiles and streamed rows. Area maps read the taps stored
+ * per pixel instead, the range given for them is the one of a bilinear sample.
+ *
+ * @param v The coordinate, within [0, size].
+ * @param size The size of the source along the axis.
+ * @param first Receives the first pixel read.
+ * @param last Receives the last pixel read.
+ */
+void RemapMap::tapRange(double v, int size, int& first, int& last) const {
+    const int i = static_cast<int>(v);
+    switch (map_interpolation) {
+    case RemapInterpolation::Nearest:
+        first = last = std::min(static_cast<int>(v + 0.5), size - 1);
+        return;
+    case RemapInterpolation::Bilinear:
+    case RemapInterpolation::Area:
+        first = std::min(i, size - 1);
+        last = std::min(i + 1, size - 1);
+        return;
+    case RemapInterpolation::Bicubic:
+        first = CommonMath::clamp(i - 1, 0, size - 1);
+        last = std::min(i + 2, size - 1);
+        return;
+    }
+}
+
+/**
+ * @brief Classifies the output pixels of one row by the source pixels their interpolation reads.
+ *
+ * Pixels outside [0, source width] x [0, source height] are Outside. Nearest and Area pixels
+ * inside it are always Interior, bilinear ones when both neighbours along each axis lie inside
+ * the source and bicubic ones when all 4 x 4 taps do. The bounds are taken on the unquantized coordinate, so a
+ * FixedPoint coordinate quantized from an Interior one is still Interior.
+ *
+ * @param y The output row.
+ * @param classes Receives the class of every pixel of the row.
+ * @param buffers Scratch buffers of the calling thread, grown to the map width.
+ */
+void RemapMap::classifyRow(int y, PixelClass* classes, SpanBuffers& buffers) const {
+    double* X = buffers.X.data();
+    double* Y = buffers.Y.data();
+    coordinateSpan(0, y, map_width, X, Y);
+
+    // taps read before and after the integer part of the coordinate
+    const bool direct = map_interpolation == RemapInterpolation::Nearest || map_interpolation == RemapInterpolation::Area;
+    const int before = map_interpolation == RemapInterpolation::Bicubic ? 1 : 0;
+    const int after = map_interpolation == RemapInterpolation::Bicubic ? 2 : 1;
+    const double lastX = source_width - 1 - after;
+    const double lastY = source_height - 1 - after;
+
+    for (int x = 0; x < map_width; ++x) {
+        const double sx = X[x];
+        const double sy = Y[x];
+        if (!(sx >= 0 && sy >= 0 && sx <= source_width && sy <= source_height)) {
+            classes[x] = PixelClass::Outside;
+        }
+        else if (direct || (sx >= before && sy >= before && sx <= lastX && sy <= lastY)) {
+            classes[x] = PixelClass::Interior;
+        }
+        else {
+            classes[x] = PixelClass::Border;
+        }
+    }
+}
+
+/**
+ * @brief Splits every output row into runs of one pixel class.
+ *
+ * Interior and Outside runs shorter than MIN_RUN are merged into the neighbouring border, so the
+ * kernels are not called for a handful of pixels at a time. Rows are classified in parallel.
+ *
+ * @return The region of the map.
+ */
+RemapRegion RemapMap::buildRegion() const {
+    std::vector<std::vector<PixelRun>> rows(map_height);
+    // first and last valid column of every row
+    std::vector<int> first(map_height, map_width);
+    std::vector<int> last(map_height, -1);
+
+    Executor::current().parallelFor(map_height, [&](long rowBegin, long rowEnd) {
+        SpanBuffers& buffers = threadBuffers(map_width);
+        std::vector<PixelClass> classes(map_width);
+
+        for (int y = static_cast<int>(rowBegin); y < rowEnd; ++y) {
+            classifyRow(y, classes.data(), buffers);
+            std::vector<PixelRun>& runs = rows[y];
+            for (int x = 0; x < map_width;) {
+                int end = x + 1;
+                while (end < map_width && classes[end] == classes[x]) {
+                    ++end;
+                }
+                PixelClass pixel_class = classes[x];
+                if (pixel_class != PixelClass::Outside) {
+                    first[y] = std::min(first[y], x);
+                    last[y] = end - 1;
+                }
+                if (end - x < MIN_RUN) {
+                    pixel_class = PixelClass::Border;
+                }
+                if (!runs.empty() && runs.back().pixel_class == pixel_class) {
+                    runs.back().count += end - x;
+                }
+                else {
+                    runs.push_back({ x, end - x, pixel_class });
+                }
+                x = end;
+            }
+        }
+    });
+
+    RemapRegion region;
+    region.row_start.reserve(map_height + 1);
+    int x0 = map_width, x1 = -1, y0 = map_height, y1 = -1;
+    for (int y = 0; y < map_height; ++y) {
+        region.row_start.push_back(region.runs.size());
+        for (const PixelRun& run : rows[y]) {
+            region.runs.push_back(run);
+            region.counts[static_cast<int>(run.pixel_class)] += run.count;
+        }
+        if (last[y] >= 0) {
+            x0 = std::min(x0, first[y]);
+            x1 = std::max(x1, last[y]);
+            y0 = std::min(y0, y);
+            y1 = y;
+        }
+    }
+    region.row_start.push_back(region.runs.size());
+    if (x1 >= 0) {
+        region.bounds = { x0, y0, x1 - x0 + 1, y1 - y0 + 1 };
+    }
+    return region;
+}
+
+/**
+ * @brief Returns the classification of the output pixels into Outside, Border and Interior runs.
+ *
+ * The region is computed on first use and shared by copies of the map. Remapper computes it
+ * when the map is built, so the first frame does not pay for it.
+ *
+ * @return The region for the current interpolation of the map.
+ */
+const RemapRegion& RemapMap::region() const {
+    RegionCache& cache = *region_cache;
+    std::call_once(cache.once, [&] { cache.region = buildRegion(); });
+    return cache.region;
+}
+
+/**
+ * @brief Computes the mask of the output pixels inside the valid region of the map.
+ *
+ * Downstream stages can use it to skip the zero-filled pixels of a remapped image.
+ *
+ * @return A single channel image of the map size, 255 for valid pixels and 0 elsewhere.
+ */
+Image<uint8_t> RemapMap::validMask() const {
+    Image<uint8_t> mask(map_width, map_height);
+
+    Executor::current().parallelFor(map_height, [&](long begin, long end) {
+        SpanBuffers& buffers = threadBuffers(map_width);
+        std::vector<PixelClass> classes(map_width);
+
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            classifyRow(y, classes.data(), buffers);
+            uint8_t* row = mask.row(y);
+            for (int x = 0; x < map_width; ++x) {
+                row[x] = classes[x] == PixelClass::Outside ? 0 : 255;
+            }
+        }
+    });
+    return mask;
+}
+
+/**
+ * @brief Returns the scratch buffers of the calling thread, grown to hold a span of count pixels and a control row of this map.
+ *
+ * The buffers live as long as the thread, so repeated remaps of the same size do not allocate.
+ *
+ * @param count Number of output pixels per span.
+ * @return The buffers of the calling thread.
+ */
+RemapMap::SpanBuffers& RemapMap::threadBuffers(int count) const {
+    thread_local SpanBuffers buffers;
+    buffers.reserve(count, Xg.width());
+    return buffers;
+}
+
+/**
+ * @brief Resolves the nearest source pixel of every output pixel of a span as linear index.
+ *
+ * Index rows are used in place. The other formats are rounded into the scratch buffers with the
+ * valid region of the bilinear kernels, FixedPoint ones from their quantized coordinates.
+ *
+ * @param image_width Width of the source image.
+ * @param image_height Height of the source image, or of the window of its rows when first_row is not negative.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param buffers Scratch buffers of the calling thread.
+ * @param first_row Source row held by the first row of a window, -1 when the image is the whole source.
+ * @return The indices, -1 for pixels outside the source, valid until the buffers are reused.
+ */
+const int32_t* RemapMap::indexSpan(int image_width, int image_height, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    const int rowOffset = std::max(first_row, 0);
+    int32_t* index = buffers.index.data();
+
+    if (map_format == MapFormat::Index) {
+        const int32_t* stored = indices.row(y) + x;
+        if (rowOffset == 0) {
+            return stored;
+        }
+        const int32_t shift = rowOffset * image_width;
+        for (int i = 0; i < count; ++i) {
+            index[i] = stored[i] < 0 ? -1 : stored[i] - shift;
+        }
+        return index;
+    }
+
+    if (map_format == MapFormat::FixedPoint) {
+        const int16_t* XY = XYi.row(y) + 2 * x;
+        const uint16_t* fr = frac.row(y) + x;
+        for (int i = 0; i < count; ++i) {
+            if (XY[2 * i] < 0) {
+                index[i] = -1;
+                continue;
+            }
+            // a fraction of one half or more rounds up, the clamped border pixels have a zero fraction
+            const int ix = XY[2 * i] + ((fr[i] & (FRAC_SIZE - 1)) >= FRAC_SIZE / 2);
+            const int iy = XY[2 * i + 1] + ((fr[i] >> FRAC_BITS) >= FRAC_SIZE / 2);
+            index[i] = (iy - rowOffset) * image_width + ix;
+        }
+        return index;
+    }
+
+    const double* X;
+    const double* Y;
+    coordinateRow(x, y, count, buffers, X, Y);
+    const int sourceRows = first_row >= 0 ? source_height : image_height;
+    for (int i = 0; i < count; ++i) {
+        int ix, iy;
+        index[i] = nearestCoordinate(X[i], Y[i], image_width, sourceRows, ix, iy) ? (iy - rowOffset) * image_width + ix : -1;
+    }
+    return index;
+}
+
+/**
+ * @brief Points a span of an Area map at its taps, which are used in place.
+ *
+ * @param x The first output column.
+ * @param y The output row.
+ * @param first_row Source row held by the first row of a window, -1 when the image is the whole source.
+ * @return The taps of the span, the indices of a window are shifted by its first row.
+ */
+RemapMap::SpanCoordinates RemapMap::areaSpan(int x, int y, int first_row) const {
+    SpanCoordinates span = {};
+    span.start = area_start.row(y) + x;
+    span.taps = area_taps.data();
+    span.index_shift = std::max(first_row, 0) * source_width;
+    return span;
+}
+
+/**
+ * @brief Resolves the source coordinates of a span of one output row for a floating point image.
+ *
+ * Float64 rows are used in place and ControlGrid rows are expanded into the scratch buffers.
+ * FixedPoint rows are used in place and blended with their quantized weights, or converted back
+ * to doubles for the bicubic kernel. Nearest interpolation resolves linear indices, Area maps
+ * point at their taps.
+ *
+ * @param image The source image, or a window of its rows when first_row is not negative.
+ * @param y The output row.
+ * @param x The first output column.
+ * @param count Number of output pixels.
+ * @param buffers Scratch buffers of the calling thread.
+ * @param first_row Source row held by the first row of a window, -1 when image is the whole source.
+ * @return The coordinates of the span, valid until the buffers are reused.
+ */
+template <typename T>
+RemapMap::SpanCoordinates RemapMap::prepareFloatingSpan(const ImageView<const T>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    SpanCoordinates span = {};
+    if (map_format == MapFormat::Area) {
+        return areaSpan(x, y, first_row);
+    }
+    if (map_interpolation == RemapInterpolation::Nearest) {
+        span.index = indexSpan(image.width(), image.height(), x, y, count, buffers, first_row);
+        return span;
+    }
+    if (map_format == MapFormat::FixedPoint && map_interpolation == RemapInterpolation::Bilinear) {
+        span.XY = XYi.row(y) + 2 * x;
+        span.frac = frac.row(y) + x;
+        return span;
+    }
+    if (map_format == MapFormat::FixedPoint) {
+        const int16_t* XY = XYi.row(y) + 2 * x;
+        const uint16_t* fr = frac.row(y) + x;
+        const int rowOffset = std::max(first_row, 0);
+        for (int i = 0; i < count; ++i) {
+            const bool inside = XY[2 * i] >= 0;
+            buffers.X[i] = inside ? XY[2 * i] + static_cast<double>(fr[i] & (FRAC_SIZE - 1)) / FRAC_SIZE : -1.0;
+            buffers.Y[i] = inside ? XY[2 * i + 1] - rowOffset + static_cast<double>(fr[i] >> FRAC_BITS) / FRAC_SIZE : -1.0;
+        }
+        span.X = buffers.X.data();
+        span.Y = buffers.Y.data();
+        return span;
+    }
+
+    const double* X;
+    const double* Y;
+    coordinateRow(x, y, count, buffers, X, Y);
+    if (first_row >= 0) {
+        // shift into the window, pixels outside the whole source must not land inside it
+        for (int i = 0; i < count; ++i) {
+            const bool inside = X[i] >= 0 && Y[i] >= 0 && X[i] <= image.width() && Y[i] <= source_height;
+            buffers.X[i] = inside ? X[i] : -1.0;
+            buffers.Y[i] = inside ? Y[i] - first_row : -1.0;
+        }
+        X = buffers.X.data();
+        Y = buffers.Y.data();
+    }
+    span.X = X;
+    span.Y = Y;
+    return span;
+}
+
+template <>
+RemapMap::SpanCoordinates RemapMap::prepareSpan<double, double>(const ImageView<const double>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    return prepareFloatingSpan(image, x, y, count, buffers, first_row);
+}
+
+template <>
+RemapMap::SpanCoordinates RemapMap::prepareSpan<float, float>(const ImageView<const float>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    return prepareFloatingSpan(image, x, y, count, buffers, first_row);
+}
+
+template <>
+RemapMap::SpanCoordinates RemapMap::prepareSpan<uint8_t, float>(const ImageView<const uint8_t>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    return prepareFloatingSpan(image, x, y, count, buffers, first_row);
+}
+
+template <>
+RemapMap::SpanCoordinates RemapMap::prepareSpan<uint16_t, float>(const ImageView<const uint16_t>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    return prepareFloatingSpan(image, x, y, count, buffers, first_row);
+}
+
+/**
+ * @brief Resolves the source coordinates of a span of one output row for an integer image.
+ *
+ * FixedPoint rows are used in place. Float64 and ControlGrid rows are quantized into the
+ * scratch buffers against the size of the given image, so no full size FixedPoint copy of the
+ * map is created. Nearest interpolation resolves linear indices, Area maps point at their taps.
+ *
+ * @param image The source image, or a window of its rows when first_row is not negative.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param buffers Scratch buffers of the calling thread.
+ * @param first_row Source row held by the first row of a window, -1 when image is the whole source.
+ * @return The coordinates of the span, valid until the buffers are reused.
+ */
+template <typename In, typename Out>
+RemapMap::SpanCoordinates RemapMap::prepareSpan(const ImageView<const In>& image, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    const int rowOffset = std::max(first_row, 0);
+
+    SpanCoordinates span = {};
+    if (map_format == MapFormat::Area) {
+        return areaSpan(x, y, first_row);
+    }
+    if (map_interpolation == RemapInterpolation::Nearest) {
+        span.index = indexSpan(image.width(), image.height(), x, y, count, buffers, first_row);
+        return span;
+    }
+    if (map_format == MapFormat::FixedPoint) {
+        span.XY = XYi.row(y) + 2 * x;
+        span.frac = frac.row(y) + x;
+        if (first_row > 0) {
+            for (int i = 0; i < count; ++i) {
+                buffers.XY[2 * i] = span.XY[2 * i];
+                buffers.XY[2 * i + 1] = span.XY[2 * i] < 0 ? span.XY[2 * i + 1] : static_cast<int16_t>(span.XY[2 * i + 1] - rowOffset);
+            }
+            span.XY = buffers.XY.data();
+        }
+        return span;
+    }
+
+    const double* X;
+    const double* Y;
+    coordinateRow(x, y, count, buffers, X, Y);
+    const int sourceRows = first_row >= 0 ? source_height : image.height();
+    for (int i = 0; i < count; ++i) {
+        int ix, iy, index;
+        if (quantizeCoordinate(X[i], Y[i], image.width(), sourceRows, ix, iy, index)) {
+            buffers.XY[2 * i] = static_cast<int16_t>(ix);
+            buffers.XY[2 * i + 1] = static_cast<int16_t>(iy - rowOffset);
+            buffers.frac[i] = static_cast<uint16_t>(index);
+        }
+        else {
+            buffers.XY[2 * i] = -1;
+            buffers.XY[2 * i + 1] = -1;
+            buffers.frac[i] = 0;
+        }
+    }
+    span.XY = buffers.XY.data();
+    span.frac = buffers.frac.data();
+    return span;
+}
+
+/**
+ * @brief Remaps a span of one output row into a floating point image from resolved coordinates.
+ *
+ * Float outputs are interpolated in single precision from float, 8-bit or 16-bit images.
+ *
+ * @param image The source image, or a window of its rows when first_row is not negative.
+ * @param output The remapped image.
+ * @param kernels The row kernels.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param span The coordinates returned by prepareSpan.
+ * @param first_row Source row held by the first row of a window, -1 when image is the whole source.
+ * @param interior True if all pixels of the span are Interior pixels of the whole source.
+ */
+template <typename In, typename Out>
+void RemapMap::applyFloatingSpan(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const {
+    const int channels = image.channels();
+    const std::ptrdiff_t outStride = output.pixelStride();
+
+    if (span.index != nullptr) {
+        nearestKernel(kernels, In(), Out())(span.index, count, image, output.row(y) + x * outStride, outStride, output.channelStride());
+        return;
+    }
+    if (span.start != nullptr) {
+        areaKernel(kernels, In(), Out())(span.start, span.taps, count, span.index_shift, image, output.row(y) + x * outStride, outStride, output.channelStride());
+        return;
+    }
+    if (span.XY == nullptr) {
+        floatingKernel(kernels, map_interpolation, interior, In(), Out())(span.X, span.Y, count, image, output.row(y) + x * outStride, outStride, output.channelStride());
+        return;
+    }
+
+    const int16_t* weights = bilinearWeights();
+    const std::ptrdiff_t pixelStride = image.pixelStride();
+    const std::ptrdiff_t rowStride = image.rowStride();
+    const int rowOffset = std::max(first_row, 0);
+    for (int i = 0; i < count; ++i) {
+        const int ix = span.XY[2 * i];
+        const int iy = span.XY[2 * i + 1] - rowOffset;
+        const int index = span.frac[i];
+        const int16_t* w = weights + 4 * index;
+        // a zero fraction means the second neighbour is never weighted and may lie outside the image
+        const std::ptrdiff_t dx = (index & (FRAC_SIZE - 1)) ? pixelStride : 0;
+        const std::ptrdiff_t dy = (index >> FRAC_BITS) ? rowStride : 0;
+        for (int c = 0; c < channels; ++c) {
+            if (ix < 0) {
+                output(x + i, y, c) = 0;
+                continue;
+            }
+            const In* p = &image(ix, iy, c);
+            output(x + i, y, c) = blendFixed<Out>(static_cast<Out>(p[0]), static_cast<Out>(p[dx]), static_cast<Out>(p[dy]), static_cast<Out>(p[dx + dy]), w);
+        }
+    }
+}
+
+template <>
+void RemapMap::applySpan<double, double>(const ImageView<const double>& image, const ImageView<double>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const {
+    applyFloatingSpan(image, output, kernels, x, y, count, span, first_row, interior);
+}
+
+template <>
+void RemapMap::applySpan<float, float>(const ImageView<const float>& image, const ImageView<float>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const {
+    applyFloatingSpan(image, output, kernels, x, y, count, span, first_row, interior);
+}
+
+template <>
+void RemapMap::applySpan<uint8_t, float>(const ImageView<const uint8_t>& image, const ImageView<float>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const {
+    applyFloatingSpan(image, output, kernels, x, y, count, span, first_row, interior);
+}
+
+template <>
+void RemapMap::applySpan<uint16_t, float>(const ImageView<const uint16_t>& image, const ImageView<float>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const {
+    applyFloatingSpan(image, output, kernels, x, y, count, span, first_row, interior);
+}
+
+/**
+ * @brief Remaps a span of one output row of an integer image from resolved coordinates.
+ *
+ * @param image The source image, or a window of its rows when first_row is not negative.
+ * @param output The remapped image.
+ * @param kernels The row kernels.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param span The coordinates returned by prepareSpan.
+ * @param first_row Unused, the rows of the window are already shifted by prepareSpan.
+ * @param interior True if all pixels of the span are Interior pixels of the whole source.
+ */
+template <typename In, typename Out>
+void RemapMap::applySpan(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, int x, int y, int count, const SpanCoordinates& span, int first_row, bool interior) const {
+    (void)first_row;
+    const std::ptrdiff_t outStride = output.pixelStride();
+    if (span.index != nullptr) {
+        nearestKernel(kernels, In(), Out())(span.index, count, image, output.row(y) + x * outStride, outStride, output.channelStride());
+        return;
+    }
+    if (span.start != nullptr) {
+        areaKernel(kernels, In(), Out())(span.start, span.taps, count, span.index_shift, image, output.row(y) + x * outStride, outStride, output.channelStride());
+        return;
+    }
+    integerKernel(kernels, map_interpolation, interior, In())(span.XY, span.frac, count, image, output.row(y) + x * outStride, outStride, output.channelStride());
+}
+
+/**
+ * @brief Remaps a span of one output row.
+ *
+ * @param image The source image, or a window of its rows when first_row is not negative.
+ * @param output The remapped image.
+ * @param kernels The row kernels.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param buffers Scratch buffers of the calling thread.
+ * @param first_row Source row held by the first row of a window, -1 when image is the whole source.
+ */
+template <typename In, typename Out>
+void RemapMap::remapSpan(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, int x, int y, int count, SpanBuffers& buffers, int first_row) const {
+    applySpan(image, output, kernels, x, y, count, prepareSpan<In, Out>(image, x, y, count, buffers, first_row), first_row);
+}
+
+/**
+ * @brief Calls span(x, y, count, buffers, pixel_class) for the parts of one output span in each run of the region.
+ *
+ * @param region The classification of the output pixels, or nullptr to treat the whole span as Border.
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param buffers Scratch buffers of the calling thread.
+ * @param span The span function.
+ */
+template <typename SpanFunction>
+void RemapMap::classifiedSpans(const RemapRegion* region, int x, int y, int count, SpanBuffers& buffers, const SpanFunction& span) const {
+    if (region == nullptr) {
+        span(x, y, count, buffers, PixelClass::Border);
+        return;
+    }
+    const int end = x + count;
+    for (size_t r = region->row_start[y]; r < region->row_start[y + 1]; ++r) {
+        const PixelRun& run = region->runs[r];
+        const int first = std::max(run.x, x);
+        const int last = std::min(run.x + run.count, end);
+        if (first < last) {
+            span(first, y, last - first, buffers, run.pixel_class);
+        }
+    }
+}
+
+/**
+ * @brief Calls span(x, y, count, buffers, pixel_class) for every output span, over rows or tiles.
+ *
+ * Rows and tiles are handed to the threads of the executor in chunks on demand, since their cost
+ * varies with the valid region and the source footprint. Tiles reaching outside the map are
+ * skipped. With a region every span is split at the boundaries of its runs, without one all
+ * spans are Border spans.
+ *
+ * @param tiles Tiles covering the output, nullptr to process whole rows.
+ * @param region The classification of the output pixels, or nullptr.
+ * @param executor Runs the rows or tiles in parallel.
+ * @param span The span function.
+ */
+template <typename SpanFunction>
+void RemapMap::traverse(const std::vector<RemapTile>* tiles, const RemapRegion* region, const Executor& executor, const SpanFunction& span) const {
+    auto classified = [&](int x, int y, int count, SpanBuffers& buffers) {
+        classifiedSpans(region, x, y, count, buffers, span);
+    };
+
+    if (tiles == nullptr) {
+        executor.parallelFor(map_height, [&](long begin, long end) {
+            SpanBuffers& buffers = threadBuffers(map_width);
+            for (int y = static_cast<int>(begin); y < end; ++y) {
+                classified(0, y, map_width, buffers);
+            }
+        });
+        return;
+    }
+
+    executor.parallelFor(static_cast<long>(tiles->size()), [&](long begin, long end) {
+        SpanBuffers& buffers = threadBuffers(map_width);
+        for (long t = begin; t < end; ++t) {
+            const RemapTile& tile = (*tiles)[t];
+            if (tile.x < 0 || tile.y < 0 || tile.x + tile.width > map_width || tile.y + tile.height > map_height) {
+                continue;
+            }
+            for (int y = tile.y; y < tile.y + tile.height; ++y) {
+                classified(tile.x, y, tile.width, buffers);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Validates the shapes and runs the span kernels over rows or tiles.
+ *
+ * When the image has the source size of the map, Outside runs are zero-filled and Interior runs
+ * use the interior kernels, otherwise every pixel goes through the range checked kernels.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param tiles Tiles covering the output, nullptr to process whole rows.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+template <typename In, typename Out>
+void RemapMap::run(const ImageView<const In>& image, const ImageView<Out>& output, RemapBackend backend, const std::vector<RemapTile>* tiles, const Executor& executor) const {
+    if (image.empty()) {
+        return;
+    }
+    checkShapes(image.width(), image.height(), image.channels(), output.width(), output.height(), output.channels());
+    const RemapKernels& kernels = RemapKernels::get(backend, image);
+
+    const RemapRegion* classified = image.width() == source_width && image.height() == source_height ? &region() : nullptr;
+
+    traverse(tiles, classified, executor, [&](int x, int y, int count, SpanBuffers& buffers, PixelClass pixel_class) {
+        if (pixel_class == PixelClass::Outside) {
+            clearSpan(output, x, y, count);
+            return;
+        }
+        applySpan(image, output, kernels, x, y, count, prepareSpan<In, Out>(image, x, y, count, buffers, -1), -1, pixel_class == PixelClass::Interior);
+    });
+}
+
+/**
+ * @brief Remaps one tile on the calling thread, for schedulers that distribute the tiles of several maps themselves.
+ *
+ * @param image The source image, its shape already validated by checkShapes.
+ * @param output The remapped image.
+ * @param kernels The row kernels.
+ * @param region The region of the map if the image has its source size, nullptr otherwise.
+ * @param tile The tile, inside the map.
+ * @param buffers Scratch buffers of the calling thread.
+ */
+template <typename In, typename Out>
+void RemapMap::remapTile(const ImageView<const In>& image, const ImageView<Out>& output, const RemapKernels& kernels, const RemapRegion* region, const RemapTile& tile, SpanBuffers& buffers) const {
+    for (int y = tile.y; y < tile.y + tile.height; ++y) {
+        classifiedSpans(region, tile.x, y, tile.width, buffers, [&](int x, int row, int count, SpanBuffers& span_buffers, PixelClass pixel_class) {
+            if (pixel_class == PixelClass::Outside) {
+                clearSpan(output, x, row, count);
+                return;
+            }
+            applySpan(image, output, kernels, x, row, count, prepareSpan<In, Out>(image, x, row, count, span_buffers, -1), -1, pixel_class == PixelClass::Interior);
+        });
+    }
+}
+
+/**
+ * @brief Validates the shapes and remaps a batch of frames in one traversal of the map.
+ *
+ * The coordinates of every span are resolved once and applied to all frames while they are
+ * still in cache, so the map is streamed from memory once per batch instead of once per frame.
+ * The work is split over rows or tiles, never over frames.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param backend The instruction set of the row kernels.
+ * @param tiles Tiles covering the output, nullptr to process whole rows.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts differ, the frames differ in size, a frame or output does not match the map or the backend is not supported.
+ */
+template <typename In, typename Out>
+void RemapMap::runBatch(const std::vector<ImageView<const In>>& images, const std::vector<ImageView<Out>>& outputs, RemapBackend backend, const std::vector<RemapTile>* tiles, const Executor& executor) const {
+    if (images.size() != outputs.size()) {
+        throw std::invalid_argument("Batch remap needs one output per frame");
+    }
+    if (images.empty()) {
+        return;
+    }
+    for (size_t f = 0; f < images.size(); ++f) {
+        if (images[f].width() != images[0].width() || images[f].height() != images[0].height()) {
+            throw std::invalid_argument("Batch remap needs frames of the same size");
+        }
+        checkShapes(images[f].width(), images[f].height(), images[f].channels(), outputs[f].width(), outputs[f].height(), outputs[f].channels());
+    }
+    if (images[0].empty()) {
+        return;
+    }
+    // frames may differ in their strides, one out of reach of the gathers selects the Scalar kernels for all
+    const RemapKernels* kernels = &RemapKernels::get(backend);
+    for (const ImageView<const In>& image : images) {
+        if (!RemapKernels::fitsGatherOffsets(image)) {
+            kernels = &remapKernelsScalar();
+        }
+    }
+    const size_t frames = images.size();
+
+    const RemapRegion* classified = images[0].width() == source_width && images[0].height() == source_height ? &region() : nullptr;
+
+    traverse(tiles, classified, executor, [&](int x, int y, int count, SpanBuffers& buffers, PixelClass pixel_class) {
+        if (pixel_class == PixelClass::Outside) {
+            for (size_t f = 0; f < frames; ++f) {
+                clearSpan(outputs[f], x, y, count);
+            }
+            return;
+        }
+        const SpanCoordinates span = prepareSpan<In, Out>(images[0], x, y, count, buffers, -1);
+        for (size_t f = 0; f < frames; ++f) {
+            applySpan(images[f], outputs[f], *kernels, x, y, count, span, -1, pixel_class == PixelClass::Interior);
+        }
+    });
+}
+
+/**
+ * @brief Remaps a double precision image row by row.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const double>& image, const ImageView<double>& output, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a single precision image row by row, interpolating in single precision.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const float>& image, const ImageView<float>& output, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps an 8-bit image row by row with integer arithmetic.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a 16-bit image row by row with integer arithmetic.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps an 8-bit image row by row into a single precision output, converting the taps inside the kernels.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint8_t>& image, const ImageView<float>& output, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a 16-bit image row by row into a single precision output, converting the taps inside the kernels.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint16_t>& image, const ImageView<float>& output, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a double precision image tile by tile.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param tiles Tiles covering the output, usually from planTiles.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const double>& image, const ImageView<double>& output, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a single precision image tile by tile, interpolating in single precision.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param tiles Tiles covering the output, usually from planTiles.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const float>& image, const ImageView<float>& output, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps an 8-bit image tile by tile with integer arithmetic.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param tiles Tiles covering the output, usually from planTiles.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a 16-bit image tile by tile with integer arithmetic.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param tiles Tiles covering the output, usually from planTiles.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps an 8-bit image tile by tile into a single precision output, converting the taps inside the kernels.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param tiles Tiles covering the output, usually from planTiles.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint8_t>& image, const ImageView<float>& output, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a 16-bit image tile by tile into a single precision output, converting the taps inside the kernels.
+ *
+ * @param image The source image.
+ * @param output The remapped image.
+ * @param tiles Tiles covering the output, usually from planTiles.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the image or output do not match the map or the backend is not supported.
+ */
+void RemapMap::remap(const ImageView<const uint16_t>& image, const ImageView<float>& output, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    run(image, output, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a batch of double precision frames row by row, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a batch of single precision frames row by row, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a batch of 8-bit frames row by row, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a batch of 16-bit frames row by row, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, nullptr, executor);
+}
+
+/**
+ * @brief Remaps a batch of double precision frames tile by tile, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param tiles Tiles covering the output, usually from planTiles with the bytes of a pixel of all frames.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a batch of single precision frames tile by tile, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param tiles Tiles covering the output, usually from planTiles with the bytes of a pixel of all frames.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a batch of 8-bit frames tile by tile, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param tiles Tiles covering the output, usually from planTiles with the bytes of a pixel of all frames.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, &tiles, executor);
+}
+
+/**
+ * @brief Remaps a batch of 16-bit frames tile by tile, reading the map once for the whole batch.
+ *
+ * @param images The source frames, all of the same size.
+ * @param outputs The remapped frames, one per source frame.
+ * @param tiles Tiles covering the output, usually from planTiles with the bytes of a pixel of all frames.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows or tiles in parallel.
+ * @throws std::invalid_argument if the counts or frame sizes differ, a frame does not match the map or the backend is not supported.
+ */
+void RemapMap::remapBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs, const std::vector<RemapTile>& tiles, RemapBackend backend, const Executor& executor) const {
+    runBatch(images, outputs, backend, &tiles, executor);
+}
+
+/**
+ * @brief Splits the output into tiles whose source footprint fits into a cache budget.
+ *
+ * The source bounding box is first collected for every 8x8 block of output pixels. Starting
+ * from bands of 128 full rows, a tile is split until the source pixels it reads fit into the
+ * budget. Long tiles are halved across their long side and square ones into quadrants, so
+ * mildly distorted regions keep long rows for the hardware prefetcher while regions of strong
+ * compression or rotation get small tiles. Tiles are returned band by band in Z-order, which
+ * keeps consecutive tiles close in the source as well.
+ *
+ * @param pixel_bytes Bytes per source pixel over all channels.
+ * @param cache_bytes Budget for the source footprint of one tile, 0 selects half of the L2 cache.
+ * @return Tiles covering every output pixel exactly once.
+ */
+std::vector<RemapTile> RemapMap::planTiles(size_t pixel_bytes, size_t cache_bytes) const {
+    std::vector<RemapTile> tiles;
+    if (empty()) {
+        return tiles;
+    }
+    if (cache_bytes == 0) {
+        cache_bytes = CpuFeatures::get().l2_cache_bytes / 2;
+    }
+
+    const int block = TILE_BLOCK;
+    const int blocksX = (map_width + block - 1) / block;
+    const int blocksY = (map_height + block - 1) / block;
+    // x0, y0, x1, y1 of the source pixels read by a block, exclusive upper bounds
+    std::vector<std::array<int, 4>> bounds(static_cast<size_t>(blocksX) * blocksY,
+        std::array<int, 4>{ { std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min() } });
+
+    Executor::current().parallelFor(blocksY, [&](long begin, long end) {
+        std::vector<double> X(map_width), Y(map_width);
+        std::vector<std::array<int, 4>> footprint(map_width);
+
+        for (int by = static_cast<int>(begin); by < end; ++by) {
+            for (int y = by * block; y < std::min((by + 1) * block, map_height); ++y) {
+                rowFootprint(y, footprint.data(), X.data(), Y.data());
+                for (int x = 0; x < map_width; ++x) {
+                    const std::array<int, 4>& f = footprint[x];
+                    if (f[2] < f[0]) {
+                        continue;
+                    }
+                    std::array<int, 4>& b = bounds[static_cast<size_t>(by) * blocksX + x / block];
+                    b[0] = std::min(b[0], f[0]);
+                    b[1] = std::min(b[1], f[1]);
+                    b[2] = std::max(b[2], f[2] + 1);
+                    b[3] = std::max(b[3], f[3] + 1);
+                }
+            }
+        }
+    });
+
+    std::function<void(int, int, int, int)> split = [&](int x, int y, int width, int height) {
+        RemapTile tile = { x, y, width, height, std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min() };
+        for (int by = y / block; by < (y + height + block - 1) / block; ++by) {
+            for (int bx = x / block; bx < (x + width + block - 1) / block; ++bx) {
+                const std::array<int, 4>& b = bounds[static_cast<size_t>(by) * blocksX + bx];
+                tile.source_x0 = std::min(tile.source_x0, b[0]);
+                tile.source_y0 = std::min(tile.source_y0, b[1]);
+                tile.source_x1 = std::max(tile.source_x1, b[2]);
+                tile.source_y1 = std::max(tile.source_y1, b[3]);
+            }
+        }
+        if (tile.source_x0 >= tile.source_x1 || tile.source_y0 >= tile.source_y1) {
+            tile.source_x0 = tile.source_y0 = tile.source_x1 = tile.source_y1 = 0;
+        }
+
+        const size_t footprint = static_cast<size_t>(tile.source_x1 - tile.source_x0) * (tile.source_y1 - tile.source_y0) * pixel_bytes;
+        const bool splitX = width > block;
+        const bool splitY = height > block;
+        if (footprint <= cache_bytes || (!splitX && !splitY)) {
+            tiles.push_back(tile);
+            return;
+        }
+
+        // long tiles are halved across their long side only, keeping rows as long as the budget allows
+        const bool halveX = splitX && !(splitY && height >= 2 * width);
+        const bool halveY = splitY && !(splitX && width >= 2 * height);
+        const int halfWidth = halveX ? (width / 2 + block - 1) / block * block : width;
+        const int halfHeight = halveY ? (height / 2 + block - 1) / block * block : height;
+        for (int j = 0; j < (halveY ? 2 : 1); ++j) {
+            for (int i = 0; i < (halveX ? 2 : 1); ++i) {
+                const int tx = x + i * halfWidth;
+                const int ty = y + j * halfHeight;
+                const int tw = i == 0 ? halfWidth : width - halfWidth;
+                const int th = j == 0 ? halfHeight : height - halfHeight;
+                if (tw > 0 && th > 0) {
+                    split(tx, ty, tw, th);
+                }
+            }
+        }
+    };
+
+    for (int y = 0; y < map_height; y += MAX_TILE) {
+        split(0, y, map_width, std::min(MAX_TILE, map_height - y));
+    }
+    return tiles;
+}
+
+/**
+ * @brief Writes the source coordinates of a span of output pixels in any map format.
+ *
+ * @param x The first output column.
+ * @param y The output row.
+ * @param count Number of output pixels.
+ * @param X Receives the source x-coordinates, -1 for FixedPoint, Index, Area, Float16 and Offset16 pixels outside the source and Homography pixels behind it.
+ * @param Y Receives the source y-coordinates.
+ */
+void RemapMap::coordinateSpan(int x, int y, int count, double* X, double* Y) const {
+    switch (map_format) {
+    case MapFormat::Float64:
+        std::copy(Xd.row(y) + x, Xd.row(y) + x + count, X);
+        std::copy(Yd.row(y) + x, Yd.row(y) + x + count, Y);
+        break;
+    case MapFormat::Float32:
+    case MapFormat::Float16:
+    case MapFormat::Offset16:
+        decodeSpan(x, y, count, X, Y);
+        break;
+    case MapFormat::FixedPoint:
+    case MapFormat::Index:
+    case MapFormat::Area:
+        for (int i = 0; i < count; ++i) {
+            std::array<double, 2> c = coordinate(x + i, y);
+            X[i] = c[0];
+            Y[i] = c[1];
+        }
+        break;
+    case MapFormat::ControlGrid:
+        expandRow(y, X, Y, x, count);
+        break;
+    case MapFormat::Homography:
+        homographySpan(x, y, count, X, Y);
+        break;
+    }
+}
+
+/**
+ * @brief Computes the source pixels read by every output pixel of a row, shared by the tile planner and RemapStream.
+ *
+ * Area maps scan the taps of every pixel, the other formats take the taps of the interpolation
+ * around the source coordinate.
+ *
+ * @param y The output row.
+ * @param bounds Receives map width inclusive bounds x0, y0, x1, y1, with x1 < x0 for pixels that read nothing.
+ * @param X Scratch for map width source x-coordinates.
+ * @param Y Scratch for map width source y-coordinates.
+ */
+void RemapMap::rowFootprint(int y, std::array<int, 4>* bounds, double* X, double* Y) const {
+    if (map_format == MapFormat::Area) {
+        const uint32_t* start = area_start.row(y);
+        const int32_t* taps = area_taps.data();
+        for (int x = 0; x < map_width; ++x) {
+            std::array<int, 4> b = { { source_width, source_height, -1, -1 } };
+            for (uint32_t t = start[x]; t < start[x + 1]; ++t) {
+                const int32_t index = taps[2 * static_cast<size_t>(t)];
+                const int ix = index % source_width;
+                const int iy = index / source_width;
+                b[0] = std::min(b[0], ix);
+                b[1] = std::min(b[1], iy);
+                b[2] = std::max(b[2], ix);
+                b[3] = std::max(b[3], iy);
+            }
+            bounds[x] = b;
+        }
+        return;
+    }
+
+    coordinateSpan(0, y, map_width, X, Y);
+    for (int x = 0; x < map_width; ++x) {
+        if (!(X[x] >= 0 && Y[x] >= 0 && X[x] <= source_width && Y[x] <= source_height)) {
+            bounds[x] = { { 0, 0, -1, -1 } };
+            continue;
+        }
+        tapRange(X[x], source_width, bounds[x][0], bounds[x][2]);
+        tapRange(Y[x], source_height, bounds[x][1], bounds[x][3]);
+    }
+}
+
+/**
+ * @brief Quantizes double precision coordinates into the FixedPoint storage.
+ *
+ * @param X The source x-coordinate of every output pixel.
+ * @param Y The source y-coordinate of every output pixel.
+ * @throws std::invalid_argument if the source image does not fit into int16 coordinates.
+ */
+void RemapMap::buildFixedPoint(const Image<double>& X, const Image<double>& Y) {
+    if (source_width > std::numeric_limits<int16_t>::max() || source_height > std::numeric_limits<int16_t>::max()) {
+        throw std::invalid_argument("Source image is too large for a FixedPoint map.");
+    }
+
+    Image<int16_t> XYimage(map_width, map_height, 2);
+    Image<uint16_t> fracImage(map_width, map_height);
+
+    Executor::current().parallelFor(map_height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < map_width; ++x) {
+                int ix, iy, index;
+                if (quantizeCoordinate(X(x, y), Y(x, y), source_width, source_height, ix, iy, index)) {
+                    XYimage(x, y, 0) = static_cast<int16_t>(ix);
+                    XYimage(x, y, 1) = static_cast<int16_t>(iy);
+                    fracImage(x, y) = static_cast<uint16_t>(index);
+                }
+                else {
+                    XYimage(x, y, 0) = -1;
+                    XYimage(x, y, 1) = -1;
+                    fracImage(x, y) = 0;
+                }
+            }
+        }
+    });
+    adopt(std::move(XYimage), std::move(fracImage), XYi, frac);
+}
+
+/**
+ * @brief Rounds double precision coordinates into the Index storage.
+ *
+ * @param X The source x-coordinate of every output pixel.
+ * @param Y The source y-coordinate of every output pixel.
+ * @throws std::invalid_argument if the source image has too many pixels for int32 indices.
+ */
+void RemapMap::buildIndex(const Image<double>& X, const Image<double>& Y) {
+    if (static_cast<int64_t>(source_width) * source_height > std::numeric_limits<int32_t>::max()) {
+        throw std::invalid_argument("Source image is too large for an Index map.");
+    }
+
+    auto plane = std::make_shared<Image<int32_t>>(map_width, map_height);
+    Image<int32_t>& index = *plane;
+
+    Executor::current().parallelFor(map_height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < map_width; ++x) {
+                int ix, iy;
+                index(x, y) = nearestCoordinate(X(x, y), Y(x, y), source_width, source_height, ix, iy) ? iy * source_width + ix : -1;
+            }
+        }
+    });
+    indices = index.view();
+    storage = plane;
+}
+
+/**
+ * @brief Converts double precision coordinates into the Float32, Float16 or Offset16 storage.
+ *
+ * Offset16 maps use the finest power of two step that holds the largest offset of a pixel inside
+ * the source in int16, at most 2^-14 pixels.
+ *
+ * @param X The source x-coordinate of every output pixel.
+ * @param Y The source y-coordinate of every output pixel.
+ * @throws std::invalid_argument if the source image is too large for the offsets of an Offset16 map.
+ */
+void RemapMap::buildCompact(const Image<double>& X, const Image<double>& Y) {
+    const Executor& executor = Executor::current();
+    if (map_format == MapFormat::Float32) {
+        Image<float> Xfloat(map_width, map_height);
+        Image<float> Yfloat(map_width, map_height);
+        executor.parallelFor(map_height, [&](long begin, long end) {
+            for (int y = static_cast<int>(begin); y < end; ++y) {
+                for (int x = 0; x < map_width; ++x) {
+                    Xfloat(x, y) = static_cast<float>(X(x, y));
+                    Yfloat(x, y) = static_cast<float>(Y(x, y));
+                }
+            }
+        });
+        adopt(std::move(Xfloat), std::move(Yfloat), Xf, Yf);
+        return;
+    }
+
+    const double scaleX = static_cast<double>(source_width) / map_width;
+    const double scaleY = static_cast<double>(source_height) / map_height;
+    auto inside = [&](int x, int y) {
+        return X(x, y) >= 0 && Y(x, y) >= 0 && X(x, y) <= source_width && Y(x, y) <= source_height;
+    };
+
+    if (map_format == MapFormat::Float16) {
+        auto plane = std::make_shared<Image<uint16_t>>(map_width, map_height, 2);
+        Image<uint16_t>& offsets = *plane;
+        const uint16_t nan = CommonMath::floatToHalf(std::numeric_limits<float>::quiet_NaN());
+        executor.parallelFor(map_height, [&](long begin, long end) {
+            for (int y = static_cast<int>(begin); y < end; ++y) {
+                for (int x = 0; x < map_width; ++x) {
+                    const bool valid = inside(x, y);
+                    offsets(x, y, 0) = valid ? CommonMath::floatToHalf(static_cast<float>(X(x, y) - ((x + 0.5) * scaleX - 0.5))) : nan;
+                    offsets(x, y, 1) = valid ? CommonMath::floatToHalf(static_cast<float>(Y(x, y) - ((y + 0.5) * scaleY - 0.5))) : nan;
+                }
+            }
+        });
+        XYh = offsets.view();
+        storage = plane;
+        return;
+    }
+
+    const int largest = std::numeric_limits<int16_t>::max() - 1;
+    if (source_width > largest || source_height > largest) {
+        throw std::invalid_argument("Source image is too large for an Offset16 map.");
+    }
+
+    // largest offset from the identity per row, the maximum over all rows selects the step
+    std::vector<double> rowOffsets(map_height, 0.0);
+    executor.parallelFor(map_height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < map_width; ++x) {
+                if (inside(x, y)) {
+                    const double ox = std::abs(X(x, y) - ((x + 0.5) * scaleX - 0.5));
+                    const double oy = std::abs(Y(x, y) - ((y + 0.5) * scaleY - 0.5));
+                    rowOffsets[y] = std::max(rowOffsets[y], std::max(ox, oy));
+                }
+            }
+        }
+    });
+    const double largestOffset = rowOffsets.empty() ? 0.0 : *std::max_element(rowOffsets.begin(), rowOffsets.end());
+    offset_bits = 14;
+    while (offset_bits > 0 && std::ldexp(largestOffset, offset_bits) > largest) {
+        --offset_bits;
+    }
+
+    auto plane = std::make_shared<Image<int16_t>>(map_width, map_height, 2);
+    Image<int16_t>& offsets = *plane;
+    executor.parallelFor(map_height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < map_width; ++x) {
+                if (inside(x, y)) {
+                    offsets(x, y, 0) = static_cast<int16_t>(std::lround(std::ldexp(X(x, y) - ((x + 0.5) * scaleX - 0.5), offset_bits)));
+                    offsets(x, y, 1) = static_cast<int16_t>(std::lround(std::ldexp(Y(x, y) - ((y + 0.5) * scaleY - 0.5), offset_bits)));
+                }
+                else {
+                    offsets(x, y, 0) = std::numeric_limits<int16_t>::min();
+                    offsets(x, y, 1) = std::numeric_limits<int16_t>::min();
+                }
+            }
+        }
+    });
+    XYo = offsets.view();
+    storage = plane;
+}
+
+/**
+ * @brief Validates the shapes of a source image and an output image against the map.
+ *
+ * @param image_width Width of the source image.
+ * @param image_height Height of the source image.
+ * @param image_channels Channels of the source image.
+ * @param output_width Width of the output image.
+ * @param output_height Height of the output image.
+ * @param output_channels Channels of the output image.
+ *
+ * @throws std::invalid_argument if the shapes do not match.
+ */
+void RemapMap::checkShapes(int image_width, int image_height, int image_channels, int output_width, int output_height, int output_channels) const {
+    // FixedPoint, Index, Area, Float16 and Offset16 maps have the source borders baked in, Float64, Float32, ControlGrid and Homography maps adapt to any source size
+    const bool baked = map_format == MapFormat::FixedPoint || map_format == MapFormat::Index || map_format == MapFormat::Area ||
+                       map_format == MapFormat::Float16 || map_format == MapFormat::Offset16;
+    if (baked && (image_width != source_width || image_height != source_height)) {
+        throw std::invalid_argument("Image dimensions do not match the source dimensions of the map.");
+    }
+    if (output_width != map_width || output_height != map_height || output_channels != image_channels) {
+        throw std::invalid_argument("Output image must match the map dimensions and the image channels.");
+    }
+}
+
+// span kernels used by RemapStream
+template void RemapMap::remapSpan<double, double>(const ImageView<const double>&, const ImageView<double>&, const RemapKernels&, int, int, int, SpanBuffers&, int) const;
+template void RemapMap::remapSpan<float, float>(const ImageView<const float>&, const ImageView<float>&, const RemapKernels&, int, int, int, SpanBuffers&, int) const;
+template void RemapMap::remapSpan<uint8_t, uint8_t>(const ImageView<const uint8_t>&, const ImageView<uint8_t>&, const RemapKernels&, int, int, int, SpanBuffers&, int) const;
+template void RemapMap::remapSpan<uint16_t, uint16_t>(const ImageView<const uint16_t>&, const ImageView<uint16_t>&, const RemapKernels&, int, int, int, SpanBuffers&, int) const;
+
+// tile kernels used by RemapPyramid
+template void RemapMap::remapTile<double, double>(const ImageView<const double>&, const ImageView<double>&, const RemapKernels&, const RemapRegion*, const RemapTile&, SpanBuffers&) const;
+template void RemapMap::remapTile<float, float>(const ImageView<const float>&, const ImageView<float>&, const RemapKernels&, const RemapRegion*, const RemapTile&, SpanBuffers&) const;
+template void RemapMap::remapTile<uint8_t, uint8_t>(const ImageView<const uint8_t>&, const ImageView<uint8_t>&, const RemapKernels&, const RemapRegion*, const RemapTile&, SpanBuffers&) const;
+template void RemapMap::remapTile<uint16_t, uint16_t>(const ImageView<const uint16_t>&, const ImageView<uint16_t>&, const RemapKernels&, const RemapRegion*, const RemapTile&, SpanBuffers&) const;
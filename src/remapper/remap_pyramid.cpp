@@ -0,0 +1,285 @@
+#include "remapper/remap_pyramid.h"
+#include "remapper/remapper.h"
+#include <stdexcept>
+
+/**
+ * @brief Builds the levels of a pyramid from a full resolution map.
+ *
+ * The lower levels are derived in the format of the base map where it serves the interpolation:
+ * Area interpolation builds Area maps, Nearest Index maps, and the other interpolations keep a
+ * FixedPoint, ControlGrid, Homography, Float32, Float16 or Offset16 base and use Float64 otherwise. The pixel classification of every
+ * level is computed here, so the first frame does not pay for it.
+ *
+ * @param base The map of level 0, used as it is.
+ * @param levels Number of levels including level 0.
+ * @param interpolation The interpolation of the levels below level 0.
+ * @throws std::invalid_argument if levels is smaller than one or the base map is empty.
+ */
+RemapPyramid::RemapPyramid(const RemapMap& base, int levels, RemapInterpolation interpolation) {
+    if (levels < 1) {
+        throw std::invalid_argument("A pyramid needs at least one level.");
+    }
+    if (base.empty()) {
+        throw std::invalid_argument("Cannot build a pyramid from an empty map.");
+    }
+
+    maps.push_back(base);
+    int width = base.width();
+    int height = base.height();
+    for (int l = 1; l < levels; ++l) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        maps.push_back(deriveLevel(base, width, height, interpolation));
+    }
+    for (const RemapMap& map : maps) {
+        map.region();
+    }
+}
+
+/**
+ * @brief Builds a pyramid over the undistort map of a remapper.
+ *
+ * @param remapper The remapper, its undistort map is built if it was not yet.
+ * @param levels Number of levels including level 0.
+ * @param interpolation The interpolation of the levels below level 0.
+ * @throws std::invalid_argument if levels is smaller than one.
+ */
+RemapPyramid::RemapPyramid(const Remapper& remapper, int levels, RemapInterpolation interpolation)
+    : RemapPyramid(remapper.getUndistortMap(), levels, interpolation) {}
+
+/**
+ * @brief Derives the map of a smaller output from a full resolution map without evaluating the camera models.
+ *
+ * Output pixel x of the level lies at (x + 0.5) * base width / width - 0.5 in the base map,
+ * whose coordinates are interpolated there.
+ *
+ * @param base The full resolution map.
+ * @param width Width of the level.
+ * @param height Height of the level.
+ * @param interpolation The interpolation of the level.
+ * @return The map of the level.
+ */
+RemapMap RemapPyramid::deriveLevel(const RemapMap& base, int width, int height, RemapInterpolation interpolation) {
+    const double scaleX = static_cast<double>(base.width()) / width;
+    const double scaleY = static_cast<double>(base.height()) / height;
+    RemapMap::PointMapping mapping = [&base, scaleX, scaleY](const std::vector<std::array<double, 2>>& pixels) {
+        std::vector<std::array<double, 2>> coordinates(pixels.size());
+        Executor::current().parallelFor(static_cast<long>(pixels.size()), [&](long begin, long end) {
+            for (long i = begin; i < end; ++i) {
+                coordinates[i] = base.coordinateAt((pixels[i][0] + 0.5) * scaleX - 0.5, (pixels[i][1] + 0.5) * scaleY - 0.5);
+            }
+        }, 1024);
+        return coordinates;
+    };
+
+    if (interpolation == RemapInterpolation::Area) {
+        return RemapMap::fromArea(width, height, base.sourceWidth(), base.sourceHeight(), mapping);
+    }
+    if (base.format() == MapFormat::Homography && interpolation != RemapInterpolation::Nearest) {
+        // level pixels map to base pixels by a scale, so the level is a homography as well
+        const Matrix3x3 scale = { { { scaleX, 0.0, 0.5 * scaleX - 0.5 }, { 0.0, scaleY, 0.5 * scaleY - 0.5 }, { 0.0, 0.0, 1.0 } } };
+        RemapMap map = RemapMap::fromHomography(width, height, base.sourceWidth(), base.sourceHeight(), CommonMath::matrixMultiply(base.getHomography(), scale));
+        map.setInterpolation(interpolation);
+        return map;
+    }
+    if (base.format() == MapFormat::ControlGrid && interpolation != RemapInterpolation::Nearest) {
+        ControlGridOptions options;
+        options.spacing = base.gridSpacing();
+        RemapMap map = RemapMap::fromControlGrid(width, height, base.sourceWidth(), base.sourceHeight(), mapping, options);
+        map.setInterpolation(interpolation);
+        return map;
+    }
+
+    std::vector<std::array<double, 2>> pixels;
+    pixels.reserve(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            pixels.push_back({ static_cast<double>(x), static_cast<double>(y) });
+        }
+    }
+    const std::vector<std::array<double, 2>> coordinates = mapping(pixels);
+
+    Image<double> Xd(width, height);
+    Image<double> Yd(width, height);
+    for (size_t i = 0; i < coordinates.size(); ++i) {
+        Xd.data()[i] = coordinates[i][0];
+        Yd.data()[i] = coordinates[i][1];
+    }
+    MapFormat format = base.format();
+    if (format == MapFormat::ControlGrid || format == MapFormat::Index || format == MapFormat::Area) {
+        format = MapFormat::Float64;
+    }
+    if (interpolation == RemapInterpolation::Nearest) {
+        format = MapFormat::Index;
+    }
+    RemapMap map(std::move(Xd), std::move(Yd), base.sourceWidth(), base.sourceHeight(), format);
+    map.setInterpolation(interpolation);
+    return map;
+}
+
+/**
+ * @brief Returns the number of bytes held by the maps of all levels.
+ *
+ * @return The memory usage in bytes.
+ */
+size_t RemapPyramid::memoryUsage() const {
+    size_t bytes = 0;
+    for (const RemapMap& map : maps) {
+        bytes += map.memoryUsage();
+    }
+    return bytes;
+}
+
+/**
+ * @brief Returns the tiles of all levels for a source pixel size, planning them on first use.
+ *
+ * @param pixel_bytes Bytes per source pixel over all channels.
+ * @return The tiles as (level, tile), level 0 first, valid for the lifetime of the pyramid.
+ */
+const std::vector<std::pair<int, RemapTile>>& RemapPyramid::getTilePlan(size_t pixel_bytes) const {
+    std::lock_guard<std::mutex> lock(plan_mutex);
+    std::vector<std::pair<int, RemapTile>>& plan = tile_plans[pixel_bytes];
+    if (plan.empty()) {
+        for (size_t l = 0; l < maps.size(); ++l) {
+            for (const RemapTile& tile : maps[l].planTiles(pixel_bytes)) {
+                plan.push_back({ static_cast<int>(l), tile });
+            }
+        }
+    }
+    return plan;
+}
+
+/**
+ * @brief Validates the shapes and remaps the tiles of all levels in one parallel loop.
+ *
+ * @param image The source image.
+ * @param outputs The outputs, one per level.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @throws std::invalid_argument if the output count differs from the levels, an output does not match its level or the backend is not supported.
+ */
+template <typename T>
+void RemapPyramid::run(const ImageView<const T>& image, const std::vector<ImageView<T>>& outputs, RemapBackend backend, const Executor& executor) const {
+    if (outputs.size() != maps.size()) {
+        throw std::invalid_argument("A pyramid remap needs one output per level.");
+    }
+    if (image.empty()) {
+        return;
+    }
+    std::vector<const RemapRegion*> regions(maps.size());
+    for (size_t l = 0; l < maps.size(); ++l) {
+        maps[l].checkShapes(image.width(), image.height(), image.channels(), outputs[l].width(), outputs[l].height(), outputs[l].channels());
+        regions[l] = image.width() == maps[l].sourceWidth() && image.height() == maps[l].sourceHeight() ? &maps[l].region() : nullptr;
+    }
+    const RemapKernels& kernels = RemapKernels::get(backend, image);
+    const std::vector<std::pair<int, RemapTile>>& plan = getTilePlan(image.channels() * sizeof(T));
+
+    executor.parallelFor(static_cast<long>(plan.size()), [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            const int l = plan[i].first;
+            const RemapMap& map = maps[l];
+            map.remapTile(image, outputs[l], kernels, regions[l], plan[i].second, map.threadBuffers(map.width()));
+        }
+    });
+}
+
+/**
+ * @brief Allocates the outputs of all levels with the layout of the image and remaps into them.
+ *
+ * @param image The source image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @return One image per level, empty images for an empty source.
+ */
+template <typename T>
+std::vector<Image<T>> RemapPyramid::allocate(const ImageView<const T>& image, RemapBackend backend, const Executor& executor) const {
+    std::vector<Image<T>> images(maps.size());
+    if (image.empty()) {
+        return images;
+    }
+    std::vector<ImageView<T>> outputs;
+    for (size_t l = 0; l < maps.size(); ++l) {
+        images[l] = Image<T>(maps[l].width(), maps[l].height(), image.channels(), image.layout());
+        outputs.push_back(images[l].view());
+    }
+    run(image, outputs, backend, executor);
+    return images;
+}
+
+/**
+ * @brief Remaps a double precision image into every level.
+ *
+ * @param image The source image.
+ * @param outputs The outputs, one per level.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @throws std::invalid_argument if the outputs do not match the levels or the backend is not supported.
+ */
+void RemapPyramid::remap(const ImageView<const double>& image, const std::vector<ImageView<double>>& outputs, RemapBackend backend, const Executor& executor) const {
+    run(image, outputs, backend, executor);
+}
+
+/**
+ * @brief Remaps an 8-bit image into every level.
+ *
+ * @param image The source image.
+ * @param outputs The outputs, one per level.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @throws std::invalid_argument if the outputs do not match the levels or the backend is not supported.
+ */
+void RemapPyramid::remap(const ImageView<const uint8_t>& image, const std::vector<ImageView<uint8_t>>& outputs, RemapBackend backend, const Executor& executor) const {
+    run(image, outputs, backend, executor);
+}
+
+/**
+ * @brief Remaps a 16-bit image into every level.
+ *
+ * @param image The source image.
+ * @param outputs The outputs, one per level.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @throws std::invalid_argument if the outputs do not match the levels or the backend is not supported.
+ */
+void RemapPyramid::remap(const ImageView<const uint16_t>& image, const std::vector<ImageView<uint16_t>>& outputs, RemapBackend backend, const Executor& executor) const {
+    run(image, outputs, backend, executor);
+}
+
+/**
+ * @brief Remaps a double precision image into newly allocated levels.
+ *
+ * @param image The source image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @return One image per level with the layout of the source.
+ * @throws std::invalid_argument if the image does not match the maps or the backend is not supported.
+ */
+std::vector<Image<double>> RemapPyramid::remap(const ImageView<const double>& image, RemapBackend backend, const Executor& executor) const {
+    return allocate(image, backend, executor);
+}
+
+/**
+ * @brief Remaps an 8-bit image into newly allocated levels.
+ *
+ * @param image The source image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @return One image per level with the layout of the source.
+ * @throws std::invalid_argument if the image does not match the maps or the backend is not supported.
+ */
+std::vector<Image<uint8_t>> RemapPyramid::remap(const ImageView<const uint8_t>& image, RemapBackend backend, const Executor& executor) const {
+    return allocate(image, backend, executor);
+}
+
+/**
+ * @brief Remaps a 16-bit image into newly allocated levels.
+ *
+ * @param image The source image.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the tiles in parallel.
+ * @return One image per level with the layout of the source.
+ * @throws std::invalid_argument if the image does not match the maps or the backend is not supported.
+ */
+std::vector<Image<uint16_t>> RemapPyramid::remap(const ImageView<const uint16_t>& image, RemapBackend backend, const Executor& executor) const {
+    return allocate(image, backend, executor);
+}
@@ -0,0 +1,141 @@
+#include "remapper/remap_stream.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+/**
+ * @brief Prepares a stream by computing the source rows read by every output row.
+ *
+ * @param map The map to remap with; copies share its storage.
+ * @param channels Channels of the source bands and the output rows.
+ * @param callback Receives every output row once.
+ * @param backend The instruction set of the row kernels.
+ * @param executor Runs the rows of every push in parallel, nullptr for Executor::current() at the time of the push.
+ * @throws std::invalid_argument if the map is empty, the channel count is invalid or the backend is not supported.
+ */
+template <typename T>
+RemapStream<T>::RemapStream(const RemapMap& map, int channels, RowCallback callback, RemapBackend backend, std::shared_ptr<Executor> executor)
+    : map(map), channels(channels), callback(std::move(callback)), backend(backend), executor(std::move(executor)) {
+
+    if (map.empty()) {
+        throw std::invalid_argument("Cannot stream through an empty map.");
+    }
+    if (channels < 1) {
+        throw std::invalid_argument("A stream needs at least one channel.");
+    }
+    RemapKernels::get(backend);
+
+    const int width = map.width();
+    const int height = map.height();
+    std::vector<int> lowest(height, std::numeric_limits<int>::max());
+    last_row.assign(height, -1);
+
+    getExecutor().parallelFor(height, [&](long rowBegin, long rowEnd) {
+        std::vector<double> X(width), Y(width);
+        std::vector<std::array<int, 4>> footprint(width);
+        for (long y = rowBegin; y < rowEnd; ++y) {
+            // rows read by the interpolation of the map, clamped to the border
+            map.rowFootprint(static_cast<int>(y), footprint.data(), X.data(), Y.data());
+            for (int x = 0; x < width; ++x) {
+                if (footprint[x][2] < footprint[x][0]) {
+                    continue;
+                }
+                lowest[y] = std::min(lowest[y], footprint[x][1]);
+                last_row[y] = std::max(last_row[y], footprint[x][3]);
+            }
+        }
+    }, 16);
+
+    order.resize(height);
+    for (int y = 0; y < height; ++y) {
+        order[y] = y;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return last_row[a] < last_row[b]; });
+
+    first_needed.assign(height + 1, std::numeric_limits<int>::max());
+    for (int i = height - 1; i >= 0; --i) {
+        first_needed[i] = std::min(first_needed[i + 1], lowest[order[i]]);
+    }
+}
+
+/**
+ * @brief Appends the next band of source rows and emits every output row that became complete.
+ *
+ * @param band The next rows of the source, directly below the rows pushed so far, any layout.
+ * @throws std::invalid_argument if the band does not match the source width or channel count or extends past the source height.
+ */
+template <typename T>
+void RemapStream<T>::push(const ImageView<const T>& band) {
+    if (band.empty()) {
+        return;
+    }
+    if (band.width() != map.sourceWidth() || band.channels() != channels) {
+        throw std::invalid_argument("Band dimensions do not match the source of the stream.");
+    }
+    if (band.height() > map.sourceHeight() - received) {
+        throw std::invalid_argument("Band extends past the last source row.");
+    }
+
+    const int sourceWidth = map.sourceWidth();
+    const size_t rowElements = static_cast<size_t>(sourceWidth) * channels;
+    const size_t buffered = static_cast<size_t>(received - first_row) * rowElements;
+    window.resize(buffered + band.height() * rowElements);
+    for (int y = 0; y < band.height(); ++y) {
+        T* row = window.data() + buffered + y * rowElements;
+        for (int x = 0; x < sourceWidth; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                row[static_cast<size_t>(x) * channels + c] = band(x, y, c);
+            }
+        }
+    }
+    received += band.height();
+    peak_rows = std::max(peak_rows, received - first_row);
+
+    int ready = emitted;
+    while (ready < map.height() && last_row[order[ready]] < received) {
+        ++ready;
+    }
+    if (ready == emitted) {
+        return;
+    }
+
+    const int width = map.width();
+    const int count = ready - emitted;
+    const size_t outputElements = static_cast<size_t>(width) * channels;
+    staging.resize(count * outputElements);
+    const ImageView<const T> source(window.data(), sourceWidth, received - first_row, channels);
+    const RemapKernels& kernels = RemapKernels::get(backend, source);
+
+    getExecutor().parallelFor(count, [&](long begin, long end) {
+        RemapMap::SpanBuffers& buffers = map.threadBuffers(width);
+        for (long i = begin; i < end; ++i) {
+            const int y = order[emitted + i];
+            T* row = staging.data() + i * outputElements;
+            if (last_row[y] < 0) {
+                std::fill(row, row + outputElements, T());
+                continue;
+            }
+            // a view over the single staging row with every output row aliased onto it
+            const ImageView<T> output(row, width, map.height(), channels, channels, 0, 1);
+            map.remapSpan(source, output, kernels, 0, y, width, buffers, first_row);
+        }
+    });
+
+    for (int i = 0; i < count; ++i) {
+        callback(order[emitted + i], ImageView<const T>(staging.data() + i * outputElements, width, 1, channels));
+    }
+    emitted = ready;
+
+    // release the rows below the lowest row read by any pending output row
+    const int keep = std::min(std::max(first_needed[emitted], first_row), received);
+    if (keep > first_row) {
+        window.erase(window.begin(), window.begin() + static_cast<size_t>(keep - first_row) * rowElements);
+        first_row = keep;
+    }
+}
+
+template class RemapStream<double>;
+template class RemapStream<float>;
+template class RemapStream<uint8_t>;
+template class RemapStream<uint16_t>;
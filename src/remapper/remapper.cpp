@@ -1,13 +1,110 @@
 #include "remapper/remapper.h"
+#include "remapper/map_cache.h"
 #include "camera/pinhole.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
+namespace {
+
+/**
+ * @brief Computes the homography of the mapping between two pinhole cameras.
+ *
+ * @param source The source camera.
+ * @param target The target camera.
+ * @param rotation The rotation from the source to the target camera frame.
+ * @param homography Receives K_source * rotation^-1 * K_target^-1, mapping target pixels to source pixels.
+ * @return False if either camera is not a pinhole.
+ */
+bool pinholeHomography(const std::shared_ptr<Camera>& source, const std::shared_ptr<Camera>& target, const Matrix3x3& rotation, Matrix3x3& homography) {
+    const std::shared_ptr<Pinhole> sourcePinhole = std::dynamic_pointer_cast<Pinhole>(source);
+    const std::shared_ptr<Pinhole> targetPinhole = std::dynamic_pointer_cast<Pinhole>(target);
+    if (!sourcePinhole || !targetPinhole) {
+        return false;
+    }
+    auto intrinsics = [](const Pinhole& camera) {
+        const std::vector<double> f = camera.getFocalLength();
+        const std::vector<double> c = camera.getPrincipalPoint();
+        return Matrix3x3{ { { f[0], camera.getSkew(), c[0] }, { 0.0, f[1], c[1] }, { 0.0, 0.0, 1.0 } } };
+    };
+    homography = CommonMath::matrixMultiply(intrinsics(*sourcePinhole),
+        CommonMath::matrixMultiply(CommonMath::rotationInverse(rotation), CommonMath::matrixInverse(intrinsics(*targetPinhole))));
+    return true;
+}
+
+// options of a remapper composed from another, whose output scale is already part of the chain
+RemapperOptions inheritedOptions(RemapperOptions options) {
+    options.output_scale = 1.0;
+    return options;
+}
+
+/**
+ * @brief Builds the coordinate images of a dense map, mapping the output pixels band by band.
+ *
+ * @param width Width of the map.
+ * @param height Height of the map.
+ * @param mapping Maps output pixels to the source coordinates they sample from.
+ * @param X Receives the source x-coordinates.
+ * @param Y Receives the source y-coordinates.
+ */
+void mapCoordinates(int width, int height, const RemapMap::PointMapping& mapping, Image<double>& X, Image<double>& Y) {
+    X = Image<double>(width, height);
+    Y = Image<double>(width, height);
+    RemapMap::forEachRowChunk(width, height, [&](int first_row, const std::vector<std::array<double, 2>>& pixels) {
+        const std::vector<std::array<double, 2>> source = mapping(pixels);
+        for (size_t i = 0; i < source.size(); ++i) {
+            const int x = static_cast<int>(i % width);
+            const int y = first_row + static_cast<int>(i / width);
+            X(x, y) = source[i][0];
+            Y(x, y) = source[i][1];
+        }
+    });
+}
+
+/**
+ * @brief Checks whether a homography maps the pixels of an image into the image of a stage.
+ *
+ * A projective map whose homogeneous coordinate is positive at the four corners is positive on
+ * the whole rectangle and maps it onto the convex hull of the mapped corners, so the corners decide.
+ *
+ * @param homography Maps pixels of the image to pixels of the stage image up to scale.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param stage_width Width of the stage image.
+ * @param stage_height Height of the stage image, points on its border are inside as in Remapper::targetRays.
+ * @return True if every pixel lands inside the stage image.
+ */
+bool rectangleInside(const Matrix3x3& homography, int width, int height, int stage_width, int stage_height) {
+    const Matrix3x3& H = homography;
+    for (int corner = 0; corner < 4; ++corner) {
+        const double x = (corner & 1) ? width - 1.0 : 0.0;
+        const double y = (corner & 2) ? height - 1.0 : 0.0;
+        const double w = H[2][0] * x + H[2][1] * y + H[2][2];
+        if (!(w > 0)) {
+            return false;
+        }
+        const double u = (H[0][0] * x + H[0][1] * y + H[0][2]) / w;
+        const double v = (H[1][0] * x + H[1][1] * y + H[1][2]) / w;
+        if (!(u >= 0 && v >= 0 && u <= stage_width && v <= stage_height)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
 /**
  * @brief Constructs a Remapper with a source camera and automatically selects the result of getPinhole as the target camera
  *
  * @param cam_source Shared pointer to the source Camera object.
+ * @param options Construction options such as the map storage format and the maps to build up front.
  */
-Remapper::Remapper(const std::shared_ptr<Camera>& cam_source) : cam_source(cam_source)
+Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const RemapperOptions& options) : cam_source(cam_source), options(options)
 {
     Remapper::configure(cam_source, std::static_pointer_cast<Camera>(cam_source->getPinhole()));
 }
@@ -17,9 +114,10 @@ Remapper::Remapper(const std::shared_ptr<Camera>& cam_source) : cam_source(cam_s
  *
  * @param cam_source Shared pointer to the source Camera object.
  * @param cam_target Shared pointer to the target Camera object.
+ * @param options Construction options such as the map storage format and the maps to build up front.
  */
-Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target)
-    : cam_source(cam_source), cam_target(cam_target) {
+Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const RemapperOptions& options)
+    : cam_source(cam_source), cam_target(cam_target), options(options) {
 
     Remapper::configure(cam_source, cam_target);
 }
@@ -30,13 +128,170 @@ Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_
  * @param cam_source Shared pointer to the source Camera object.
  * @param cam_target Shared pointer to the target Camera object.
  * @param rotation_matrix The rotation matrix used to map source to target.
+ * @param options Construction options such as the map storage format and the maps to build up front.
  */
-Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const Matrix3x3& rotation_matrix)
-    : cam_source(cam_source), cam_target(cam_target) {
+Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const Matrix3x3& rotation_matrix, const RemapperOptions& options)
+    : cam_source(cam_source), cam_target(cam_target), options(options) {
 
     Remapper::configure(cam_source, cam_target, rotation_matrix);
 }
 
+/**
+ * @brief Composes two remappers into one whose maps hold the chained mapping.
+ *
+ * Undistorting with the result equals undistorting with first and then with second, and
+ * distorting equals the reverse chain, except that the image is interpolated once. The options
+ * of first are used, without its output scale.
+ *
+ * @param first The remapper applied first.
+ * @param second The remapper applied to the target image of first.
+ * @throws std::invalid_argument if the target size of first differs from the source size of second.
+ */
+Remapper::Remapper(const Remapper& first, const Remapper& second) : Remapper(first, second, inheritedOptions(first.options)) {}
+
+/**
+ * @brief Composes two remappers into one whose maps hold the chained mapping.
+ *
+ * @param first The remapper applied first.
+ * @param second The remapper applied to the target image of first.
+ * @param options Construction options of the composed remapper.
+ * @throws std::invalid_argument if the target size of first differs from the source size of second or second has row rotations.
+ */
+Remapper::Remapper(const Remapper& first, const Remapper& second, const RemapperOptions& options) : options(options) {
+    if (first.target_width != second.source_width || first.target_height != second.source_height) {
+        throw std::invalid_argument("The target image of the first remapper must have the source size of the second.");
+    }
+    if (!second.row_rotations.empty()) {
+        throw std::invalid_argument("Only the first of two composed remappers can have row rotations.");
+    }
+
+    const std::shared_ptr<Camera> source = second.cam_source;
+    const std::shared_ptr<Camera> target = second.cam_target;
+    const Matrix3x3 rotation = second.rotation_matrix;
+    const Matrix3x3 inverse = CommonMath::rotationInverse(rotation);
+    const std::vector<int> target_size = target->getImageSize();
+    const uint64_t fingerprints[2] = { source->fingerprint(), target->fingerprint() };
+
+    RemapStage stage;
+    stage.backward = [source, target, inverse](const std::vector<std::array<double, 2>>& pixels) {
+        return source->project(CommonMath::rotatePoints(target->backproject(pixels), inverse));
+    };
+    stage.forward = [source, target, rotation](const std::vector<std::array<double, 2>>& pixels) {
+        return target->project(CommonMath::rotatePoints(source->backproject(pixels), rotation));
+    };
+    stage.width = target_size[0];
+    stage.height = target_size[1];
+    stage.fingerprint = Utils::hashBytes(rotation.data(), sizeof(rotation), Utils::hashBytes(fingerprints, sizeof(fingerprints)));
+    stage.projective = pinholeHomography(source, target, rotation, stage.homography);
+
+    std::vector<RemapStage> next = { stage };
+    next.insert(next.end(), second.stages.begin(), second.stages.end());
+    compose(first, next);
+}
+
+/**
+ * @brief Composes a remapper with a transform of its undistorted image, such as a crop, resize or rotation.
+ *
+ * The options of remapper are used, without its output scale.
+ *
+ * @param remapper The remapper applied first.
+ * @param transform The transform of the target image of remapper.
+ */
+Remapper::Remapper(const Remapper& remapper, const PixelTransform& transform) : Remapper(remapper, transform, inheritedOptions(remapper.options)) {}
+
+/**
+ * @brief Composes a remapper with a transform of its undistorted image, such as a crop, resize or rotation.
+ *
+ * @param remapper The remapper applied first.
+ * @param transform The transform of the target image of remapper.
+ * @param options Construction options of the composed remapper.
+ */
+Remapper::Remapper(const Remapper& remapper, const PixelTransform& transform, const RemapperOptions& options) : options(options) {
+    compose(remapper, { transformStage(transform) });
+}
+
+/**
+ * @brief Copies a remapper with the maps it built so far, which share their storage with the original.
+ *
+ * @param other The remapper to copy.
+ */
+Remapper::Remapper(const Remapper& other) {
+    std::lock_guard<std::mutex> lock(other.map_mutex);
+    assign(other);
+}
+
+/**
+ * @brief Moves a remapper with the maps it built so far, the moved-from remapper keeps no maps.
+ *
+ * @param other The remapper to move.
+ */
+Remapper::Remapper(Remapper&& other) {
+    std::lock_guard<std::mutex> lock(other.map_mutex);
+    assign(std::move(other));
+    other.undistort_built = false;
+    other.distort_built = false;
+}
+
+/**
+ * @brief Replaces the remapper by a copy of another one, see the copy constructor.
+ *
+ * @param other The remapper to copy.
+ * @return This remapper.
+ */
+Remapper& Remapper::operator=(const Remapper& other) {
+    if (this != &other) {
+        std::lock(map_mutex, other.map_mutex);
+        std::lock_guard<std::mutex> lock(map_mutex, std::adopt_lock);
+        std::lock_guard<std::mutex> other_lock(other.map_mutex, std::adopt_lock);
+        assign(other);
+    }
+    return *this;
+}
+
+/**
+ * @brief Replaces the remapper by another one, see the move constructor.
+ *
+ * @param other The remapper to move.
+ * @return This remapper.
+ */
+Remapper& Remapper::operator=(Remapper&& other) {
+    if (this != &other) {
+        std::lock(map_mutex, other.map_mutex);
+        std::lock_guard<std::mutex> lock(map_mutex, std::adopt_lock);
+        std::lock_guard<std::mutex> other_lock(other.map_mutex, std::adopt_lock);
+        assign(std::move(other));
+        other.undistort_built = false;
+        other.distort_built = false;
+    }
+    return *this;
+}
+
+/**
+ * @brief Copies or moves every member except the map lock, which the caller holds on both remappers.
+ *
+ * @param other The remapper to copy from, or to move from when passed as an rvalue.
+ */
+template <typename Other>
+void Remapper::assign(Other&& other) {
+    cam_source = std::forward<Other>(other).cam_source;
+    cam_target = std::forward<Other>(other).cam_target;
+    options = std::forward<Other>(other).options;
+    source_width = other.source_width;
+    source_height = other.source_height;
+    target_width = other.target_width;
+    target_height = other.target_height;
+    rotation_matrix = other.rotation_matrix;
+    row_rotations = std::forward<Other>(other).row_rotations;
+    stages = std::forward<Other>(other).stages;
+    undistort_built = other.undistort_built;
+    distort_built = other.distort_built;
+    undistort_map = std::forward<Other>(other).undistort_map;
+    distort_map = std::forward<Other>(other).distort_map;
+    target_rays = std::forward<Other>(other).target_rays;
+    updated = other.updated;
+    tile_plans = std::forward<Other>(other).tile_plans;
+}
+
 /**
  * @brief Applies distortion to an image following the mapping from target to source.
  *
@@ -44,7 +299,7 @@ Remapper::Remapper(const std::shared_ptr<Camera>& cam_source, const std::shared_
  * @return The distorted image.
  */
 std::vector<std::vector<std::vector<double>>>  Remapper::distort(const std::vector<std::vector<std::vector<double>>>& image) {
-    return CommonMath::interp2(image, Xd_invert, Yd_invert);
+    return Utils::toVector(distort(Utils::toImage(image)));
 }
 
 /**
@@ -54,75 +309,1102 @@ std::vector<std::vector<std::vector<double>>>  Remapper::distort(const std::vect
  * @return The undistorted image.
  */
 std::vector<std::vector<std::vector<double>>>  Remapper::undistort(const std::vector<std::vector<std::vector<double>>>& image) {
-    return CommonMath::interp2(image, Xd, Yd);
+    return Utils::toVector(undistort(Utils::toImage(image)));
+}
+
+/**
+ * @brief Applies distortion to a contiguous image following the mapping from target to source.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @return The distorted image with the layout of the input.
+ */
+Image<double> Remapper::distort(const ImageView<const double>& image) {
+    return apply(RemapDirection::Distort, image);
+}
+
+/**
+ * @brief Removes distortion from a contiguous image following the mapping from source to target.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @return The undistorted image with the layout of the input.
+ */
+Image<double> Remapper::undistort(const ImageView<const double>& image) {
+    return apply(RemapDirection::Undistort, image);
+}
+
+/**
+ * @brief Applies distortion to an 8-bit image with the integer remap kernel.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @return The distorted image with the layout of the input.
+ */
+Image<uint8_t> Remapper::distort(const ImageView<const uint8_t>& image) {
+    return apply(RemapDirection::Distort, image);
+}
+
+/**
+ * @brief Removes distortion from an 8-bit image with the integer remap kernel.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @return The undistorted image with the layout of the input.
+ */
+Image<uint8_t> Remapper::undistort(const ImageView<const uint8_t>& image) {
+    return apply(RemapDirection::Undistort, image);
+}
+
+/**
+ * @brief Applies distortion to a 16-bit image with the integer remap kernel.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @return The distorted image with the layout of the input.
+ */
+Image<uint16_t> Remapper::distort(const ImageView<const uint16_t>& image) {
+    return apply(RemapDirection::Distort, image);
+}
+
+/**
+ * @brief Removes distortion from a 16-bit image with the integer remap kernel.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @return The undistorted image with the layout of the input.
+ */
+Image<uint16_t> Remapper::undistort(const ImageView<const uint16_t>& image) {
+    return apply(RemapDirection::Undistort, image);
+}
+
+/**
+ * @brief Applies distortion to a single precision image following the mapping from target to source.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @return The distorted image with the layout of the input.
+ */
+Image<float> Remapper::distort(const ImageView<const float>& image) {
+    return apply(RemapDirection::Distort, image);
+}
+
+/**
+ * @brief Removes distortion from a single precision image following the mapping from source to target.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @return The undistorted image with the layout of the input.
+ */
+Image<float> Remapper::undistort(const ImageView<const float>& image) {
+    return apply(RemapDirection::Undistort, image);
+}
+
+/**
+ * @brief Applies distortion to a double precision image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @param output The distorted image, with the size of the distort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::distortInto(const ImageView<const double>& image, const ImageView<double>& output) {
+    applyInto(RemapDirection::Distort, image, output);
+}
+
+/**
+ * @brief Removes distortion from a double precision image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @param output The undistorted image, with the size of the undistort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::undistortInto(const ImageView<const double>& image, const ImageView<double>& output) {
+    applyInto(RemapDirection::Undistort, image, output);
+}
+
+/**
+ * @brief Applies distortion to an 8-bit image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @param output The distorted image, with the size of the distort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::distortInto(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output) {
+    applyInto(RemapDirection::Distort, image, output);
+}
+
+/**
+ * @brief Removes distortion from an 8-bit image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @param output The undistorted image, with the size of the undistort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::undistortInto(const ImageView<const uint8_t>& image, const ImageView<uint8_t>& output) {
+    applyInto(RemapDirection::Undistort, image, output);
+}
+
+/**
+ * @brief Applies distortion to a 16-bit image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @param output The distorted image, with the size of the distort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::distortInto(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output) {
+    applyInto(RemapDirection::Distort, image, output);
+}
+
+/**
+ * @brief Removes distortion from a 16-bit image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @param output The undistorted image, with the size of the undistort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::undistortInto(const ImageView<const uint16_t>& image, const ImageView<uint16_t>& output) {
+    applyInto(RemapDirection::Undistort, image, output);
+}
+
+/**
+ * @brief Applies distortion to a single precision image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @param output The distorted image, with the size of the distort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::distortInto(const ImageView<const float>& image, const ImageView<float>& output) {
+    applyInto(RemapDirection::Distort, image, output);
+}
+
+/**
+ * @brief Removes distortion from a single precision image into a caller-owned output, allocating nothing per frame.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @param output The undistorted image, with the size of the undistort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::undistortInto(const ImageView<const float>& image, const ImageView<float>& output) {
+    applyInto(RemapDirection::Undistort, image, output);
+}
+
+/**
+ * @brief Applies distortion to an 8-bit image into a caller-owned single precision output, converting the pixels inside the remap kernels.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @param output The distorted image, with the size of the distort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::distortInto(const ImageView<const uint8_t>& image, const ImageView<float>& output) {
+    applyInto(RemapDirection::Distort, image, output);
 }
 
+/**
+ * @brief Removes distortion from an 8-bit image into a caller-owned single precision output, converting the pixels inside the remap kernels.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @param output The undistorted image, with the size of the undistort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::undistortInto(const ImageView<const uint8_t>& image, const ImageView<float>& output) {
+    applyInto(RemapDirection::Undistort, image, output);
+}
+
+/**
+ * @brief Applies distortion to a 16-bit image into a caller-owned single precision output, converting the pixels inside the remap kernels.
+ *
+ * @param image The input image to be distorted, any layout or stride.
+ * @param output The distorted image, with the size of the distort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::distortInto(const ImageView<const uint16_t>& image, const ImageView<float>& output) {
+    applyInto(RemapDirection::Distort, image, output);
+}
+
+/**
+ * @brief Removes distortion from a 16-bit image into a caller-owned single precision output, converting the pixels inside the remap kernels.
+ *
+ * @param image The input image to be undistorted, any layout or stride.
+ * @param output The undistorted image, with the size of the undistort map and the channel count of the input.
+ * @throws std::invalid_argument if the output does not match instead of reallocating it.
+ */
+void Remapper::undistortInto(const ImageView<const uint16_t>& image, const ImageView<float>& output) {
+    applyInto(RemapDirection::Undistort, image, output);
+}
+
+/**
+ * @brief Applies distortion to a batch of double precision frames, streaming the distort map once for all of them.
+ *
+ * @param images The frames to be distorted, all of the same size, any layout or stride.
+ * @param outputs The distorted frames, one per input, each with the size of the distort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::distortBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs) {
+    applyBatch(RemapDirection::Distort, images, outputs);
+}
+
+/**
+ * @brief Removes distortion from a batch of double precision frames, streaming the undistort map once for all of them.
+ *
+ * @param images The frames to be undistorted, all of the same size, any layout or stride.
+ * @param outputs The undistorted frames, one per input, each with the size of the undistort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::undistortBatch(const std::vector<ImageView<const double>>& images, const std::vector<ImageView<double>>& outputs) {
+    applyBatch(RemapDirection::Undistort, images, outputs);
+}
+
+/**
+ * @brief Applies distortion to a batch of 8-bit frames, streaming the distort map once for all of them.
+ *
+ * @param images The frames to be distorted, all of the same size, any layout or stride.
+ * @param outputs The distorted frames, one per input, each with the size of the distort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::distortBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs) {
+    applyBatch(RemapDirection::Distort, images, outputs);
+}
+
+/**
+ * @brief Removes distortion from a batch of 8-bit frames, streaming the undistort map once for all of them.
+ *
+ * @param images The frames to be undistorted, all of the same size, any layout or stride.
+ * @param outputs The undistorted frames, one per input, each with the size of the undistort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::undistortBatch(const std::vector<ImageView<const uint8_t>>& images, const std::vector<ImageView<uint8_t>>& outputs) {
+    applyBatch(RemapDirection::Undistort, images, outputs);
+}
+
+/**
+ * @brief Applies distortion to a batch of 16-bit frames, streaming the distort map once for all of them.
+ *
+ * @param images The frames to be distorted, all of the same size, any layout or stride.
+ * @param outputs The distorted frames, one per input, each with the size of the distort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::distortBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs) {
+    applyBatch(RemapDirection::Distort, images, outputs);
+}
+
+/**
+ * @brief Removes distortion from a batch of 16-bit frames, streaming the undistort map once for all of them.
+ *
+ * @param images The frames to be undistorted, all of the same size, any layout or stride.
+ * @param outputs The undistorted frames, one per input, each with the size of the undistort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::undistortBatch(const std::vector<ImageView<const uint16_t>>& images, const std::vector<ImageView<uint16_t>>& outputs) {
+    applyBatch(RemapDirection::Undistort, images, outputs);
+}
+
+/**
+ * @brief Applies distortion to a batch of single precision frames, streaming the distort map once for all of them.
+ *
+ * @param images The frames to be distorted, all of the same size, any layout or stride.
+ * @param outputs The distorted frames, one per input, each with the size of the distort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::distortBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs) {
+    applyBatch(RemapDirection::Distort, images, outputs);
+}
+
+/**
+ * @brief Removes distortion from a batch of single precision frames, streaming the undistort map once for all of them.
+ *
+ * @param images The frames to be undistorted, all of the same size, any layout or stride.
+ * @param outputs The undistorted frames, one per input, each with the size of the undistort map and the channel count of its input.
+ * @throws std::invalid_argument if the counts, frame sizes or outputs do not match.
+ */
+void Remapper::undistortBatch(const std::vector<ImageView<const float>>& images, const std::vector<ImageView<float>>& outputs) {
+    applyBatch(RemapDirection::Undistort, images, outputs);
+}
+
+/**
+ * @brief Remaps an image with the map of a direction into a newly allocated image.
+ *
+ * @param direction Undistort or Distort.
+ * @param image The input image.
+ * @return The remapped image with the layout of the input, empty for an empty input.
+ */
+template <typename T>
+Image<T> Remapper::apply(RemapDirection direction, const ImageView<const T>& image) const {
+    const RemapMap& map = direction == RemapDirection::Undistort ? getUndistortMap() : getDistortMap();
+    if (image.empty() || map.empty()) {
+        return {};
+    }
+
+    Image<T> output(map.width(), map.height(), image.channels(), image.layout());
+    execute(direction, map, image, output.view());
+    return output;
+}
+
+/**
+ * @brief Remaps an image with the map of a direction into a caller-owned output.
+ *
+ * @param direction Undistort or Distort.
+ * @param image The input image.
+ * @param output The output, with the size of the map and the channel count of the image in any layout.
+ * @throws std::invalid_argument if the image or output do not match the map.
+ */
+template <typename In, typename Out>
+void Remapper::applyInto(RemapDirection direction, const ImageView<const In>& image, const ImageView<Out>& output) const {
+    const RemapMap& map = direction == RemapDirection::Undistort ? getUndistortMap() : getDistortMap();
+    if (image.empty() || !output.sameShape(map.width(), map.height(), image.channels())) {
+        throw std::invalid_argument("Output dimensions do not match the remap map and the channels of the image.");
+    }
+    execute(direction, map, image, output);
+}
+
+/**
+ * @brief Remaps a batch of frames with the map of a direction into caller-owned outputs.
+ *
+ * With tiled execution the tiles are planned for the source footprint of all frames together,
+ * so a tile of every frame stays in cache while the map tile is applied to the batch.
+ *
+ * @param direction Undistort or Distort.
+ * @param images The input frames.
+ * @param outputs The outputs, one per frame.
+ * @throws std::invalid_argument if the frames or outputs do not match the map or each other.
+ */
+template <typename T>
+void Remapper::applyBatch(RemapDirection direction, const std::vector<ImageView<const T>>& images, const std::vector<ImageView<T>>& outputs) const {
+    const RemapMap& map = direction == RemapDirection::Undistort ? getUndistortMap() : getDistortMap();
+    if (images.size() != outputs.size()) {
+        throw std::invalid_argument("A batch needs one output per frame.");
+    }
+    size_t pixelBytes = 0;
+    for (size_t f = 0; f < images.size(); ++f) {
+        if (images[f].empty() || !outputs[f].sameShape(map.width(), map.height(), images[f].channels())) {
+            throw std::invalid_argument("Output dimensions do not match the remap map and the channels of the image.");
+        }
+        pixelBytes += images[f].channels() * sizeof(T);
+    }
+    if (images.empty()) {
+        return;
+    }
+
+    if (options.execution == RemapExecution::Tiles) {
+        map.remapBatch(images, outputs, getTilePlan(direction, pixelBytes), options.backend, getExecutor());
+    }
+    else {
+        map.remapBatch(images, outputs, options.backend, getExecutor());
+    }
+}
+
+/**
+ * @brief Runs the remap kernels of a map with the execution selected by the options.
+ *
+ * @param direction Undistort or Distort, selects the tile plan.
+ * @param map The map of the direction.
+ * @param image The input image.
+ * @param output The output image.
+ */
+template <typename In, typename Out>
+void Remapper::execute(RemapDirection direction, const RemapMap& map, const ImageView<const In>& image, const ImageView<Out>& output) const {
+    if (options.execution == RemapExecution::Tiles) {
+        map.remap(image, output, getTilePlan(direction, image.channels() * sizeof(In)), options.backend, getExecutor());
+    }
+    else {
+        map.remap(image, output, options.backend, getExecutor());
+    }
+}
+
+/**
+ * @brief Returns the tiles of a direction for a source pixel size, planning them on first use.
+ *
+ * @param direction Undistort or Distort.
+ * @param pixel_bytes Bytes per source pixel over all channels.
+ * @return The tiles, valid for the lifetime of the Remapper.
+ */
+const std::vector<RemapTile>& Remapper::getTilePlan(RemapDirection direction, size_t pixel_bytes) const {
+    const RemapMap& map = direction == RemapDirection::Undistort ? getUndistortMap() : getDistortMap();
+    std::lock_guard<std::mutex> lock(map_mutex);
+    std::vector<RemapTile>& tiles = tile_plans[std::make_pair(static_cast<int>(direction), pixel_bytes)];
+    if (tiles.empty()) {
+        Executor::Scope scope(getExecutor());
+        tiles = map.planTiles(pixel_bytes, options.tile_cache_bytes);
+    }
+    return tiles;
+}
+
+/**
+ * @brief Stores the camera geometry and builds the maps requested by the options.
+ *
+ * Maps that are not requested are built on first use by the corresponding remap call or getter.
+ * An output scale other than 1 appends a resize of the whole target image to the stages, so the
+ * maps undistort and scale in one pass.
+ *
+ * @param cam_source Shared pointer to the source Camera object.
+ * @param cam_target Shared pointer to the target Camera object.
+ * @param rotation_matrix The rotation matrix used to map source to target.
+ * @throws std::invalid_argument if the output scale is not positive or Homography maps are requested for a mapping that is no homography.
+ */
 void Remapper::configure(const std::shared_ptr<Camera>& cam_source, const std::shared_ptr<Camera>& cam_target, const Matrix3x3& rotation_matrix)
 {
-    
-    std::vector<int> source_size = cam_source->getImageSize();
+    if (!(options.output_scale > 0)) {
+        throw std::invalid_argument("The output scale must be positive.");
+    }
+    this->cam_target = cam_target;
+    if (options.output_scale != 1.0) {
+        int width, height;
+        stageInputSize(stages.size(), width, height);
+        stages.push_back(transformStage(PixelTransform::resize(width, height,
+            std::max(1, static_cast<int>(std::lround(width * options.output_scale))), std::max(1, static_cast<int>(std::lround(height * options.output_scale))))));
+    }
 
+    std::vector<int> source_size = cam_source->getImageSize();
     source_width = source_size[0];
     source_height = source_size[1];
 
-    X.resize(source_height, std::vector<double>(source_width, 0));
-    Y.resize(source_height, std::vector<double>(source_width, 0));
+    std::vector<int> target_size = cam_target->getImageSize();
+    target_width = target_size[0];
+    target_height = target_size[1];
+
+    if (!stages.empty()) {
+        target_width = stages.back().width;
+        target_height = stages.back().height;
+    }
+
+    this->rotation_matrix = rotation_matrix;
+    if (mapFormat() == MapFormat::Homography && !isHomography()) {
+        throw std::invalid_argument("Homography maps need pinhole source and target cameras, a single rotation and projective stages.");
+    }
+
+    if (options.prebuild == RemapDirection::Undistort || options.prebuild == RemapDirection::Both) {
+        getUndistortMap();
+    }
+    if (options.prebuild == RemapDirection::Distort || options.prebuild == RemapDirection::Both) {
+        getDistortMap();
+    }
+}
+
+/**
+ * @brief Takes over the cameras and stages of a remapper, appends further stages and configures the maps.
+ *
+ * @param first The remapper whose mapping comes first.
+ * @param next The stages applied after it.
+ */
+void Remapper::compose(const Remapper& first, const std::vector<RemapStage>& next)
+{
+    cam_source = first.cam_source;
+    row_rotations = first.row_rotations;
+    updated = first.updated;
+    stages = first.stages;
+    stages.insert(stages.end(), next.begin(), next.end());
+    configure(first.cam_source, first.cam_target, first.rotation_matrix);
+}
+
+/**
+ * @brief Wraps a pixel transform into a composed stage.
+ *
+ * @param transform The transform.
+ * @return The stage applying the transform.
+ */
+Remapper::RemapStage Remapper::transformStage(const PixelTransform& transform)
+{
+    RemapStage stage;
+    stage.backward = [transform](const std::vector<std::array<double, 2>>& pixels) { return transform.backward(pixels); };
+    stage.forward = [transform](const std::vector<std::array<double, 2>>& pixels) { return transform.forward(pixels); };
+    stage.width = transform.width();
+    stage.height = transform.height();
+    stage.fingerprint = transform.fingerprint();
+    stage.projective = true;
+    stage.homography = transform.inverse();
+    return stage;
+}
 
-    for (int y = 0; y < source_height; ++y) {
-        for (int x = 0; x < source_width; ++x) {
-            X[y][x] = x + 1;
-            Y[y][x] = y + 1;
+/**
+ * @brief Returns the size of the image a stage reads, the target camera image or the output of the previous stage.
+ *
+ * @param stage Index of the stage.
+ * @param width Receives the input width.
+ * @param height Receives the input height.
+ */
+void Remapper::stageInputSize(size_t stage, int& width, int& height) const
+{
+    if (stage > 0) {
+        width = stages[stage - 1].width;
+        height = stages[stage - 1].height;
+        return;
+    }
+    std::vector<int> size = cam_target->getImageSize();
+    width = size[0];
+    height = size[1];
+}
+
+/**
+ * @brief Returns the map from target pixels to source coordinates, building it on first use.
+ *
+ * @return The undistort map.
+ */
+const RemapMap& Remapper::getUndistortMap() const {
+    std::lock_guard<std::mutex> lock(map_mutex);
+    if (!undistort_built) {
+        Executor::Scope scope(getExecutor());
+        undistort_map = loadOrBuild(RemapDirection::Undistort);
+        undistort_built = true;
+    }
+    return undistort_map;
+}
+
+/**
+ * @brief Returns the map from source pixels to target coordinates, building it on first use.
+ *
+ * @return The distort map.
+ */
+const RemapMap& Remapper::getDistortMap() const {
+    std::lock_guard<std::mutex> lock(map_mutex);
+    if (!distort_built) {
+        Executor::Scope scope(getExecutor());
+        distort_map = loadOrBuild(RemapDirection::Distort);
+        distort_built = true;
+    }
+    return distort_map;
+}
+
+/**
+ * @brief Returns the number of bytes held by the maps built so far.
+ *
+ * @return The memory usage in bytes.
+ */
+size_t Remapper::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(map_mutex);
+    return undistort_map.memoryUsage() + distort_map.memoryUsage() + target_rays.capacity() * sizeof(target_rays[0]);
+}
+
+/**
+ * @brief Replaces the rotation from the source to the target camera frame and rebuilds the undistort map.
+ *
+ * Meant for per-frame changes such as electronic stabilization. The first update backprojects the
+ * target pixels once and keeps the rays, later updates only rotate and project them on the executor
+ * of the options. ControlGrid and Area maps are rebuilt from scratch, they evaluate the cameras
+ * at few points or many samples per pixel instead of once per pixel. The distort map and the tile
+ * plans are dropped and built again on first use, and rebuilt maps bypass the persistent cache.
+ *
+ * @param rotation_matrix The new rotation matrix used to map source to target.
+ */
+void Remapper::updateRotation(const Matrix3x3& rotation_matrix)
+{
+    this->rotation_matrix = rotation_matrix;
+    row_rotations.clear();
+    rebuildUndistortMap();
+}
+
+/**
+ * @brief Replaces the intrinsics of a pinhole target camera, such as the zoom of a virtual pan-tilt-zoom view, and rebuilds the undistort map.
+ *
+ * The image size of the target stays the same. A pinhole ray only moves within the plane z = 1
+ * when the intrinsics change, so cached rays are mapped to the new intrinsics directly, see updateRotation.
+ *
+ * @param focal_length The new focal lengths along x and y.
+ * @param principal_point The new principal point.
+ * @param skew The new skew.
+ * @throws std::invalid_argument if the target camera is not a pinhole or the focal lengths are not positive.
+ */
+void Remapper::updateTargetIntrinsics(const std::vector<double>& focal_length, const std::vector<double>& principal_point, double skew)
+{
+    const std::shared_ptr<Pinhole> previous = std::dynamic_pointer_cast<Pinhole>(cam_target);
+    if (!previous) {
+        throw std::invalid_argument("Only the intrinsics of a pinhole target camera can be updated.");
+    }
+    if (focal_length.size() != 2 || principal_point.size() != 2 || !(focal_length[0] > 0) || !(focal_length[1] > 0)) {
+        throw std::invalid_argument("A pinhole needs two positive focal lengths and a principal point.");
+    }
+
+    // the caller may share the target camera, so the new intrinsics go into a copy
+    auto target = std::make_shared<Pinhole>(*previous);
+    target->setFocalLength(focal_length);
+    target->setPrincipalPoint(principal_point);
+    target->setSkew(skew);
+
+    if (!target_rays.empty()) {
+        // back to the previous pixel, then forward through the new intrinsics, see Pinhole::backproject
+        const std::vector<double> f0 = previous->getFocalLength();
+        const std::vector<double> c0 = previous->getPrincipalPoint();
+        const double s0 = previous->getSkew();
+        getExecutor().parallelFor(static_cast<long>(target_rays.size()), [&](long begin, long end) {
+            for (long i = begin; i < end; ++i) {
+                std::array<double, 3>& ray = target_rays[i];
+                const double u = ray[0] * f0[0] + ray[1] * s0 + c0[0];
+                const double v = ray[1] * f0[1] + c0[1];
+                ray[1] = (v - principal_point[1]) / focal_length[1];
+                ray[0] = (u - principal_point[0] - ray[1] * skew) / focal_length[0];
+            }
+        }, 4096);
+    }
+    cam_target = target;
+    rebuildUndistortMap();
+}
+
+/**
+ * @brief Replaces the rotation by one rotation per band of source rows, for rolling shutter cameras, and rebuilds the undistort map.
+ *
+ * The source rows are split into as many bands of equal height as there are rotations, a rotation
+ * per row corrects every row. Each rotation maps the source camera frame at the exposure of its
+ * band to the target frame, like the rotation of the constructor, for example interpolated from
+ * gyro orientations at the exposure times of the rows. A target pixel is projected with the
+ * rotation of the band its own source pixel falls in, found by projectRay starting from the middle
+ * band and reprojecting until the band is stable, so the map does not depend on the build order.
+ * The cached target rays are used as in updateRotation, and updateRotation returns to a single rotation.
+ *
+ * @param row_rotations Rotations of the bands from the first to the last source row.
+ * @throws std::invalid_argument if there are no rotations or more than source rows.
+ */
+void Remapper::updateRowRotations(const std::vector<Matrix3x3>& row_rotations)
+{
+    if (row_rotations.empty() || row_rotations.size() > static_cast<size_t>(source_height)) {
+        throw std::invalid_argument("There must be between one rotation and one rotation per source row.");
+    }
+    if (row_rotations.size() == 1) {
+        updateRotation(row_rotations[0]);
+        return;
+    }
+    if (mapFormat() == MapFormat::Homography) {
+        throw std::invalid_argument("Row rotations do not form a homography, use a map format with per-pixel coordinates.");
+    }
+    this->row_rotations = row_rotations;
+    rotation_matrix = row_rotations[row_rotations.size() / 2];
+    rebuildUndistortMap();
+}
+
+/**
+ * @brief Rebuilds the undistort map after the rotation or the target camera changed.
+ *
+ * If the undistort map was never built it is left to be built on first use.
+ */
+void Remapper::rebuildUndistortMap()
+{
+    std::lock_guard<std::mutex> lock(map_mutex);
+    updated = true;
+    distort_built = false;
+    distort_map = RemapMap();
+    tile_plans.clear();
+    if (!undistort_built) {
+        return;
+    }
+
+    Executor::Scope scope(getExecutor());
+    const MapFormat format = mapFormat();
+    if (format == MapFormat::ControlGrid || format == MapFormat::Area || format == MapFormat::Homography) {
+        undistort_map = buildUndistortMap();
+    }
+    else {
+        if (target_rays.empty()) {
+            target_rays.resize(static_cast<size_t>(target_width) * target_height);
+            RemapMap::forEachRowChunk(target_width, target_height, [&](int first_row, const std::vector<std::array<double, 2>>& pixels) {
+                const std::vector<std::array<double, 3>> rays = targetRays(pixels);
+                std::copy(rays.begin(), rays.end(), target_rays.begin() + static_cast<size_t>(first_row) * target_width);
+            });
         }
+        undistort_map = projectTargetRays();
     }
+    undistort_map.setInterpolation(options.interpolation);
+    undistort_map.region();
+}
 
-    std::vector<int> target_size = cam_target->getImageSize();
-    target_width = target_size[0];
-    target_height = target_size[1];
+/**
+ * @brief Builds the undistort map from the cached target rays, rotating and projecting them row by row.
+ *
+ * With row rotations every ray is projected with the rotation of the band it lands in, see projectRay.
+ *
+ * @return The undistort map.
+ */
+RemapMap Remapper::projectTargetRays() const
+{
+    const std::vector<Matrix3x3> inverses = inverseRotations();
+    Image<double> Xd(target_width, target_height);
+    Image<double> Yd(target_width, target_height);
 
-    std::vector<std::array<double, 2>> target_pixels;
-#pragma omp parallel for
-    for (int y = 0; y < target_height; ++y) {
-        for (int x = 0; x < target_width; ++x) {
-            target_pixels.push_back({ static_cast<double>(x), static_cast<double>(y) });
+    Executor::current().parallelFor(target_height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            const std::array<double, 3>* rays = target_rays.data() + static_cast<size_t>(y) * target_width;
+            for (int x = 0; x < target_width; ++x) {
+                const std::array<double, 2> p = projectRay(rays[x], inverses);
+                Xd(x, y) = p[0];
+                Yd(x, y) = p[1];
+            }
         }
+    });
+    return RemapMap(std::move(Xd), std::move(Yd), source_width, source_height, denseFormat());
+}
+
+/**
+ * @brief Backprojects target pixels to rays in the target camera frame.
+ *
+ * Composed stages are undone first, pixels leaving the image of a stage become NaN.
+ *
+ * @param target_pixels Pixel coordinates in the target image.
+ * @return The rays of the pixels, before the rotation into the source camera frame.
+ */
+std::vector<std::array<double, 3>> Remapper::targetRays(const std::vector<std::array<double, 2>>& target_pixels) const
+{
+    if (stages.empty()) {
+        return cam_target->backproject(target_pixels);
     }
 
-    std::vector<std::array<double, 2>> source_pixels;
-#pragma omp parallel for
-    for (int y = 0; y < source_height; ++y) {
-        for (int x = 0; x < source_width; ++x) {
-            source_pixels.push_back({ static_cast<double>(x), static_cast<double>(y) });
+    // walk the stages backwards, points outside an intermediate image would be black in the chain
+    std::vector<std::array<double, 2>> pixels = target_pixels;
+    for (size_t s = stages.size(); s-- > 0;) {
+        pixels = stages[s].backward(pixels);
+        int width, height;
+        stageInputSize(s, width, height);
+        for (std::array<double, 2>& p : pixels) {
+            if (!(p[0] >= 0 && p[1] >= 0 && p[0] <= width && p[1] <= height)) {
+                p = { DNAN, DNAN };
+            }
         }
     }
+    return cam_target->backproject(pixels);
+}
 
-    std::vector<std::array<double, 3>> grid_rays = cam_target->backproject(target_pixels);
-    std::vector<std::array<double, 2>> distorted_pixels = cam_source->project(CommonMath::rotatePoints(grid_rays, CommonMath::rotationInverse(rotation_matrix)));
+/**
+ * @brief Returns the band of row rotations a source row belongs to.
+ *
+ * @param source_y Row coordinate in the source image, rows outside belong to the first or last band.
+ * @return The band, -1 for NaN.
+ */
+int Remapper::rowBand(double source_y) const
+{
+    if (std::isnan(source_y)) {
+        return -1;
+    }
+    const int bands = static_cast<int>(row_rotations.size());
+    const double band = std::floor((source_y + 0.5) * bands / source_height);
+    return static_cast<int>(std::min(std::max(band, 0.0), bands - 1.0));
+}
 
-    // these sections are repeated, should turn into function
-    Xd.resize(target_height, std::vector<double>(target_width, 0));
-    Yd.resize(target_height, std::vector<double>(target_width, 0));
+/**
+ * @brief Returns the rotations from the target to the source frame, one per band of row rotations or the inverse of the single rotation.
+ *
+ * @return The inverse rotations.
+ */
+std::vector<Matrix3x3> Remapper::inverseRotations() const
+{
+    if (row_rotations.empty()) {
+        return { CommonMath::rotationInverse(rotation_matrix) };
+    }
+    std::vector<Matrix3x3> inverses;
+    inverses.reserve(row_rotations.size());
+    for (const Matrix3x3& rotation : row_rotations) {
+        inverses.push_back(CommonMath::rotationInverse(rotation));
+    }
+    return inverses;
+}
 
-#pragma omp parallel for
-    for (size_t i = 0; i < distorted_pixels.size(); ++i) {
-        size_t row = i / target_width;
-        size_t col = i % target_width;
-        Xd[row][col] = distorted_pixels[i][0];
-        Yd[row][col] = distorted_pixels[i][1];
+/**
+ * @brief Projects a target ray into the source image with the rotation of the source row it lands on.
+ *
+ * The ray is projected with the rotation of the middle band and again with the band of the
+ * resulting row, until the band stays the same or once per band for rays that alternate between
+ * bands. Every ray starts from the same band, so the pixel only depends on the ray and not on
+ * the order in which the map is built.
+ *
+ * @param ray The ray in the target camera frame.
+ * @param inverses The inverse rotations of the bands, see inverseRotations.
+ * @return The source pixel.
+ */
+std::array<double, 2> Remapper::projectRay(const std::array<double, 3>& ray, const std::vector<Matrix3x3>& inverses) const
+{
+    int band = static_cast<int>(inverses.size() / 2);
+    std::array<double, 2> pixel = cam_source->project(CommonMath::rotatePoint(ray, inverses[band]));
+    for (size_t i = 1; i < inverses.size(); ++i) {
+        const int row_band = rowBand(pixel[1]);
+        if (row_band < 0 || row_band == band) {
+            break;
+        }
+        band = row_band;
+        pixel = cam_source->project(CommonMath::rotatePoint(ray, inverses[band]));
+    }
+    return pixel;
+}
+
+/**
+ * @brief Maps target pixels to the source coordinates they sample from.
+ *
+ * @param target_pixels Pixel coordinates in the target image.
+ * @return The corresponding source pixel coordinates.
+ */
+std::vector<std::array<double, 2>> Remapper::undistortPoints(const std::vector<std::array<double, 2>>& target_pixels) const
+{
+    if (row_rotations.empty()) {
+        return cam_source->project(CommonMath::rotatePoints(targetRays(target_pixels), CommonMath::rotationInverse(rotation_matrix)));
     }
 
+    const std::vector<std::array<double, 3>> rays = targetRays(target_pixels);
+    const std::vector<Matrix3x3> inverses = inverseRotations();
+    std::vector<std::array<double, 2>> source_pixels(rays.size());
+    Executor::current().parallelFor(static_cast<long>(rays.size()), [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            source_pixels[i] = projectRay(rays[i], inverses);
+        }
+    }, 256);
+    return source_pixels;
+}
+
+/**
+ * @brief Maps source pixels to the target coordinates they sample from.
+ *
+ * Composed stages are applied last, pixels leaving the image of a stage become NaN.
+ *
+ * @param source_pixels Pixel coordinates in the source image.
+ * @return The corresponding target pixel coordinates.
+ */
+std::vector<std::array<double, 2>> Remapper::distortPoints(const std::vector<std::array<double, 2>>& source_pixels) const
+{
     std::vector<std::array<double, 3>> grid_rays_invert = cam_source->backproject(source_pixels);
-    std::vector<std::array<double, 2>> distorted_pixels_invert = cam_target->project(CommonMath::rotatePoints(grid_rays_invert, rotation_matrix));
+    std::vector<std::array<double, 2>> pixels;
+    if (row_rotations.empty()) {
+        pixels = cam_target->project(CommonMath::rotatePoints(grid_rays_invert, rotation_matrix));
+    }
+    else {
+        // the row of a source pixel selects its rotation directly
+        pixels.resize(source_pixels.size());
+        Executor::current().parallelFor(static_cast<long>(source_pixels.size()), [&](long begin, long end) {
+            for (long i = begin; i < end; ++i) {
+                const int band = rowBand(source_pixels[i][1]);
+                pixels[i] = cam_target->project(CommonMath::rotatePoint(grid_rays_invert[i], row_rotations[band < 0 ? 0 : band]));
+            }
+        }, 256);
+    }
+
+    for (size_t s = 0; s < stages.size(); ++s) {
+        int width, height;
+        stageInputSize(s, width, height);
+        for (std::array<double, 2>& p : pixels) {
+            if (!(p[0] >= 0 && p[1] >= 0 && p[0] <= width && p[1] <= height)) {
+                p = { DNAN, DNAN };
+            }
+        }
+        pixels = stages[s].forward(pixels);
+    }
+    return pixels;
+}
+
+/**
+ * @brief Computes the key identifying a map in the persistent cache.
+ *
+ * The key covers both camera fingerprints, the rotation or row rotations, the composed stages, the
+ * direction, the map options and the cache file version, so any change that alters the map selects
+ * a different cache entry.
+ *
+ * @param direction The direction of the map, Undistort or Distort.
+ * @return The 64-bit cache key.
+ */
+uint64_t Remapper::cacheKey(RemapDirection direction) const
+{
+    uint64_t fingerprints[2] = { cam_source->fingerprint(), cam_target->fingerprint() };
+    int32_t settings[7] = { static_cast<int32_t>(MapCache::VERSION), static_cast<int32_t>(direction), static_cast<int32_t>(mapFormat()),
+                            options.control_grid.spacing, static_cast<int32_t>(options.control_grid.interpolation), static_cast<int32_t>(options.interpolation),
+                            options.area.max_samples };
+
+    uint64_t hash = Utils::hashBytes(fingerprints, sizeof(fingerprints));
+    hash = Utils::hashBytes(rotation_matrix.data(), sizeof(rotation_matrix), hash);
+    if (!row_rotations.empty()) {
+        hash = Utils::hashBytes(row_rotations.data(), row_rotations.size() * sizeof(Matrix3x3), hash);
+    }
+    hash = Utils::hashBytes(settings, sizeof(settings), hash);
+    for (const RemapStage& stage : stages) {
+        hash = Utils::hashBytes(&stage.fingerprint, sizeof(stage.fingerprint), hash);
+    }
+    return Utils::hashBytes(&options.control_grid.max_error, sizeof(double), hash);
+}
+
+/**
+ * @brief Loads a map from the persistent cache or builds it and stores it in the cache.
+ *
+ * Without a cache directory, or once a per-frame update changed the rotation or the target camera,
+ * the map is always built, so per-frame maps do not fill the cache directory. Failing to write the
+ * cache is reported but does not prevent the map from being used. The pixel classification of the map (see
+ * RemapMap::region) is computed here as well, so the first frame does not pay for it.
+ *
+ * @param direction The direction of the map, Undistort or Distort.
+ * @return The map.
+ */
+RemapMap Remapper::loadOrBuild(RemapDirection direction) const
+{
+    std::string path;
+    uint64_t key = 0;
+    if (!options.cache_directory.empty() && mapFormat() != MapFormat::Homography && !updated) {
+        key = cacheKey(direction);
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.ptmap", static_cast<unsigned long long>(key));
+        path = options.cache_directory + "/" + name;
+
+        RemapMap map;
+        if (MapCache::tryLoad(path, key, map)) {
+            map.region();
+            return map;
+        }
+    }
+
+    RemapMap map = direction == RemapDirection::Undistort ? buildUndistortMap() : buildDistortMap();
+    map.setInterpolation(options.interpolation);
+    map.region();
+
+    if (!path.empty()) {
+        try {
+            MapCache::save(map, path, key);
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << "Could not write the remap map cache: " << e.what() << std::endl;
+        }
+    }
+    return map;
+}
+
+/**
+ * @brief Builds the undistort map by projecting every target pixel ray into the source camera.
+ *
+ * Dense maps are built in bands of rows, see mapCoordinates. ControlGrid maps only evaluate the camera models at the control points, Area maps sample the
+ * footprint of every target pixel and Homography maps hold the matrix of the mapping. Homography maps whose target pixels
+ * an intermediate image would clip are built as Float64 maps instead, see mapHomography.
+ *
+ * @return The undistort map.
+ */
+RemapMap Remapper::buildUndistortMap() const
+{
+    Matrix3x3 homography;
+    if (mapFormat() == MapFormat::Homography && mapHomography(RemapDirection::Undistort, homography)) {
+        return RemapMap::fromHomography(target_width, target_height, source_width, source_height, homography);
+    }
+    if (mapFormat() == MapFormat::ControlGrid) {
+        return RemapMap::fromControlGrid(target_width, target_height, source_width, source_height,
+            [this](const std::vector<std::array<double, 2>>& pixels) { return undistortPoints(pixels); }, options.control_grid);
+    }
+    if (mapFormat() == MapFormat::Area) {
+        return RemapMap::fromArea(target_width, target_height, source_width, source_height,
+            [this](const std::vector<std::array<double, 2>>& pixels) { return undistortPoints(pixels); }, options.area);
+    }
 
-    Xd_invert.resize(source_height, std::vector<double>(source_width, 0));
-    Yd_invert.resize(source_height, std::vector<double>(source_width, 0));
+    Image<double> Xd, Yd;
+    mapCoordinates(target_width, target_height, [this](const std::vector<std::array<double, 2>>& pixels) { return undistortPoints(pixels); }, Xd, Yd);
+    return RemapMap(std::move(Xd), std::move(Yd), source_width, source_height, denseFormat());
+}
 
-#pragma omp parallel for
-    for (size_t i = 0; i < distorted_pixels_invert.size(); ++i) {
-        size_t row = i / source_width;
-        size_t col = i % source_width;
-        Xd_invert[row][col] = distorted_pixels_invert[i][0];
-        Yd_invert[row][col] = distorted_pixels_invert[i][1];
+/**
+ * @brief Builds the distort map by backprojecting every source pixel and projecting it into the target camera.
+ *
+ * Dense maps are built in bands of rows, see mapCoordinates. ControlGrid maps only evaluate the camera models at the control points, Area maps sample the
+ * footprint of every source pixel and Homography maps hold the inverse matrix of the mapping. Homography maps whose source pixels
+ * an intermediate image would clip are built as Float64 maps instead, see mapHomography.
+ *
+ * @return The distort map.
+ */
+RemapMap Remapper::buildDistortMap() const
+{
+    Matrix3x3 homography;
+    if (mapFormat() == MapFormat::Homography && mapHomography(RemapDirection::Distort, homography)) {
+        return RemapMap::fromHomography(source_width, source_height, target_width, target_height, homography);
+    }
+    if (mapFormat() == MapFormat::ControlGrid) {
+        return RemapMap::fromControlGrid(source_width, source_height, target_width, target_height,
+            [this](const std::vector<std::array<double, 2>>& pixels) { return distortPoints(pixels); }, options.control_grid);
     }
+    if (mapFormat() == MapFormat::Area) {
+        return RemapMap::fromArea(source_width, source_height, target_width, target_height,
+            [this](const std::vector<std::array<double, 2>>& pixels) { return distortPoints(pixels); }, options.area);
+    }
+
+    Image<double> Xd_invert, Yd_invert;
+    mapCoordinates(source_width, source_height, [this](const std::vector<std::array<double, 2>>& pixels) { return distortPoints(pixels); }, Xd_invert, Yd_invert);
+    return RemapMap(std::move(Xd_invert), std::move(Yd_invert), target_width, target_height, denseFormat());
 }
 
+/**
+ * @brief Returns the storage format of the maps, the Index format for Nearest and the Area format for Area interpolation.
+ *
+ * @return The map format.
+ */
+MapFormat Remapper::mapFormat() const
+{
+    if (options.interpolation == RemapInterpolation::Nearest) {
+        return MapFormat::Index;
+    }
+    return options.interpolation == RemapInterpolation::Area ? MapFormat::Area : options.map_format;
+}
 
+/**
+ * @brief Returns the storage format of maps with per-pixel coordinates, Float64 in place of Homography.
+ *
+ * @return The map format.
+ */
+MapFormat Remapper::denseFormat() const
+{
+    const MapFormat format = mapFormat();
+    return format == MapFormat::Homography ? MapFormat::Float64 : format;
+}
+
+/**
+ * @brief Returns whether the mapping from target to source pixels is a single homography, which Homography maps hold without per-pixel storage.
+ *
+ * This is the case for pinhole source and target cameras with a single rotation, followed only by
+ * pixel transforms or composed pinhole to pinhole remappers.
+ *
+ * @return True if the mapping is a homography.
+ */
+bool Remapper::isHomography() const
+{
+    Matrix3x3 homography;
+    return undistortHomography(homography);
+}
+
+/**
+ * @brief Computes the homography mapping target pixels to source pixels, through the cameras and all stages.
+ *
+ * @param homography Receives the homography.
+ * @return False if the mapping is no homography, see isHomography.
+ */
+bool Remapper::undistortHomography(Matrix3x3& homography) const
+{
+    if (!row_rotations.empty() || !pinholeHomography(cam_source, cam_target, rotation_matrix, homography)) {
+        return false;
+    }
+    for (const RemapStage& stage : stages) {
+        if (!stage.projective) {
+            return false;
+        }
+        homography = CommonMath::matrixMultiply(homography, stage.homography);
+    }
+    return true;
+}
+
+/**
+ * @brief Computes the homography held by the Homography map of a direction.
+ *
+ * Dense maps mark pixels that leave the image of an intermediate stage as outside, a single
+ * homography cannot. It is therefore only used when the output pixels of the map, walked through
+ * the stages as in targetRays or distortPoints, stay inside every intermediate image, for
+ * instance for crops inside the image. Otherwise the map is built with per-pixel coordinates,
+ * so both formats always remap the same pixels.
+ *
+ * @param direction Undistort or Distort.
+ * @param homography Receives the matrix mapping output pixels of the map to its source pixels.
+ * @return False if the mapping is no homography or an intermediate image clips the output pixels.
+ */
+bool Remapper::mapHomography(RemapDirection direction, Matrix3x3& homography) const
+{
+    Matrix3x3 undistort;
+    if (!undistortHomography(undistort)) {
+        return false;
+    }
+
+    int width, height;
+    if (direction == RemapDirection::Undistort) {
+        Matrix3x3 partial = { { { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 } } };
+        for (size_t s = stages.size(); s-- > 0;) {
+            partial = CommonMath::matrixMultiply(stages[s].homography, partial);
+            stageInputSize(s, width, height);
+            if (!rectangleInside(partial, target_width, target_height, width, height)) {
+                return false;
+            }
+        }
+        homography = undistort;
+        return true;
+    }
+
+    Matrix3x3 pinhole;
+    pinholeHomography(cam_source, cam_target, rotation_matrix, pinhole);
+    Matrix3x3 partial = CommonMath::matrixInverse(pinhole);
+    for (size_t s = 0; s < stages.size(); ++s) {
+        stageInputSize(s, width, height);
+        if (!rectangleInside(partial, source_width, source_height, width, height)) {
+            return false;
+        }
+        partial = CommonMath::matrixMultiply(CommonMath::matrixInverse(stages[s].homography), partial);
+    }
+    homography = CommonMath::matrixInverse(undistort);
+    return true;
+}
@@ -0,0 +1,246 @@
+#include "remapper/stereo_remapper.h"
+#include <stdexcept>
+
+namespace {
+
+// Pinhole of a camera with its extrinsics, Pinhole::getPinhole keeps only the intrinsics
+std::shared_ptr<Pinhole> rectificationPinhole(const std::shared_ptr<Camera>& cam) {
+    const std::shared_ptr<Pinhole> pinhole = cam->getPinhole();
+    return std::make_shared<Pinhole>(pinhole->getFocalLength(), pinhole->getPrincipalPoint(), pinhole->getSkew(), pinhole->getImageSize(),
+        cam->getRotation(), cam->getTranslation());
+}
+
+} // namespace
+
+/**
+ * @brief Computes the rectification of a stereo pair and builds the undistort maps of both cameras.
+ *
+ * The rectified pinhole averages the focal lengths of the pinholes of both cameras and centers
+ * the principal point, see CommonMath::stereoRectify. An output scale in the options scales it
+ * along with the rectified images. The undistort maps are always built here, the options only
+ * add the distort maps.
+ *
+ * @param cam_left The left camera.
+ * @param cam_right The right camera, its extrinsics relative to those of the left camera define the baseline.
+ * @param options Construction options of both remappers.
+ * @throws std::invalid_argument if the pinholes of the cameras differ in image size or the camera centers coincide.
+ */
+StereoRemapper::StereoRemapper(const std::shared_ptr<Camera>& cam_left, const std::shared_ptr<Camera>& cam_right, const RemapperOptions& options)
+    : options(options) {
+    std::shared_ptr<Pinhole> pinholeL = rectificationPinhole(cam_left);
+    std::shared_ptr<Pinhole> pinholeR = rectificationPinhole(cam_right);
+    const std::vector<int> size = pinholeL->getImageSize();
+    if (size != pinholeR->getImageSize()) {
+        throw std::invalid_argument("The cameras of a stereo pair must have the same image size.");
+    }
+
+    // center of the right camera in the frame of the left camera
+    const Point3 center = CommonMath::rotatePoint(cam_right->getInvTranslation(), cam_left->getRotationMatrix()) + cam_left->getTranslation();
+    baseline_length = CommonMath::norm(center);
+    if (!(baseline_length > 0)) {
+        throw std::invalid_argument("The cameras of a stereo pair need distinct centers.");
+    }
+
+    CommonMath::stereoRectify(pinholeL, pinholeR, left_rotation, right_rotation);
+
+    if (this->options.prebuild == RemapDirection::None) {
+        this->options.prebuild = RemapDirection::Undistort;
+    }
+    else if (this->options.prebuild == RemapDirection::Distort) {
+        this->options.prebuild = RemapDirection::Both;
+    }
+    left_remapper.reset(new Remapper(cam_left, pinholeL, left_rotation, this->options));
+    right_remapper.reset(new Remapper(cam_right, pinholeR, right_rotation, this->options));
+
+    // the output scale resizes with aligned outer pixel edges, see PixelTransform::resize
+    const double sx = static_cast<double>(width()) / size[0];
+    const double sy = static_cast<double>(height()) / size[1];
+    const std::vector<double> focal = pinholeL->getFocalLength();
+    const std::vector<double> principal = pinholeL->getPrincipalPoint();
+    rectified_camera = std::make_shared<Pinhole>(std::vector<double>{ focal[0] * sx, focal[1] * sy },
+        std::vector<double>{ (principal[0] + 0.5) * sx - 0.5, (principal[1] + 0.5) * sy - 0.5 }, pinholeL->getSkew() * sx,
+        std::vector<int>{ width(), height() });
+}
+
+/**
+ * @brief Converts a disparity of the rectified pair to a depth.
+ *
+ * @param disparity Horizontal offset x_left - x_right in rectified pixels.
+ * @return The depth along the rectified optical axis, NaN if the disparity is not positive.
+ */
+double StereoRemapper::depth(double disparity) const {
+    if (!(disparity > 0)) {
+        return DNAN;
+    }
+    return rectified_camera->getFocalLength()[0] * baseline_length / disparity;
+}
+
+/**
+ * @brief Reconstructs the point seen at a pixel of the rectified left image with a disparity.
+ *
+ * @param x Column in the rectified left image.
+ * @param y Row in the rectified left image.
+ * @param disparity Horizontal offset x_left - x_right in rectified pixels.
+ * @return The point in the rectified left camera frame, NaN if the disparity is not positive.
+ */
+Point3 StereoRemapper::triangulate(double x, double y, double disparity) const {
+    const double z = depth(disparity);
+    const Point3 ray = rectified_camera->backproject(Point2{ x, y });
+    return { ray[0] / ray[2] * z, ray[1] / ray[2] * z, z };
+}
+
+/**
+ * @brief Returns the number of bytes held by the maps of both cameras.
+ *
+ * @return The memory usage in bytes.
+ */
+size_t StereoRemapper::memoryUsage() const {
+    return left_remapper->memoryUsage() + right_remapper->memoryUsage();
+}
+
+/**
+ * @brief Returns the tiles of both maps for the source pixel sizes of a pair, planning them on first use.
+ *
+ * @param left_pixel_bytes Bytes per pixel of the left frame over all channels.
+ * @param right_pixel_bytes Bytes per pixel of the right frame over all channels.
+ * @return The tiles as (camera, tile), the left tiles first, valid for the lifetime of the StereoRemapper.
+ */
+const std::vector<std::pair<int, RemapTile>>& StereoRemapper::getTilePlan(size_t left_pixel_bytes, size_t right_pixel_bytes) const {
+    std::lock_guard<std::mutex> lock(plan_mutex);
+    std::vector<std::pair<int, RemapTile>>& plan = tile_plans[std::make_pair(left_pixel_bytes, right_pixel_bytes)];
+    if (plan.empty()) {
+        Executor::Scope scope(options.executor ? *options.executor : Executor::current());
+        for (const RemapTile& tile : left_remapper->getUndistortMap().planTiles(left_pixel_bytes, options.tile_cache_bytes)) {
+            plan.push_back({ 0, tile });
+        }
+        for (const RemapTile& tile : right_remapper->getUndistortMap().planTiles(right_pixel_bytes, options.tile_cache_bytes)) {
+            plan.push_back({ 1, tile });
+        }
+    }
+    return plan;
+}
+
+/**
+ * @brief Validates the shapes and remaps the tiles of both frames in one parallel loop.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @param left_output The rectified left frame.
+ * @param right_output The rectified right frame.
+ * @throws std::invalid_argument if a frame is empty, does not match its camera or its output does not match the rectified size.
+ */
+template <typename T>
+void StereoRemapper::run(const ImageView<const T>& left, const ImageView<const T>& right, const ImageView<T>& left_output, const ImageView<T>& right_output) const {
+    if (left.empty() || right.empty()) {
+        throw std::invalid_argument("Both frames of a stereo pair are needed.");
+    }
+    const RemapMap* maps[2] = { &left_remapper->getUndistortMap(), &right_remapper->getUndistortMap() };
+    const ImageView<const T>* images[2] = { &left, &right };
+    const ImageView<T>* outputs[2] = { &left_output, &right_output };
+    const RemapRegion* regions[2];
+    for (int c = 0; c < 2; ++c) {
+        maps[c]->checkShapes(images[c]->width(), images[c]->height(), images[c]->channels(), outputs[c]->width(), outputs[c]->height(), outputs[c]->channels());
+        regions[c] = images[c]->width() == maps[c]->sourceWidth() && images[c]->height() == maps[c]->sourceHeight() ? &maps[c]->region() : nullptr;
+    }
+    const RemapKernels& kernels = RemapKernels::fitsGatherOffsets(right) ? RemapKernels::get(options.backend, left) : RemapKernels::get(options.backend, right);
+    const std::vector<std::pair<int, RemapTile>>& plan = getTilePlan(left.channels() * sizeof(T), right.channels() * sizeof(T));
+
+    const Executor& executor = options.executor ? *options.executor : Executor::current();
+    executor.parallelFor(static_cast<long>(plan.size()), [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            const int c = plan[i].first;
+            const RemapMap& map = *maps[c];
+            map.remapTile(*images[c], *outputs[c], kernels, regions[c], plan[i].second, map.threadBuffers(map.width()));
+        }
+    });
+}
+
+/**
+ * @brief Allocates the rectified frames with the layouts of the inputs and remaps into them.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @return The rectified pair.
+ */
+template <typename T>
+std::pair<Image<T>, Image<T>> StereoRemapper::allocate(const ImageView<const T>& left, const ImageView<const T>& right) const {
+    std::pair<Image<T>, Image<T>> pair(Image<T>(width(), height(), left.channels(), left.layout()),
+                                       Image<T>(width(), height(), right.channels(), right.layout()));
+    run(left, right, pair.first.view(), pair.second.view());
+    return pair;
+}
+
+/**
+ * @brief Rectifies a double precision stereo pair.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @return The rectified left and right frames.
+ * @throws std::invalid_argument if a frame is empty or does not match its camera.
+ */
+std::pair<Image<double>, Image<double>> StereoRemapper::rectify(const ImageView<const double>& left, const ImageView<const double>& right) const {
+    return allocate(left, right);
+}
+
+/**
+ * @brief Rectifies an 8-bit stereo pair.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @return The rectified left and right frames.
+ * @throws std::invalid_argument if a frame is empty or does not match its camera.
+ */
+std::pair<Image<uint8_t>, Image<uint8_t>> StereoRemapper::rectify(const ImageView<const uint8_t>& left, const ImageView<const uint8_t>& right) const {
+    return allocate(left, right);
+}
+
+/**
+ * @brief Rectifies a 16-bit stereo pair.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @return The rectified left and right frames.
+ * @throws std::invalid_argument if a frame is empty or does not match its camera.
+ */
+std::pair<Image<uint16_t>, Image<uint16_t>> StereoRemapper::rectify(const ImageView<const uint16_t>& left, const ImageView<const uint16_t>& right) const {
+    return allocate(left, right);
+}
+
+/**
+ * @brief Rectifies a double precision stereo pair into caller-owned outputs.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @param left_output The rectified left frame, of the rectified size with the channel count of left.
+ * @param right_output The rectified right frame, of the rectified size with the channel count of right.
+ * @throws std::invalid_argument if a frame is empty or a frame or output does not match.
+ */
+void StereoRemapper::rectifyInto(const ImageView<const double>& left, const ImageView<const double>& right, const ImageView<double>& left_output, const ImageView<double>& right_output) const {
+    run(left, right, left_output, right_output);
+}
+
+/**
+ * @brief Rectifies an 8-bit stereo pair into caller-owned outputs.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @param left_output The rectified left frame, of the rectified size with the channel count of left.
+ * @param right_output The rectified right frame, of the rectified size with the channel count of right.
+ * @throws std::invalid_argument if a frame is empty or a frame or output does not match.
+ */
+void StereoRemapper::rectifyInto(const ImageView<const uint8_t>& left, const ImageView<const uint8_t>& right, const ImageView<uint8_t>& left_output, const ImageView<uint8_t>& right_output) const {
+    run(left, right, left_output, right_output);
+}
+
+/**
+ * @brief Rectifies a 16-bit stereo pair into caller-owned outputs.
+ *
+ * @param left The left frame.
+ * @param right The right frame.
+ * @param left_output The rectified left frame, of the rectified size with the channel count of left.
+ * @param right_output The rectified right frame, of the rectified size with the channel count of right.
+ * @throws std::invalid_argument if a frame is empty or a frame or output does not match.
+ */
+void StereoRemapper::rectifyInto(const ImageView<const uint16_t>& left, const ImageView<const uint16_t>& right, const ImageView<uint16_t>& left_output, const ImageView<uint16_t>& right_output) const {
+    run(left, right, left_output, right_output);
+}
@@ -2,12 +2,51 @@
 #include "camera/camera.h"
 #include "camera/pinhole.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+namespace {
+
+// Clamped corner pixels and fractions of one bilinear sample, shared by every channel of a pixel
+struct BilinearTaps {
+    int x1, x2, y1, y2;
+    double x_frac, y_frac;
+};
+
+/**
+ * @brief Computes the taps of a bilinear sample with the border handling of CommonMath::bilinearInterpolate.
+ *
+ * @return False if the coordinate lies outside the image, in which case every channel is 0.
+ */
+inline bool bilinearTaps(double x, double y, int width, int height, BilinearTaps& taps) {
+    if (width == 0 || height == 0 || x < 0 || y < 0 || x > width || y > height) {
+        return false;
+    }
+    int x1 = static_cast<int>(std::floor(x));
+    int y1 = static_cast<int>(std::floor(y));
+    taps.x_frac = x - x1;
+    taps.y_frac = y - y1;
+    taps.x1 = CommonMath::clamp(x1, 0, width - 1);
+    taps.x2 = CommonMath::clamp(x1 + 1, 0, width - 1);
+    taps.y1 = CommonMath::clamp(y1, 0, height - 1);
+    taps.y2 = CommonMath::clamp(y1 + 1, 0, height - 1);
+    return true;
+}
+
+inline double bilinearBlend(const BilinearTaps& taps, double Q11, double Q12, double Q21, double Q22) {
+    double R1 = (1 - taps.x_frac) * Q11 + taps.x_frac * Q21;
+    double R2 = (1 - taps.x_frac) * Q12 + taps.x_frac * Q22;
+    return (1 - taps.y_frac) * R1 + taps.y_frac * R2;
+}
+
+} // namespace
+
 /**
  * @brief Evaluates a polynomial at a given value x.
  *
@@ -73,12 +112,14 @@ double CommonMath::evaluateFourier(const std::vector<double>& fourier_coeff, dou
  * @param img The source image.
  * @param Xd The x-coordinates for interpolation.
  * @param Yd The y-coordinates for interpolation.
+ * @param executor Runs the rows in parallel.
  * @return The interpolated image.
  */
 std::vector<std::vector<std::vector<double>>> CommonMath::interp2(
     const std::vector<std::vector<std::vector<double>>>& img,
     const std::vector<std::vector<double>>& Xd,
-    const std::vector<std::vector<double>>& Yd
+    const std::vector<std::vector<double>>& Yd,
+    const Executor& executor
 ) {
 
     if (img.size() == 0 || Xd.size() == 0 || Yd.size() == 0)
@@ -95,12 +136,24 @@ std::vector<std::vector<std::vector<double>>> CommonMath::interp2(
         numChannels,
         std::vector<std::vector<double>>(height, std::vector<double>(width, 0))
     );
-
-    // Loop over each channel
-    for (int c = 0; c < numChannels; ++c) {
-
-        outputImg[c] = interp2(img[c], Xd, Yd);
-    }
+    int imgHeight = img[0].size();
+    int imgWidth = imgHeight > 0 ? static_cast<int>(img[0][0].size()) : 0;
+
+    // The taps are computed once per pixel and applied to every channel
+    executor.parallelFor(height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                BilinearTaps taps;
+                if (!bilinearTaps(Xd[y][x], Yd[y][x], imgWidth, imgHeight, taps)) {
+                    continue;
+                }
+                for (int c = 0; c < numChannels; ++c) {
+                    const std::vector<std::vector<double>>& channel = img[c];
+                    outputImg[c][y][x] = bilinearBlend(taps, channel[taps.y1][taps.x1], channel[taps.y2][taps.x1], channel[taps.y1][taps.x2], channel[taps.y2][taps.x2]);
+                }
+            }
+        }
+    });
 
     return outputImg;
 }
@@ -111,12 +164,14 @@ std::vector<std::vector<std::vector<double>>> CommonMath::interp2(
  * @param img The source image.
  * @param Xd The x-coordinates for interpolation.
  * @param Yd The y-coordinates for interpolation.
+ * @param executor Runs the rows in parallel.
  * @return The interpolated image.
  */
 std::vector<std::vector<double>>  CommonMath::interp2(
     const std::vector<std::vector<double>>& img,
     const std::vector<std::vector<double>>& Xd,
-    const std::vector<std::vector<double>>& Yd
+    const std::vector<std::vector<double>>& Yd,
+    const Executor& executor
 ) {
 
     if (img.size() == 0 || Xd.size() == 0 || Yd.size() == 0 )
@@ -130,13 +185,14 @@ std::vector<std::vector<double>>  CommonMath::interp2(
     std::vector<std::vector<double>> outputImg(height, std::vector<double>(width, 0));
 
     // Loop over each point in the destination grid
-    #pragma omp parallel for
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            // Interpolate pixel value from img at (Xd[y][x], Yd[y][x])
-            outputImg[y][x] = bilinearInterpolate(img, Xd[y][x], Yd[y][x]);
+    executor.parallelFor(height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            for (int x = 0; x < width; ++x) {
+                // Interpolate pixel value from img at (Xd[y][x], Yd[y][x])
+                outputImg[y][x] = bilinearInterpolate(img, Xd[y][x], Yd[y][x]);
+            }
         }
-    }
+    });
 
     return outputImg;
 }
@@ -194,6 +250,256 @@ double CommonMath::bilinearInterpolate(const std::vector<std::vector<double>>& i
     return q;
 }
 
+/**
+ * @brief Performs bilinear interpolation on an image at given coordinates into a caller-owned output.
+ *
+ * Every channel of img is sampled at (Xd, Yd). The output must have the shape of the maps and the
+ * channel count of img, it may use any layout or stride.
+ *
+ * @param img The source image.
+ * @param Xd The x-coordinates for interpolation.
+ * @param Yd The y-coordinates for interpolation.
+ * @param output The interpolated image.
+ * @param executor Runs the rows in parallel.
+ * @throws std::invalid_argument if the maps or the output have mismatching shapes.
+ */
+void CommonMath::interp2(const ImageView<const double>& img, const ImageView<const double>& Xd, const ImageView<const double>& Yd, const ImageView<double>& output, const Executor& executor) {
+
+    if (img.empty() || Xd.empty() || Yd.empty())
+    {
+        return;
+    }
+
+    if (!Xd.sameShape(Yd) || !output.sameShape(Xd.width(), Xd.height(), img.channels())) {
+        throw std::invalid_argument("Interpolation maps and output image must have matching dimensions.");
+    }
+
+    int height = Xd.height();
+    int width = Xd.width();
+    int channels = img.channels();
+
+    // The taps are computed once per pixel and applied to every channel
+    executor.parallelFor(height, [&](long begin, long end) {
+        for (int y = static_cast<int>(begin); y < end; ++y) {
+            const double* xRow = Xd.row(y);
+            const double* yRow = Yd.row(y);
+            for (int x = 0; x < width; ++x) {
+                BilinearTaps taps;
+                if (!bilinearTaps(xRow[x * Xd.pixelStride()], yRow[x * Yd.pixelStride()], img.width(), img.height(), taps)) {
+                    for (int c = 0; c < channels; ++c) {
+                        output(x, y, c) = 0.0;
+                    }
+                    continue;
+                }
+                const double* p11 = &img(taps.x1, taps.y1);
+                const double* p12 = &img(taps.x1, taps.y2);
+                const double* p21 = &img(taps.x2, taps.y1);
+                const double* p22 = &img(taps.x2, taps.y2);
+                for (int c = 0; c < channels; ++c) {
+                    const std::ptrdiff_t k = c * img.channelStride();
+                    output(x, y, c) = bilinearBlend(taps, p11[k], p12[k], p21[k], p22[k]);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Performs bilinear interpolation on an image at given coordinates.
+ *
+ * @param img The source image.
+ * @param Xd The x-coordinates for interpolation.
+ * @param Yd The y-coordinates for interpolation.
+ * @param executor Runs the rows in parallel.
+ * @return The interpolated image with the layout of img and the size of the maps.
+ */
+Image<double> CommonMath::interp2(const ImageView<const double>& img, const ImageView<const double>& Xd, const ImageView<const double>& Yd, const Executor& executor) {
+
+    if (img.empty() || Xd.empty() || Yd.empty())
+    {
+        return {};
+    }
+
+    Image<double> outputImg(Xd.width(), Xd.height(), img.channels(), img.layout());
+    interp2(img, Xd, Yd, outputImg, executor);
+
+    return outputImg;
+}
+
+/**
+ * @brief Performs bilinear interpolation on a single point in a single channel image view.
+ *
+ * @param img The source image, only channel 0 is sampled.
+ * @param x The x-coordinate for interpolation.
+ * @param y The y-coordinate for interpolation.
+ * @return The interpolated value.
+ */
+double CommonMath::bilinearInterpolate(const ImageView<const double>& img, double x, double y) {
+    int height = img.height();
+    int width = img.width();
+    if (height == 0 || width == 0)
+    {
+        return {};
+    }
+
+    if (x < 0 || y < 0 || x > width || y > height) {
+        return 0;
+    }
+    int x1 = static_cast<int>(std::floor(x));
+    int y1 = static_cast<int>(std::floor(y));
+    int x2 = x1 + 1;
+    int y2 = y1 + 1;
+
+    // Get fractional value of intermediate pixels
+    double x_frac = x - x1;
+    double y_frac = y - y1;
+
+    // Clamp indices and get 4 corner pixel values
+    x1 = CommonMath::clamp(x1, 0, width - 1);
+    x2 = CommonMath::clamp(x2, 0, width - 1);
+    y1 = CommonMath::clamp(y1, 0, height - 1);
+    y2 = CommonMath::clamp(y2, 0, height - 1);
+    double Q11 = img(x1, y1);
+    double Q12 = img(x1, y2);
+    double Q21 = img(x2, y1);
+    double Q22 = img(x2, y2);
+
+    // Perform bilinear interpolation
+    double R1 = (1 - x_frac) * Q11 + x_frac * Q21;
+    double R2 = (1 - x_frac) * Q12 + x_frac * Q22;
+    double q = (1 - y_frac) * R1 + y_frac * R2;
+
+    return q;
+}
+
+/**
+ * @brief Performs Catmull-Rom bicubic interpolation on a single point in a single channel image view.
+ *
+ * The point must lie within [0, width] x [0, height] like for bilinearInterpolate, the 4x4 taps
+ * around it are clamped to the image, replicating the border pixels.
+ *
+ * @param img The source image, only channel 0 is sampled.
+ * @param x The x-coordinate for interpolation.
+ * @param y The y-coordinate for interpolation.
+ * @return The interpolated value, 0 outside the image.
+ */
+double CommonMath::bicubicInterpolate(const ImageView<const double>& img, double x, double y) {
+    int height = img.height();
+    int width = img.width();
+    if (height == 0 || width == 0 || x < 0 || y < 0 || x > width || y > height) {
+        return 0;
+    }
+
+    int x1 = static_cast<int>(std::floor(x));
+    int y1 = static_cast<int>(std::floor(y));
+    double wx[4], wy[4];
+    catmullRomWeights(x - x1, wx);
+    catmullRomWeights(y - y1, wy);
+
+    double q = 0.0;
+    for (int j = 0; j < 4; ++j) {
+        int yj = CommonMath::clamp(y1 - 1 + j, 0, height - 1);
+        double r = 0.0;
+        for (int i = 0; i < 4; ++i) {
+            r += wx[i] * img(CommonMath::clamp(x1 - 1 + i, 0, width - 1), yj);
+        }
+        q += wy[j] * r;
+    }
+    return q;
+}
+
+/**
+ * @brief Computes the Catmull-Rom weights of the four taps at offsets -1, 0, 1 and 2 around a position.
+ *
+ * @param t The position between the taps at offsets 0 and 1, in [0, 1).
+ * @param weights The four tap weights, summing to one.
+ */
+void CommonMath::catmullRomWeights(double t, double weights[4]) {
+    double t2 = t * t;
+    double t3 = t2 * t;
+    weights[0] = 0.5 * (-t3 + 2.0 * t2 - t);
+    weights[1] = 0.5 * (3.0 * t3 - 5.0 * t2 + 2.0);
+    weights[2] = 0.5 * (-3.0 * t3 + 4.0 * t2 + t);
+    weights[3] = 0.5 * (t3 - t2);
+}
+
+/**
+ * @brief Converts a float to the bit pattern of the nearest IEEE 754 half precision value.
+ *
+ * Rounds to nearest even, values beyond the largest half (65504) become infinity and NaN stays NaN.
+ *
+ * @param value The value to convert.
+ * @return The half precision bit pattern.
+ */
+uint16_t CommonMath::floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t magnitude = bits & 0x7fffffffu;
+
+    if (magnitude >= 0x7f800000u) {
+        // infinity, NaN keeps a quiet mantissa bit
+        return static_cast<uint16_t>(sign | 0x7c00u | (magnitude > 0x7f800000u ? 0x0200u : 0u));
+    }
+    if (magnitude >= 0x477ff000u) {
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+    if (magnitude < 0x38800000u) {
+        // subnormal half, multiples of 2^-24
+        if (magnitude < 0x33000000u) {
+            return static_cast<uint16_t>(sign);
+        }
+        const uint32_t shift = 126 - (magnitude >> 23);
+        const uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t tie = 1u << (shift - 1);
+        half += rest > tie || (rest == tie && (half & 1u)) ? 1u : 0u;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // rebias the exponent from 127 to 15, a carry of the rounding moves into the exponent
+    uint32_t half = (magnitude - 0x38000000u) >> 13;
+    const uint32_t rest = magnitude & 0x1fffu;
+    half += rest > 0x1000u || (rest == 0x1000u && (half & 1u)) ? 1u : 0u;
+    return static_cast<uint16_t>(sign | half);
+}
+
+/**
+ * @brief Converts the bit pattern of an IEEE 754 half precision value to a float, exactly.
+ *
+ * @param half The half precision bit pattern.
+ * @return The value.
+ */
+float CommonMath::halfToFloat(uint16_t half) {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1fu;
+    uint32_t mantissa = half & 0x3ffu;
+
+    uint32_t bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0) {
+        bits = sign;
+    }
+    else {
+        // subnormal half, normalized for the float exponent
+        exponent = 113;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
 /**
  * @brief Rotates a point using a given rotation matrix.
  *
@@ -216,19 +522,21 @@ Point3 CommonMath::rotatePoint(const Point3& point, const Matrix3x3& rotation_ma
  *
  * @param points The list of points to rotate.
  * @param rotation_matrix The rotation matrix.
+ * @param executor Runs the points in parallel.
  * @return The list of rotated points.
  */
-std::vector<Point3> CommonMath::rotatePoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix) {
+std::vector<Point3> CommonMath::rotatePoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix, const Executor& executor) {
     std::vector<Point3> rotatedPoints;
 
     int N = points.size();
     rotatedPoints.reserve(N);
     rotatedPoints.resize(N);
 
-    #pragma omp parallel for
-    for (size_t i = 0; i < N; ++i) {
-        rotatedPoints[i] = rotatePoint(points[i], rotation_matrix);
-    }
+    executor.parallelFor(N, [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            rotatedPoints[i] = rotatePoint(points[i], rotation_matrix);
+        }
+    }, 1024);
 
     return rotatedPoints;
 }
@@ -261,19 +569,21 @@ Point3 CommonMath::transformPoint(const Point3& point, const Matrix3x3& rotation
  * @param points The list of points to transform.
  * @param rotation_matrix The rotation matrix.
  * @param translation The translation vector.
+ * @param executor Runs the points in parallel.
  * @return The list of transformed points.
  */
-std::vector<Point3> CommonMath::transformPoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix, const Point3& translation) {
+std::vector<Point3> CommonMath::transformPoints(const std::vector<Point3>& points, const Matrix3x3& rotation_matrix, const Point3& translation, const Executor& executor) {
     std::vector<Point3> transformedPoints;
 
     int N = points.size();
     transformedPoints.reserve(N);
     transformedPoints.resize(N);
 
-    #pragma omp parallel for
-    for (size_t i = 0; i < N; ++i) {
-        transformedPoints[i] = transformPoint(points[i], rotation_matrix, translation);
-    }
+    executor.parallelFor(N, [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            transformedPoints[i] = transformPoint(points[i], rotation_matrix, translation);
+        }
+    }, 1024);
 
     return transformedPoints;
 }
@@ -289,6 +599,34 @@ Matrix3x3 CommonMath::rotationInverse(const Matrix3x3& rotation_matrix)
     return CommonMath::transposeMatrix(rotation_matrix);
 }
 
+/**
+ * @brief Computes the inverse of a general 3x3 matrix from its adjugate.
+ *
+ * @param matrix The matrix.
+ * @return The inverse matrix.
+ * @throws std::invalid_argument if the matrix is singular.
+ */
+Matrix3x3 CommonMath::matrixInverse(const Matrix3x3& matrix)
+{
+    const Matrix3x3& m = matrix;
+    Matrix3x3 adjugate = { {
+        { m[1][1] * m[2][2] - m[1][2] * m[2][1], m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][1] * m[1][2] - m[0][2] * m[1][1] },
+        { m[1][2] * m[2][0] - m[1][0] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][2] * m[1][0] - m[0][0] * m[1][2] },
+        { m[1][0] * m[2][1] - m[1][1] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1], m[0][0] * m[1][1] - m[0][1] * m[1][0] }
+    } };
+    const double determinant = m[0][0] * adjugate[0][0] + m[0][1] * adjugate[1][0] + m[0][2] * adjugate[2][0];
+    if (determinant == 0.0 || !std::isfinite(determinant)) {
+        throw std::invalid_argument("Matrix is singular.");
+    }
+
+    for (auto& row : adjugate) {
+        for (double& value : row) {
+            value /= determinant;
+        }
+    }
+    return adjugate;
+}
+
 /**
  * @brief Converts Euler angles to a rotation matrix.
  *
@@ -351,16 +689,17 @@ std::vector<std::vector<double>> CommonMath::transposeMatrix(const std::vector<s
  * @param cameraR The right camera.
  * @param raysL The rays from the left camera.
  * @param raysR The rays from the right camera.
+ * @param executor Runs the intersections in parallel.
  * @return The 3D intersection points.
  */
-std::vector<Point3> CommonMath::intersectRays(std::shared_ptr<Camera> cameraL, std::shared_ptr<Camera> cameraR, const std::vector<Point3>& raysL, const std::vector<Point3>& raysR)
+std::vector<Point3> CommonMath::intersectRays(std::shared_ptr<Camera> cameraL, std::shared_ptr<Camera> cameraR, const std::vector<Point3>& raysL, const std::vector<Point3>& raysR, const Executor& executor)
 {
     auto centerL = cameraL->getInvTranslation();
     auto centerR = cameraR->getInvTranslation();
 
     // transform rays to object frame
-    auto raysLObject = CommonMath::rotatePoints(raysL, cameraL->getInvRotationMatrix());
-    auto raysRObject = CommonMath::rotatePoints(raysR, cameraR->getInvRotationMatrix());
+    auto raysLObject = CommonMath::rotatePoints(raysL, cameraL->getInvRotationMatrix(), executor);
+    auto raysRObject = CommonMath::rotatePoints(raysR, cameraR->getInvRotationMatrix(), executor);
 
     Point3 p1 = centerL;
     Point3 p3 = centerR;
@@ -369,23 +708,24 @@ std::vector<Point3> CommonMath::intersectRays(std::shared_ptr<Camera> cameraL, s
     points3D.reserve(raysL.size());
     points3D.resize(raysL.size());
 
-    #pragma omp parallel for
-    for (int i = 0; i < raysL.size(); i++)
-    {
-        Point3 p2{}, p4{}, pa{}, pb{};
-        double mua, mub;
-        p2 = centerL + raysLObject[i];
-        p4 = centerR + raysRObject[i];
-        if (CommonMath::lineLineIntersect(p1, p2, p3, p4, pa, pb, mua, mub))
+    executor.parallelFor(static_cast<long>(raysL.size()), [&](long begin, long end) {
+        for (long i = begin; i < end; i++)
         {
-            Point3 result = (pa + pb)/2;
-            points3D[i] = result;
-        }
-        else
-        {
-            points3D[i] = { DNAN,DNAN,DNAN };
+            Point3 p2{}, p4{}, pa{}, pb{};
+            double mua, mub;
+            p2 = centerL + raysLObject[i];
+            p4 = centerR + raysRObject[i];
+            if (CommonMath::lineLineIntersect(p1, p2, p3, p4, pa, pb, mua, mub))
+            {
+                Point3 result = (pa + pb)/2;
+                points3D[i] = result;
+            }
+            else
+            {
+                points3D[i] = { DNAN,DNAN,DNAN };
+            }
         }
-    }
+    }, 256);
 
     return points3D;
 }
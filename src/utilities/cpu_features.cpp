@@ -0,0 +1,92 @@
+#include "utilities/cpu_features.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Queries the processor and the operating system for the supported instruction sets.
+ *
+ * AVX2 and AVX-512 additionally require the operating system to save the extended registers.
+ * The L2 cache size is taken from the C library where available.
+ *
+ * @return The detected features, all false on non-x86 targets.
+ */
+CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.avx512f = __builtin_cpu_supports("avx512f");
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    features.sse41 = (info[2] & (1 << 19)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool osAvx = (xcr0 & 0x6) == 0x6;
+    bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = osAvx && (info[1] & (1 << 5)) != 0;
+        features.avx512f = osAvx512 && (info[1] & (1 << 16)) != 0;
+    }
+#endif
+
+#if defined(__linux__) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0) {
+        features.l2_cache_bytes = static_cast<size_t>(l2);
+    }
+#endif
+
+    return features;
+}
+
+} // namespace
+
+/**
+ * @brief Returns the features of the processor the program runs on.
+ *
+ * @return The cached feature flags, detected on first use.
+ */
+const CpuFeatures& CpuFeatures::get() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+/**
+ * @brief Returns a human readable list of the detected features.
+ *
+ * @return The space separated feature names.
+ */
+std::string CpuFeatures::toString() const {
+    std::string result;
+    if (sse41) {
+        result += "sse4.1 ";
+    }
+    if (avx2) {
+        result += "avx2 ";
+    }
+    if (avx512f) {
+        result += "avx512f ";
+    }
+    if (result.empty()) {
+        return "scalar";
+    }
+    result.pop_back();
+    return result;
+}
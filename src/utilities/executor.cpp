@@ -0,0 +1,279 @@
+#include "utilities/executor.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// executor of the loop body running on this thread, nullptr outside of loops and scopes
+thread_local const Executor* scoped_executor = nullptr;
+
+std::mutex default_mutex;
+std::shared_ptr<Executor> default_executor;
+
+// forwards to the process default at the time of each loop, so replacing it never invalidates a reference
+class DefaultExecutor : public Executor {
+public:
+    int concurrency() const override { return Executor::getDefault()->concurrency(); }
+
+protected:
+    void run(long count, LoopBody body, long grain, int max_threads) const override {
+        Executor::getDefault()->parallelFor(count, body, grain, max_threads);
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Runs a loop over [0, count) in chunks.
+ *
+ * @param count Number of items, nothing runs when it is not positive.
+ * @param body Called with the begin and end of every chunk, from any thread of the executor.
+ * @param grain Smallest number of items per chunk, except for the last one.
+ * @param max_threads Largest number of threads working on this loop, 0 for the concurrency of the executor.
+ */
+void Executor::parallelFor(long count, LoopBody body, long grain, int max_threads) const {
+    if (count <= 0) {
+        return;
+    }
+    run(count, body, std::max(grain, 1L), std::max(max_threads, 0));
+}
+
+/**
+ * @brief Returns the executor of the calling thread.
+ *
+ * @return The executor running the current loop body or scope, otherwise the process default.
+ */
+const Executor& Executor::current() {
+    static const DefaultExecutor forwarding;
+    return scoped_executor != nullptr ? *scoped_executor : forwarding;
+}
+
+/**
+ * @brief Replaces the process default executor.
+ *
+ * Loops running on the previous default finish on it.
+ *
+ * @param executor The new default, nullptr restores a ThreadPool with one thread per core.
+ */
+void Executor::setDefault(std::shared_ptr<Executor> executor) {
+    std::lock_guard<std::mutex> lock(default_mutex);
+    default_executor = std::move(executor);
+}
+
+/**
+ * @brief Returns the process default executor, creating the built-in pool on first use.
+ *
+ * @return The default executor.
+ */
+std::shared_ptr<Executor> Executor::getDefault() {
+    std::lock_guard<std::mutex> lock(default_mutex);
+    if (!default_executor) {
+        default_executor = std::make_shared<ThreadPool>();
+    }
+    return default_executor;
+}
+
+/**
+ * @brief Makes an executor current on the calling thread.
+ *
+ * @param executor The executor, it must outlive the scope.
+ */
+Executor::Scope::Scope(const Executor& executor) : previous(scoped_executor) {
+    scoped_executor = &executor;
+}
+
+/**
+ * @brief Restores the executor that was current before the scope.
+ */
+Executor::Scope::~Scope() {
+    scoped_executor = previous;
+}
+
+/**
+ * @brief Runs the whole loop as one chunk on the calling thread.
+ *
+ * The grain and thread cap have no effect, there is a single chunk on a single thread.
+ *
+ * @param count Number of items.
+ * @param body The loop body.
+ */
+void InlineExecutor::run(long count, LoopBody body, long /*grain*/, int /*max_threads*/) const {
+    Scope scope(*this);
+    body(0, count);
+}
+
+// a loop submitted to a ThreadPool, lives on the stack of the submitting thread until every thread left it
+struct ThreadPool::Loop {
+    LoopBody body;
+    long count;
+    long grain;
+    int max_threads;
+    long divisor;                       // chunks take this fraction of the remaining items
+    std::atomic<long> next{ 0 };        // first item not yet claimed
+    std::atomic<int> threads{ 1 };      // threads working on the loop, starting with the submitting thread
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    Loop(LoopBody body, long count, long grain, int max_threads, long divisor)
+        : body(body), count(count), grain(grain), max_threads(max_threads), divisor(divisor) {}
+
+    bool exhausted() const { return next.load() >= count; }
+    bool full() const { return max_threads > 0 && threads.load() >= max_threads; }
+
+    // called by every thread once it found no chunk left, the last one wakes the submitting thread
+    void leave() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--threads == 0) {
+            done.notify_all();
+        }
+    }
+};
+
+/**
+ * @brief Starts the worker threads.
+ *
+ * @param options Thread count and pinning.
+ */
+ThreadPool::ThreadPool(const ThreadPoolOptions& options) {
+    int threads = options.threads;
+    if (threads <= 0) {
+        threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    loops.reserve(16);
+    for (int i = 0; i + 1 < threads; ++i) {
+        workers.emplace_back(&ThreadPool::work, this);
+#if defined(__linux__)
+        if (options.pin_threads) {
+            const int processors = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET((i + 1) % processors, &set);
+            pthread_setaffinity_np(workers.back().native_handle(), sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+/**
+ * @brief Stops and joins the worker threads, loops still running finish on their submitting threads.
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Runs a loop with the calling thread and the idle workers and waits for it.
+ *
+ * Loops of a single chunk, with a single thread or on a pool without workers run inline. The loop
+ * lives on the stack and the list of running loops only grows to the deepest nesting seen, so a
+ * loop does not allocate once the pool is warm.
+ *
+ * @param count Number of items.
+ * @param body The loop body.
+ * @param grain Smallest number of items per chunk.
+ * @param max_threads Largest number of threads on the loop, 0 for no cap.
+ */
+void ThreadPool::run(long count, LoopBody body, long grain, int max_threads) const {
+    if (workers.empty() || count <= grain || max_threads == 1) {
+        Scope scope(*this);
+        body(0, count);
+        return;
+    }
+
+    Loop loop(body, count, grain, max_threads, 2L * (max_threads > 0 ? std::min(max_threads, concurrency()) : concurrency()));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loops.push_back(&loop);
+    }
+    wake.notify_all();
+
+    execute(loop);
+    {
+        // no worker joins once the loop is off the list
+        std::lock_guard<std::mutex> lock(mutex);
+        loops.erase(std::find(loops.begin(), loops.end(), &loop));
+    }
+
+    std::unique_lock<std::mutex> lock(loop.mutex);
+    if (--loop.threads > 0) {
+        loop.done.wait(lock, [&] { return loop.threads.load() == 0; });
+    }
+    if (loop.error) {
+        std::rethrow_exception(loop.error);
+    }
+}
+
+/**
+ * @brief Claims and runs chunks of a loop until none are left.
+ *
+ * After an exception the remaining items are skipped and the exception is kept for the submitting thread.
+ *
+ * @param loop The loop, joined by the calling thread.
+ */
+void ThreadPool::execute(Loop& loop) const {
+    Scope scope(*this);
+    long begin = loop.next.load();
+    while (true) {
+        long end;
+        do {
+            if (begin >= loop.count) {
+                return;
+            }
+            end = std::min(loop.count, begin + std::max(loop.grain, (loop.count - begin) / loop.divisor));
+        } while (!loop.next.compare_exchange_weak(begin, end));
+
+        try {
+            loop.body(begin, end);
+        }
+        catch (...) {
+            loop.next.store(loop.count);
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            if (!loop.error) {
+                loop.error = std::current_exception();
+            }
+        }
+        begin = loop.next.load();
+    }
+}
+
+/**
+ * @brief Worker thread, joins the newest loop that has chunks left and room for another thread.
+ */
+void ThreadPool::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        Loop* loop = nullptr;
+        for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+            if (!(*it)->exhausted() && !(*it)->full()) {
+                loop = *it;
+                break;
+            }
+        }
+        if (loop == nullptr) {
+            wake.wait(lock);
+            continue;
+        }
+
+        // joining under the pool mutex keeps the submitting thread from returning before this thread leaves
+        ++loop->threads;
+        lock.unlock();
+        execute(*loop);
+        loop->leave();
+        lock.lock();
+    }
+}
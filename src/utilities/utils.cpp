@@ -26,6 +26,76 @@ T clamp(T val, T mn, T mx) {
     return std::max(mn, std::min(val, mx));
 }
 
+/**
+ * @brief Writes an interleaved 8-bit buffer to a file in a specified format.
+ *
+ * @param buffer Pointer to the first pixel of the interleaved image.
+ * @param width Width of the image in pixels.
+ * @param height Height of the image in pixels.
+ * @param channels Number of interleaved channels.
+ * @param stride_in_bytes Bytes between the start of consecutive rows.
+ * @param filename The path to the output image file.
+ * @param format The format to save the image in (e.g., "bmp", "png", "jpg").
+ * @throws std::invalid_argument if the format is unsupported.
+ */
+static void writeInterleaved(const uint8_t* buffer, int width, int height, int channels, int stride_in_bytes, const std::string& filename, const std::string& format) {
+    // bmp and jpg writers of stb only accept densely packed rows
+    std::vector<uint8_t> packed;
+    if (stride_in_bytes != width * channels && format != "png") {
+        packed.resize(static_cast<size_t>(width) * height * channels);
+        for (int y = 0; y < height; ++y) {
+            std::copy(buffer + static_cast<size_t>(y) * stride_in_bytes, buffer + static_cast<size_t>(y) * stride_in_bytes + width * channels, packed.data() + static_cast<size_t>(y) * width * channels);
+        }
+        buffer = packed.data();
+        stride_in_bytes = width * channels;
+    }
+
+    // Determine the format and save the image
+    bool success = false;
+    if (format == "bmp") {
+        success = stbi_write_bmp(filename.c_str(), width, height, channels, buffer);
+    }
+    else if (format == "png") {
+        success = stbi_write_png(filename.c_str(), width, height, channels, buffer, stride_in_bytes);
+    }
+    else if (format == "jpg" || format == "jpeg") {
+        int quality = 100;
+        success = stbi_write_jpg(filename.c_str(), width, height, channels, buffer, quality);
+    }
+    else {
+        throw std::invalid_argument("Unsupported image format.");
+    }
+
+    if (success) {
+        std::cout << "Image saved as " << filename << "\n";
+    }
+    else {
+        std::cerr << "Failed to save image.\n";
+    }
+}
+
+/**
+ * @brief Extracts the lower case extension of a filename.
+ *
+ * @param filename The path to the image file including the extension.
+ * @return The extension without the leading dot.
+ * @throws std::invalid_argument if the filename has no or an empty extension.
+ */
+static std::string imageFormatFromFilename(const std::string& filename) {
+    std::string::size_type idx = filename.rfind('.');
+    if (idx == std::string::npos) {
+        throw std::invalid_argument("Filename does not contain an extension.");
+    }
+
+    std::string extension = filename.substr(idx + 1);
+    if (extension.empty()) {
+        throw std::invalid_argument("Filename extension is empty.");
+    }
+
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
 /**
  * @brief Loads an image from a file and returns it as a 3D vector.
  *
@@ -97,52 +167,211 @@ void Utils::saveImage(const std::vector<std::vector<std::vector<double>>>& data,
         }
     }
 
-    // Determine the format and save the image
-    bool success = false;
-    if (format == "bmp") {
-        success = stbi_write_bmp(filename.c_str(), width, height, channels, imageBuffer.data());
+    writeInterleaved(imageBuffer.data(), width, height, channels, width * channels, filename, format);
+}
+
+/**
+ * @brief Saves an image to a file in a specified format based on the extension in the filename.
+ *
+ * @param data The 3D vector representing the image.
+ * @param filename The path to the output image file including the extension.
+ * @throws std::invalid_argument if the input data has inconsistent dimensions or an unsupported format.
+ */
+void Utils::saveImage(const std::vector<std::vector<std::vector<double>>>& data, const std::string& filename) {
+    saveImage(data, filename, imageFormatFromFilename(filename));
+}
+
+/**
+ * @brief Loads an image from a file into a contiguous 8-bit image.
+ *
+ * The image is stored interleaved, the storage of image is reused when its shape already matches.
+ *
+ * @param filename The path to the image file.
+ * @param image The output image.
+ * @param desiredChannels The number of desired channels in the output image.
+ * @throws std::runtime_error if the image fails to load.
+ */
+void Utils::loadImage(const std::string& filename, Image<uint8_t>& image, int desiredChannels) {
+    int width, height, channels;
+    uint8_t* imgData = stbi_load(filename.c_str(), &width, &height, &channels, desiredChannels);
+    if (imgData == nullptr) {
+        throw std::runtime_error("Failed to load image.");
     }
-    else if (format == "png") {
-        int stride_in_bytes = width * channels;
-        success = stbi_write_png(filename.c_str(), width, height, channels, imageBuffer.data(), stride_in_bytes);
+
+    image.resize(width, height, desiredChannels, ImageLayout::Interleaved);
+    std::copy(imgData, imgData + static_cast<size_t>(width) * height * desiredChannels, image.data());
+
+    stbi_image_free(imgData);
+}
+
+/**
+ * @brief Loads an image from a file into a contiguous double precision image.
+ *
+ * The image is stored interleaved, the storage of image is reused when its shape already matches.
+ *
+ * @param filename The path to the image file.
+ * @param image The output image.
+ * @param desiredChannels The number of desired channels in the output image.
+ * @throws std::runtime_error if the image fails to load.
+ */
+void Utils::loadImage(const std::string& filename, Image<double>& image, int desiredChannels) {
+    int width, height, channels;
+    uint8_t* imgData = stbi_load(filename.c_str(), &width, &height, &channels, desiredChannels);
+    if (imgData == nullptr) {
+        throw std::runtime_error("Failed to load image.");
     }
-    else if (format == "jpg" || format == "jpeg") {
-        int quality = 100;
-        success = stbi_write_jpg(filename.c_str(), width, height, channels, imageBuffer.data(), quality);
+
+    image.resize(width, height, desiredChannels, ImageLayout::Interleaved);
+    std::transform(imgData, imgData + static_cast<size_t>(width) * height * desiredChannels, image.data(),
+        [](uint8_t value) { return static_cast<double>(value); });
+
+    stbi_image_free(imgData);
+}
+
+/**
+ * @brief Saves an 8-bit image to a file in a specified format.
+ *
+ * Interleaved images are handed to the encoder without an intermediate copy.
+ *
+ * @param image The image to save.
+ * @param filename The path to the output image file.
+ * @param format The format to save the image in (e.g., "bmp", "png", "jpg").
+ * @throws std::invalid_argument if the image is empty or the format is unsupported.
+ */
+void Utils::saveImage(const ImageView<const uint8_t>& image, const std::string& filename, const std::string& format) {
+    if (image.empty()) {
+        throw std::invalid_argument("Input data has no channels.");
     }
-    else {
-        throw std::invalid_argument("Unsupported image format.");
+
+    int width = image.width();
+    int height = image.height();
+    int channels = image.channels();
+
+    if (image.layout() == ImageLayout::Interleaved && image.pixelStride() == channels) {
+        writeInterleaved(image.data(), width, height, channels, static_cast<int>(image.rowStride()), filename, format);
+        return;
     }
 
-    if (success) {
-        std::cout << "Image saved as " << filename << "\n";
+    std::vector<uint8_t> imageBuffer(static_cast<size_t>(width) * height * channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                imageBuffer[(static_cast<size_t>(y) * width + x) * channels + c] = image(x, y, c);
+            }
+        }
     }
-    else {
-        std::cerr << "Failed to save image.\n";
+    writeInterleaved(imageBuffer.data(), width, height, channels, width * channels, filename, format);
+}
+
+/**
+ * @brief Saves an 8-bit image to a file in a format based on the extension in the filename.
+ *
+ * @param image The image to save.
+ * @param filename The path to the output image file including the extension.
+ * @throws std::invalid_argument if the image is empty or the format is unsupported.
+ */
+void Utils::saveImage(const ImageView<const uint8_t>& image, const std::string& filename) {
+    saveImage(image, filename, imageFormatFromFilename(filename));
+}
+
+/**
+ * @brief Saves a double precision image to a file in a specified format.
+ *
+ * Values are clamped to [0, 255] before being narrowed to 8 bits.
+ *
+ * @param image The image to save.
+ * @param filename The path to the output image file.
+ * @param format The format to save the image in (e.g., "bmp", "png", "jpg").
+ * @throws std::invalid_argument if the image is empty or the format is unsupported.
+ */
+void Utils::saveImage(const ImageView<const double>& image, const std::string& filename, const std::string& format) {
+    if (image.empty()) {
+        throw std::invalid_argument("Input data has no channels.");
+    }
+
+    int width = image.width();
+    int height = image.height();
+    int channels = image.channels();
+
+    std::vector<uint8_t> imageBuffer(static_cast<size_t>(width) * height * channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                imageBuffer[(static_cast<size_t>(y) * width + x) * channels + c] =
+                    static_cast<unsigned char>(clamp(image(x, y, c), 0.0, 255.0));
+            }
+        }
     }
+    writeInterleaved(imageBuffer.data(), width, height, channels, width * channels, filename, format);
 }
 
 /**
- * @brief Saves an image to a file in a specified format based on the extension in the filename.
+ * @brief Saves a double precision image to a file in a format based on the extension in the filename.
  *
- * @param data The 3D vector representing the image.
+ * @param image The image to save.
  * @param filename The path to the output image file including the extension.
- * @throws std::invalid_argument if the input data has inconsistent dimensions or an unsupported format.
+ * @throws std::invalid_argument if the image is empty or the format is unsupported.
  */
-void Utils::saveImage(const std::vector<std::vector<std::vector<double>>>& data, const std::string& filename) {
-    std::string::size_type idx = filename.rfind('.');
-    if (idx == std::string::npos) {
-        throw std::invalid_argument("Filename does not contain an extension.");
+void Utils::saveImage(const ImageView<const double>& image, const std::string& filename) {
+    saveImage(image, filename, imageFormatFromFilename(filename));
+}
+
+/**
+ * @brief Copies a 3D vector image indexed as [channel][row][column] into a contiguous image.
+ *
+ * @param data The 3D vector representing the image.
+ * @param layout The memory layout of the returned image.
+ * @return The contiguous image.
+ * @throws std::invalid_argument if the channels have inconsistent dimensions.
+ */
+Image<double> Utils::toImage(const std::vector<std::vector<std::vector<double>>>& data, ImageLayout layout) {
+    if (data.empty() || data[0].empty()) {
+        return {};
     }
 
-    std::string extension = filename.substr(idx + 1);
-    if (extension.empty()) {
-        throw std::invalid_argument("Filename extension is empty.");
+    int channels = static_cast<int>(data.size());
+    int height = static_cast<int>(data[0].size());
+    int width = static_cast<int>(data[0][0].size());
+
+    Image<double> image(width, height, channels, layout);
+    for (int c = 0; c < channels; ++c) {
+        if (data[c].size() != static_cast<size_t>(height)) {
+            throw std::invalid_argument("All channels must have the same dimensions.");
+        }
+        for (int y = 0; y < height; ++y) {
+            if (data[c][y].size() != static_cast<size_t>(width)) {
+                throw std::invalid_argument("All channels must have the same dimensions.");
+            }
+            for (int x = 0; x < width; ++x) {
+                image(x, y, c) = data[c][y][x];
+            }
+        }
     }
 
-    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return image;
+}
+
+/**
+ * @brief Copies an image into a 3D vector indexed as [channel][row][column].
+ *
+ * @param image The image to copy.
+ * @return The 3D vector representing the image.
+ */
+std::vector<std::vector<std::vector<double>>> Utils::toVector(const ImageView<const double>& image) {
+    if (image.empty()) {
+        return {};
+    }
 
-    saveImage(data, filename, extension);
+    std::vector<std::vector<std::vector<double>>> data(image.channels(), std::vector<std::vector<double>>(image.height(), std::vector<double>(image.width())));
+    for (int c = 0; c < image.channels(); ++c) {
+        for (int y = 0; y < image.height(); ++y) {
+            for (int x = 0; x < image.width(); ++x) {
+                data[c][y][x] = image(x, y, c);
+            }
+        }
+    }
+
+    return data;
 }
 
 /**
@@ -156,3 +385,24 @@ bool Utils::exists(const std::string& name) {
     struct stat buffer;
     return (stat(name.c_str(), &buffer) == 0);
 }
+
+/**
+ * @brief Hashes a block of memory with 64-bit FNV-1a.
+ *
+ * The hash is stable across runs and platforms with the same byte order, so it can be used
+ * for file names and cache keys.
+ *
+ * @param data Pointer to the bytes to hash.
+ * @param size Number of bytes.
+ * @param seed Initial hash value, the result of a previous call to continue a hash.
+ * @return The updated hash value.
+ */
+uint64_t Utils::hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,30 @@
+#ifndef TEST_REMAP_HELPERS_H
+#define TEST_REMAP_HELPERS_H
+
+#include <cmath>
+#include <memory>
+#include "pixeltraq.h"
+
+// Mildly distorted 320x240 camera shared by the remapping tests
+inline std::shared_ptr<BrownConrady> createRemapTestCamera() {
+    std::vector<double> focal_length = { 500.0, 500.0 };
+    std::vector<double> principal_point = { 160.0, 120.0 };
+    std::vector<int> image_size = { 320, 240 };
+    return std::make_shared<BrownConrady>(focal_length, principal_point, image_size, std::vector<double>{ 0.1 }, std::vector<double>{ 0, 0 }, std::vector<double>{ 0 });
+}
+
+// Smooth sine pattern around 100, the phase shifts it for the second image of a pair
+template <typename T>
+Image<T> createRemapTestImage(int width, int height, int channels, double phase = 0.0) {
+    Image<T> image(width, height, channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                image(x, y, c) = static_cast<T>(100.0 + 90.0 * std::sin(0.07 * x + 0.05 * y + c + phase));
+            }
+        }
+    }
+    return image;
+}
+
+#endif // TEST_REMAP_HELPERS_H
@@ -519,4 +519,18 @@ TEST(CameraTest, cameraToWorldPnts_ZeroInputs_validresult) {
         -2.526221499972754,
         -2.220853245946583
         }, 1e-6);
-}
\ No newline at end of file
+}
+// Test that fingerprints identify the camera geometry
+TEST(CameraTest, fingerprint_ChangedParameters_Differs) {
+    std::vector<int> image_size = { 640, 480 };
+    Point3 rotation = { 0.0, 0.0, 0.0 };
+    Point3 translation = { 0.0, 0.0, 0.0 };
+    auto pinhole1 = std::make_shared<Pinhole>(std::vector<double>{ 500.0, 500.0 }, std::vector<double>{ 320.0, 240.0 }, 0.0, image_size, rotation, translation);
+    auto pinhole2 = std::make_shared<Pinhole>(std::vector<double>{ 500.0, 500.0 }, std::vector<double>{ 320.0, 240.0 }, 0.0, image_size, rotation, translation);
+    auto pinhole3 = std::make_shared<Pinhole>(std::vector<double>{ 500.0, 500.5 }, std::vector<double>{ 320.0, 240.0 }, 0.0, image_size, rotation, translation);
+    auto pinhole4 = std::make_shared<Pinhole>(std::vector<double>{ 500.0, 500.0 }, std::vector<double>{ 320.0, 240.0 }, 0.0, std::vector<int>{ 640, 481 }, rotation, translation);
+
+    EXPECT_EQ(pinhole1->fingerprint(), pinhole2->fingerprint());
+    EXPECT_NE(pinhole1->fingerprint(), pinhole3->fingerprint());
+    EXPECT_NE(pinhole1->fingerprint(), pinhole4->fingerprint());
+}
@@ -152,6 +152,32 @@ TEST(CommonMathTest, Interp2Overload2_EmptyInputs_ReturnEmpty) {
     EXPECT_EQ(CommonMath::interp2(img, Xd, Yd), img);
 }
 
+// Test interp2 on image views matches the nested vector overload
+TEST(CommonMathTest, Interp2View_NormalInputs_MatchNestedOverload) {
+    std::vector<std::vector<std::vector<double>>> img = { {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}}, {{9, 8, 7}, {6, 5, 4}, {3, 2, 1}} };
+    std::vector<std::vector<double>> Xd = { {0, 0.5, 1.25}, {2, 2.75, -1} };
+    std::vector<std::vector<double>> Yd = { {0, 0.5, 1.5}, {2, 0.25, 1} };
+
+    auto expected = CommonMath::interp2(img, Xd, Yd);
+
+    Image<double> XdImage(3, 2), YdImage(3, 2);
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 3; ++x) {
+            XdImage(x, y) = Xd[y][x];
+            YdImage(x, y) = Yd[y][x];
+        }
+    }
+
+    EXPECT_EQ(Utils::toVector(CommonMath::interp2(Utils::toImage(img), XdImage, YdImage)), expected);
+    EXPECT_EQ(Utils::toVector(CommonMath::interp2(Utils::toImage(img, ImageLayout::Interleaved), XdImage, YdImage)), expected);
+}
+
+// Test interp2 on image views with mismatching output
+TEST(CommonMathTest, Interp2View_MismatchedOutput_Throw) {
+    Image<double> img(3, 3, 1), Xd(2, 2), Yd(2, 2), output(3, 2, 1);
+    EXPECT_THROW(CommonMath::interp2(img, Xd, Yd, output), std::invalid_argument);
+}
+
 // Test bilinearInterpolate with normal inputs
 TEST(CommonMathTest, BilinearInterpolate_NormalInputs_ReturnExpected) {
     std::vector<std::vector<double>> img = { {1, 2}, {3, 4} };
@@ -379,4 +405,51 @@ TEST(CommonMathTest, transposeMatrix_NormalInputs_ReturnExpected) {
     } };
     Matrix3x3 result = CommonMath::transposeMatrix(matrix);
     EXPECT_EQ(result, expected_transpose);
-}
\ No newline at end of file
+}
+// Test for matrixInverse with a general and a singular matrix
+TEST(CommonMathTest, matrixInverse_NormalInputs_ReturnExpected) {
+    Matrix3x3 matrix = { {
+        {2, 0, 1},
+        {1, 3, 0},
+        {0.5, 0, 4}
+    } };
+    Matrix3x3 product = CommonMath::matrixMultiply(matrix, CommonMath::matrixInverse(matrix));
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            EXPECT_NEAR(product[i][j], i == j ? 1.0 : 0.0, 1e-12);
+        }
+    }
+
+    Matrix3x3 singular = { {
+        {1, 2, 3},
+        {4, 5, 6},
+        {7, 8, 9}
+    } };
+    EXPECT_THROW(CommonMath::matrixInverse(singular), std::invalid_argument);
+}
+
+TEST(CommonMathTest, halfFloat_AllPatterns_RoundTrip) {
+    for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+        const uint16_t half = static_cast<uint16_t>(bits);
+        const float value = CommonMath::halfToFloat(half);
+        if (value != value) {
+            EXPECT_NE(CommonMath::halfToFloat(CommonMath::floatToHalf(value)), CommonMath::halfToFloat(CommonMath::floatToHalf(value)));
+            continue;
+        }
+        ASSERT_EQ(CommonMath::floatToHalf(value), half) << "pattern " << bits;
+    }
+}
+
+TEST(CommonMathTest, floatToHalf_NormalInputs_RoundToNearestEven) {
+    EXPECT_EQ(CommonMath::floatToHalf(1.0f), 0x3c00);
+    EXPECT_EQ(CommonMath::floatToHalf(-2.0f), 0xc000);
+    EXPECT_EQ(CommonMath::floatToHalf(65504.0f), 0x7bff);
+    EXPECT_EQ(CommonMath::floatToHalf(65520.0f), 0x7c00);
+    EXPECT_EQ(CommonMath::floatToHalf(std::ldexp(1.0f, -24)), 0x0001);
+    EXPECT_EQ(CommonMath::floatToHalf(std::ldexp(1.0f, -25)), 0x0000);
+    // halfway between 1 and the next half rounds to even, slightly above rounds up
+    EXPECT_EQ(CommonMath::floatToHalf(1.0f + std::ldexp(1.0f, -11)), 0x3c00);
+    EXPECT_EQ(CommonMath::floatToHalf(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)), 0x3c01);
+    EXPECT_EQ(CommonMath::floatToHalf(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3c02);
+    EXPECT_NEAR(CommonMath::halfToFloat(CommonMath::floatToHalf(12.3456f)), 12.3456f, std::ldexp(1.0f, -8));
+}
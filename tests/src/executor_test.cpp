@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "pixeltraq.h"
+
+namespace {
+
+// runs every index through the executor and checks it ran exactly once
+void expectEveryIndexOnce(const Executor& executor, long count, long grain, int max_threads = 0) {
+    std::vector<std::atomic<int>> visits(count);
+    for (std::atomic<int>& v : visits) {
+        v = 0;
+    }
+    executor.parallelFor(count, [&](long begin, long end) {
+        EXPECT_LT(begin, end);
+        EXPECT_TRUE(end - begin >= grain || end == count);
+        for (long i = begin; i < end; ++i) {
+            ++visits[i];
+        }
+    }, grain, max_threads);
+    for (long i = 0; i < count; ++i) {
+        ASSERT_EQ(visits[i].load(), 1) << "index " << i;
+    }
+}
+
+} // namespace
+
+TEST(ExecutorTest, parallelfor_coverseveryindexonce) {
+    ThreadPoolOptions options;
+    options.threads = 4;
+    ThreadPool pool(options);
+    InlineExecutor inline_executor;
+    EXPECT_EQ(pool.concurrency(), 4);
+    EXPECT_EQ(inline_executor.concurrency(), 1);
+
+    for (long count : { 1L, 7L, 1000L, 100003L }) {
+        for (long grain : { 1L, 64L }) {
+            expectEveryIndexOnce(pool, count, grain);
+            expectEveryIndexOnce(pool, count, grain, 2);
+            expectEveryIndexOnce(inline_executor, count, grain);
+        }
+    }
+    // nothing runs for empty loops
+    pool.parallelFor(0, [](long, long) { FAIL(); });
+}
+
+TEST(ExecutorTest, maxthreads_capsthreadsperloop) {
+    ThreadPoolOptions options;
+    options.threads = 4;
+    ThreadPool pool(options);
+
+    std::atomic<int> running(0);
+    std::atomic<int> peak(0);
+    std::mutex mutex;
+    std::set<std::thread::id> ids;
+    pool.parallelFor(400, [&](long, long) {
+        const int now = ++running;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.insert(std::this_thread::get_id());
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        --running;
+    }, 1, 2);
+    EXPECT_LE(peak.load(), 2);
+    EXPECT_LE(ids.size(), 2u);
+
+    // a single thread runs inline on the caller
+    const std::thread::id caller = std::this_thread::get_id();
+    pool.parallelFor(100, [&](long, long) { EXPECT_EQ(std::this_thread::get_id(), caller); }, 1, 1);
+}
+
+TEST(ExecutorTest, exception_propagatestocaller) {
+    ThreadPoolOptions options;
+    options.threads = 4;
+    ThreadPool pool(options);
+    InlineExecutor inline_executor;
+
+    for (const Executor* executor : { static_cast<const Executor*>(&pool), static_cast<const Executor*>(&inline_executor) }) {
+        EXPECT_THROW(executor->parallelFor(10000, [](long begin, long end) {
+            if (begin <= 5000 && 5000 < end) {
+                throw std::runtime_error("item 5000");
+            }
+        }), std::runtime_error);
+    }
+    // the pool keeps working after a failed loop
+    expectEveryIndexOnce(pool, 5000, 16);
+}
+
+TEST(ExecutorTest, nestedloops_runoncurrentexecutor) {
+    ThreadPoolOptions options;
+    options.threads = 3;
+    ThreadPool pool(options);
+
+    std::atomic<long> total(0);
+    std::atomic<int> foreign(0);
+    pool.parallelFor(16, [&](long begin, long end) {
+        for (long i = begin; i < end; ++i) {
+            if (&Executor::current() != &pool) {
+                ++foreign;
+            }
+            Executor::current().parallelFor(1000, [&](long inner_begin, long inner_end) {
+                total += inner_end - inner_begin;
+            }, 10);
+        }
+    });
+    EXPECT_EQ(total.load(), 16 * 1000);
+    EXPECT_EQ(foreign.load(), 0);
+
+    InlineExecutor inline_executor;
+    {
+        Executor::Scope scope(inline_executor);
+        EXPECT_EQ(&Executor::current(), &inline_executor);
+    }
+    EXPECT_NE(&Executor::current(), &inline_executor);
+}
+
+TEST(ExecutorTest, setdefault_replacesprocessdefault) {
+    std::shared_ptr<Executor> previous = Executor::getDefault();
+    auto inline_executor = std::make_shared<InlineExecutor>();
+    Executor::setDefault(inline_executor);
+    EXPECT_EQ(Executor::getDefault(), inline_executor);
+    EXPECT_EQ(Executor::current().concurrency(), 1);
+
+    // the whole loop is one chunk on the inline default
+    long chunks = 0;
+    Executor::current().parallelFor(1000, [&](long, long) { ++chunks; });
+    EXPECT_EQ(chunks, 1);
+
+    Executor::setDefault(nullptr);
+    EXPECT_NE(Executor::getDefault(), inline_executor);
+    Executor::setDefault(previous);
+}
+
+TEST(ExecutorTest, remapper_withexecutor_matchesdefault) {
+    std::vector<double> focal_length = { 500.0, 505.0 };
+    std::vector<double> principal_point = { 162.0, 118.0 };
+    std::vector<int> image_size = { 320, 240 };
+    auto camera = std::make_shared<BrownConrady>(focal_length, principal_point, image_size, std::vector<double>{ 0.1, -0.02 }, std::vector<double>{ 0.001, 0 }, std::vector<double>{ 0 });
+
+    Image<uint8_t> image(320, 240, 3);
+    for (int y = 0; y < 240; ++y) {
+        for (int x = 0; x < 320; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                image(x, y, c) = static_cast<uint8_t>((x * 7 + y * 3 + c * 50) % 256);
+            }
+        }
+    }
+
+    Remapper reference(camera);
+    Image<uint8_t> expected = reference.undistort(image.view());
+
+    ThreadPoolOptions pool_options;
+    pool_options.threads = 4;
+    for (std::shared_ptr<Executor> executor : { std::shared_ptr<Executor>(std::make_shared<InlineExecutor>()), std::shared_ptr<Executor>(std::make_shared<ThreadPool>(pool_options)) }) {
+        RemapperOptions options;
+        options.executor = executor;
+        Remapper remapper(camera, options);
+        Image<uint8_t> output = remapper.undistort(image.view());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(output.data()[i], expected.data()[i]) << "index " << i;
+        }
+    }
+}
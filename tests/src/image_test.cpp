@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <vector>
+#include "pixeltraq.h"
+
+TEST(ImageTest, Constructor_Interleaved_ValidStrides) {
+    Image<uint8_t> image(4, 3, 3);
+    EXPECT_EQ(image.width(), 4);
+    EXPECT_EQ(image.height(), 3);
+    EXPECT_EQ(image.channels(), 3);
+    EXPECT_EQ(image.layout(), ImageLayout::Interleaved);
+    EXPECT_EQ(image.pixelStride(), 3);
+    EXPECT_EQ(image.rowStride(), 12);
+    EXPECT_EQ(image.channelStride(), 1);
+    EXPECT_EQ(image.size(), 36u);
+    EXPECT_TRUE(image.view().isContiguous());
+}
+
+TEST(ImageTest, Constructor_Planar_ValidStrides) {
+    Image<double> image(4, 3, 2, ImageLayout::Planar);
+    EXPECT_EQ(image.layout(), ImageLayout::Planar);
+    EXPECT_EQ(image.pixelStride(), 1);
+    EXPECT_EQ(image.rowStride(), 4);
+    EXPECT_EQ(image.channelStride(), 12);
+
+    image(3, 2, 1) = 7.0;
+    EXPECT_EQ(image.data()[12 + 2 * 4 + 3], 7.0);
+}
+
+TEST(ImageTest, View_ExternalBufferWithPadding_AccessesCorrectElements) {
+    std::vector<uint16_t> buffer(3 * 8, 0);
+    ImageView<uint16_t> view(buffer.data(), 5, 3, 1, ImageLayout::Interleaved, 8);
+    view(4, 2) = 42;
+    EXPECT_EQ(buffer[2 * 8 + 4], 42);
+    EXPECT_FALSE(view.isContiguous());
+
+    ImageView<const uint16_t> constView = view;
+    EXPECT_EQ(constView(4, 2), 42);
+}
+
+TEST(ImageTest, Roi_ValidRegion_SharesStorage) {
+    Image<int> image(6, 4, 2);
+    auto roi = image.view().roi(2, 1, 3, 2);
+    roi(0, 0, 1) = 5;
+    EXPECT_EQ(image(2, 1, 1), 5);
+    EXPECT_EQ(roi.width(), 3);
+    EXPECT_EQ(roi.height(), 2);
+    EXPECT_THROW(image.view().roi(4, 0, 3, 1), std::out_of_range);
+}
+
+TEST(ImageTest, Channel_InterleavedImage_SelectsSingleChannel) {
+    Image<int> image(2, 2, 3);
+    image(1, 1, 2) = 9;
+    auto channel = image.view().channel(2);
+    EXPECT_EQ(channel.channels(), 1);
+    EXPECT_EQ(channel(1, 1), 9);
+    EXPECT_THROW(image.view().channel(3), std::out_of_range);
+}
+
+TEST(ImageTest, Resize_SameShape_KeepsStorage) {
+    Image<float> image(8, 8, 1);
+    const float* data = image.data();
+    image.resize(8, 8, 1);
+    EXPECT_EQ(image.data(), data);
+    image.resize(4, 4, 1);
+    EXPECT_EQ(image.width(), 4);
+    EXPECT_EQ(image.size(), 16u);
+}
+
+TEST(ImageTest, CopyAndMove_ValidImage_ViewsFollowStorage) {
+    Image<double> image(3, 2, 1);
+    image(2, 1) = 1.5;
+
+    Image<double> copy = image;
+    copy(2, 1) = 2.5;
+    EXPECT_EQ(image(2, 1), 1.5);
+    EXPECT_EQ(copy(2, 1), 2.5);
+
+    Image<double> moved = std::move(copy);
+    EXPECT_EQ(moved(2, 1), 2.5);
+    EXPECT_EQ(moved.view().data(), moved.data());
+}
+
+TEST(ImageTest, ToImageToVector_Roundtrip_ReturnsOriginal) {
+    std::vector<std::vector<std::vector<double>>> data = { {{1, 2, 3}, {4, 5, 6}}, {{7, 8, 9}, {10, 11, 12}} };
+
+    auto planar = Utils::toImage(data);
+    EXPECT_EQ(planar.layout(), ImageLayout::Planar);
+    EXPECT_EQ(Utils::toVector(planar), data);
+
+    auto interleaved = Utils::toImage(data, ImageLayout::Interleaved);
+    EXPECT_EQ(interleaved(2, 1, 1), 12);
+    EXPECT_EQ(Utils::toVector(interleaved), data);
+}
+
+TEST(ImageTest, SaveLoad_Interleaved_Roundtrip) {
+    Image<uint8_t> image(5, 4, 3);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            for (int c = 0; c < image.channels(); ++c) {
+                image(x, y, c) = static_cast<uint8_t>(10 * x + 3 * y + c);
+            }
+        }
+    }
+
+    std::string filename = "image_test_roundtrip.png";
+    Utils::saveImage(image, filename);
+
+    Image<uint8_t> loaded;
+    Utils::loadImage(filename, loaded, 3);
+    std::remove(filename.c_str());
+
+    ASSERT_EQ(loaded.width(), 5);
+    ASSERT_EQ(loaded.height(), 4);
+    ASSERT_EQ(loaded.channels(), 3);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            for (int c = 0; c < image.channels(); ++c) {
+                EXPECT_EQ(loaded(x, y, c), image(x, y, c));
+            }
+        }
+    }
+}
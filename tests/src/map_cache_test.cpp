@@ -0,0 +1,245 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include "pixeltraq.h"
+#include "test_remap_helpers.h"
+
+namespace {
+
+// Empty directory for the cache files of a test, unique under the temporary directory and removed with the guard
+class CacheDirectory {
+public:
+    explicit CacheDirectory(const std::string& name) {
+        directory = std::filesystem::temp_directory_path() / ("pixeltraq_" + name + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+    }
+    ~CacheDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+    }
+    CacheDirectory(const CacheDirectory&) = delete;
+    CacheDirectory& operator=(const CacheDirectory&) = delete;
+
+    std::string path() const { return directory.string(); }
+
+private:
+    std::filesystem::path directory;
+};
+
+void expectSameCoordinates(const RemapMap& a, const RemapMap& b) {
+    ASSERT_EQ(a.width(), b.width());
+    ASSERT_EQ(a.height(), b.height());
+    EXPECT_EQ(a.format(), b.format());
+    EXPECT_EQ(a.sourceWidth(), b.sourceWidth());
+    EXPECT_EQ(a.sourceHeight(), b.sourceHeight());
+    for (int y = 0; y < a.height(); y += 7) {
+        for (int x = 0; x < a.width(); x += 5) {
+            ASSERT_EQ(a.coordinate(x, y), b.coordinate(x, y));
+        }
+    }
+}
+
+// Overwrites a value of a stored plane in a cache file, found by the bytes of the plane that follow it
+template <typename T>
+void overwriteStoredValue(const std::string& filename, const T* plane, T value) {
+    std::ifstream input(filename, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    input.close();
+    const size_t position = bytes.find(std::string(reinterpret_cast<const char*>(plane), 64 * sizeof(T)));
+    ASSERT_NE(position, std::string::npos);
+    std::memcpy(&bytes[position], &value, sizeof(value));
+    std::ofstream output(filename, std::ios::binary | std::ios::trunc);
+    output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+TEST(MapCacheTest, saveload_allformats_roundtrip) {
+    CacheDirectory cache("map_cache_roundtrip");
+    const std::string directory = cache.path();
+    auto camera = createRemapTestCamera();
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint, MapFormat::ControlGrid, MapFormat::Index, MapFormat::Area,
+                              MapFormat::Float32, MapFormat::Float16, MapFormat::Offset16 }) {
+        RemapperOptions options;
+        options.map_format = format;
+        options.interpolation = format == MapFormat::Index ? RemapInterpolation::Nearest : format == MapFormat::Area ? RemapInterpolation::Area : RemapInterpolation::Bicubic;
+        Remapper remapper(camera, options);
+        const RemapMap& map = remapper.getUndistortMap();
+
+        std::string filename = directory + "/map" + std::to_string(static_cast<int>(format)) + ".ptmap";
+        MapCache::save(map, filename, 42);
+        RemapMap loaded = MapCache::load(filename, 42);
+
+        expectSameCoordinates(map, loaded);
+        EXPECT_EQ(loaded.memoryUsage(), map.memoryUsage());
+        EXPECT_EQ(loaded.gridSpacing(), map.gridSpacing());
+        EXPECT_EQ(loaded.interpolation(), options.interpolation);
+    }
+}
+
+TEST(MapCacheTest, load_wrongkey_throw) {
+    CacheDirectory cache("map_cache_wrongkey");
+    const std::string directory = cache.path();
+    Remapper remapper(createRemapTestCamera());
+
+    std::string filename = directory + "/map.ptmap";
+    MapCache::save(remapper.getUndistortMap(), filename, 1);
+    EXPECT_THROW(MapCache::load(filename, 2), std::runtime_error);
+
+    RemapMap map;
+    EXPECT_FALSE(MapCache::tryLoad(filename, 2, map));
+    EXPECT_TRUE(map.empty());
+}
+
+TEST(MapCacheTest, load_truncatedfile_throw) {
+    CacheDirectory cache("map_cache_truncated");
+    const std::string directory = cache.path();
+    Remapper remapper(createRemapTestCamera());
+
+    std::string filename = directory + "/map.ptmap";
+    MapCache::save(remapper.getUndistortMap(), filename, 7);
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) / 2);
+    EXPECT_THROW(MapCache::load(filename, 7), std::runtime_error);
+}
+
+TEST(MapCacheTest, load_negativedimensions_throw) {
+    CacheDirectory cache("map_cache_baddimensions");
+    const std::string directory = cache.path();
+    Remapper remapper(createRemapTestCamera());
+
+    // negated map and plane sizes whose byte counts still match the file, the map size follows the
+    // magic, version, byte order mark, key and format of the header and the plane sizes its 72 bytes
+    std::string filename = directory + "/map.ptmap";
+    MapCache::save(remapper.getUndistortMap(), filename, 11);
+    {
+        std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out);
+        const int32_t size[2] = { -320, -240 };
+        for (std::streamoff offset : { 28, 72, 96 }) {
+            file.seekp(offset);
+            file.write(reinterpret_cast<const char*>(size), sizeof(size));
+        }
+    }
+    EXPECT_THROW(MapCache::load(filename, 11), std::runtime_error);
+    RemapMap loaded;
+    EXPECT_FALSE(MapCache::tryLoad(filename, 11, loaded));
+}
+
+TEST(MapCacheTest, load_indexoutsidesource_throw) {
+    CacheDirectory cache("map_cache_badindex");
+    const std::string directory = cache.path();
+    RemapperOptions options;
+    options.interpolation = RemapInterpolation::Nearest;
+    Remapper remapper(createRemapTestCamera(), options);
+    const RemapMap& map = remapper.getUndistortMap();
+    ASSERT_EQ(map.format(), MapFormat::Index);
+
+    std::string filename = directory + "/map.ptmap";
+    for (int32_t index : { -2, 320 * 240 }) {
+        MapCache::save(map, filename, 3);
+        overwriteStoredValue(filename, map.getIndices().row(120), index);
+        EXPECT_THROW(MapCache::load(filename, 3), std::runtime_error);
+        RemapMap loaded;
+        EXPECT_FALSE(MapCache::tryLoad(filename, 3, loaded));
+    }
+}
+
+TEST(MapCacheTest, load_fixedpointoutsidesource_throw) {
+    CacheDirectory cache("map_cache_badfixedpoint");
+    const std::string directory = cache.path();
+    RemapperOptions options;
+    options.map_format = MapFormat::FixedPoint;
+    Remapper remapper(createRemapTestCamera(), options);
+    const RemapMap& map = remapper.getUndistortMap();
+    ASSERT_EQ(map.format(), MapFormat::FixedPoint);
+
+    std::string filename = directory + "/map.ptmap";
+    const int16_t* coordinates = map.getIntegerCoordinates().row(120) + 2 * 160;
+    for (int16_t ix : { -2, 320 }) {
+        MapCache::save(map, filename, 9);
+        overwriteStoredValue(filename, coordinates, ix);
+        EXPECT_THROW(MapCache::load(filename, 9), std::runtime_error);
+        RemapMap loaded;
+        EXPECT_FALSE(MapCache::tryLoad(filename, 9, loaded));
+    }
+
+    MapCache::save(map, filename, 9);
+    overwriteStoredValue(filename, map.getFractionIndices().row(120) + 160, static_cast<uint16_t>(RemapMap::FRAC_SIZE * RemapMap::FRAC_SIZE));
+    EXPECT_THROW(MapCache::load(filename, 9), std::runtime_error);
+}
+
+TEST(MapCacheTest, load_areatapoutsidesource_throw) {
+    CacheDirectory cache("map_cache_badtap");
+    const std::string directory = cache.path();
+    RemapperOptions options;
+    options.interpolation = RemapInterpolation::Area;
+    Remapper remapper(createRemapTestCamera(), options);
+    const RemapMap& map = remapper.getUndistortMap();
+    ASSERT_EQ(map.format(), MapFormat::Area);
+
+    std::string filename = directory + "/map.ptmap";
+    const int32_t* tap = map.getAreaTaps().row(0) + 2 * (map.getAreaTaps().width() / 2);
+    for (int32_t index : { -1, 320 * 240 }) {
+        MapCache::save(map, filename, 5);
+        overwriteStoredValue(filename, tap, index);
+        EXPECT_THROW(MapCache::load(filename, 5), std::runtime_error);
+        RemapMap loaded;
+        EXPECT_FALSE(MapCache::tryLoad(filename, 5, loaded));
+    }
+}
+
+TEST(MapCacheTest, remapper_cachedirectory_reusesmaps) {
+    CacheDirectory cache("map_cache_remapper");
+    const std::string directory = cache.path();
+    RemapperOptions options;
+    options.cache_directory = directory;
+
+    Image<double> image = Utils::toImage(std::vector<std::vector<std::vector<double>>>(1, std::vector<std::vector<double>>(240, std::vector<double>(320, 5.0))));
+
+    Remapper first(createRemapTestCamera(), options);
+    Image<double> expected = first.undistort(image);
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 1);
+
+    Remapper second(createRemapTestCamera(), options);
+    Image<double> result = second.undistort(image);
+    expectSameCoordinates(first.getUndistortMap(), second.getUndistortMap());
+    ASSERT_EQ(result.size(), expected.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQ(result.data()[i], expected.data()[i]);
+    }
+
+    // a different camera must not pick up the cached map
+    auto other = createRemapTestCamera();
+    other->setTranslation(Point3{ 0.0, 0.0, 1.0 });
+    Remapper third(other, options);
+    third.getUndistortMap();
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 2);
+}
+
+TEST(MapCacheTest, remapper_updates_bypasscache) {
+    CacheDirectory cache("map_cache_updates");
+    const std::string directory = cache.path();
+    RemapperOptions options;
+    options.cache_directory = directory;
+    auto camera = createRemapTestCamera();
+    Remapper remapper(camera, camera->getPinhole(), options);
+    remapper.getUndistortMap();
+    remapper.getDistortMap();
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 2);
+
+    // per-frame updates rebuild both maps without writing them to the cache
+    for (int frame = 1; frame <= 5; ++frame) {
+        remapper.updateRotation(CommonMath::eulerToRot({ 0.01 * frame, -0.005 * frame, 0.0 }));
+        remapper.getDistortMap();
+    }
+    remapper.updateTargetIntrinsics({ 500.0, 500.0 }, { 160.0, 120.0 });
+    remapper.getDistortMap();
+    remapper.updateRowRotations({ CommonMath::eulerToRot({ 0.01, 0.0, 0.0 }), CommonMath::eulerToRot({ 0.02, 0.0, 0.0 }) });
+    remapper.getDistortMap();
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 2);
+}
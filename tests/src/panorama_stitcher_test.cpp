@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include "pixeltraq.h"
+
+namespace {
+
+// fisheye of a rig looking along the rig z axis turned by yaw
+std::shared_ptr<Camera> createRigCamera(double yaw) {
+    return std::make_shared<Kannala>(std::vector<double>{ 300.0, 300.0 }, std::vector<double>{ 319.5, 239.5 }, std::vector<int>{ 640, 480 },
+        std::vector<double>{ -0.02, 0.001 }, std::vector<double>{}, std::vector<double>{}, std::vector<double>{}, std::vector<double>{},
+        Point3{ 0.0, yaw, 0.0 });
+}
+
+template <typename T>
+Image<T> createConstantImage(int channels, double value) {
+    Image<T> image(640, 480, channels);
+    for (size_t i = 0; i < image.size(); ++i) {
+        image.data()[i] = static_cast<T>(value);
+    }
+    return image;
+}
+
+PanoramaOptions smallPanorama() {
+    PanoramaOptions options;
+    options.width = 360;
+    options.height = 180;
+    return options;
+}
+
+} // namespace
+
+TEST(PanoramaStitcherTest, blendtable_weightsandcoordinates_matchcameras) {
+    std::vector<std::shared_ptr<Camera>> cameras = { createRigCamera(0.9), createRigCamera(-0.9) };
+    PanoramaStitcher stitcher(cameras, smallPanorama());
+    ASSERT_EQ(stitcher.width(), 360);
+    ASSERT_EQ(stitcher.height(), 180);
+    EXPECT_GT(stitcher.memoryUsage(), 360u * 180u * sizeof(uint32_t));
+
+    int overlapping = 0;
+    for (int y = 0; y < 180; y += 3) {
+        for (int x = 0; x < 360; x += 3) {
+            const std::vector<BlendSample> samples = stitcher.samples(x, y);
+            double total = 0;
+            for (const BlendSample& s : samples) {
+                // the sample is the projection of the pixel direction, which the camera sees
+                const Camera& camera = *cameras[s.camera];
+                const Point3 ray = CommonMath::rotatePoint(stitcher.direction(x, y), camera.getRotationMatrix());
+                const Point2 p = camera.project(ray);
+                EXPECT_GT(ray[2], 0.0);
+                EXPECT_NEAR(s.x, p[0], 1e-3);
+                EXPECT_NEAR(s.y, p[1], 1e-3);
+                EXPECT_GT(s.weight, 0.0f);
+                total += s.weight;
+            }
+            if (!samples.empty()) {
+                EXPECT_NEAR(total, 1.0, 1e-6) << "at (" << x << ", " << y << ")";
+            }
+            overlapping += samples.size() > 1;
+        }
+    }
+    EXPECT_GT(overlapping, 100);
+
+    // behind both cameras nothing contributes, the weights mirror across the seam between columns 179 and 180
+    EXPECT_TRUE(stitcher.samples(0, 90).empty());
+    const std::vector<BlendSample> left = stitcher.samples(179, 90);
+    const std::vector<BlendSample> right = stitcher.samples(180, 90);
+    ASSERT_EQ(left.size(), 2u);
+    ASSERT_EQ(right.size(), 2u);
+    EXPECT_NEAR(left[0].weight, right[1].weight, 1e-4);
+    EXPECT_THROW(stitcher.samples(360, 0), std::out_of_range);
+}
+
+TEST(PanoramaStitcherTest, stitch_constantframes_blendsacrossseam) {
+    std::vector<std::shared_ptr<Camera>> cameras = { createRigCamera(0.9), createRigCamera(-0.9) };
+    ThreadPoolOptions pool_options;
+    pool_options.threads = 4;
+    PanoramaOptions options = smallPanorama();
+    options.executor = std::make_shared<ThreadPool>(pool_options);
+    PanoramaStitcher stitcher(cameras, options);
+
+    const Image<uint8_t> first = createConstantImage<uint8_t>(3, 100);
+    const Image<uint8_t> second = createConstantImage<uint8_t>(3, 200);
+    const Image<uint8_t> panorama = stitcher.stitch({ first.view(), second.view() });
+    ASSERT_EQ(panorama.width(), 360);
+    ASSERT_EQ(panorama.channels(), 3);
+
+    const Image<double> first64 = createConstantImage<double>(1, 100);
+    const Image<double> second64 = createConstantImage<double>(1, 200);
+    Image<double> panorama64(360, 180, 1);
+    stitcher.stitchInto({ first64.view(), second64.view() }, panorama64.view());
+
+    for (int y = 0; y < 180; ++y) {
+        for (int x = 0; x < 360; ++x) {
+            double expected = 0;
+            for (const BlendSample& s : stitcher.samples(x, y)) {
+                expected += s.weight * (s.camera == 0 ? 100.0 : 200.0);
+            }
+            ASSERT_NEAR(panorama64(x, y), expected, 1e-3) << "at (" << x << ", " << y << ")";
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_NEAR(panorama(x, y, c), expected, 0.5 + 1e-3) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+    EXPECT_NEAR(panorama64(179, 90) + panorama64(180, 90), 300.0, 0.01);
+    EXPECT_EQ(panorama64(0, 90), 0.0);
+}
+
+TEST(PanoramaStitcherTest, stitch_singlepinhole_matchesremapper) {
+    // a pinhole panorama of one pinhole camera is a plain bilinear remap
+    auto camera = std::make_shared<Pinhole>(std::vector<double>{ 300.0, 300.0 }, std::vector<double>{ 159.5, 119.5 }, 0.0, std::vector<int>{ 320, 240 });
+    PanoramaOptions options;
+    options.projection = PanoramaProjection::Cylindrical;
+    options.width = 200;
+    options.height = 100;
+    options.horizontal_fov = 0.9;
+    options.vertical_fov = 0.6;
+    PanoramaStitcher stitcher({ camera }, options);
+
+    Image<double> frame(320, 240, 1);
+    for (int y = 0; y < 240; ++y) {
+        for (int x = 0; x < 320; ++x) {
+            frame(x, y) = std::sin(0.05 * x) + std::cos(0.07 * y);
+        }
+    }
+    const Image<double> panorama = stitcher.stitch({ frame.view() });
+    for (int y = 1; y < 99; y += 7) {
+        for (int x = 1; x < 199; x += 7) {
+            const std::vector<BlendSample> samples = stitcher.samples(x, y);
+            ASSERT_EQ(samples.size(), 1u);
+            EXPECT_EQ(samples[0].weight, 1.0f);
+            const Point2 p = camera->project(stitcher.direction(x, y));
+            EXPECT_NEAR(panorama(x, y), std::sin(0.05 * p[0]) + std::cos(0.07 * p[1]), 0.01) << "at (" << x << ", " << y << ")";
+        }
+    }
+}
+
+TEST(PanoramaStitcherTest, invalidinputs_throw) {
+    std::vector<std::shared_ptr<Camera>> cameras = { createRigCamera(0.9), createRigCamera(-0.9) };
+    EXPECT_THROW(PanoramaStitcher({}, smallPanorama()), std::invalid_argument);
+    PanoramaOptions options = smallPanorama();
+    options.width = 0;
+    EXPECT_THROW(PanoramaStitcher(cameras, options), std::invalid_argument);
+    options = smallPanorama();
+    options.projection = PanoramaProjection::Cylindrical;
+    EXPECT_THROW(PanoramaStitcher(cameras, options), std::invalid_argument);
+
+    PanoramaStitcher stitcher(cameras, smallPanorama());
+    const Image<uint8_t> frame = createConstantImage<uint8_t>(3, 100);
+    const Image<uint8_t> gray = createConstantImage<uint8_t>(1, 100);
+    EXPECT_THROW(stitcher.stitch({ frame.view() }), std::invalid_argument);
+    EXPECT_THROW(stitcher.stitch({ frame.view(), gray.view() }), std::invalid_argument);
+    Image<uint8_t> wrong(360, 180, 1);
+    EXPECT_THROW(stitcher.stitchInto({ frame.view(), frame.view() }, wrong.view()), std::invalid_argument);
+}
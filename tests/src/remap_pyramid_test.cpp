@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include "pixeltraq.h"
+#include "test_remap_helpers.h"
+
+TEST(RemapPyramidTest, remap_alllevels_matchesperlevelremap) {
+    auto camera = createRemapTestCamera();
+    Remapper remapper(camera);
+    Image<uint8_t> image8 = createRemapTestImage<uint8_t>(320, 240, 3);
+    Image<double> image64 = createRemapTestImage<double>(320, 240, 1);
+
+    for (RemapInterpolation interpolation : { RemapInterpolation::Area, RemapInterpolation::Bilinear, RemapInterpolation::Nearest }) {
+        RemapPyramid pyramid(remapper, 4, interpolation);
+        ASSERT_EQ(pyramid.levels(), 4);
+        EXPECT_EQ(pyramid.level(1).width(), 160);
+        EXPECT_EQ(pyramid.level(3).height(), 30);
+        EXPECT_EQ(pyramid.level(2).interpolation(), interpolation);
+
+        std::vector<Image<uint8_t>> levels8 = pyramid.remap(image8.view());
+        std::vector<Image<double>> levels64 = pyramid.remap(image64.view());
+        ASSERT_EQ(levels8.size(), 4u);
+        for (int l = 0; l < 4; ++l) {
+            const RemapMap& map = pyramid.level(l);
+            Image<uint8_t> expected8(map.width(), map.height(), 3);
+            Image<double> expected64(map.width(), map.height(), 1);
+            map.remap(image8.view(), expected8.view());
+            map.remap(image64.view(), expected64.view());
+            for (size_t i = 0; i < expected8.size(); ++i) {
+                ASSERT_EQ(levels8[l].data()[i], expected8.data()[i]) << "level " << l << " at index " << i;
+            }
+            for (size_t i = 0; i < expected64.size(); ++i) {
+                ASSERT_EQ(levels64[l].data()[i], expected64.data()[i]) << "level " << l << " at index " << i;
+            }
+        }
+    }
+}
+
+TEST(RemapPyramidTest, level_derivedmap_matchesscaledremapper) {
+    auto camera = createRemapTestCamera();
+    Remapper remapper(camera);
+    RemapPyramid pyramid(remapper, 3, RemapInterpolation::Bilinear);
+
+    // the same half size map evaluated through the camera models
+    RemapperOptions options;
+    options.output_scale = 0.5;
+    Remapper half(camera, options);
+    const RemapMap& exact = half.getUndistortMap();
+    const RemapMap& derived = pyramid.level(1);
+    ASSERT_EQ(derived.width(), exact.width());
+    ASSERT_EQ(derived.height(), exact.height());
+
+    int compared = 0;
+    for (int y = 0; y < exact.height(); ++y) {
+        for (int x = 0; x < exact.width(); ++x) {
+            const std::array<double, 2> e = exact.coordinate(x, y);
+            const std::array<double, 2> d = derived.coordinate(x, y);
+            if (!(e[0] >= 1 && e[1] >= 1 && e[0] <= 318 && e[1] <= 238)) {
+                continue;
+            }
+            ASSERT_NEAR(d[0], e[0], 0.01) << "at (" << x << ", " << y << ")";
+            ASSERT_NEAR(d[1], e[1], 0.01) << "at (" << x << ", " << y << ")";
+            ++compared;
+        }
+    }
+    EXPECT_GT(compared, 10000);
+}
+
+TEST(RemapPyramidTest, remap_arealevels_filtercheckerboard) {
+    auto camera = createRemapTestCamera();
+    Remapper remapper(camera);
+    RemapPyramid pyramid(remapper, 4);
+
+    Image<uint8_t> checkerboard(320, 240);
+    for (int y = 0; y < 240; ++y) {
+        for (int x = 0; x < 320; ++x) {
+            checkerboard(x, y) = (x + y) % 2 ? 255 : 0;
+        }
+    }
+    std::vector<Image<uint8_t>> levels = pyramid.remap(checkerboard.view());
+    for (int l = 2; l < 4; ++l) {
+        const Image<uint8_t>& level = levels[l];
+        for (int y = 2; y < level.height() - 2; ++y) {
+            for (int x = 2; x < level.width() - 2; ++x) {
+                ASSERT_NEAR(level(x, y), 127.5, 20.0) << "level " << l << " at (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+TEST(RemapPyramidTest, remap_invalidarguments_throw) {
+    auto camera = createRemapTestCamera();
+    Remapper remapper(camera);
+    EXPECT_THROW(RemapPyramid(remapper, 0), std::invalid_argument);
+    EXPECT_THROW(RemapPyramid(RemapMap(), 2), std::invalid_argument);
+
+    RemapPyramid pyramid(remapper, 2);
+    Image<uint8_t> image = createRemapTestImage<uint8_t>(320, 240, 1);
+    Image<uint8_t> output(320, 240);
+    EXPECT_THROW(pyramid.remap(image.view(), std::vector<ImageView<uint8_t>>{ output.view() }), std::invalid_argument);
+    Image<uint8_t> wrong(100, 100);
+    EXPECT_THROW(pyramid.remap(image.view(), std::vector<ImageView<uint8_t>>{ output.view(), wrong.view() }), std::invalid_argument);
+}
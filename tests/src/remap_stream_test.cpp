@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include "pixeltraq.h"
+#include "test_remap_helpers.h"
+
+namespace {
+
+// Streams an image through a map in bands and collects the emitted rows
+template <typename T>
+Image<T> streamImage(const RemapMap& map, const Image<T>& image, int band_rows, int& peak_rows) {
+    Image<T> output(map.width(), map.height(), image.channels());
+    Image<int> emitted(1, map.height());
+    RemapStream<T> stream(map, image.channels(), [&](int y, const ImageView<const T>& row) {
+        emitted(0, y) += 1;
+        for (int x = 0; x < row.width(); ++x) {
+            for (int c = 0; c < row.channels(); ++c) {
+                output(x, y, c) = row(x, 0, c);
+            }
+        }
+    });
+
+    for (int y = 0; y < image.height(); y += band_rows) {
+        stream.push(image.view().roi(0, y, image.width(), std::min(band_rows, image.height() - y)));
+    }
+    EXPECT_TRUE(stream.finished());
+    for (int y = 0; y < map.height(); ++y) {
+        EXPECT_EQ(emitted(0, y), 1) << "row " << y;
+    }
+    peak_rows = stream.peakBufferedRows();
+    return output;
+}
+
+} // namespace
+
+TEST(RemapStreamTest, push_allformats_matchesfullremap) {
+    auto camera = createRemapTestCamera();
+    Image<uint8_t> image8 = createRemapTestImage<uint8_t>(320, 240, 3);
+    Image<double> image64 = createRemapTestImage<double>(320, 240, 1);
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint, MapFormat::ControlGrid }) {
+        for (RemapInterpolation interpolation : { RemapInterpolation::Nearest, RemapInterpolation::Bilinear, RemapInterpolation::Bicubic }) {
+            RemapperOptions options;
+            options.map_format = format;
+            options.interpolation = interpolation;
+            Remapper remapper(camera, options);
+            const RemapMap& map = remapper.getUndistortMap();
+
+            int peak = 0;
+            Image<uint8_t> streamed8 = streamImage(map, image8, 7, peak);
+            EXPECT_LT(peak, 240);
+            Image<double> streamed64 = streamImage(map, image64, 16, peak);
+            Image<uint8_t> full8 = remapper.undistort(image8.view());
+            Image<double> full64 = remapper.undistort(image64.view());
+
+            for (int y = 0; y < map.height(); ++y) {
+                for (int x = 0; x < map.width(); ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        ASSERT_EQ(streamed8(x, y, c), full8(x, y, c)) << "format " << static_cast<int>(format) << " interpolation " << static_cast<int>(interpolation) << " at (" << x << ", " << y << ")";
+                    }
+                    ASSERT_EQ(streamed64(x, y), full64(x, y)) << "format " << static_cast<int>(format) << " interpolation " << static_cast<int>(interpolation) << " at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+}
+
+TEST(RemapStreamTest, push_areamap_matchesfullremap) {
+    auto camera = createRemapTestCamera();
+    RemapperOptions options;
+    options.interpolation = RemapInterpolation::Area;
+    options.output_scale = 0.25;
+    Remapper remapper(camera, options);
+    const RemapMap& map = remapper.getUndistortMap();
+
+    Image<uint8_t> image = createRemapTestImage<uint8_t>(320, 240, 3);
+    int peak = 0;
+    Image<uint8_t> streamed = streamImage(map, image, 5, peak);
+    Image<uint8_t> full = remapper.undistort(image.view());
+    EXPECT_LT(peak, 240);
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_EQ(streamed(x, y, c), full(x, y, c)) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+TEST(RemapStreamTest, push_rotatedmap_releasesrows) {
+    // a rotated target reads the source in a slanted band, so rows are emitted out of order
+    auto camera = createRemapTestCamera();
+    const double angle = 0.15;
+    Matrix3x3 rotation = { { { 1.0, 0.0, 0.0 }, { 0.0, std::cos(angle), -std::sin(angle) }, { 0.0, std::sin(angle), std::cos(angle) } } };
+    RemapperOptions options;
+    options.map_format = MapFormat::FixedPoint;
+    Remapper remapper(camera, camera, rotation, options);
+    const RemapMap& map = remapper.getUndistortMap();
+
+    Image<uint16_t> image = createRemapTestImage<uint16_t>(320, 240, 1);
+    int peak = 0;
+    Image<uint16_t> streamed = streamImage(map, image, 1, peak);
+    Image<uint16_t> full = remapper.undistort(image.view());
+    EXPECT_LT(peak, 200);
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            ASSERT_EQ(streamed(x, y), full(x, y)) << "at (" << x << ", " << y << ")";
+        }
+    }
+}
+
+TEST(RemapStreamTest, push_invalidband_throw) {
+    auto camera = createRemapTestCamera();
+    Remapper remapper(camera);
+    RemapStream<uint8_t> stream(remapper.getUndistortMap(), 1, [](int, const ImageView<const uint8_t>&) {});
+
+    Image<uint8_t> narrow(319, 10);
+    EXPECT_THROW(stream.push(narrow), std::invalid_argument);
+    Image<uint8_t> color(320, 10, 3);
+    EXPECT_THROW(stream.push(color), std::invalid_argument);
+    Image<uint8_t> tall(320, 241);
+    EXPECT_THROW(stream.push(tall), std::invalid_argument);
+    EXPECT_EQ(stream.receivedRows(), 0);
+}
@@ -1,8 +1,106 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <memory>
+#include <new>
 #include <vector>
 #include "pixeltraq.h"
 
+// Counts heap allocations while an AllocationCounter is alive, so tests can check that a code path
+// allocates nothing. Every form of operator new and delete is replaced so that they stay paired.
+namespace {
+
+std::atomic<bool> allocation_counting(false);
+std::atomic<long> allocation_count(0);
+
+void* allocate(std::size_t size) {
+    if (allocation_counting.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    if (allocation_counting.load(std::memory_order_relaxed)) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    return std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+}
+
+// kept out of line, so the compiler does not pair free with the operator new of the caller
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void deallocate(void* p) noexcept {
+    std::free(p);
+}
+
+// counts the allocations of all threads during its lifetime, one counter at a time
+class AllocationCounter {
+public:
+    AllocationCounter() : start(allocation_count.load()) { allocation_counting = true; }
+    ~AllocationCounter() { allocation_counting = false; }
+    long count() const { return allocation_count.load() - start; }
+
+private:
+    long start;
+};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* p = allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = allocateAligned(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocateAligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p); }
+
 // Helper function to create a dummy image
 std::vector<std::vector<std::vector<double>>> createDummyImage(int width, int height, int channels) {
     std::vector<std::vector<std::vector<double>>> image(channels, std::vector<std::vector<double>>(height, std::vector<double>(width, 0)));
@@ -420,4 +518,1719 @@ TEST(RemapperTest, UndistortDistortRoundtripReturnsOriginal) {
             }
         }
     }
-}
\ No newline at end of file
+}
+TEST(RemapperTest, undistortimage_interleavedimage_matchesnestedresult) {
+    std::vector<double> focal_length = { 600.0, 600.0 };
+    std::vector<double> principal_point = { 320, 240 };
+    std::vector<int> image_size = { 640, 480 };
+    std::vector<double> radial_distortion = { 0.1 };
+    std::vector<double> tangential_distortion = { 0, 0 };
+    std::vector<double> tangential_distortion_polycoeff = { 0 };
+    auto cam_source = std::make_shared<BrownConrady>(focal_length, principal_point, image_size, radial_distortion, tangential_distortion, tangential_distortion_polycoeff);
+    Remapper remapper(cam_source);
+
+    auto image = createDummyImage(640, 480, 3);
+    auto expected = remapper.undistort(image);
+
+    Image<double> interleaved = Utils::toImage(image, ImageLayout::Interleaved);
+    Image<double> undistorted = remapper.undistort(interleaved);
+    EXPECT_EQ(undistorted.layout(), ImageLayout::Interleaved);
+    EXPECT_EQ(Utils::toVector(undistorted), expected);
+
+    Image<double> distorted = remapper.distort(undistorted);
+    EXPECT_EQ(Utils::toVector(distorted), remapper.distort(expected));
+}
+
+// Helper function to create a brown conrady camera with noticeable distortion
+std::shared_ptr<BrownConrady> createDistortedCamera() {
+    std::vector<double> focal_length = { 600.0, 600.0 };
+    std::vector<double> principal_point = { 320, 240 };
+    std::vector<int> image_size = { 640, 480 };
+    std::vector<double> radial_distortion = { 0.1 };
+    std::vector<double> tangential_distortion = { 0, 0 };
+    std::vector<double> tangential_distortion_polycoeff = { 0 };
+    return std::make_shared<BrownConrady>(focal_length, principal_point, image_size, radial_distortion, tangential_distortion, tangential_distortion_polycoeff);
+}
+
+// Helper function to create an 8-bit interleaved test pattern
+Image<uint8_t> createPatternImage(int width, int height, int channels) {
+    Image<uint8_t> image(width, height, channels);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < channels; ++c) {
+                image(x, y, c) = static_cast<uint8_t>(x / 6 + y / 6 + 10 * c);
+            }
+        }
+    }
+    return image;
+}
+
+TEST(RemapperTest, bilinearweights_alltableentries_sumtoone) {
+    const int16_t* weights = RemapMap::bilinearWeights();
+    for (int i = 0; i < RemapMap::FRAC_SIZE * RemapMap::FRAC_SIZE; ++i) {
+        int sum = weights[4 * i] + weights[4 * i + 1] + weights[4 * i + 2] + weights[4 * i + 3];
+        EXPECT_EQ(sum, 1 << RemapMap::WEIGHT_BITS);
+    }
+}
+
+TEST(RemapperTest, fixedpointmap_validcamera_smallerthanfloat64) {
+    auto cam_source = createDistortedCamera();
+    Remapper remapper(cam_source);
+    RemapperOptions options;
+    options.map_format = MapFormat::FixedPoint;
+    Remapper compact(cam_source, options);
+
+    EXPECT_EQ(compact.getUndistortMap().format(), MapFormat::FixedPoint);
+    EXPECT_EQ(compact.getUndistortMap().memoryUsage() * 8, remapper.getUndistortMap().memoryUsage() * 3);
+}
+
+TEST(RemapperTest, compactmaps_allformats_withindocumentederror) {
+    auto cam_source = createDistortedCamera();
+    Remapper reference(cam_source);
+    const RemapMap& exact = reference.getUndistortMap();
+
+    Image<double> image(640, 480, 1);
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            image(x, y) = std::sin(0.05 * x + 0.03 * y);
+        }
+    }
+    Image<double> expected = reference.undistort(image.view());
+
+    // bytes per pixel relative to Float64 and the largest coordinate error
+    const struct {
+        MapFormat format;
+        size_t divisor;
+        double tolerance;
+    } cases[] = { { MapFormat::Float32, 2, 1e-4 }, { MapFormat::Float16, 4, 1.0 / 32 }, { MapFormat::Offset16, 4, 1e-3 } };
+    for (const auto& c : cases) {
+        RemapperOptions options;
+        options.map_format = c.format;
+        Remapper remapper(cam_source, options);
+        const RemapMap& map = remapper.getUndistortMap();
+        EXPECT_EQ(map.format(), c.format);
+        EXPECT_EQ(map.memoryUsage() * c.divisor, exact.memoryUsage());
+
+        double maxError = 0.0;
+        for (int y = 0; y < 480; ++y) {
+            for (int x = 0; x < 640; ++x) {
+                const std::array<double, 2> e = exact.coordinate(x, y);
+                const std::array<double, 2> a = map.coordinate(x, y);
+                const bool inside = e[0] >= 0 && e[1] >= 0 && e[0] <= 640 && e[1] <= 480;
+                ASSERT_EQ(a[0] >= 0 && a[1] >= 0 && a[0] <= 640 && a[1] <= 480, inside) << "format " << static_cast<int>(c.format) << " at (" << x << ", " << y << ")";
+                if (inside) {
+                    maxError = std::max(maxError, std::max(std::abs(a[0] - e[0]), std::abs(a[1] - e[1])));
+                }
+            }
+        }
+        EXPECT_LE(maxError, c.tolerance) << "format " << static_cast<int>(c.format);
+        if (c.format == MapFormat::Offset16) {
+            EXPECT_LE(maxError, std::ldexp(1.0, -map.offsetBits() - 1) + 1e-12);
+        }
+
+        // the kernels read the decoded coordinates, a smooth image changes by the coordinate error at most
+        Image<double> output = remapper.undistort(image.view());
+        for (size_t i = 0; i < output.size(); ++i) {
+            ASSERT_NEAR(output.data()[i], expected.data()[i], 0.1 * c.tolerance + 1e-9) << "format " << static_cast<int>(c.format) << " at index " << i;
+        }
+        Image<uint8_t> pattern = createPatternImage(640, 480, 3);
+        EXPECT_NO_THROW(remapper.undistort(pattern.view()));
+    }
+}
+
+TEST(RemapperTest, undistortuint8_fixedpointmap_matchesdoubleresult) {
+    auto cam_source = createDistortedCamera();
+    RemapperOptions options;
+    options.map_format = MapFormat::FixedPoint;
+    Remapper remapper(cam_source);
+    Remapper compact(cam_source, options);
+
+    Image<uint8_t> image = createPatternImage(640, 480, 3);
+    Image<double> imageDouble(640, 480, 3);
+    std::copy(image.data(), image.data() + image.size(), imageDouble.data());
+
+    Image<double> expected = remapper.undistort(imageDouble);
+    Image<uint8_t> undistortedFloatMap = remapper.undistort(image);
+    Image<uint8_t> undistortedFixedMap = compact.undistort(image);
+
+    ASSERT_EQ(undistortedFixedMap.width(), 640);
+    ASSERT_EQ(undistortedFixedMap.height(), 480);
+    ASSERT_EQ(undistortedFixedMap.channels(), 3);
+
+    // 1/32 pixel quantization and rounding keep the error within 1
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                EXPECT_NEAR(undistortedFixedMap(x, y, c), expected(x, y, c), 1.0) << "at (" << x << ", " << y << ", " << c << ")";
+                EXPECT_EQ(undistortedFixedMap(x, y, c), undistortedFloatMap(x, y, c));
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, distortuint16_fixedpointmap_roundtripsinterior) {
+    std::vector<double> focal_length = { 600.0, 600.0 };
+    std::vector<double> principal_point = { 400.0, 300.0 };
+    std::vector<int> image_size = { 800, 600 };
+    auto cam_source = std::make_shared<Pinhole>(focal_length, principal_point, 0.0, image_size);
+    auto cam_target = std::make_shared<Pinhole>(focal_length, principal_point, 0.0, image_size);
+    RemapperOptions options;
+    options.map_format = MapFormat::FixedPoint;
+    Remapper remapper(cam_source, cam_target, options);
+
+    Image<uint16_t> image(800, 600, 1);
+    for (int y = 0; y < 600; ++y) {
+        for (int x = 0; x < 800; ++x) {
+            image(x, y) = static_cast<uint16_t>(60 * x + y);
+        }
+    }
+
+    Image<uint16_t> roundtrip = remapper.undistort(remapper.distort(image));
+    for (int y = 1; y < 599; ++y) {
+        for (int x = 1; x < 799; ++x) {
+            EXPECT_EQ(roundtrip(x, y), image(x, y));
+        }
+    }
+}
+
+TEST(RemapperTest, undistortuint8_fixedpointmapwrongsize_throw) {
+    RemapperOptions options;
+    options.map_format = MapFormat::FixedPoint;
+    Remapper remapper(createDistortedCamera(), options);
+
+    Image<uint8_t> image = createPatternImage(320, 240, 1);
+    EXPECT_THROW(remapper.undistort(image), std::invalid_argument);
+}
+
+// Map over a small source with odd sizes, sampling outside, on and inside the borders
+RemapMap createCoverageMap(int source_width, int source_height, MapFormat format) {
+    const int width = 37;
+    const int height = 11;
+    Image<double> Xd(width, height);
+    Image<double> Yd(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            Xd(x, y) = -1.5 + x * (source_width + 3.0) / (width - 1) + 0.013 * y;
+            Yd(x, y) = -1.0 + y * (source_height + 2.0) / (height - 1) + 0.007 * x;
+        }
+    }
+    Xd(3, 4) = source_width;
+    Yd(3, 4) = source_height;
+    Xd(5, 5) = 0.0;
+    Yd(5, 5) = source_height - 1.0;
+    return RemapMap(std::move(Xd), std::move(Yd), source_width, source_height, format);
+}
+
+TEST(RemapperTest, remapkernels_allbackends_matchscalar) {
+    const int source_width = 23;
+    const int source_height = 17;
+    RemapMap floatMap = createCoverageMap(source_width, source_height, MapFormat::Float64);
+    RemapMap fixedMap = createCoverageMap(source_width, source_height, MapFormat::FixedPoint);
+
+    Image<double> imageDouble(source_width, source_height, 3);
+    Image<float> imageFloat(source_width, source_height, 3, ImageLayout::Planar);
+    Image<uint8_t> imageU8 = createPatternImage(source_width, source_height, 3);
+    Image<uint16_t> imageU16(source_width, source_height, 2, ImageLayout::Planar);
+    for (int c = 0; c < 3; ++c) {
+        for (int y = 0; y < source_height; ++y) {
+            for (int x = 0; x < source_width; ++x) {
+                imageDouble(x, y, c) = std::sin(0.3 * x + 0.2 * y + c);
+                imageFloat(x, y, c) = static_cast<float>(std::cos(0.4 * x - 0.1 * y + c));
+                if (c < 2) {
+                    imageU16(x, y, c) = static_cast<uint16_t>(40000 + 700 * x - 900 * y + 5 * c);
+                }
+            }
+        }
+    }
+
+    Image<double> referenceDouble(floatMap.width(), floatMap.height(), 3);
+    Image<uint8_t> referenceU8(fixedMap.width(), fixedMap.height(), 3);
+    Image<uint8_t> referenceU8Float(floatMap.width(), floatMap.height(), 3);
+    Image<uint16_t> referenceU16(fixedMap.width(), fixedMap.height(), 2, ImageLayout::Planar);
+    Image<float> referenceFloat(floatMap.width(), floatMap.height(), 3);
+    Image<float> referenceU8ToFloat(floatMap.width(), floatMap.height(), 3);
+    Image<float> referenceU16ToFloat(floatMap.width(), floatMap.height(), 2);
+    floatMap.remap(imageDouble, referenceDouble, RemapBackend::Scalar);
+    fixedMap.remap(imageU8, referenceU8, RemapBackend::Scalar);
+    floatMap.remap(imageU8, referenceU8Float, RemapBackend::Scalar);
+    fixedMap.remap(imageU16, referenceU16, RemapBackend::Scalar);
+    floatMap.remap(imageFloat, referenceFloat, RemapBackend::Scalar);
+    floatMap.remap(imageU8, referenceU8ToFloat, RemapBackend::Scalar);
+    floatMap.remap(imageU16, referenceU16ToFloat, RemapBackend::Scalar);
+
+    for (RemapBackend backend : { RemapBackend::Auto, RemapBackend::SSE41, RemapBackend::AVX2, RemapBackend::AVX512 }) {
+        if (!RemapKernels::isSupported(backend)) {
+            EXPECT_THROW(RemapKernels::get(backend), std::invalid_argument);
+            continue;
+        }
+        SCOPED_TRACE(RemapKernels::name(backend));
+
+        Image<double> outputDouble(floatMap.width(), floatMap.height(), 3);
+        Image<uint8_t> outputU8(fixedMap.width(), fixedMap.height(), 3);
+        Image<uint8_t> outputU8Float(floatMap.width(), floatMap.height(), 3);
+        Image<uint16_t> outputU16(fixedMap.width(), fixedMap.height(), 2, ImageLayout::Planar);
+        Image<float> outputFloat(floatMap.width(), floatMap.height(), 3);
+        Image<float> outputU8ToFloat(floatMap.width(), floatMap.height(), 3);
+        Image<float> outputU16ToFloat(floatMap.width(), floatMap.height(), 2);
+        floatMap.remap(imageDouble, outputDouble, backend);
+        fixedMap.remap(imageU8, outputU8, backend);
+        floatMap.remap(imageU8, outputU8Float, backend);
+        fixedMap.remap(imageU16, outputU16, backend);
+        floatMap.remap(imageFloat, outputFloat, backend);
+        floatMap.remap(imageU8, outputU8ToFloat, backend);
+        floatMap.remap(imageU16, outputU16ToFloat, backend);
+
+        EXPECT_EQ(outputDouble.size(), referenceDouble.size());
+        for (size_t i = 0; i < referenceDouble.size(); ++i) {
+            ASSERT_EQ(outputDouble.data()[i], referenceDouble.data()[i]) << "at index " << i;
+        }
+        for (size_t i = 0; i < referenceU8.size(); ++i) {
+            ASSERT_EQ(outputU8.data()[i], referenceU8.data()[i]) << "at index " << i;
+            ASSERT_EQ(outputU8Float.data()[i], referenceU8Float.data()[i]) << "at index " << i;
+        }
+        for (size_t i = 0; i < referenceU16.size(); ++i) {
+            ASSERT_EQ(outputU16.data()[i], referenceU16.data()[i]) << "at index " << i;
+            ASSERT_EQ(outputU16ToFloat.data()[i], referenceU16ToFloat.data()[i]) << "at index " << i;
+        }
+        for (size_t i = 0; i < referenceFloat.size(); ++i) {
+            ASSERT_EQ(outputFloat.data()[i], referenceFloat.data()[i]) << "at index " << i;
+            ASSERT_EQ(outputU8ToFloat.data()[i], referenceU8ToFloat.data()[i]) << "at index " << i;
+        }
+
+        // homography spans of every length, with pixels on both sides of the source camera
+        const Matrix3x3 homography = { { { 1.1, 0.2, -3.0 }, { -0.1, 0.9, 5.0 }, { 0.004, -0.002, 0.3 } } };
+        std::vector<double> X(40), Y(40), expectedX(40), expectedY(40);
+        for (int count : { 0, 1, 3, 7, 8, 13, 40 }) {
+            RemapKernels::get(RemapBackend::Scalar).homographySpan(homography, -100, 17, count, expectedX.data(), expectedY.data());
+            RemapKernels::get(backend).homographySpan(homography, -100, 17, count, X.data(), Y.data());
+            for (int i = 0; i < count; ++i) {
+                ASSERT_EQ(X[i], expectedX[i]) << "at index " << i;
+                ASSERT_EQ(Y[i], expectedY[i]) << "at index " << i;
+            }
+        }
+        EXPECT_EQ(expectedX[0], -1.0);
+        EXPECT_NE(expectedX[39], -1.0);
+    }
+}
+
+TEST(RemapperTest, remapkernels_sourcebeyondgatheroffsets_usescalar) {
+    uint8_t pixel = 0;
+    const ImageView<const uint8_t> small(&pixel, 1, 1);
+    // rows 2^30 elements apart, the image spans more than the 32-bit offsets of the gathers reach
+    const ImageView<const uint8_t> huge(&pixel, 1024, 4, 4, 4, std::ptrdiff_t(1) << 30, 1);
+    EXPECT_TRUE(RemapKernels::fitsGatherOffsets(small));
+    EXPECT_FALSE(RemapKernels::fitsGatherOffsets(huge));
+    for (RemapBackend backend : { RemapBackend::Auto, RemapBackend::Scalar, RemapBackend::SSE41, RemapBackend::AVX2, RemapBackend::AVX512 }) {
+        if (RemapKernels::isSupported(backend)) {
+            EXPECT_EQ(RemapKernels::get(backend, small).backend, RemapKernels::get(backend).backend);
+            EXPECT_EQ(RemapKernels::get(backend, huge).backend, RemapBackend::Scalar);
+        }
+    }
+}
+
+TEST(RemapperTest, undistortdouble_scalarbackend_matchesinterp2) {
+    RemapperOptions options;
+    options.backend = RemapBackend::Scalar;
+    Remapper scalarRemapper(createDistortedCamera(), options);
+    Remapper autoRemapper(createDistortedCamera());
+
+    Image<double> image = Utils::toImage(createDummyImage(640, 480, 1));
+    Image<double> expected = CommonMath::interp2(image, scalarRemapper.getUndistortMap().getX(), scalarRemapper.getUndistortMap().getY());
+    Image<double> scalarResult = scalarRemapper.undistort(image);
+    Image<double> autoResult = autoRemapper.undistort(image);
+
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(scalarResult.data()[i], expected.data()[i]);
+        ASSERT_EQ(autoResult.data()[i], expected.data()[i]);
+    }
+}
+
+TEST(RemapperTest, undistort_lazyconstruction_buildsonlyundistortmap) {
+    Remapper remapper(createDistortedCamera());
+    EXPECT_EQ(remapper.memoryUsage(), 0u);
+
+    Image<double> image = Utils::toImage(createDummyImage(640, 480, 1));
+    Image<double> result = remapper.undistort(image);
+    EXPECT_FALSE(result.empty());
+    EXPECT_EQ(remapper.memoryUsage(), remapper.getUndistortMap().memoryUsage());
+    EXPECT_GT(remapper.memoryUsage(), 0u);
+}
+
+TEST(RemapperTest, constructor_prebuildboth_matcheslazyresult) {
+    RemapperOptions options;
+    options.prebuild = RemapDirection::Both;
+    Remapper eager(createDistortedCamera(), options);
+    Remapper lazy(createDistortedCamera());
+
+    const RemapMap& undistortMap = eager.getUndistortMap();
+    const RemapMap& distortMap = eager.getDistortMap();
+    EXPECT_EQ(eager.memoryUsage(), undistortMap.memoryUsage() + distortMap.memoryUsage());
+
+    Image<double> image = Utils::toImage(createDummyImage(640, 480, 1));
+    Image<double> eagerResult = eager.distort(image);
+    Image<double> lazyResult = lazy.distort(image);
+    ASSERT_EQ(eagerResult.size(), lazyResult.size());
+    for (size_t i = 0; i < eagerResult.size(); ++i) {
+        ASSERT_EQ(eagerResult.data()[i], lazyResult.data()[i]);
+    }
+}
+
+TEST(RemapperTest, controlgridmap_distortedcamera_withintolerance) {
+    RemapperOptions options;
+    options.map_format = MapFormat::ControlGrid;
+    options.control_grid.spacing = 32;
+    options.control_grid.max_error = 0.05;
+    Remapper gridRemapper(createDistortedCamera(), options);
+    Remapper denseRemapper(createDistortedCamera());
+
+    const RemapMap& grid = gridRemapper.getUndistortMap();
+    const RemapMap& dense = denseRemapper.getUndistortMap();
+    EXPECT_EQ(grid.format(), MapFormat::ControlGrid);
+    EXPECT_LE(grid.gridError(), 0.05);
+    EXPECT_LT(grid.memoryUsage() * 50, dense.memoryUsage());
+
+    double maxError = 0.0;
+    for (int y = 0; y < dense.height(); ++y) {
+        for (int x = 0; x < dense.width(); ++x) {
+            std::array<double, 2> exact = dense.coordinate(x, y);
+            if (exact[0] < 0 || exact[1] < 0 || exact[0] > 640 || exact[1] > 480) {
+                continue;
+            }
+            std::array<double, 2> approx = grid.coordinate(x, y);
+            maxError = std::max(maxError, std::hypot(approx[0] - exact[0], approx[1] - exact[1]));
+        }
+    }
+    EXPECT_LT(maxError, 0.1);
+}
+
+TEST(RemapperTest, controlgridmap_expandrow_matchescoordinate) {
+    RemapperOptions options;
+    options.map_format = MapFormat::ControlGrid;
+    options.control_grid.interpolation = GridInterpolation::Bilinear;
+    options.control_grid.max_error = 0.01;
+    Remapper remapper(createDistortedCamera(), options);
+
+    const RemapMap& grid = remapper.getUndistortMap();
+    EXPECT_LT(grid.gridSpacing(), 16);
+
+    std::vector<double> X(grid.width()), Y(grid.width());
+    for (int y : { 0, 7, 239, 479 }) {
+        grid.expandRow(y, X.data(), Y.data());
+        for (int x = 0; x < grid.width(); ++x) {
+            std::array<double, 2> expected = grid.coordinate(x, y);
+            ASSERT_NEAR(X[x], expected[0], 1e-9);
+            ASSERT_NEAR(Y[x], expected[1], 1e-9);
+        }
+    }
+}
+
+TEST(RemapperTest, undistort_controlgridmap_matchesdenseresult) {
+    RemapperOptions options;
+    options.map_format = MapFormat::ControlGrid;
+    Remapper gridRemapper(createDistortedCamera(), options);
+    Remapper denseRemapper(createDistortedCamera());
+
+    Image<uint8_t> image = createPatternImage(640, 480, 3);
+    Image<uint8_t> gridResult = gridRemapper.undistort(image);
+    Image<uint8_t> denseResult = denseRemapper.undistort(image);
+    Image<double> gridDouble = gridRemapper.distort(Utils::toImage(createDummyImage(640, 480, 1)));
+    Image<double> denseDouble = denseRemapper.distort(Utils::toImage(createDummyImage(640, 480, 1)));
+
+    ASSERT_EQ(gridResult.size(), denseResult.size());
+    for (int y = 8; y < 472; ++y) {
+        for (int x = 8; x < 632; ++x) {
+            // pixels on the edge of the valid region may flip between inside and outside
+            for (int c = 0; c < 3 && gridResult(x, y, 0) != 0 && denseResult(x, y, 0) != 0; ++c) {
+                ASSERT_NEAR(gridResult(x, y, c), denseResult(x, y, c), 1);
+            }
+            if (denseDouble(x, y) != 0.0 && gridDouble(x, y) != 0.0) {
+                ASSERT_NEAR(gridDouble(x, y), denseDouble(x, y), 0.5);
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, controlgridmap_invalidspacing_throw) {
+    auto identity = [](const std::vector<std::array<double, 2>>& points) { return points; };
+    ControlGridOptions options;
+    options.spacing = 0;
+    EXPECT_THROW(RemapMap::fromControlGrid(64, 48, 64, 48, identity, options), std::invalid_argument);
+}
+
+TEST(RemapperTest, controlgridmap_undefinedoutsidedisc_keepsvalidpixels) {
+    // an affine mapping that is undefined beyond a disc, like a lens beyond its field of view
+    auto disc = [](const std::vector<std::array<double, 2>>& points) {
+        std::vector<std::array<double, 2>> result(points.size());
+        for (size_t i = 0; i < points.size(); ++i) {
+            const double dx = points[i][0] - 32.0;
+            const double dy = points[i][1] - 24.0;
+            result[i] = dx * dx + dy * dy <= 20.0 * 20.0 ? std::array<double, 2>{ 0.9 * points[i][0] + 3.0, 0.8 * points[i][1] + 4.0 }
+                                                         : std::array<double, 2>{ DNAN, DNAN };
+        }
+        return result;
+    };
+    ControlGridOptions options;
+    options.spacing = 16;
+    options.max_error = 0.05;
+    RemapMap grid = RemapMap::fromControlGrid(64, 48, 64, 48, disc, options);
+    EXPECT_TRUE(std::isfinite(grid.gridError()));
+
+    int compared = 0;
+    for (int y = 0; y < 48; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            const std::array<double, 2> e = disc({ { static_cast<double>(x), static_cast<double>(y) } })[0];
+            if (std::isnan(e[0])) {
+                continue;
+            }
+            const std::array<double, 2> a = grid.coordinate(x, y);
+            ASSERT_NEAR(a[0], e[0], options.max_error) << "at (" << x << ", " << y << ")";
+            ASSERT_NEAR(a[1], e[1], options.max_error) << "at (" << x << ", " << y << ")";
+            ++compared;
+        }
+    }
+    EXPECT_GT(compared, 1000);
+}
+
+TEST(RemapperTest, plantiles_smallbudget_coversoutputonce) {
+    auto cam_source = createDistortedCamera();
+    Remapper remapper(cam_source);
+    const RemapMap& map = remapper.getUndistortMap();
+
+    std::vector<RemapTile> tiles = map.planTiles(3, 4096);
+    EXPECT_GT(tiles.size(), static_cast<size_t>((480 + RemapMap::MAX_TILE - 1) / RemapMap::MAX_TILE));
+
+    Image<int> coverage(map.width(), map.height());
+    for (const RemapTile& tile : tiles) {
+        EXPECT_LE(tile.height, RemapMap::MAX_TILE);
+        EXPECT_LE(tile.source_x0, tile.source_x1);
+        EXPECT_LE(tile.source_y0, tile.source_y1);
+        for (int y = tile.y; y < tile.y + tile.height; ++y) {
+            for (int x = tile.x; x < tile.x + tile.width; ++x) {
+                coverage(x, y) += 1;
+            }
+        }
+    }
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            ASSERT_EQ(coverage(x, y), 1) << "at (" << x << ", " << y << ")";
+        }
+    }
+}
+
+TEST(RemapperTest, undistort_tiledexecution_matchesrowresult) {
+    auto cam_source = createDistortedCamera();
+    Image<uint8_t> image8 = createPatternImage(640, 480, 3);
+    Image<double> image64(640, 480, 2, ImageLayout::Planar);
+    for (int c = 0; c < 2; ++c) {
+        for (int y = 0; y < 480; ++y) {
+            for (int x = 0; x < 640; ++x) {
+                image64(x, y, c) = std::sin(0.05 * x + 0.03 * y + c);
+            }
+        }
+    }
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint, MapFormat::ControlGrid }) {
+        RemapperOptions options;
+        options.map_format = format;
+        Remapper rows(cam_source, options);
+        options.execution = RemapExecution::Tiles;
+        options.tile_cache_bytes = 8192;
+        Remapper tiles(cam_source, options);
+
+        Image<uint8_t> rows8 = rows.undistort(image8.view());
+        Image<uint8_t> tiles8 = tiles.undistort(image8.view());
+        Image<double> rows64 = rows.undistort(image64.view());
+        Image<double> tiles64 = tiles.undistort(image64.view());
+        Image<uint8_t> distorted8 = tiles.distort(tiles8.view());
+        ASSERT_EQ(distorted8.width(), 640);
+
+        for (int y = 0; y < rows8.height(); ++y) {
+            for (int x = 0; x < rows8.width(); ++x) {
+                for (int c = 0; c < 3; ++c) {
+                    ASSERT_EQ(rows8(x, y, c), tiles8(x, y, c)) << "format " << static_cast<int>(format) << " at (" << x << ", " << y << ")";
+                }
+                for (int c = 0; c < 2; ++c) {
+                    ASSERT_EQ(rows64(x, y, c), tiles64(x, y, c)) << "format " << static_cast<int>(format) << " at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, undistortinto_mismatchedoutput_throw) {
+    auto cam_source = createDistortedCamera();
+    Remapper remapper(cam_source);
+    Image<uint8_t> image = createPatternImage(640, 480, 3);
+
+    Image<uint8_t> wrongSize(639, 480, 3);
+    EXPECT_THROW(remapper.undistortInto(image.view(), wrongSize.view()), std::invalid_argument);
+    Image<uint8_t> wrongChannels(640, 480, 1);
+    EXPECT_THROW(remapper.undistortInto(image.view(), wrongChannels.view()), std::invalid_argument);
+    Image<double> wrongImage(640, 480, 3);
+    Image<double> output(640, 480, 3);
+    EXPECT_THROW(remapper.distortInto(ImageView<const double>(), output.view()), std::invalid_argument);
+    EXPECT_NO_THROW(remapper.distortInto(wrongImage.view(), output.view()));
+}
+
+TEST(RemapperTest, undistortinto_afterwarmup_allocatesnothing) {
+    {
+        // the counter sees allocations made inside the library
+        AllocationCounter counter;
+        Image<double> probe(4, 4, 1);
+        EXPECT_GT(counter.count(), 0);
+    }
+
+    auto cam_source = createDistortedCamera();
+    Image<uint8_t> image8 = createPatternImage(640, 480, 3);
+    Image<double> image64(640, 480, 1);
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            image64(x, y) = std::sin(0.05 * x + 0.03 * y);
+        }
+    }
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint, MapFormat::ControlGrid }) {
+        for (RemapExecution execution : { RemapExecution::Rows, RemapExecution::Tiles }) {
+            RemapperOptions options;
+            options.map_format = format;
+            options.execution = execution;
+            Remapper remapper(cam_source, options);
+
+            Image<uint8_t> output8(640, 480, 3);
+            Image<double> output64(640, 480, 1, ImageLayout::Planar);
+            remapper.undistortInto(image8.view(), output8.view());
+            remapper.distortInto(image64.view(), output64.view());
+
+            long allocations;
+            {
+                AllocationCounter counter;
+                for (int frame = 0; frame < 5; ++frame) {
+                    remapper.undistortInto(image8.view(), output8.view());
+                    remapper.distortInto(image64.view(), output64.view());
+                }
+                allocations = counter.count();
+            }
+            EXPECT_EQ(allocations, 0) << "format " << static_cast<int>(format) << ", execution " << static_cast<int>(execution);
+
+            Image<uint8_t> expected8 = remapper.undistort(image8.view());
+            Image<double> expected64 = remapper.distort(image64.view());
+            for (int y = 0; y < 480; ++y) {
+                for (int x = 0; x < 640; ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        ASSERT_EQ(output8(x, y, c), expected8(x, y, c));
+                    }
+                    ASSERT_EQ(output64(x, y), expected64(x, y));
+                }
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, remap_multichannel_matchesperchannel) {
+    const int source_width = 23;
+    const int source_height = 17;
+    RemapMap floatMap = createCoverageMap(source_width, source_height, MapFormat::Float64);
+    RemapMap fixedMap = createCoverageMap(source_width, source_height, MapFormat::FixedPoint);
+
+    Image<uint8_t> rgba = createPatternImage(source_width, source_height, 4);
+    Image<uint16_t> rgb16(source_width, source_height, 3);
+    Image<double> planar(source_width, source_height, 3, ImageLayout::Planar);
+    for (int c = 0; c < 3; ++c) {
+        for (int y = 0; y < source_height; ++y) {
+            for (int x = 0; x < source_width; ++x) {
+                rgb16(x, y, c) = static_cast<uint16_t>(30000 + 900 * x - 700 * y + 11 * c);
+                planar(x, y, c) = std::cos(0.4 * x - 0.3 * y + c);
+            }
+        }
+    }
+
+    for (RemapBackend backend : { RemapBackend::Scalar, RemapBackend::SSE41, RemapBackend::AVX2, RemapBackend::AVX512 }) {
+        if (!RemapKernels::isSupported(backend)) {
+            continue;
+        }
+        SCOPED_TRACE(RemapKernels::name(backend));
+
+        for (const RemapMap* map : { &floatMap, &fixedMap }) {
+            Image<uint8_t> outputRgba(map->width(), map->height(), 4);
+            Image<uint16_t> outputRgb16(map->width(), map->height(), 3, ImageLayout::Planar);
+            Image<double> outputPlanar(map->width(), map->height(), 3);
+            map->remap(rgba, outputRgba, backend);
+            map->remap(rgb16, outputRgb16, backend);
+            map->remap(planar, outputPlanar, backend);
+
+            for (int c = 0; c < 4; ++c) {
+                Image<uint8_t> channel(map->width(), map->height());
+                map->remap(rgba.view().channel(c), channel, backend);
+                for (int y = 0; y < map->height(); ++y) {
+                    for (int x = 0; x < map->width(); ++x) {
+                        ASSERT_EQ(outputRgba(x, y, c), channel(x, y)) << "channel " << c << " at (" << x << ", " << y << ")";
+                    }
+                }
+            }
+            for (int c = 0; c < 3; ++c) {
+                Image<uint16_t> channel16(map->width(), map->height());
+                Image<double> channel64(map->width(), map->height());
+                map->remap(rgb16.view().channel(c), channel16, backend);
+                map->remap(planar.view().channel(c), channel64, backend);
+                for (int y = 0; y < map->height(); ++y) {
+                    for (int x = 0; x < map->width(); ++x) {
+                        ASSERT_EQ(outputRgb16(x, y, c), channel16(x, y)) << "channel " << c << " at (" << x << ", " << y << ")";
+                        ASSERT_EQ(outputPlanar(x, y, c), channel64(x, y)) << "channel " << c << " at (" << x << ", " << y << ")";
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, undistortbatch_allformats_matchesperframe) {
+    auto cam_source = createDistortedCamera();
+    const int frames = 4;
+    std::vector<Image<uint8_t>> images8;
+    std::vector<Image<double>> images64;
+    for (int f = 0; f < frames; ++f) {
+        Image<uint8_t> image8 = createPatternImage(640, 480, 3);
+        Image<double> image64(640, 480, 1);
+        for (int y = 0; y < 480; ++y) {
+            for (int x = 0; x < 640; ++x) {
+                image8(x, y, 0) = static_cast<uint8_t>(image8(x, y, 0) + 17 * f);
+                image64(x, y, 0) = std::sin(0.05 * x + 0.03 * y + f);
+            }
+        }
+        images8.push_back(std::move(image8));
+        images64.push_back(std::move(image64));
+    }
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint, MapFormat::ControlGrid, MapFormat::Offset16 }) {
+        for (RemapExecution execution : { RemapExecution::Rows, RemapExecution::Tiles }) {
+            RemapperOptions options;
+            options.map_format = format;
+            options.execution = execution;
+            options.tile_cache_bytes = 8192;
+            Remapper remapper(cam_source, options);
+
+            std::vector<Image<uint8_t>> outputs8;
+            std::vector<Image<double>> outputs64;
+            std::vector<ImageView<const uint8_t>> views8;
+            std::vector<ImageView<uint8_t>> outputViews8;
+            std::vector<ImageView<const double>> views64;
+            std::vector<ImageView<double>> outputViews64;
+            for (int f = 0; f < frames; ++f) {
+                outputs8.emplace_back(640, 480, 3);
+                outputs64.emplace_back(640, 480, 1);
+            }
+            for (int f = 0; f < frames; ++f) {
+                views8.push_back(images8[f].view());
+                outputViews8.push_back(outputs8[f].view());
+                views64.push_back(images64[f].view());
+                outputViews64.push_back(outputs64[f].view());
+            }
+            remapper.undistortBatch(views8, outputViews8);
+            remapper.undistortBatch(views64, outputViews64);
+
+            for (int f = 0; f < frames; ++f) {
+                Image<uint8_t> expected8 = remapper.undistort(images8[f].view());
+                Image<double> expected64 = remapper.undistort(images64[f].view());
+                for (int y = 0; y < 480; ++y) {
+                    for (int x = 0; x < 640; ++x) {
+                        for (int c = 0; c < 3; ++c) {
+                            ASSERT_EQ(outputs8[f](x, y, c), expected8(x, y, c)) << "format " << static_cast<int>(format) << " frame " << f << " at (" << x << ", " << y << ")";
+                        }
+                        ASSERT_EQ(outputs64[f](x, y, 0), expected64(x, y, 0)) << "format " << static_cast<int>(format) << " frame " << f << " at (" << x << ", " << y << ")";
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, undistortbatch_mismatchedframes_throw) {
+    auto cam_source = createDistortedCamera();
+    Remapper remapper(cam_source);
+    Image<uint8_t> image = createPatternImage(640, 480, 3);
+    Image<uint8_t> smaller = createPatternImage(320, 240, 3);
+    Image<uint8_t> output(640, 480, 3);
+    Image<uint8_t> other(640, 480, 3);
+
+    EXPECT_THROW(remapper.undistortBatch({ image.view() }, {}), std::invalid_argument);
+    EXPECT_THROW(remapper.undistortBatch({ image.view(), smaller.view() }, { output.view(), other.view() }), std::invalid_argument);
+    EXPECT_NO_THROW(remapper.undistortBatch(std::vector<ImageView<const uint8_t>>(), std::vector<ImageView<uint8_t>>()));
+}
+
+TEST(RemapperTest, bicubicweights_alltableentries_sumtoone) {
+    const int16_t* weights = RemapMap::bicubicWeights();
+    for (int i = 0; i < RemapMap::FRAC_SIZE * RemapMap::FRAC_SIZE; ++i) {
+        int sum = 0;
+        for (int k = 0; k < 16; ++k) {
+            sum += weights[16 * i + k];
+        }
+        EXPECT_EQ(sum, 1 << RemapMap::WEIGHT_BITS);
+    }
+    // a zero fraction only weights the integer pixel
+    EXPECT_EQ(weights[5], 1 << RemapMap::WEIGHT_BITS);
+}
+
+TEST(RemapperTest, undistort_nearestinterpolation_gathersroundedpixel) {
+    auto cam_source = createDistortedCamera();
+    RemapperOptions options;
+    options.interpolation = RemapInterpolation::Nearest;
+    Remapper nearest(cam_source, options);
+    Remapper reference(cam_source);
+    const RemapMap& map = nearest.getUndistortMap();
+    ASSERT_EQ(map.format(), MapFormat::Index);
+    EXPECT_EQ(map.interpolation(), RemapInterpolation::Nearest);
+    EXPECT_LT(map.memoryUsage(), reference.getUndistortMap().memoryUsage() / 3);
+
+    Image<uint8_t> image8 = createPatternImage(640, 480, 3);
+    Image<double> image64(640, 480, 2, ImageLayout::Planar);
+    for (int c = 0; c < 2; ++c) {
+        for (int y = 0; y < 480; ++y) {
+            for (int x = 0; x < 640; ++x) {
+                image64(x, y, c) = std::sin(0.05 * x + 0.03 * y + c);
+            }
+        }
+    }
+    Image<uint8_t> result8 = nearest.undistort(image8.view());
+    Image<double> result64 = nearest.undistort(image64.view());
+
+    ImageView<const double> X = reference.getUndistortMap().getX();
+    ImageView<const double> Y = reference.getUndistortMap().getY();
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            const double sx = X(x, y);
+            const double sy = Y(x, y);
+            const bool inside = sx >= 0 && sy >= 0 && sx <= 640 && sy <= 480;
+            const int ix = inside ? std::min(static_cast<int>(sx + 0.5), 639) : 0;
+            const int iy = inside ? std::min(static_cast<int>(sy + 0.5), 479) : 0;
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_EQ(result8(x, y, c), inside ? image8(ix, iy, c) : 0) << "at (" << x << ", " << y << ")";
+            }
+            for (int c = 0; c < 2; ++c) {
+                ASSERT_EQ(result64(x, y, c), inside ? image64(ix, iy, c) : 0.0) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, undistort_bicubicinterpolation_matchesbicubicinterpolate) {
+    auto cam_source = createDistortedCamera();
+    Image<double> image64(640, 480);
+    Image<uint8_t> image8(640, 480);
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            image64(x, y) = 100.0 + 80.0 * std::sin(0.05 * x) * std::cos(0.04 * y);
+            image8(x, y) = static_cast<uint8_t>(std::lround(image64(x, y)));
+        }
+    }
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint, MapFormat::ControlGrid }) {
+        RemapperOptions options;
+        options.map_format = format;
+        options.interpolation = RemapInterpolation::Bicubic;
+        Remapper remapper(cam_source, options);
+        const RemapMap& map = remapper.getUndistortMap();
+        EXPECT_EQ(map.interpolation(), RemapInterpolation::Bicubic);
+
+        Image<double> result64 = remapper.undistort(image64.view());
+        Image<uint8_t> result8 = remapper.undistort(image8.view());
+        for (int y = 0; y < 480; ++y) {
+            for (int x = 0; x < 640; ++x) {
+                const std::array<double, 2> c = map.coordinate(x, y);
+                const double expected = CommonMath::bicubicInterpolate(image64.view(), c[0], c[1]);
+                ASSERT_NEAR(result64(x, y), expected, 1e-9) << "format " << static_cast<int>(format) << " at (" << x << ", " << y << ")";
+                // the integer kernels quantize the coordinate to 1/32 pixel and the image to integers
+                ASSERT_NEAR(result8(x, y), expected, 2.0) << "format " << static_cast<int>(format) << " at (" << x << ", " << y << ")";
+            }
+        }
+    }
+
+    EXPECT_THROW(RemapMap(Image<double>(4, 4), Image<double>(4, 4), 4, 4, MapFormat::Index).setInterpolation(RemapInterpolation::Bilinear), std::invalid_argument);
+}
+
+// Helper function to create a rotated and scaled map that reaches past every border of the source
+RemapMap createRotatedMap(int source_width, int source_height, MapFormat format) {
+    const int width = 160;
+    const int height = 90;
+    Image<double> Xd(width, height);
+    Image<double> Yd(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            Xd(x, y) = -6.0 + 0.4 * x + 0.05 * y;
+            Yd(x, y) = -4.0 + 0.5 * y - 0.03 * x;
+        }
+    }
+    return RemapMap(std::move(Xd), std::move(Yd), source_width, source_height, format);
+}
+
+TEST(RemapperTest, region_allinterpolations_matchescoordinates) {
+    const int source_width = 50;
+    const int source_height = 40;
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::FixedPoint }) {
+        for (RemapInterpolation interpolation : { RemapInterpolation::Nearest, RemapInterpolation::Bilinear, RemapInterpolation::Bicubic }) {
+            SCOPED_TRACE(static_cast<int>(format) * 3 + static_cast<int>(interpolation));
+            RemapMap map = createRotatedMap(source_width, source_height, format);
+            map.setInterpolation(interpolation);
+            const RemapRegion& region = map.region();
+            const int before = interpolation == RemapInterpolation::Bicubic ? 1 : 0;
+            const int after = interpolation == RemapInterpolation::Bicubic ? 2 : 1;
+
+            ASSERT_EQ(region.row_start.size(), static_cast<size_t>(map.height() + 1));
+            EXPECT_EQ(region.counts[0] + region.counts[1] + region.counts[2], static_cast<size_t>(map.width()) * map.height());
+            EXPECT_GT(region.counts[static_cast<int>(PixelClass::Outside)], 0u);
+            EXPECT_GT(region.counts[static_cast<int>(PixelClass::Interior)], 0u);
+
+            Image<uint8_t> mask = map.validMask();
+            int x0 = map.width(), x1 = -1, y0 = map.height(), y1 = -1;
+            for (int y = 0; y < map.height(); ++y) {
+                int next = 0;
+                for (size_t r = region.row_start[y]; r < region.row_start[y + 1]; ++r) {
+                    const PixelRun& run = region.runs[r];
+                    ASSERT_EQ(run.x, next);
+                    if (run.pixel_class != PixelClass::Border) {
+                        EXPECT_GE(run.count, RemapMap::MIN_RUN);
+                    }
+                    for (int x = run.x; x < run.x + run.count; ++x) {
+                        const std::array<double, 2> c = map.coordinate(x, y);
+                        const bool valid = c[0] >= 0 && c[1] >= 0 && c[0] <= source_width && c[1] <= source_height;
+                        const bool interior = interpolation == RemapInterpolation::Nearest ||
+                            (c[0] >= before && c[1] >= before && c[0] <= source_width - 1 - after && c[1] <= source_height - 1 - after);
+                        ASSERT_EQ(mask(x, y), valid ? 255 : 0) << "at (" << x << ", " << y << ")";
+                        if (run.pixel_class == PixelClass::Outside) {
+                            ASSERT_FALSE(valid) << "at (" << x << ", " << y << ")";
+                        }
+                        if (run.pixel_class == PixelClass::Interior) {
+                            ASSERT_TRUE(valid && interior) << "at (" << x << ", " << y << ")";
+                        }
+                        if (valid) {
+                            x0 = std::min(x0, x);
+                            x1 = std::max(x1, x);
+                            y0 = std::min(y0, y);
+                            y1 = std::max(y1, y);
+                        }
+                    }
+                    next = run.x + run.count;
+                }
+                ASSERT_EQ(next, map.width());
+            }
+
+            const RemapRect rect = map.validRect();
+            EXPECT_EQ(rect.x, x0);
+            EXPECT_EQ(rect.y, y0);
+            EXPECT_EQ(rect.width, x1 - x0 + 1);
+            EXPECT_EQ(rect.height, y1 - y0 + 1);
+        }
+    }
+}
+
+TEST(RemapperTest, remap_classifiedregion_matchescoordinatesamples) {
+    const int source_width = 50;
+    const int source_height = 40;
+    Image<double> image64(source_width, source_height, 2);
+    Image<uint8_t> image8 = createPatternImage(source_width, source_height, 3);
+    for (int y = 0; y < source_height; ++y) {
+        for (int x = 0; x < source_width; ++x) {
+            image64(x, y, 0) = std::sin(0.3 * x + 0.2 * y);
+            image64(x, y, 1) = std::cos(0.1 * x - 0.4 * y);
+        }
+    }
+
+    for (RemapInterpolation interpolation : { RemapInterpolation::Bilinear, RemapInterpolation::Bicubic }) {
+        RemapMap map = createRotatedMap(source_width, source_height, MapFormat::Float64);
+        map.setInterpolation(interpolation);
+        RemapMap fixedMap = createRotatedMap(source_width, source_height, MapFormat::FixedPoint);
+        fixedMap.setInterpolation(interpolation);
+
+        // dirty outputs, Outside runs must be zero-filled
+        Image<double> result64(map.width(), map.height(), 2);
+        Image<uint8_t> result8(map.width(), map.height(), 3);
+        Image<uint8_t> reference8(map.width(), map.height(), 3);
+        result64.fill(7.0);
+        result8.fill(7);
+        map.remap(image64, result64);
+        fixedMap.remap(image8, result8);
+        fixedMap.remap(image8, reference8, RemapBackend::Scalar);
+
+        for (int y = 0; y < map.height(); ++y) {
+            for (int x = 0; x < map.width(); ++x) {
+                const std::array<double, 2> c = map.coordinate(x, y);
+                for (int ch = 0; ch < 2; ++ch) {
+                    const double expected = interpolation == RemapInterpolation::Bicubic ?
+                        CommonMath::bicubicInterpolate(image64.view().channel(ch), c[0], c[1]) :
+                        CommonMath::bilinearInterpolate(image64.view().channel(ch), c[0], c[1]);
+                    ASSERT_EQ(result64(x, y, ch), expected) << "at (" << x << ", " << y << ")";
+                }
+                for (int ch = 0; ch < 3; ++ch) {
+                    ASSERT_EQ(result8(x, y, ch), reference8(x, y, ch)) << "at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, remapkernels_interiorvariants_matchgeneric) {
+    const int width = 29;
+    const int height = 21;
+    const int count = 203;
+    Image<double> imageDouble(width, height, 3);
+    Image<uint8_t> imageU8 = createPatternImage(width, height, 3);
+    Image<uint16_t> imageU16(width, height, 2, ImageLayout::Planar);
+    for (int c = 0; c < 3; ++c) {
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                imageDouble(x, y, c) = std::sin(0.3 * x + 0.2 * y + c);
+                if (c < 2) {
+                    imageU16(x, y, c) = static_cast<uint16_t>(40000 + 700 * x - 900 * y + 5 * c);
+                }
+            }
+        }
+    }
+
+    // coordinates whose bicubic taps lie inside the image, every 7th one on an integer position
+    std::vector<double> X(count), Y(count);
+    std::vector<int16_t> XY(2 * count);
+    std::vector<uint16_t> frac(count);
+    for (int i = 0; i < count; ++i) {
+        const int fx = i % 7 == 0 ? 0 : (i * 13) % RemapMap::FRAC_SIZE;
+        const int fy = i % 7 == 0 ? 0 : (i * 5) % RemapMap::FRAC_SIZE;
+        XY[2 * i] = static_cast<int16_t>(1 + i % (width - 4));
+        XY[2 * i + 1] = static_cast<int16_t>(1 + (i / 3) % (height - 4));
+        frac[i] = static_cast<uint16_t>(fy * RemapMap::FRAC_SIZE + fx);
+        X[i] = XY[2 * i] + static_cast<double>(fx) / RemapMap::FRAC_SIZE;
+        Y[i] = XY[2 * i + 1] + static_cast<double>(fy) / RemapMap::FRAC_SIZE;
+    }
+
+    for (RemapBackend backend : { RemapBackend::Scalar, RemapBackend::SSE41, RemapBackend::AVX2, RemapBackend::AVX512 }) {
+        if (!RemapKernels::isSupported(backend)) {
+            continue;
+        }
+        SCOPED_TRACE(RemapKernels::name(backend));
+        const RemapKernels& kernels = RemapKernels::get(backend);
+
+        std::vector<double> expectedDouble(3 * count), outputDouble(3 * count);
+        std::vector<uint8_t> expectedU8(3 * count), outputU8(3 * count);
+        std::vector<uint16_t> expectedU16(2 * count), outputU16(2 * count);
+
+        kernels.bilinearDouble(X.data(), Y.data(), count, imageDouble, expectedDouble.data(), 3, 1);
+        kernels.bilinearDoubleInterior(X.data(), Y.data(), count, imageDouble, outputDouble.data(), 3, 1);
+        EXPECT_EQ(outputDouble, expectedDouble);
+        kernels.bicubicDouble(X.data(), Y.data(), count, imageDouble, expectedDouble.data(), 3, 1);
+        kernels.bicubicDoubleInterior(X.data(), Y.data(), count, imageDouble, outputDouble.data(), 3, 1);
+        EXPECT_EQ(outputDouble, expectedDouble);
+
+        kernels.fixedPointU8(XY.data(), frac.data(), count, imageU8, expectedU8.data(), 3, 1);
+        kernels.fixedPointInteriorU8(XY.data(), frac.data(), count, imageU8, outputU8.data(), 3, 1);
+        EXPECT_EQ(outputU8, expectedU8);
+        kernels.bicubicU8(XY.data(), frac.data(), count, imageU8, expectedU8.data(), 3, 1);
+        kernels.bicubicInteriorU8(XY.data(), frac.data(), count, imageU8, outputU8.data(), 3, 1);
+        EXPECT_EQ(outputU8, expectedU8);
+
+        kernels.fixedPointU16(XY.data(), frac.data(), count, imageU16, expectedU16.data(), 1, count);
+        kernels.fixedPointInteriorU16(XY.data(), frac.data(), count, imageU16, outputU16.data(), 1, count);
+        EXPECT_EQ(outputU16, expectedU16);
+        kernels.bicubicU16(XY.data(), frac.data(), count, imageU16, expectedU16.data(), 1, count);
+        kernels.bicubicInteriorU16(XY.data(), frac.data(), count, imageU16, outputU16.data(), 1, count);
+        EXPECT_EQ(outputU16, expectedU16);
+    }
+}
+
+TEST(RemapperTest, pixeltransform_factories_mapcorners) {
+    const std::vector<std::array<double, 2>> corners = { { 0.0, 0.0 }, { 9.0, 0.0 }, { 0.0, 5.0 } };
+
+    PixelTransform rotated = PixelTransform::rotate90(1, 10, 6);
+    EXPECT_EQ(rotated.width(), 6);
+    EXPECT_EQ(rotated.height(), 10);
+    std::vector<std::array<double, 2>> result = rotated.forward(corners);
+    EXPECT_EQ(result[0], (std::array<double, 2>{ 5.0, 0.0 }));
+    EXPECT_EQ(result[1], (std::array<double, 2>{ 5.0, 9.0 }));
+    EXPECT_EQ(result[2], (std::array<double, 2>{ 0.0, 0.0 }));
+    EXPECT_EQ(rotated.backward(result), corners);
+
+    PixelTransform full = rotated.then(PixelTransform::rotate90(-3, 6, 10)).then(PixelTransform::rotate90(2, 10, 6));
+    EXPECT_EQ(full.width(), 10);
+    EXPECT_EQ(full.height(), 6);
+    EXPECT_EQ(full.forward(corners), corners);
+
+    result = PixelTransform::flip(true, false, 10, 6).forward(corners);
+    EXPECT_EQ(result[0], (std::array<double, 2>{ 9.0, 0.0 }));
+    EXPECT_EQ(result[1], (std::array<double, 2>{ 0.0, 0.0 }));
+
+    // the outer edges of the image line up
+    result = PixelTransform::resize(10, 6, 20, 3).forward({ { -0.5, -0.5 }, { 9.5, 5.5 } });
+    EXPECT_NEAR(result[0][0], -0.5, 1e-12);
+    EXPECT_NEAR(result[0][1], -0.5, 1e-12);
+    EXPECT_NEAR(result[1][0], 19.5, 1e-12);
+    EXPECT_NEAR(result[1][1], 2.5, 1e-12);
+
+    // points on the horizon of a homography have no image
+    PixelTransform projective({ { { 1, 0, 0 }, { 0, 1, 0 }, { 0.1, 0, 1 } } }, 10, 10);
+    result = projective.forward({ { -10.0, 3.0 }, { -20.0, 3.0 } });
+    EXPECT_TRUE(std::isnan(result[0][0]));
+    EXPECT_TRUE(std::isnan(result[1][0]));
+    EXPECT_THROW(PixelTransform({ { { 1, 0, 0 }, { 2, 0, 0 }, { 0, 0, 1 } } }, 10, 10), std::invalid_argument);
+}
+
+TEST(RemapperTest, composedtransform_rotateandcrop_matcheschain) {
+    auto camera = createDistortedCamera();
+    Remapper remapper(camera);
+    Image<double> image = Utils::toImage(createDummyImage(640, 480, 2));
+    Image<double> undistorted = remapper.undistort(image.view());
+    ASSERT_EQ(remapper.targetWidth(), undistorted.width());
+
+    // a quarter turn and a crop reaching past the undistorted image
+    Remapper rotatedRemapper(remapper, PixelTransform::rotate90(1, 640, 480));
+    Remapper croppedRemapper(remapper, PixelTransform::crop(-20, 100, 200, 150));
+    EXPECT_EQ(rotatedRemapper.targetWidth(), 480);
+    EXPECT_EQ(rotatedRemapper.targetHeight(), 640);
+    Image<double> rotated = rotatedRemapper.undistort(image.view());
+    Image<double> cropped = croppedRemapper.undistort(image.view());
+    ASSERT_EQ(rotated.width(), 480);
+    ASSERT_EQ(cropped.width(), 200);
+
+    for (int c = 0; c < 2; ++c) {
+        for (int y = 0; y < 640; ++y) {
+            for (int x = 0; x < 480; ++x) {
+                ASSERT_EQ(rotated(x, y, c), undistorted(y, 479 - x, c)) << "at (" << x << ", " << y << ")";
+            }
+        }
+        for (int y = 0; y < 150; ++y) {
+            for (int x = 0; x < 200; ++x) {
+                const double expected = x < 20 ? 0.0 : undistorted(x - 20, y + 100, c);
+                ASSERT_EQ(cropped(x, y, c), expected) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+
+    // the distort direction inverts the chain as well
+    Image<double> restored = rotatedRemapper.distort(rotated.view());
+    Image<double> reference = remapper.distort(undistorted.view());
+    for (size_t i = 0; i < reference.size(); ++i) {
+        ASSERT_NEAR(restored.data()[i], reference.data()[i], 1e-9) << "at index " << i;
+    }
+}
+
+TEST(RemapperTest, composedremapper_tworemappers_matchesmapcomposition) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Camera> pinhole = camera->getPinhole();
+    Remapper first(camera);
+    Remapper second(pinhole, pinhole, CommonMath::eulerToRot({ 0.02, -0.03, 0.05 }));
+    Remapper composed(first, second);
+
+    const RemapMap& firstMap = first.getUndistortMap();
+    const RemapMap& secondMap = second.getUndistortMap();
+    const RemapMap& composedMap = composed.getUndistortMap();
+    ASSERT_EQ(composedMap.width(), secondMap.width());
+    ASSERT_EQ(composedMap.height(), secondMap.height());
+
+    int compared = 0;
+    for (int y = 0; y < composedMap.height(); y += 7) {
+        for (int x = 0; x < composedMap.width(); x += 7) {
+            const std::array<double, 2> q = secondMap.coordinate(x, y);
+            const std::array<double, 2> c = composedMap.coordinate(x, y);
+            const bool inside = q[0] >= 0 && q[1] >= 0 && q[0] <= firstMap.width() && q[1] <= firstMap.height();
+            if (!inside) {
+                EXPECT_TRUE(std::isnan(c[0])) << "at (" << x << ", " << y << ")";
+                continue;
+            }
+            if (q[0] > firstMap.width() - 1 || q[1] > firstMap.height() - 1) {
+                continue;
+            }
+            // the first map is smooth, so interpolating it at the second map lands on the composed coordinate
+            EXPECT_NEAR(c[0], CommonMath::bilinearInterpolate(firstMap.getX(), q[0], q[1]), 0.01) << "at (" << x << ", " << y << ")";
+            EXPECT_NEAR(c[1], CommonMath::bilinearInterpolate(firstMap.getY(), q[0], q[1]), 0.01) << "at (" << x << ", " << y << ")";
+            ++compared;
+        }
+    }
+    EXPECT_GT(compared, 1000);
+
+    Remapper mismatched(first, PixelTransform::crop(0, 0, 100, 100));
+    EXPECT_THROW(Remapper(mismatched, second), std::invalid_argument);
+}
+
+TEST(RemapperTest, areamap_integerdownscale_averagesblocks) {
+    // a 4x downscale whose footprints cover exactly 4x4 source pixels
+    const int source_width = 64;
+    const int source_height = 48;
+    RemapMap map = RemapMap::fromArea(16, 12, source_width, source_height, [](const std::vector<std::array<double, 2>>& pixels) {
+        std::vector<std::array<double, 2>> coordinates;
+        for (const std::array<double, 2>& p : pixels) {
+            coordinates.push_back({ 4.0 * p[0] + 1.5, 4.0 * p[1] + 1.5 });
+        }
+        return coordinates;
+    });
+    EXPECT_EQ(map.format(), MapFormat::Area);
+    EXPECT_EQ(map.interpolation(), RemapInterpolation::Area);
+    EXPECT_EQ(map.getAreaTaps().width(), 16 * 12 * 16);
+    EXPECT_THROW(map.setInterpolation(RemapInterpolation::Bilinear), std::invalid_argument);
+
+    Image<uint8_t> image8(source_width, source_height, 2);
+    Image<double> image64(source_width, source_height, 2);
+    for (int y = 0; y < source_height; ++y) {
+        for (int x = 0; x < source_width; ++x) {
+            for (int c = 0; c < 2; ++c) {
+                image8(x, y, c) = static_cast<uint8_t>((x * 37 + y * 101 + c * 59) % 256);
+                image64(x, y, c) = image8(x, y, c);
+            }
+        }
+    }
+    Image<uint8_t> output8(16, 12, 2);
+    Image<double> output64(16, 12, 2);
+    map.remap(image8.view(), output8.view());
+    map.remap(image64.view(), output64.view());
+
+    for (int y = 0; y < 12; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            for (int c = 0; c < 2; ++c) {
+                int sum = 0;
+                for (int j = 0; j < 4; ++j) {
+                    for (int i = 0; i < 4; ++i) {
+                        sum += image8(4 * x + i, 4 * y + j, c);
+                    }
+                }
+                ASSERT_EQ(output8(x, y, c), (sum + 8) / 16) << "at (" << x << ", " << y << ")";
+                ASSERT_NEAR(output64(x, y, c), sum / 16.0, 1e-12) << "at (" << x << ", " << y << ")";
+            }
+        }
+    }
+}
+
+TEST(RemapperTest, areamap_magnifyingmap_matchesbilinear) {
+    // createRotatedMap magnifies the source, so every footprint is a single bilinear sample
+    const int source_width = 50;
+    const int source_height = 40;
+    RemapMap bilinear = createRotatedMap(source_width, source_height, MapFormat::Float64);
+    RemapMap area = RemapMap::fromArea(bilinear.width(), bilinear.height(), source_width, source_height, [](const std::vector<std::array<double, 2>>& pixels) {
+        std::vector<std::array<double, 2>> coordinates;
+        for (const std::array<double, 2>& p : pixels) {
+            coordinates.push_back({ -6.0 + 0.4 * p[0] + 0.05 * p[1], -4.0 + 0.5 * p[1] - 0.03 * p[0] });
+        }
+        return coordinates;
+    });
+    EXPECT_EQ(area.region().counts[0], bilinear.region().counts[0]);
+    EXPECT_EQ(area.validRect().width, bilinear.validRect().width);
+
+    Image<double> image(source_width, source_height, 3);
+    for (int y = 0; y < source_height; ++y) {
+        for (int x = 0; x < source_width; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                image(x, y, c) = 100.0 + 90.0 * std::sin(0.3 * x - 0.2 * y + c);
+            }
+        }
+    }
+    Image<double> expected(area.width(), area.height(), 3);
+    Image<double> rows(area.width(), area.height(), 3);
+    Image<double> tiles(area.width(), area.height(), 3);
+    bilinear.remap(image.view(), expected.view());
+    area.remap(image.view(), rows.view());
+    area.remap(image.view(), tiles.view(), area.planTiles(3 * sizeof(double), 2048));
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_NEAR(rows.data()[i], expected.data()[i], 0.01) << "at index " << i;
+        ASSERT_EQ(tiles.data()[i], rows.data()[i]) << "at index " << i;
+    }
+}
+
+TEST(RemapperTest, undistort_areaoutputscale_filterscheckerboard) {
+    auto camera = createDistortedCamera();
+    RemapperOptions options;
+    options.output_scale = 0.25;
+    Remapper bilinear(camera, options);
+    options.interpolation = RemapInterpolation::Area;
+    Remapper area(camera, options);
+    EXPECT_EQ(area.targetWidth(), 160);
+    EXPECT_EQ(area.targetHeight(), 120);
+    RemapperOptions invalid;
+    invalid.output_scale = 0.0;
+    EXPECT_THROW(Remapper(camera, invalid), std::invalid_argument);
+
+    // a checkerboard of single pixels averages to mid grey, while sparse bilinear samples alias
+    Image<uint8_t> checkerboard(640, 480);
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            checkerboard(x, y) = (x + y) % 2 ? 255 : 0;
+        }
+    }
+    Image<uint8_t> filtered = area.undistort(checkerboard.view());
+    Image<uint8_t> aliased = bilinear.undistort(checkerboard.view());
+    ASSERT_EQ(filtered.width(), 160);
+    double filteredError = 0.0, aliasedError = 0.0;
+    int compared = 0;
+    for (int y = 10; y < 110; ++y) {
+        for (int x = 10; x < 150; ++x) {
+            filteredError = std::max(filteredError, std::abs(filtered(x, y) - 127.5));
+            aliasedError = std::max(aliasedError, std::abs(aliased(x, y) - 127.5));
+            ++compared;
+        }
+    }
+    EXPECT_GT(compared, 0);
+    EXPECT_LT(filteredError, 20.0);
+    EXPECT_GT(aliasedError, 60.0);
+
+    // composing keeps the scaled chain without scaling it again
+    Remapper cropped(area, PixelTransform::crop(0, 0, 80, 60));
+    EXPECT_EQ(cropped.targetWidth(), 80);
+    EXPECT_EQ(cropped.getUndistortMap().format(), MapFormat::Area);
+}
+
+namespace {
+
+// compares every 5th coordinate of two maps, NaN must match NaN
+void expectSameCoordinates(const RemapMap& actual, const RemapMap& expected, double tolerance) {
+    ASSERT_EQ(actual.width(), expected.width());
+    ASSERT_EQ(actual.height(), expected.height());
+    for (int y = 0; y < expected.height(); y += 5) {
+        for (int x = 0; x < expected.width(); x += 5) {
+            const std::array<double, 2> a = actual.coordinate(x, y);
+            const std::array<double, 2> e = expected.coordinate(x, y);
+            for (int i = 0; i < 2; ++i) {
+                if (std::isnan(e[i])) {
+                    ASSERT_TRUE(std::isnan(a[i])) << "at (" << x << ", " << y << ")";
+                }
+                else {
+                    ASSERT_NEAR(a[i], e[i], tolerance) << "at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    }
+}
+
+// Homography maps mark pixels behind the source camera instead of leaving them undefined, so only finite coordinates are compared
+void expectSameFiniteCoordinates(const RemapMap& actual, const RemapMap& expected) {
+    ASSERT_EQ(actual.width(), expected.width());
+    ASSERT_EQ(actual.height(), expected.height());
+    int compared = 0;
+    for (int y = 0; y < expected.height(); y += 3) {
+        for (int x = 0; x < expected.width(); x += 3) {
+            const std::array<double, 2> a = actual.coordinate(x, y);
+            const std::array<double, 2> e = expected.coordinate(x, y);
+            if (std::isfinite(e[0]) && std::isfinite(e[1])) {
+                ASSERT_NEAR(a[0], e[0], 1e-9) << "at (" << x << ", " << y << ")";
+                ASSERT_NEAR(a[1], e[1], 1e-9) << "at (" << x << ", " << y << ")";
+                ++compared;
+            }
+        }
+    }
+    EXPECT_GT(compared, expected.width() * expected.height() / 20);
+}
+
+} // namespace
+
+TEST(RemapperTest, copyandmove_builtmaps_keepmappingandstayindependent) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Camera> pinhole = camera->getPinhole();
+    const Remapper reference(camera, pinhole);
+    Remapper original(camera, pinhole);
+    original.getUndistortMap();
+
+    // copies share the built map, later updates of one leave the other alone
+    Remapper copy(original);
+    EXPECT_EQ(copy.getUndistortMap().getX().data(), original.getUndistortMap().getX().data());
+    copy.updateRotation(CommonMath::eulerToRot({ 0.0, 0.05, 0.0 }));
+    EXPECT_NE(copy.getUndistortMap().coordinate(300, 200)[0], original.getUndistortMap().coordinate(300, 200)[0]);
+    expectSameCoordinates(original.getUndistortMap(), reference.getUndistortMap(), 0.0);
+
+    auto make = [&original]() {
+        Remapper made(original);
+        return made;
+    };
+    Remapper moved(make());
+    std::vector<Remapper> remappers;
+    remappers.push_back(std::move(moved));
+    remappers.push_back(original);
+    remappers.emplace_back(camera, pinhole);
+    copy = remappers[1];
+    remappers[2] = std::move(copy);
+    for (const Remapper& remapper : remappers) {
+        expectSameCoordinates(remapper.getUndistortMap(), reference.getUndistortMap(), 0.0);
+        expectSameCoordinates(remapper.getDistortMap(), reference.getDistortMap(), 0.0);
+    }
+}
+
+TEST(RemapperTest, updaterotation_allformats_matchesnewremapper) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Camera> pinhole = camera->getPinhole();
+    ThreadPoolOptions pool_options;
+    pool_options.threads = 4;
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::Float32, MapFormat::ControlGrid }) {
+        for (double scale : { 1.0, 0.5 }) {
+            RemapperOptions options;
+            options.map_format = format;
+            options.output_scale = scale;
+            options.executor = std::make_shared<ThreadPool>(pool_options);
+            Remapper remapper(camera, pinhole, options);
+            remapper.getUndistortMap();
+            remapper.getDistortMap();
+
+            for (const Point3& angles : { Point3{ 0.01, -0.02, 0.03 }, Point3{ -0.05, 0.04, -0.1 } }) {
+                const Matrix3x3 rotation = CommonMath::eulerToRot(angles);
+                remapper.updateRotation(rotation);
+                Remapper expected(camera, pinhole, rotation, options);
+                expectSameCoordinates(remapper.getUndistortMap(), expected.getUndistortMap(), 1e-9);
+                expectSameCoordinates(remapper.getDistortMap(), expected.getDistortMap(), 1e-9);
+            }
+        }
+    }
+
+    // an update before the first build leaves the map to be built on first use
+    const Matrix3x3 rotation = CommonMath::eulerToRot({ 0.02, 0.0, 0.0 });
+    Remapper lazy(camera, pinhole);
+    lazy.updateRotation(rotation);
+    EXPECT_EQ(lazy.memoryUsage(), 0u);
+    expectSameCoordinates(lazy.getUndistortMap(), Remapper(camera, pinhole, rotation).getUndistortMap(), 1e-9);
+}
+
+TEST(RemapperTest, updatetargetintrinsics_zoom_matchesnewremapper) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Pinhole> pinhole = camera->getPinhole();
+    const Matrix3x3 rotation = CommonMath::eulerToRot({ 0.03, -0.01, 0.02 });
+    Remapper remapper(camera, pinhole, rotation);
+    remapper.getUndistortMap();
+
+    for (double zoom : { 1.5, 2.0, 0.8 }) {
+        const std::vector<double> focal = { 600.0 * zoom, 600.0 * zoom };
+        const std::vector<double> principal = { 330.0, 235.0 };
+        remapper.updateTargetIntrinsics(focal, principal, 0.5);
+        auto target = std::make_shared<Pinhole>(focal, principal, 0.5, std::vector<int>{ 640, 480 });
+        Remapper expected(camera, target, rotation);
+        expectSameCoordinates(remapper.getUndistortMap(), expected.getUndistortMap(), 1e-9);
+    }
+    // the target camera passed to the constructor keeps its intrinsics
+    EXPECT_EQ(pinhole->getFocalLength()[0], 600.0);
+    EXPECT_EQ(std::static_pointer_cast<Pinhole>(remapper.getTargetCamera())->getFocalLength()[0], 480.0);
+
+    EXPECT_THROW(remapper.updateTargetIntrinsics({ 0.0, 600.0 }, { 320.0, 240.0 }), std::invalid_argument);
+    Remapper distorted_target(camera, camera);
+    EXPECT_THROW(distorted_target.updateTargetIntrinsics({ 600.0, 600.0 }, { 320.0, 240.0 }), std::invalid_argument);
+}
+
+TEST(RemapperTest, updaterowrotations_beforeandafterfirstuse_identicalmaps) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Camera> pinhole = camera->getPinhole();
+    std::vector<Matrix3x3> rotations;
+    for (int b = 0; b < 16; ++b) {
+        rotations.push_back(CommonMath::eulerToRot({ 0.01 * b, -0.015 * b, 0.005 * b }));
+    }
+
+    // before first use the map is built from the target pixels, afterwards from the cached target rays
+    Remapper before(camera, pinhole);
+    before.updateRowRotations(rotations);
+    Remapper after(camera, pinhole);
+    after.getUndistortMap();
+    after.updateRowRotations(rotations);
+    expectSameCoordinates(after.getUndistortMap(), before.getUndistortMap(), 0.0);
+}
+
+TEST(RemapperTest, updaterowrotations_rollingshutter_matchesbandremappers) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Camera> pinhole = camera->getPinhole();
+    const int bands = 8;
+    std::vector<Matrix3x3> rotations;
+    for (int b = 0; b < bands; ++b) {
+        rotations.push_back(CommonMath::eulerToRot({ 0.002 * b, -0.003 * b, 0.001 * b }));
+    }
+
+    for (MapFormat format : { MapFormat::Float64, MapFormat::ControlGrid }) {
+        RemapperOptions options;
+        options.map_format = format;
+        Remapper remapper(camera, pinhole, options);
+        remapper.getUndistortMap();
+        remapper.updateRowRotations(rotations);
+        const RemapMap& undistortMap = remapper.getUndistortMap();
+        const RemapMap& distortMap = remapper.getDistortMap();
+
+        // every pixel matches the remapper of the band its source row lies in, away from the band edges
+        const double band_height = 480.0 / bands;
+        const double tolerance = format == MapFormat::ControlGrid ? options.control_grid.max_error * 2 : 1e-9;
+        std::vector<Remapper> references;
+        for (int b = 0; b < bands; ++b) {
+            references.emplace_back(camera, pinhole, rotations[b], options);
+        }
+        int compared = 0;
+        for (int y = 0; y < 480; y += 4) {
+            for (int x = 0; x < 640; x += 4) {
+                const std::array<double, 2> c = undistortMap.coordinate(x, y);
+                const double position = (c[1] + 0.5) / band_height;
+                if (std::isnan(c[1]) || std::abs(position - std::round(position)) * band_height < 2.0) {
+                    continue;
+                }
+                const int band = std::min(std::max(static_cast<int>(position), 0), bands - 1);
+                const std::array<double, 2> e = references[band].getUndistortMap().coordinate(x, y);
+                ASSERT_NEAR(c[0], e[0], tolerance) << "at (" << x << ", " << y << ")";
+                ASSERT_NEAR(c[1], e[1], tolerance) << "at (" << x << ", " << y << ")";
+                ++compared;
+
+                // the distort map rotates each source row with its own band
+                const std::array<double, 2> d = distortMap.coordinate(x, y);
+                const std::array<double, 2> r = references[std::min(y * bands / 480, bands - 1)].getDistortMap().coordinate(x, y);
+                if (!std::isnan(r[0])) {
+                    ASSERT_NEAR(d[0], r[0], tolerance) << "at (" << x << ", " << y << ")";
+                    ASSERT_NEAR(d[1], r[1], tolerance) << "at (" << x << ", " << y << ")";
+                }
+            }
+        }
+        EXPECT_GT(compared, 10000);
+    }
+
+    // identical bands equal a single rotation
+    Remapper rolling(camera, pinhole);
+    rolling.getUndistortMap();
+    rolling.updateRowRotations(std::vector<Matrix3x3>(bands, rotations[3]));
+    expectSameCoordinates(rolling.getUndistortMap(), Remapper(camera, pinhole, rotations[3]).getUndistortMap(), 1e-9);
+
+    EXPECT_THROW(rolling.updateRowRotations({}), std::invalid_argument);
+    EXPECT_THROW(rolling.updateRowRotations(std::vector<Matrix3x3>(481, rotations[0])), std::invalid_argument);
+    EXPECT_THROW(Remapper(Remapper(camera), rolling), std::invalid_argument);
+}
+
+TEST(RemapperTest, undistortfloat_allinterpolations_matchesdouble) {
+    auto camera = createDistortedCamera();
+    Image<double> image64(640, 480, 2);
+    Image<float> image32(640, 480, 2);
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            for (int c = 0; c < 2; ++c) {
+                image32(x, y, c) = static_cast<float>(std::sin(0.05 * x + 0.03 * y + c));
+                image64(x, y, c) = image32(x, y, c);
+            }
+        }
+    }
+
+    struct Setup { MapFormat format; RemapInterpolation interpolation; double scale; };
+    for (const Setup& setup : { Setup{ MapFormat::Float64, RemapInterpolation::Bilinear, 1.0 }, Setup{ MapFormat::FixedPoint, RemapInterpolation::Bilinear, 1.0 },
+                                Setup{ MapFormat::Float32, RemapInterpolation::Bicubic, 1.0 }, Setup{ MapFormat::Float64, RemapInterpolation::Nearest, 1.0 },
+                                Setup{ MapFormat::Float64, RemapInterpolation::Area, 0.5 } }) {
+        for (RemapExecution execution : { RemapExecution::Rows, RemapExecution::Tiles }) {
+            RemapperOptions options;
+            options.map_format = setup.format;
+            options.interpolation = setup.interpolation;
+            options.output_scale = setup.scale;
+            options.execution = execution;
+            Remapper remapper(camera, options);
+
+            // float pixels are read, interpolated and written in single precision
+            const Image<double> expected = remapper.undistort(image64.view());
+            const Image<float> output = remapper.undistort(image32.view());
+            Image<float> batch(expected.width(), expected.height(), 2);
+            remapper.undistortBatch({ image32.view() }, { batch.view() });
+            ASSERT_EQ(output.width(), expected.width());
+            for (int y = 0; y < expected.height(); ++y) {
+                for (int x = 0; x < expected.width(); ++x) {
+                    for (int c = 0; c < 2; ++c) {
+                        ASSERT_NEAR(output(x, y, c), expected(x, y, c), 1e-6) << "interpolation " << static_cast<int>(setup.interpolation) << " at (" << x << ", " << y << ")";
+                        ASSERT_EQ(batch(x, y, c), output(x, y, c));
+                    }
+                }
+            }
+        }
+    }
+
+    const Image<float> distorted = Remapper(camera).distort(image32.view());
+    EXPECT_EQ(distorted.width(), 640);
+}
+
+TEST(RemapperTest, undistortinto_integertofloat_matchesconvertedimage) {
+    auto camera = createDistortedCamera();
+    Image<uint8_t> image8 = createPatternImage(640, 480, 3);
+    Image<uint16_t> image16(640, 480, 3, ImageLayout::Planar);
+    Image<float> converted8(640, 480, 3);
+    Image<float> converted16(640, 480, 3);
+    for (int y = 0; y < 480; ++y) {
+        for (int x = 0; x < 640; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                image16(x, y, c) = static_cast<uint16_t>(257 * image8(x, y, c) + x);
+                converted8(x, y, c) = image8(x, y, c);
+                converted16(x, y, c) = image16(x, y, c);
+            }
+        }
+    }
+
+    struct Setup { MapFormat format; RemapInterpolation interpolation; double scale; };
+    for (const Setup& setup : { Setup{ MapFormat::Float64, RemapInterpolation::Bilinear, 1.0 }, Setup{ MapFormat::FixedPoint, RemapInterpolation::Bilinear, 1.0 },
+                                Setup{ MapFormat::Float32, RemapInterpolation::Bicubic, 1.0 }, Setup{ MapFormat::Float64, RemapInterpolation::Nearest, 1.0 },
+                                Setup{ MapFormat::Float64, RemapInterpolation::Area, 0.5 } }) {
+        for (RemapExecution execution : { RemapExecution::Rows, RemapExecution::Tiles }) {
+            RemapperOptions options;
+            options.map_format = setup.format;
+            options.interpolation = setup.interpolation;
+            options.output_scale = setup.scale;
+            options.execution = execution;
+            Remapper remapper(camera, options);
+
+            // the taps are converted exactly, the kernels then run the arithmetic of float images
+            const Image<float> expected8 = remapper.undistort(converted8.view());
+            const Image<float> expected16 = remapper.undistort(converted16.view());
+            Image<float> output8(expected8.width(), expected8.height(), 3, ImageLayout::Planar);
+            Image<float> output16(expected16.width(), expected16.height(), 3);
+            remapper.undistortInto(image8.view(), output8.view());
+            remapper.undistortInto(image16.view(), output16.view());
+            for (int y = 0; y < expected8.height(); ++y) {
+                for (int x = 0; x < expected8.width(); ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        ASSERT_EQ(output8(x, y, c), expected8(x, y, c)) << "interpolation " << static_cast<int>(setup.interpolation) << " at (" << x << ", " << y << ")";
+                        // 16-bit Area sums are exact integers, float images sum in single precision
+                        if (setup.interpolation == RemapInterpolation::Area) {
+                            ASSERT_NEAR(output16(x, y, c), expected16(x, y, c), 1e-6 * expected16(x, y, c));
+                        }
+                        else {
+                            ASSERT_EQ(output16(x, y, c), expected16(x, y, c)) << "interpolation " << static_cast<int>(setup.interpolation) << " at (" << x << ", " << y << ")";
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    Remapper remapper(camera);
+    Image<float> wrongSize(320, 240, 3);
+    EXPECT_THROW(remapper.undistortInto(image8.view(), wrongSize.view()), std::invalid_argument);
+    EXPECT_THROW(remapper.distortInto(image16.view(), wrongSize.view()), std::invalid_argument);
+}
+
+TEST(RemapperTest, mapbuild_anythreadcount_isdeterministic) {
+    auto camera = createDistortedCamera();
+    std::shared_ptr<Camera> pinhole = camera->getPinhole();
+    std::vector<Matrix3x3> rotations;
+    for (int b = 0; b < 6; ++b) {
+        rotations.push_back(CommonMath::eulerToRot({ 0.004 * b, -0.002 * b, 0.001 * b }));
+    }
+
+    std::vector<std::shared_ptr<Executor>> executors = { std::make_shared<InlineExecutor>() };
+    for (int threads : { 2, 3, 4 }) {
+        ThreadPoolOptions pool_options;
+        pool_options.threads = threads;
+        executors.push_back(std::make_shared<ThreadPool>(pool_options));
+    }
+
+    for (bool rolling : { false, true }) {
+        std::vector<Remapper> remappers;
+        for (const std::shared_ptr<Executor>& executor : executors) {
+            RemapperOptions options;
+            options.executor = executor;
+            remappers.emplace_back(camera, pinhole, options);
+            if (rolling) {
+                remappers.back().updateRowRotations(rotations);
+            }
+        }
+        // the maps are built in bands of rows, every pixel is mapped on its own
+        for (size_t i = 1; i < remappers.size(); ++i) {
+            expectSameCoordinates(remappers[i].getUndistortMap(), remappers[0].getUndistortMap(), 0.0);
+            expectSameCoordinates(remappers[i].getDistortMap(), remappers[0].getDistortMap(), 0.0);
+        }
+    }
+
+    // a dense map holds the projection of every target pixel ray
+    Remapper remapper(camera, pinhole);
+    const RemapMap& map = remapper.getUndistortMap();
+    for (int y = 0; y < 480; y += 37) {
+        for (int x = 0; x < 640; x += 41) {
+            const std::array<double, 2> expected = camera->project(pinhole->backproject(std::array<double, 2>{ static_cast<double>(x), static_cast<double>(y) }));
+            EXPECT_EQ(map.coordinate(x, y)[0], expected[0]);
+            EXPECT_EQ(map.coordinate(x, y)[1], expected[1]);
+        }
+    }
+}
+
+TEST(RemapperTest, homographymap_pinholetopinhole_matchesfloat64) {
+    auto source = std::make_shared<Pinhole>(std::vector<double>{ 520.0, 515.0 }, std::vector<double>{ 322.0, 241.0 }, 0.8, std::vector<int>{ 640, 480 });
+    auto target = std::make_shared<Pinhole>(std::vector<double>{ 450.0, 450.0 }, std::vector<double>{ 300.0, 220.0 }, 0.0, std::vector<int>{ 600, 440 });
+    const Matrix3x3 rotation = CommonMath::eulerToRot({ 0.03, -0.05, 0.1 });
+    const Image<uint8_t> image = createPatternImage(640, 480, 3);
+
+    for (double scale : { 1.0, 0.5 }) {
+        RemapperOptions options;
+        options.output_scale = scale;
+        Remapper expected(source, target, rotation, options);
+        options.map_format = MapFormat::Homography;
+        Remapper remapper(source, target, rotation, options);
+        EXPECT_TRUE(remapper.isHomography());
+        EXPECT_TRUE(expected.isHomography());
+
+        expectSameFiniteCoordinates(remapper.getUndistortMap(), expected.getUndistortMap());
+        expectSameFiniteCoordinates(remapper.getDistortMap(), expected.getDistortMap());
+        EXPECT_EQ(remapper.getUndistortMap().format(), MapFormat::Homography);
+        // source pixels outside the downscaled target image clip at the resize stage, so that distort map stays dense
+        EXPECT_EQ(remapper.getDistortMap().format(), scale == 1.0 ? MapFormat::Homography : MapFormat::Float64);
+        if (scale == 1.0) {
+            EXPECT_EQ(remapper.memoryUsage(), 0u);
+        }
+
+        // coordinates differ in the last bits only, so 8 bit results may round the other way
+        const Image<uint8_t> output = remapper.undistort(image.view());
+        const Image<uint8_t> reference = expected.undistort(image.view());
+        for (size_t i = 0; i < reference.size(); ++i) {
+            ASSERT_NEAR(output.data()[i], reference.data()[i], 1) << "index " << i;
+        }
+
+        // rotation updates and pixel transforms fold into the matrix
+        const Matrix3x3 update = CommonMath::eulerToRot({ -0.02, 0.04, 0.0 });
+        remapper.updateRotation(update);
+        expected.updateRotation(update);
+        expectSameFiniteCoordinates(remapper.getUndistortMap(), expected.getUndistortMap());
+        const PixelTransform crop = PixelTransform::crop(20, 10, 200, 150);
+        Remapper cropped(remapper, crop);
+        EXPECT_TRUE(cropped.isHomography());
+        expectSameFiniteCoordinates(cropped.getUndistortMap(), Remapper(expected, crop).getUndistortMap());
+    }
+
+    // pixels behind the source camera are outside instead of mirrored
+    const Matrix3x3 turn = CommonMath::eulerToRot({ 0.0, 1.4, 0.0 });
+    RemapperOptions options;
+    options.map_format = MapFormat::Homography;
+    Remapper wide(source, target, turn, options);
+    const Matrix3x3 inverse = CommonMath::rotationInverse(turn);
+    for (int x = 0; x < 600; x += 13) {
+        const Point3 ray = CommonMath::rotatePoint(target->backproject(std::array<double, 2>{ static_cast<double>(x), 220.0 }), inverse);
+        if (ray[2] < 0) {
+            EXPECT_EQ(wide.getUndistortMap().coordinate(x, 220)[0], -1.0);
+        }
+    }
+
+    // other cameras and row rotations have no homography
+    auto camera = createDistortedCamera();
+    EXPECT_FALSE(Remapper(camera, camera->getPinhole()).isHomography());
+    EXPECT_THROW(Remapper(camera, camera->getPinhole(), options), std::invalid_argument);
+    Remapper remapper(source, target, options);
+    EXPECT_THROW(remapper.updateRowRotations({ rotation, turn }), std::invalid_argument);
+    EXPECT_THROW(RemapMap(Image<double>(4, 4, 1), Image<double>(4, 4, 1), 4, 4, MapFormat::Homography), std::invalid_argument);
+}
+
+TEST(RemapperTest, homographymap_composedcrop_matchesfloat64) {
+    auto source = std::make_shared<Pinhole>(std::vector<double>{ 520.0, 515.0 }, std::vector<double>{ 322.0, 241.0 }, 0.0, std::vector<int>{ 640, 480 });
+    auto target = std::make_shared<Pinhole>(std::vector<double>{ 450.0, 450.0 }, std::vector<double>{ 300.0, 220.0 }, 0.0, std::vector<int>{ 600, 440 });
+    const Matrix3x3 rotation = CommonMath::eulerToRot({ 0.02, -0.03, 0.05 });
+    RemapperOptions options;
+    Remapper expected(source, target, rotation, options);
+    options.map_format = MapFormat::Homography;
+    Remapper remapper(source, target, rotation, options);
+
+    // crops inside the intermediate images keep the matrix, source pixels outside the crops clip in the distort direction
+    const PixelTransform inside = PixelTransform::crop(40, 30, 400, 300);
+    const PixelTransform second = PixelTransform::crop(100, 50, 300, 200);
+    Remapper cropped(Remapper(remapper, inside), second);
+    EXPECT_EQ(cropped.getUndistortMap().format(), MapFormat::Homography);
+    EXPECT_EQ(cropped.getDistortMap().format(), MapFormat::Float64);
+    expectSameFiniteCoordinates(cropped.getUndistortMap(), Remapper(Remapper(expected, inside), second).getUndistortMap());
+
+    // crops reaching past an intermediate image clip exactly like the dense map
+    auto expectSameMaps = [](const Remapper& actual, const Remapper& reference) {
+        EXPECT_TRUE(actual.isHomography());
+        for (RemapDirection direction : { RemapDirection::Undistort, RemapDirection::Distort }) {
+            const RemapMap& a = direction == RemapDirection::Undistort ? actual.getUndistortMap() : actual.getDistortMap();
+            const RemapMap& e = direction == RemapDirection::Undistort ? reference.getUndistortMap() : reference.getDistortMap();
+            EXPECT_EQ(a.format(), MapFormat::Float64);
+            ASSERT_EQ(a.width(), e.width());
+            ASSERT_EQ(a.height(), e.height());
+            for (int y = 0; y < e.height(); ++y) {
+                for (int x = 0; x < e.width(); ++x) {
+                    const std::array<double, 2> p = a.coordinate(x, y);
+                    const std::array<double, 2> q = e.coordinate(x, y);
+                    ASSERT_TRUE(p == q || (std::isnan(p[0]) && std::isnan(q[0]))) << "at (" << x << ", " << y << ")";
+                }
+            }
+        }
+    };
+    const PixelTransform outside = PixelTransform::crop(-30, -20, 660, 480);
+    const PixelTransform corner = PixelTransform::crop(0, 0, 300, 200);
+    expectSameMaps(Remapper(remapper, outside), Remapper(expected, outside));
+    expectSameMaps(Remapper(Remapper(remapper, outside), corner), Remapper(Remapper(expected, outside), corner));
+}
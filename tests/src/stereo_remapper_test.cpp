@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include "pixeltraq.h"
+#include "test_remap_helpers.h"
+
+namespace {
+
+std::shared_ptr<BrownConrady> createStereoTestCamera(const Point3& rotation, const Point3& translation, int width = 320) {
+    std::vector<double> focal_length = { 500.0, 505.0 };
+    std::vector<double> principal_point = { 162.0, 118.0 };
+    std::vector<int> image_size = { width, 240 };
+    return std::make_shared<BrownConrady>(focal_length, principal_point, image_size, std::vector<double>{ 0.1, -0.02 }, std::vector<double>{ 0.001, 0 }, std::vector<double>{ 0 }, rotation, translation);
+}
+
+} // namespace
+
+TEST(StereoRemapperTest, rectify_pair_matchesindividualremappers) {
+    auto left = createStereoTestCamera({ 0, 0, 0 }, { 0, 0, 0 });
+    auto right = createStereoTestCamera({ 0.02, -0.01, 0.005 }, { -0.1, 0.002, 0.001 });
+    StereoRemapper stereo(left, right);
+
+    Image<uint8_t> left8 = createRemapTestImage<uint8_t>(320, 240, 3, 0.0);
+    Image<uint8_t> right8 = createRemapTestImage<uint8_t>(320, 240, 3, 1.0);
+    Image<double> left64 = createRemapTestImage<double>(320, 240, 1, 0.0);
+    Image<double> right64 = createRemapTestImage<double>(320, 240, 1, 1.0);
+    std::pair<Image<uint8_t>, Image<uint8_t>> pair8 = stereo.rectify(left8.view(), right8.view());
+    std::pair<Image<double>, Image<double>> pair64 = stereo.rectify(left64.view(), right64.view());
+    ASSERT_EQ(pair8.first.width(), stereo.width());
+    ASSERT_EQ(pair8.second.height(), stereo.height());
+
+    Image<uint8_t> expectedL8(stereo.width(), stereo.height(), 3), expectedR8(stereo.width(), stereo.height(), 3);
+    Image<double> expectedL64(stereo.width(), stereo.height(), 1), expectedR64(stereo.width(), stereo.height(), 1);
+    stereo.left().getUndistortMap().remap(left8.view(), expectedL8.view());
+    stereo.right().getUndistortMap().remap(right8.view(), expectedR8.view());
+    stereo.left().getUndistortMap().remap(left64.view(), expectedL64.view());
+    stereo.right().getUndistortMap().remap(right64.view(), expectedR64.view());
+    for (size_t i = 0; i < expectedL8.size(); ++i) {
+        ASSERT_EQ(pair8.first.data()[i], expectedL8.data()[i]) << "left at index " << i;
+        ASSERT_EQ(pair8.second.data()[i], expectedR8.data()[i]) << "right at index " << i;
+    }
+    for (size_t i = 0; i < expectedL64.size(); ++i) {
+        ASSERT_EQ(pair64.first.data()[i], expectedL64.data()[i]) << "left at index " << i;
+        ASSERT_EQ(pair64.second.data()[i], expectedR64.data()[i]) << "right at index " << i;
+    }
+}
+
+TEST(StereoRemapperTest, rectifiedcamera_alignsrows_andtriangulates) {
+    auto left = createStereoTestCamera({ 0, 0, 0 }, { 0, 0, 0 });
+    auto right = createStereoTestCamera({ 0.02, -0.01, 0.005 }, { -0.1, 0.002, 0.001 });
+    const std::vector<Point3> points = { { 0.3, -0.2, 3.0 }, { -0.4, 0.25, 5.0 }, { 0.05, 0.1, 1.5 } };
+
+    for (double scale : { 1.0, 0.5 }) {
+        RemapperOptions options;
+        options.output_scale = scale;
+        StereoRemapper stereo(left, right, options);
+        EXPECT_NEAR(stereo.baseline(), std::sqrt(0.1 * 0.1 + 0.002 * 0.002 + 0.001 * 0.001), 1e-9);
+        EXPECT_EQ(stereo.rectifiedCamera()->getImageSize()[0], stereo.width());
+        EXPECT_EQ(stereo.width(), static_cast<int>(std::lround(320 * scale)));
+
+        for (const Point3& point : points) {
+            const Point3 pointL = CommonMath::rotatePoint(left->worldToCameraPnts(point), stereo.leftRotation());
+            const Point3 pointR = CommonMath::rotatePoint(right->worldToCameraPnts(point), stereo.rightRotation());
+            const Point2 pixelL = stereo.rectifiedCamera()->project(pointL);
+            const Point2 pixelR = stereo.rectifiedCamera()->project(pointR);
+
+            // epipolar lines are rows, and the rectified maps sample the source pixels of the point
+            EXPECT_NEAR(pixelL[1], pixelR[1], 1e-6);
+            const Point2 sourceL = left->project(left->worldToCameraPnts(point));
+            const Point2 sourceR = right->project(right->worldToCameraPnts(point));
+            const std::array<double, 2> sampledL = stereo.left().getUndistortMap().coordinateAt(pixelL[0], pixelL[1]);
+            const std::array<double, 2> sampledR = stereo.right().getUndistortMap().coordinateAt(pixelR[0], pixelR[1]);
+            EXPECT_NEAR(sampledL[0], sourceL[0], 0.05);
+            EXPECT_NEAR(sampledL[1], sourceL[1], 0.05);
+            EXPECT_NEAR(sampledR[0], sourceR[0], 0.05);
+            EXPECT_NEAR(sampledR[1], sourceR[1], 0.05);
+
+            const double disparity = pixelL[0] - pixelR[0];
+            EXPECT_NEAR(stereo.depth(disparity), pointL[2], 1e-6);
+            const Point3 triangulated = stereo.triangulate(pixelL[0], pixelL[1], disparity);
+            for (int i = 0; i < 3; ++i) {
+                EXPECT_NEAR(triangulated[i], pointL[i], 1e-6);
+            }
+        }
+        EXPECT_TRUE(std::isnan(stereo.depth(0.0)));
+    }
+}
+
+TEST(StereoRemapperTest, pinholepair_rectifiesbaseline) {
+    const std::vector<double> focal_length = { 500.0, 505.0 };
+    const std::vector<double> principal_point = { 162.0, 118.0 };
+    const std::vector<int> image_size = { 320, 240 };
+    auto left = std::make_shared<Pinhole>(focal_length, principal_point, 0.0, image_size);
+    auto right = std::make_shared<Pinhole>(focal_length, principal_point, 0.0, image_size, Point3{ 0.01, -0.02, 0.0 }, Point3{ -0.1, 0.0, 0.0 });
+    StereoRemapper stereo(left, right);
+    EXPECT_NEAR(stereo.baseline(), 0.1, 1e-9);
+
+    const Point3 point = { 0.3, -0.2, 3.0 };
+    const Point3 pointL = CommonMath::rotatePoint(left->worldToCameraPnts(point), stereo.leftRotation());
+    const Point3 pointR = CommonMath::rotatePoint(right->worldToCameraPnts(point), stereo.rightRotation());
+    const Point2 pixelL = stereo.rectifiedCamera()->project(pointL);
+    const Point2 pixelR = stereo.rectifiedCamera()->project(pointR);
+    EXPECT_NEAR(pixelL[1], pixelR[1], 1e-6);
+    EXPECT_NEAR(stereo.depth(pixelL[0] - pixelR[0]), pointL[2], 1e-6);
+}
+
+TEST(StereoRemapperTest, invalidarguments_throw) {
+    auto left = createStereoTestCamera({ 0, 0, 0 }, { 0, 0, 0 });
+    auto right = createStereoTestCamera({ 0.02, -0.01, 0.005 }, { -0.1, 0.002, 0.001 });
+    EXPECT_THROW(StereoRemapper(left, createStereoTestCamera({ 0, 0, 0 }, { -0.1, 0, 0 }, 400)), std::invalid_argument);
+    EXPECT_THROW(StereoRemapper(left, createStereoTestCamera({ 0.02, 0, 0 }, { 0, 0, 0 })), std::invalid_argument);
+
+    StereoRemapper stereo(left, right);
+    Image<uint8_t> image = createRemapTestImage<uint8_t>(320, 240, 1, 0.0);
+    Image<uint8_t> output(stereo.width(), stereo.height());
+    Image<uint8_t> wrong(100, 100);
+    EXPECT_THROW(stereo.rectify(image.view(), ImageView<const uint8_t>()), std::invalid_argument);
+    EXPECT_THROW(stereo.rectifyInto(image.view(), image.view(), output.view(), wrong.view()), std::invalid_argument);
+}